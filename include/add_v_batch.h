@@ -0,0 +1,38 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Batch mode : a manifest holds one job per line, written as the options of
+ * a single add_vector run, e.g.
+ *         -f x0.txt -f y0.txt -e "a+b" -o sum0.txt
+ *         -f m.txt -p 1,0 -o mt.txt -d double -s ',\n'
+ * Blank lines and lines starting with '#' are skipped, quotes group words and
+ * \n, \t, \\ are unescaped. -d and -s given with -b are the defaults of jobs
+ * that leave them out; -H and -M apply to the whole process and are rejected
+ * on job lines. Jobs share the process and its thread pool : each job runs on
+ * one pool thread, so many small jobs run concurrently.
+ */
+typedef api_Err_Status (*Batch_Job_Fn)( Program_Options * );
+
+api_Err_Status batch_run( char *, Program_Options *, Batch_Job_Fn );
+api_Err_Status batch_line_options( char *, char *, Program_Options *, Program_Options *, uint32_t * );
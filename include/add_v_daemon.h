@@ -0,0 +1,45 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Daemon mode : serve jobs on a unix stream socket from one resident process.
+ * A request is one line in manifest syntax (see add_v_batch.h), e.g.
+ *         -f x.txt -f y.txt -e "a*b+1"
+ * and is answered with one line :
+ *         OK <shm-name> <type> <no_dims> <dims, outermost first> <bytes>
+ *         ERR <api_Err_Status>
+ * The result is copied into the POSIX shared memory object <shm-name>
+ * (mode 0600, laid out as in shm_array.h : <bytes> of values after the
+ * header), which the client maps and then shm_unlink()s. Input arrays
+ * stay resident in an Array_Cache between requests, bounded by
+ * HETERO_CACHE_MB (default 1024 MiB). Requests with -l map their files once
+ * and parse only the blocks of records their slices touch; those blocks
+ * count against the same bound. The lines
+ * "stats" and "shutdown" query the cache counters and stop the daemon.
+ */
+typedef struct __Daemon_Reply__ Daemon_Reply ;
+
+typedef api_Err_Status (*Daemon_Job_Fn)( Program_Options *, Array_Cache *, Daemon_Reply * );
+
+api_Err_Status daemon_run( char *, Program_Options *, Daemon_Job_Fn );
+api_Err_Status daemon_reply_array( Daemon_Reply *, void *, Vector_MetaData * );
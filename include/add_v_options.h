@@ -20,10 +20,29 @@
  * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define MAX_INPUT_FILES  26      /* inputs are named 'a'..'z' in expressions */
+
 typedef struct __Program_Options__
 {
-    uint8_t *file ;
+    uint8_t *file[MAX_INPUT_FILES] ;
+    uint32_t no_files ;
+    uint8_t *sparse[MAX_INPUT_FILES] ;   /* index:value inputs added to the result */
+    uint32_t no_sparse ;
     uint8_t *sep ;
+    uint8_t *expr ;
+    uint8_t *perm ;
+    uint32_t in_place ;                  /* expression result is written over input a */
+    uint32_t ragged ;                    /* inputs have rows of varying length */
+    uint32_t strict ;                    /* check every value, see parse_set_strict() */
+    int32_t hugepages ;                  /* Huge_Policy for the process, -1 : HETERO_HUGEPAGES */
+    uint64_t mem_limit ;                 /* bytes for the process, 0 : HETERO_MEM_LIMIT */
+    uint32_t slice ;                     /* only records slice_first.. of the outermost axis */
+    uint64_t slice_first ;
+    uint64_t slice_count ;               /* 0 : to the end */
+    uint8_t *output ;                    /* result file, stdout when NULL */
+    uint8_t *shm_prefix ;                /* inputs and results go to shared memory under this name */
+    uint8_t *batch ;                     /* manifest of jobs, one per line */
+    uint8_t *daemon ;                    /* unix socket to serve requests on */
     Data_Type type ; 
 } Program_Options ;
 
@@ -0,0 +1,59 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Resident arrays read by read_data(), for long-running processes. An entry
+ * is keyed by file path, data-type and separators, and is valid for the
+ * file's modification time, size and inode. When those change but the
+ * bytes hash to the value recorded while parsing (Vector_MetaData.text_hash),
+ * the entry is kept; otherwise the file is read again. An entry read
+ * leniently is read again for a thread in strict mode (parse_set_strict()). Callers borrow arrays with cache_get() and hand them back with
+ * cache_put(); unreferenced entries are evicted, least recently used first,
+ * when the cache holds more than its budget. Borrowed arrays are shared and
+ * must not be modified. cache_get_range() copies slices of files that are
+ * mapped and parsed lazily (lazy_array.h) : repeated slices of one file only
+ * parse the blocks of records no earlier slice touched. Their parsed blocks
+ * count against the same budget, and the least recently used array or
+ * file's blocks are evicted first.
+ */
+typedef struct __Array_Cache__ Array_Cache ;
+
+typedef struct __Cache_Stats__
+{
+    uint64_t hits ;
+    uint64_t misses ;
+    uint64_t evictions ;
+    uint64_t bytes ;             /* payload held : arrays and parsed blocks */
+    uint32_t entries ;
+    uint64_t blocks ;            /* parsed blocks held for slices */
+    uint64_t block_hits ;
+    uint64_t block_misses ;
+} Cache_Stats ;
+
+
+api_Err_Status cache_create( Array_Cache **, uint64_t );
+api_Err_Status cache_get( Array_Cache *, char *, uint8_t *, void **, Vector_MetaData * );
+api_Err_Status cache_get_range( Array_Cache *, char *, uint8_t *, uint64_t, uint64_t, void **, Vector_MetaData * );
+void cache_put( Array_Cache *, void * );
+void cache_stats( Array_Cache *, Cache_Stats * );
+void cache_destroy( Array_Cache ** );
@@ -0,0 +1,44 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* what to tune, bits of Autotune_Options.what */
+#define TUNE_READ       (1u << 0)
+#define TUNE_THREADS    (1u << 1)
+#define TUNE_EXPR       (1u << 2)
+#define TUNE_STENCIL    (1u << 3)
+#define TUNE_GEMM       (1u << 4)
+
+typedef struct __Autotune_Options__
+{
+    uint8_t *file ;          /* sample input for the read sweep */
+    uint8_t *sep ;
+    Data_Type type ;
+    uint32_t what ;
+    uint64_t edge ;          /* stencil volume edge */
+    uint64_t mat ;           /* square matrix size */
+    uint64_t items ;         /* element-wise vector length */
+    uint32_t reps ;
+    uint32_t dry_run ;       /* report winners without saving them */
+} Autotune_Options ;
+
+api_Err_Status parse_autotune_cmdline( int , char ** , Autotune_Options * );
+void clean_autotune_opts( Autotune_Options * );
@@ -0,0 +1,43 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Sustainable memory bandwidth probes (STREAM methodology : arrays much
+ * larger than the last level cache, best of several repetitions, bytes
+ * counted are the bytes the kernel reads and writes)
+ */
+#define BW_DEFAULT_BYTES   (256ULL * 1024 * 1024)    /* per array */
+#define BW_DEFAULT_REPS    5
+
+typedef enum __Bw_Kernel__
+{
+    Bw_Copy         =  0 ,   /* c = a           : 16 bytes per element */
+    Bw_Scale             ,   /* b = s * c       : 16 bytes per element */
+    Bw_Add               ,   /* c = a + b       : 24 bytes per element */
+    Bw_Triad             ,   /* a = b + s * c   : 24 bytes per element */
+    Bw_MaxKernels
+} Bw_Kernel ;
+
+const char *bw_kernel_name( Bw_Kernel );
+double bw_stream( Bw_Kernel, Thread_Pool *, uint64_t, uint32_t );
+double bw_stream_copy( uint64_t, uint32_t );
@@ -34,10 +34,20 @@ typedef enum __Supported_Data_Type__
     DataType_float           ,
     DataType_double          ,
     DataType_long_double     ,
+    DataType_float16         ,   /* IEEE binary16, stored as uint16_t */
+    DataType_bfloat16        ,   /* upper half of binary32, stored as uint16_t */
     DataType_MaxTypes          /* Sentinel value for error checking */
 } Data_Type ;
 
 
+/*!
+ * Dimensions of an array. The rank-specific views alias shape[], which
+ * holds the extent of every axis outermost first for any rank up to
+ * DATA_MAX_DIMS : items = shape[0], rows,cols = shape[0..1] and
+ * dim_z,dim_y,dim_x = shape[0..2]. Extents past no_dims are not defined.
+ */
+#define DATA_MAX_DIMS   8
+
 typedef struct __Data_Dimensions_1D__
 {
     uint64_t items ;     /* Number of entries in the data-set */
@@ -52,9 +62,9 @@ typedef struct __Data_Dimensions_2D__
 
 typedef struct __Data_Dimensions_3D__
 {
-    uint64_t dim_x ;     /* Number of entries in the data-set */
-    uint64_t dim_y ;     /* dimension of each data vector */
     uint64_t dim_z ;
+    uint64_t dim_y ;     /* dimension of each data vector */
+    uint64_t dim_x ;     /* Number of entries in the data-set */
 } Data_Dim_3D ;
 
 
@@ -64,6 +74,7 @@ typedef union __Data_Dimensions__
     Data_Dim_1D dim_1d ;
     Data_Dim_2D dim_2d ;
     Data_Dim_3D dim_3d ;
+    uint64_t shape[DATA_MAX_DIMS] ;
 } Data_Dimensions ;
 
 
@@ -72,12 +83,32 @@ typedef struct __Vector_MetaData__
     Data_Type type ;
     uint32_t no_dims ;
     Data_Dimensions dim ;
+    uint64_t text_hash ; /* hash_bytes() of the file as stored, 0 when not read from a file */
+    uint64_t data_hash ; /* hash_bytes() of the values after parsing, 0 when unknown */
 } Vector_MetaData ;
 
 
 #define LINE_SIZE 4096
 
+/* memory for the values of an array whose dimensions have just been detected */
+typedef void *(*Data_Place_Fn)( void *, Vector_MetaData * );
+
 uint32_t sizeof_datatype( Data_Type type );
+const char *datatype_name( Data_Type type );
 api_Err_Status read_data( void **, Vector_MetaData *, char *, uint8_t *);
+api_Err_Status read_data_placed( void **, Vector_MetaData *, char *, uint8_t *, Data_Place_Fn, void * );
+api_Err_Status read_data_range( void **, Vector_MetaData *, char *, uint8_t *, uint64_t, uint64_t );
+api_Err_Status parse_records( void **, Vector_MetaData *, uint8_t *, uint8_t *, char *, uint64_t, uint32_t );
+api_Err_Status read_text( uint8_t **, uint64_t *, char *);
+api_Err_Status convert_number( uint8_t *, Data_Type, void *, uint64_t );
+void parse_set_strict( int32_t );
+uint32_t parse_strict( void );
 api_Err_Status clean_data( void **, Vector_MetaData *);
+api_Err_Status alloc_data( void **, Vector_MetaData *);
+api_Err_Status wrap_data( void **, Vector_MetaData *, void * );
+api_Err_Status unwrap_data( void **, Vector_MetaData * );
+void *data_payload( void *, Vector_MetaData *);
+uint64_t data_items( Vector_MetaData *);
+void data_strides( Vector_MetaData *, uint64_t * );
+uint32_t data_same_shape( Vector_MetaData *, Vector_MetaData * );
 
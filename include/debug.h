@@ -1,21 +1,21 @@
-/* 
+/*!
  * This program is a set of examples about how to use openCL for use in
  * heterogeneous programs
  * Copyright (C) 2017  Dejice Jacob
- * 
- * 
+ *
+ *
  * This file is part of hetero-examples.
- * 
+ *
  * hetero-examples is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 2 of the License, or
  * (at your option) any later version.
- * 
+ *
  * hetero-examples is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
- * 
+ *
  * You should have received a copy of the GNU General Public License
  * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
  */
@@ -34,12 +34,40 @@ typedef enum __Debug_Levels__
     err_level_Max
 } Debug_Level ;
 
-#define DEFAULT_TRACE_LEVEL   err_level_error
+/* messages below TRACE_LEVEL are compiled out (make TRACE=<level>) */
+#define DEFAULT_TRACE_LEVEL   err_level_dbg
 
 #ifndef TRACE_LEVEL
   #define TRACE_LEVEL  DEFAULT_TRACE_LEVEL
 #endif
 
+/* messages below the runtime level are skipped : HETERO_LOG_LEVEL overrides */
+#define DEFAULT_LOG_LEVEL     err_level_info
 
+extern int g_log_level ;
 
-#define debug( format , args... )  printf("[%s:%d] | "format"\r\n" , __FUNCTION__ , __LINE__ , ##args )
+void log_write( int, const char *, int, const char *, ... ) __attribute__((format(printf, 4, 5))) ;
+void log_flush( void );
+void log_shutdown( void );
+
+
+/*!
+ * Messages are formatted by the calling thread into its own ring and written
+ * to stdout, in order, by a background thread; callers never take the stdio
+ * lock. log_flush() writes everything queued so far, e.g. before printing
+ * results on stdout. HETERO_LOG_SYNC=1 writes messages as they are made.
+ */
+#define log_at( level , format , args... )                                          \
+    do {                                                                            \
+        if(((level) >= TRACE_LEVEL) && ((level) >= g_log_level))                    \
+            log_write((level), __FUNCTION__ , __LINE__ , format , ##args );         \
+    } while( 0 )
+
+#define log_dbg( format , args... )    log_at( err_level_dbg      , format , ##args )
+#define log_info( format , args... )   log_at( err_level_info     , format , ##args )
+#define log_warn( format , args... )   log_at( err_level_warn     , format , ##args )
+#define log_error( format , args... )  log_at( err_level_error    , format , ##args )
+#define log_critical( format , args... ) log_at( err_level_critical , format , ##args )
+#define log_fatal( format , args... )  log_at( err_level_fatal    , format , ##args )
+
+#define debug( format , args... )      log_info( format , ##args )
@@ -0,0 +1,42 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Compressed inputs. read_text() recognises zstd and lz4 frames by their
+ * magic number and inflates them straight into the text buffer the parsers
+ * work on. Independent frames (and independent lz4 blocks) are inflated in
+ * parallel on the thread pool. Support is compiled in with make ZSTD=1 and
+ * make LZ4=1 respectively
+ */
+typedef enum __Compress_Format__
+{
+    Compress_None       =  0 ,
+    Compress_Zstd            ,
+    Compress_Lz4             ,
+    Compress_MaxFormats
+} Compress_Format ;
+
+
+Compress_Format compress_format( const uint8_t *, uint64_t );
+const char *compress_name( Compress_Format );
+api_Err_Status decompress_text( uint8_t **, uint64_t *, const uint8_t *, uint64_t, char * );
@@ -0,0 +1,69 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Lazy element-wise expressions over arrays returned by read_data().
+ * An expression is first built as a tree, then evaluated in a single fused
+ * pass: the tree is compiled to a short register program which is run over
+ * cache-sized blocks of the operands, so no full-size temporaries are
+ * created and every operand is streamed from memory exactly once.
+ * Operands of other shapes are broadcast NumPy style (see
+ * expr_result_meta()) : they are gathered block by block from cache and
+ * never expanded to the size of the result. Integer division by zero gives
+ * 0 rather than trapping; expr_evaluate() counts such divisions and warns
+ * once per evaluation. Floating-point division follows IEEE (inf, nan).
+ */
+typedef enum __Expr_Op__
+{
+    Expr_Leaf       =  0 ,   /* operand array */
+    Expr_Const           ,   /* scalar constant */
+    Expr_Add             ,
+    Expr_Sub             ,
+    Expr_Mul             ,
+    Expr_Div             ,
+    Expr_Neg             ,
+    Expr_MaxOps
+} Expr_Op ;
+
+
+typedef struct __Expr_Node__
+{
+    Expr_Op op ;
+    struct __Expr_Node__ *lhs ;     /* operand of unary / left of binary ops */
+    struct __Expr_Node__ *rhs ;     /* right operand of binary ops */
+    void *data ;                    /* Expr_Leaf : array from read_data() */
+    Vector_MetaData *meta ;         /* Expr_Leaf : meta-data of the array */
+    double value ;                  /* Expr_Const : value */
+} Expr_Node ;
+
+
+#define EXPR_MAX_OPERANDS   26      /* operands are named 'a'..'z' */
+
+api_Err_Status expr_leaf( Expr_Node **, void *, Vector_MetaData * );
+api_Err_Status expr_const( Expr_Node **, double );
+api_Err_Status expr_unary( Expr_Node **, Expr_Op, Expr_Node * );
+api_Err_Status expr_binary( Expr_Node **, Expr_Op, Expr_Node *, Expr_Node * );
+api_Err_Status expr_parse( Expr_Node **, char *, void **, Vector_MetaData *, uint32_t );
+api_Err_Status expr_result_meta( Expr_Node *, Vector_MetaData * );
+api_Err_Status expr_evaluate( Expr_Node *, void *, Vector_MetaData * );
+void expr_free( Expr_Node ** );
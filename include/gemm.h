@@ -0,0 +1,48 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Dense matrix multiply C = A x B on 2D arrays from read_data()
+ * (buff[row][col]). float and double multiply in their own type, int8 and
+ * int16 inputs accumulate into an int32 result, which wraps modulo 2^32
+ * when a sum does not fit.
+ */
+
+/*!
+ * Cache blocking. Zero selects the value tuned for this machine (see
+ * tune_db.h), else the default for the data-type.
+ * mc x kc block of A stays in L2, kc x nr panel of B in L1,
+ * kc x nc block of B in the last level cache
+ */
+typedef struct __Gemm_Blocking__
+{
+    uint32_t mc ;
+    uint32_t kc ;
+    uint32_t nc ;
+} Gemm_Blocking ;
+
+
+void gemm_tune_knob( char *, size_t, Data_Type, const char * );
+api_Err_Status gemm_result_meta( Vector_MetaData *, Vector_MetaData *, Vector_MetaData * );
+api_Err_Status gemm( void *, Vector_MetaData *, void *, Vector_MetaData *, void *, Vector_MetaData *, Gemm_Blocking * );
+api_Err_Status gemm_reference( void *, Vector_MetaData *, void *, Vector_MetaData *, void *, Vector_MetaData * );
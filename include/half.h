@@ -0,0 +1,40 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * 16-bit floating point storage types. Values are stored as uint16_t and
+ * widened to float for arithmetic :
+ *  float16  - IEEE 754 binary16 : 1 sign, 5 exponent, 10 mantissa bits
+ *  bfloat16 - upper half of a binary32 : 1 sign, 8 exponent, 7 mantissa bits
+ * Narrowing rounds to nearest even. The array conversions use F16C or
+ * AVX-512 when the executing CPU has them.
+ */
+float half_to_f32( uint16_t );
+uint16_t f32_to_half( float );
+float bf16_to_f32( uint16_t );
+uint16_t f32_to_bf16( float );
+
+void half_to_float( float *, const uint16_t *, uint64_t );
+void float_to_half( uint16_t *, const float *, uint64_t );
+void bfloat16_to_float( float *, const uint16_t *, uint64_t );
+void float_to_bfloat16( uint16_t *, const float *, uint64_t );
@@ -0,0 +1,47 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * 64-bit non-cryptographic content hash. The algorithm is XXH3-64 with seed 0
+ * and the default secret, so a value can be checked with `xxhsum -H3`. The
+ * state is streaming : any split of the input into hash_update() calls gives
+ * the same value, and hash_digest() may be taken at any point. Inputs are
+ * read as little-endian 64-bit words.
+ */
+#define HASH_STRIPE     64
+#define HASH_BLOCK      1024         /* 16 stripes, scrambled after each block */
+
+typedef struct __Hash_State__
+{
+    uint64_t acc[8] ;
+    uint64_t total ;                 /* bytes fed so far */
+    uint64_t buffered ;              /* bytes waiting at buff + HASH_STRIPE */
+    uint8_t buff[HASH_STRIPE + HASH_BLOCK] ;  /* tail of the last block, then pending input */
+} Hash_State ;
+
+
+void hash_init( Hash_State * );
+void hash_update( Hash_State *, const void *, uint64_t );
+uint64_t hash_digest( Hash_State * );
+uint64_t hash_bytes( const void *, uint64_t );
+api_Err_Status hash_file( char *, uint64_t * );
@@ -0,0 +1,85 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Splits an element-wise or reduction job over 1D payloads between the
+ * native thread pool and a device queue. Both sides pull chunks from a
+ * shared cursor; chunk sizes follow guided self-scheduling weighted by the
+ * throughput each side has measured so far, so both run out of work at
+ * about the same time.
+ */
+typedef enum __Hetero_Op__
+{
+    Hetero_Add      =  0 ,   /* out[i] = a[i] + b[i] */
+    Hetero_Sum           ,   /* sum = a[0] + ... + a[items-1] */
+    Hetero_MaxOps
+} Hetero_Op ;
+
+
+typedef enum __Hetero_Device_Type__
+{
+    Hetero_Dev_None     =  0 ,   /* thread pool only */
+    Hetero_Dev_Host          ,   /* device emulated by one extra host thread */
+    Hetero_Dev_OpenCL        ,   /* OpenCL queue, needs a build with OPENCL=1 */
+    Hetero_Dev_MaxTypes
+} Hetero_Device_Type ;
+
+
+typedef struct __Hetero_Job__
+{
+    Hetero_Op op ;
+    Data_Type type ;
+    uint64_t items ;
+    const void *a ;          /* contiguous payloads, see data_payload() */
+    const void *b ;          /* Hetero_Add only */
+    void *out ;              /* Hetero_Add only */
+    double sum ;             /* Hetero_Sum result */
+} Hetero_Job ;
+
+
+/* which side ran the work */
+#define HETERO_AGENT_CPU     0
+#define HETERO_AGENT_DEV     1
+#define HETERO_AGENTS        2
+
+#define HETERO_USE_CPU       (1u << HETERO_AGENT_CPU)
+#define HETERO_USE_DEV       (1u << HETERO_AGENT_DEV)
+
+#define HETERO_MIN_CHUNK     (64 * 1024)   /* items, also the size of the probing chunks */
+
+typedef struct __Hetero_Stats__
+{
+    uint64_t items[HETERO_AGENTS] ;
+    uint64_t chunks[HETERO_AGENTS] ;
+    double busy[HETERO_AGENTS] ;     /* seconds spent running chunks */
+    double rate[HETERO_AGENTS] ;     /* last throughput estimate, items/s */
+    double secs ;                    /* wall time of the whole job */
+} Hetero_Stats ;
+
+
+typedef struct __Hetero_Device__ Hetero_Device ;
+
+api_Err_Status hetero_device_open( Hetero_Device **, Hetero_Device_Type );
+void hetero_device_close( Hetero_Device ** );
+const char *hetero_device_name( Hetero_Device * );
+api_Err_Status hetero_run( Hetero_Job *, Hetero_Device *, uint32_t, uint64_t, Hetero_Stats * );
@@ -0,0 +1,37 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+typedef struct __Hetero_Split_Options__
+{
+    uint8_t *file_a ;            /* 1D inputs. NULL : generate vectors */
+    uint8_t *file_b ;            /* second operand of add */
+    uint8_t *sep ;
+    Data_Type type ;
+    Hetero_Op op ;
+    Hetero_Device_Type device ;
+    uint64_t items ;             /* size of generated vectors */
+    uint64_t min_chunk ;
+    uint32_t verify ;
+} Hetero_Split_Options ;
+
+api_Err_Status parse_hetero_split_cmdline( int , char ** , Hetero_Split_Options * );
+void clean_hetero_split_opts( Hetero_Split_Options * );
@@ -0,0 +1,73 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Allocation of large buffers (file text, array values) on huge pages, to
+ * cut TLB misses while parsing and computing multi-GB inputs. The policy is
+ * process-wide, set with huge_set_policy() or HETERO_HUGEPAGES :
+ *   off      - malloc()/calloc()
+ *   thp      - 2 MiB aligned anonymous mappings advised MADV_HUGEPAGE
+ *   explicit - MAP_HUGETLB from the reserved pool, 1 GiB pages for buffers
+ *              of 1 GiB or more, else 2 MiB; falls back to thp, then malloc
+ * Buffers below HUGE_MIN_BYTES always come from malloc(). Every buffer from
+ * huge_alloc() is released with huge_free(), which also accepts malloc()'d
+ * pointers. Buffers from huge_alloc() are accounted by stage, see
+ * mem_track.h.
+ */
+#define HUGE_PAGE_2M       (2ULL << 20)
+#define HUGE_PAGE_1G       (1ULL << 30)
+#define HUGE_MIN_BYTES     HUGE_PAGE_2M
+
+typedef enum __Huge_Policy__
+{
+    Huge_Off       =  0 ,
+    Huge_THP            ,
+    Huge_Explicit       ,
+    Huge_MaxPolicies
+} Huge_Policy ;
+
+typedef enum __Huge_Kind__
+{
+    Huge_Small     =  0 ,        /* malloc() : policy off, small or fallback */
+    Huge_Advised        ,        /* anonymous mapping advised MADV_HUGEPAGE */
+    Huge_Pool_2M        ,        /* MAP_HUGETLB, 2 MiB pages */
+    Huge_Pool_1G        ,        /* MAP_HUGETLB, 1 GiB pages */
+    Huge_MaxKinds
+} Huge_Kind ;
+
+typedef struct __Huge_Stats__
+{
+    uint64_t bytes[Huge_MaxKinds] ;      /* requested bytes by what was obtained */
+    uint64_t allocs[Huge_MaxKinds] ;
+    uint64_t fallbacks ;                 /* huge pages asked for but not obtained */
+} Huge_Stats ;
+
+
+api_Err_Status huge_policy_parse( const char *, Huge_Policy * );
+void huge_set_policy( Huge_Policy );
+Huge_Policy huge_policy( void );
+void *huge_alloc( uint64_t, uint32_t );
+void huge_free( void * );
+void huge_report( const char *, void *, uint64_t );
+void huge_stats( Huge_Stats * );
+void huge_summary( void );
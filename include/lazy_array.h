@@ -0,0 +1,54 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Lazily parsed array of a text file. lazy_open() maps the file and loads
+ * its row index (see row_index.h), building it when there is none : no
+ * value is converted. The records of the outermost axis are parsed in
+ * blocks of ROW_INDEX_STRIDE records, the first time a block is asked for,
+ * and parsed blocks stay resident while they fit the array's budget. Blocks
+ * are borrowed with lazy_block() and handed back with lazy_block_put();
+ * unreferenced blocks are evicted, least recently used first. A block is
+ * parsed strictly when the array was opened by a thread in strict mode
+ * (parse_set_strict()). Compressed files cannot be mapped and are refused.
+ */
+typedef struct __Lazy_Array__ Lazy_Array ;
+
+typedef struct __Lazy_Stats__
+{
+    uint64_t hits ;
+    uint64_t misses ;            /* blocks parsed */
+    uint64_t evictions ;
+    uint64_t bytes ;             /* parsed values held */
+    uint64_t resident ;          /* blocks held */
+} Lazy_Stats ;
+
+
+api_Err_Status lazy_open( Lazy_Array **, char *, uint8_t *, Vector_MetaData *, uint64_t );
+api_Err_Status lazy_block( Lazy_Array *, uint64_t, void **, uint64_t *, uint64_t * );
+void lazy_block_put( Lazy_Array *, uint64_t );
+uint64_t lazy_trim( Lazy_Array *, uint64_t );
+api_Err_Status lazy_read_range( Lazy_Array *, uint64_t, uint64_t, void **, Vector_MetaData * );
+uint32_t lazy_current( Lazy_Array * );
+void lazy_stats( Lazy_Array *, Lazy_Stats * );
+void lazy_close( Lazy_Array ** );
@@ -0,0 +1,35 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+typedef struct __MatMul_Options__
+{
+    uint8_t *file_a ;        /* 2D inputs. NULL : generate matrices */
+    uint8_t *file_b ;
+    uint8_t *sep ;
+    Data_Type type ;
+    uint64_t m , n , k ;     /* sizes of generated matrices */
+    uint32_t verify ;
+    Gemm_Blocking blocking ;
+} MatMul_Options ;
+
+api_Err_Status parse_mat_mul_cmdline( int , char ** , MatMul_Options * );
+void clean_mat_mul_opts( MatMul_Options * );
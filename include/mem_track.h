@@ -0,0 +1,66 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Accounting of the large buffers (file text, arrays, results) by pipeline
+ * stage. Every huge_alloc() is charged to the stage of the calling thread,
+ * set with mem_stage_set(), and credited back to that stage by huge_free().
+ * An optional limit (mem_set_limit() or HETERO_MEM_LIMIT, bytes with an
+ * optional K, M, G or T suffix) makes allocations that would exceed it
+ * fail, and read_data() stream its text to stay under it.
+ */
+typedef enum __Mem_Stage__
+{
+    Mem_Read            =  0 ,   /* file into memory, inflating */
+    Mem_Detect               ,   /* dimension detection */
+    Mem_Alloc                ,   /* arrays of read_data() */
+    Mem_Parse                ,   /* text to numbers */
+    Mem_Compute              ,   /* results of computations */
+    Mem_Write                ,   /* output */
+    Mem_Other                ,   /* threads that set no stage */
+    Mem_MaxStages
+} Mem_Stage ;
+
+
+typedef struct __Mem_Stats__
+{
+    uint64_t allocs ;            /* buffers allocated in the stage */
+    uint64_t frees ;             /* of those, released since */
+    uint64_t bytes ;             /* bytes allocated in the stage */
+    uint64_t live ;              /* of those, not released yet */
+    uint64_t peak ;              /* high-water mark of live */
+    uint64_t total_peak ;        /* process-wide live bytes at their highest in the stage */
+} Mem_Stats ;
+
+
+Mem_Stage mem_stage_set( Mem_Stage );
+Mem_Stage mem_stage( void );
+api_Err_Status mem_charge( uint64_t, Mem_Stage * );
+void mem_release( uint64_t, Mem_Stage );
+api_Err_Status mem_size_parse( const char *, uint64_t * );
+void mem_set_limit( uint64_t );
+uint64_t mem_limit( void );
+uint64_t mem_headroom( void );
+uint64_t mem_current( void );
+void mem_stats( Mem_Stats *, Mem_Stats * );
+void mem_report( void );
@@ -0,0 +1,71 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Hardware counters (perf_event_open) around the stages of read_data() and
+ * the compute kernels. Enabled with HETERO_PERF=1 in the environment.
+ * Every participating thread (callers and pool workers) opens its own
+ * counters; a region sums the counts of all registered threads between
+ * perf_begin() and perf_end(). Where counters cannot be opened (containers,
+ * perf_event_paranoid, virtual machines) regions report wall time only.
+ */
+typedef enum __Perf_Counter__
+{
+    Perf_Cycles         =  0 ,
+    Perf_Instructions        ,
+    Perf_Cache_Misses        ,
+    Perf_Branch_Misses       ,
+    Perf_LLC_Loads           ,
+    Perf_MaxCounters
+} Perf_Counter ;
+
+
+typedef enum __Perf_Region__
+{
+    Perf_Read           =  0 ,   /* read_data() : file into memory */
+    Perf_Inflate             ,   /* read_data() : compressed input to text */
+    Perf_Detect              ,   /* read_data() : dimension detection */
+    Perf_Alloc               ,   /* read_data() : array allocation */
+    Perf_Parse               ,   /* read_data() : text to numbers */
+    Perf_Expr                ,   /* element-wise expression kernels */
+    Perf_Stencil             ,
+    Perf_Gemm                ,
+    Perf_Transpose           ,
+    Perf_MaxRegions
+} Perf_Region ;
+
+
+typedef struct __Perf_Sample__
+{
+    uint64_t count[Perf_MaxCounters] ;
+    struct timespec wall ;
+    uint32_t valid ;
+} Perf_Sample ;
+
+
+uint32_t perf_enabled( void );
+void perf_thread_register( void );
+void perf_thread_unregister( void );
+void perf_begin( Perf_Sample * );
+void perf_end( Perf_Sample *, Perf_Region, uint64_t );
+void perf_report( void );
@@ -0,0 +1,50 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Ragged (jagged) arrays : rows of varying length, kept as one contiguous
+ * value buffer plus an offset array per level instead of a padded block.
+ * For 2D data offset[0][r]..offset[0][r+1] are the values of row r; for 3D
+ * data offset[0][p]..offset[0][p+1] are the rows of plane p and offset[1]
+ * indexes the values of every row. Separators are given innermost first,
+ * as for read_data(). Empty rows are kept, trailing separators are not.
+ * Element-wise kernels run over the value buffer (see ragged_values()) of
+ * arrays sharing the same shape.
+ */
+#define RAGGED_MAX_DIMS   3
+
+typedef struct __Ragged_Data__
+{
+    Data_Type type ;
+    uint32_t no_dims ;                          /* 2 or 3 */
+    uint64_t count[RAGGED_MAX_DIMS] ;           /* entries per level, outermost first. Last is values */
+    uint64_t *offset[RAGGED_MAX_DIMS - 1] ;     /* count[l]+1 offsets into level l+1 */
+    void *val ;
+} Ragged_Data ;
+
+
+api_Err_Status ragged_read( Ragged_Data *, char *, uint8_t * );
+api_Err_Status ragged_alloc_like( Ragged_Data *, Ragged_Data * );
+uint32_t ragged_same_shape( Ragged_Data *, Ragged_Data * );
+void ragged_values( Ragged_Data *, Vector_MetaData * );
+void ragged_free( Ragged_Data * );
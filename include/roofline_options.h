@@ -0,0 +1,48 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* kernels to place on the roofline, bits of Roofline_Options.what */
+#define ROOF_ADD        (1u << 0)
+#define ROOF_SUM        (1u << 1)
+#define ROOF_PARSE      (1u << 2)
+#define ROOF_HASH       (1u << 3)
+#define ROOF_TRANSPOSE  (1u << 4)
+#define ROOF_STENCIL    (1u << 5)
+#define ROOF_GEMM       (1u << 6)
+#define ROOF_ALL        (ROOF_ADD | ROOF_SUM | ROOF_PARSE | ROOF_HASH | ROOF_TRANSPOSE | ROOF_STENCIL | ROOF_GEMM)
+
+typedef struct __Roofline_Options__
+{
+    uint8_t *file ;          /* sample input of the parse kernel. NULL : generated */
+    uint8_t *sep ;
+    Data_Type type ;         /* float or double */
+    uint32_t what ;
+    uint64_t bytes ;         /* size of each STREAM and element-wise array */
+    uint64_t values ;        /* values in the generated parse sample */
+    uint64_t edge ;          /* stencil volume edge */
+    uint64_t mat ;           /* square matrix size */
+    uint32_t reps ;
+} Roofline_Options ;
+
+api_Err_Status parse_roofline_cmdline( int , char ** , Roofline_Options * );
+void clean_roofline_opts( Roofline_Options * );
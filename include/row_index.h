@@ -0,0 +1,63 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Sidecar row index of a text file, persisted as <file>.idx. It holds the
+ * byte offset of every ROW_INDEX_STRIDE'th record along the outermost axis
+ * (rows of 2D data, planes of 3D data) so read_data_range() can seek to a
+ * range of records and parse only those. read_data() writes the index the
+ * first time it reads a file with more than ROW_INDEX_STRIDE records,
+ * unless HETERO_ROW_INDEX=0. The index is stale, and rebuilt, when the size
+ * or modification time of the file or the separators differ. Compressed
+ * files cannot be seeked and are not indexed.
+ */
+#define ROW_INDEX_MAGIC     "HETIDX01"
+#define ROW_INDEX_STRIDE    1024         /* records between offsets */
+
+typedef struct __Row_Index_Header__
+{
+    char magic[8] ;              /* ROW_INDEX_MAGIC, no terminator */
+    uint32_t no_dims ;
+    uint32_t stride ;            /* records between offsets */
+    uint64_t file_size ;
+    int64_t mtime_sec ;
+    int64_t mtime_nsec ;
+    uint64_t records ;           /* extent of the outermost axis */
+    uint64_t no_offsets ;
+    uint64_t shape[DATA_MAX_DIMS] ;      /* as detected : inner axes from the first record */
+    char sep[DATA_MAX_DIMS + 8] ;        /* separators, NUL-terminated */
+} Row_Index_Header ;
+
+typedef struct __Row_Index__
+{
+    Row_Index_Header hdr ;
+    uint64_t *offset ;           /* offset[i] : first byte of record i * stride */
+} Row_Index ;
+
+
+api_Err_Status row_index_build( Row_Index *, const uint8_t *, uint64_t, uint8_t *, Vector_MetaData *, char * );
+api_Err_Status row_index_save( Row_Index *, char * );
+api_Err_Status row_index_load( Row_Index *, char *, uint8_t * );
+api_Err_Status row_index_range( Row_Index *, uint64_t, uint64_t, uint64_t *, uint64_t *, uint64_t * );
+void row_index_free( Row_Index * );
+api_Err_Status read_data_index( Row_Index *, Vector_MetaData *, char *, uint8_t * );
@@ -0,0 +1,65 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Arrays in shared memory. An object starts with a Shm_Array_Header page
+ * describing the array, followed by its values, row-major and in native
+ * byte order, at header_size. Another process maps the object and reads the
+ * values in place. Objects are POSIX shared memory (name "/..." , mode 0600)
+ * or, when no name is given, an anonymous memfd that children inherit and
+ * open through /proc/<pid>/fd/<fd> (kept in Shm_Array.name). Names holding
+ * more than the leading '/' are opened as plain files.
+ */
+#define SHM_ARRAY_MAGIC     "HETARR02"   /* 02 : DATA_MAX_DIMS extents */
+#define SHM_ARRAY_HEADER    4096         /* header page : values are page-aligned */
+#define SHM_ARRAY_NAME_MAX  256
+
+typedef struct __Shm_Array_Header__
+{
+    char magic[8] ;              /* SHM_ARRAY_MAGIC, no terminator */
+    uint32_t header_size ;       /* offset of the values */
+    uint32_t type ;              /* Data_Type */
+    uint32_t type_size ;         /* bytes per value */
+    uint32_t no_dims ;
+    uint64_t dims[DATA_MAX_DIMS] ;   /* outermost first, as Data_Dimensions.shape */
+    uint64_t payload_bytes ;
+    char type_name[16] ;         /* datatype_name(), NUL-terminated */
+    uint64_t text_hash ;         /* Vector_MetaData hashes, 0 when unknown */
+    uint64_t data_hash ;
+} Shm_Array_Header ;
+
+typedef struct __Shm_Array__
+{
+    void *buff ;                 /* array in read_data() layout over the mapping */
+    Vector_MetaData meta ;
+    Shm_Array_Header *hdr ;      /* start of the mapping */
+    uint64_t map_size ;
+    int fd ;                     /* memfd, -1 for named objects */
+    char name[SHM_ARRAY_NAME_MAX] ;
+} Shm_Array ;
+
+
+api_Err_Status shm_array_create( Shm_Array *, char *, Vector_MetaData * );
+api_Err_Status shm_array_load( Shm_Array *, char *, char *, uint8_t *, Data_Type );
+api_Err_Status shm_array_open( Shm_Array *, char *, int );
+void shm_array_close( Shm_Array *, uint32_t );
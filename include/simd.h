@@ -0,0 +1,49 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Compile a kernel for several instruction sets and select the best one
+ * for the executing CPU at load time (GCC function multi-versioning).
+ * Kernels are written as plain loops and left to the auto-vectoriser.
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(NO_TARGET_CLONES)
+  #define SIMD_KERNEL  __attribute__((target_clones("avx512f","avx2","default")))
+#else
+  #define SIMD_KERNEL
+#endif
+
+/*!
+ * Floating point kernels bound by fused multiply-add throughput. AVX2 does
+ * not imply FMA, so the 256-bit clone asks for FMA itself
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(NO_TARGET_CLONES)
+  #define SIMD_FMA_KERNEL  __attribute__((target_clones("avx512f","fma","default")))
+#else
+  #define SIMD_FMA_KERNEL
+#endif
+
+/* Alignment of kernel scratch and packed buffers (one cache line) */
+#define SIMD_ALIGN   64
+
+/* Tell the vectoriser that same-index aliasing between operands is safe */
+#define SIMD_IVDEP   _Pragma("GCC ivdep")
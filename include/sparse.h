@@ -0,0 +1,49 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Sparse vectors and matrices. Input files hold index:value tokens; the
+ * first separator splits tokens, the second (if any) splits rows, e.g.
+ *         0:1.5,17:2.25,90210:-1        (vector)
+ *         3:1,9:4\n\n0:2\n              (3-row matrix, row 1 empty)
+ * Data is held in CSR form : row_ptr[r]..row_ptr[r+1] index the column and
+ * value of the entries of row r, columns ascending and unique. A vector is
+ * a single-row matrix. Dimensions are inferred from the largest index.
+ */
+#define SPARSE_INDEX_SEP  ':'
+
+typedef struct __Sparse_Data__
+{
+    Vector_MetaData meta ;   /* type, 1 or 2 dims, logical (dense) shape */
+    uint64_t nnz ;           /* stored entries */
+    uint64_t *row_ptr ;      /* rows+1 offsets into col/val */
+    uint64_t *col ;          /* column (vector : index) of each entry */
+    void *val ;              /* value of each entry, contiguous of meta.type */
+} Sparse_Data ;
+
+
+api_Err_Status sparse_read( Sparse_Data *, char *, uint8_t * );
+api_Err_Status sparse_from_coo( Sparse_Data *, Vector_MetaData *, uint64_t, uint64_t *, uint64_t *, void * );
+api_Err_Status sparse_add_dense( void *, Vector_MetaData *, Sparse_Data *, void *, Vector_MetaData * );
+api_Err_Status sparse_add( Sparse_Data *, Sparse_Data *, Sparse_Data * );
+void sparse_free( Sparse_Data * );
@@ -0,0 +1,63 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Jacobi-style smoothing stencils over 3D volumes returned by read_data()
+ * (buff[z][y][x], x contiguous). Boundary cells are kept fixed.
+ */
+typedef enum __Stencil_Type__
+{
+    Stencil_7pt     =  0 ,   /* centre + 6 face neighbours */
+    Stencil_27pt         ,   /* centre + 6 faces + 12 edges + 8 corners */
+    Stencil_MaxTypes
+} Stencil_Type ;
+
+
+typedef struct __Stencil_Coeffs__
+{
+    Stencil_Type type ;
+    double centre ;
+    double face ;
+    double edge ;            /* 27-point only */
+    double corner ;          /* 27-point only */
+} Stencil_Coeffs ;
+
+
+/*!
+ * Blocking parameters. Zero selects the value tuned for this machine (see
+ * tune_db.h), else one derived from the cache sizes.
+ * tile_x/tile_y - spatial block of output cells computed by one task
+ * time_block    - number of sweeps fused into one pass over memory
+ */
+typedef struct __Stencil_Tiling__
+{
+    uint32_t tile_x ;
+    uint32_t tile_y ;
+    uint32_t time_block ;
+} Stencil_Tiling ;
+
+
+void stencil_default_coeffs( Stencil_Coeffs *, Stencil_Type );
+void stencil_tune_knob( char *, size_t, Stencil_Type, Data_Type, const char * );
+api_Err_Status stencil_3d( void *, void *, Vector_MetaData *, Stencil_Coeffs *, uint32_t, Stencil_Tiling * );
+api_Err_Status stencil_3d_reference( void *, void *, Vector_MetaData *, Stencil_Coeffs *, uint32_t );
@@ -0,0 +1,36 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+typedef struct __Stencil_Options__
+{
+    uint8_t *file ;          /* 3D input. NULL : generate a volume */
+    uint8_t *sep ;
+    Data_Type type ;
+    uint64_t size ;          /* edge of generated cube */
+    uint32_t points ;        /* 7 or 27 */
+    uint32_t iterations ;
+    uint32_t verify ;
+    Stencil_Tiling tiling ;
+} Stencil_Options ;
+
+api_Err_Status parse_stencil_cmdline( int , char ** , Stencil_Options * );
+void clean_stencil_opts( Stencil_Options * );
@@ -0,0 +1,41 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Work function executed by the pool. task_idx is the index of the task
+ * being executed (0..no_tasks-1) and thread_idx the index of the executing
+ * thread (0..no_threads-1, 0 being the caller of tpool_parallel_for())
+ */
+typedef void (*tpool_task_fn)( void *ctx, uint64_t task_idx, uint32_t thread_idx );
+
+typedef struct __Thread_Pool__ Thread_Pool ;
+
+#define TPOOL_MAX_THREADS   256
+
+api_Err_Status tpool_create( Thread_Pool **, uint32_t );
+api_Err_Status tpool_parallel_for( Thread_Pool *, uint64_t, tpool_task_fn, void * );
+void tpool_destroy( Thread_Pool ** );
+uint32_t tpool_size( Thread_Pool * );
+uint32_t tpool_default_threads( void );
+Thread_Pool *tpool_default( void );
+void tpool_default_release( void );
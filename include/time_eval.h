@@ -36,3 +36,18 @@ do { \
 #define time_taken(begin,end)  ( ((double)((end) - (begin)))/ CLOCKS_PER_SEC )
 
 
+
+
+/*!
+ * Wall-clock timers for multi-threaded code, where clock() would add up
+ * the CPU time of all threads. Calls clock_gettime() - defined in <time.h>
+ */
+#define start_wall_timer(x)  \
+do { \
+    clock_gettime( CLOCK_MONOTONIC , &(x) ); \
+} while(0)
+
+#define stop_wall_timer(x)  start_wall_timer(x)
+
+#define wall_time_taken(begin,end)  ( ((double)((end).tv_sec - (begin).tv_sec)) + \
+                                      (((double)((end).tv_nsec - (begin).tv_nsec)) / 1e9) )
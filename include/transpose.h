@@ -0,0 +1,35 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Axis permutation of 2D and 3D arrays from read_data().
+ * perm[i] names the input axis which becomes output axis i, axes being
+ * numbered in subscript order (0 = outermost : rows in 2D, z in 3D).
+ * e.g. for buff[z][y][x], perm = {2,1,0} produces out[x][y][z]
+ */
+#define PERMUTE_MAX_DIMS   3
+
+api_Err_Status permute_result_meta( Vector_MetaData *, Vector_MetaData *, uint32_t * );
+api_Err_Status permute_axes( void *, Vector_MetaData *, void *, Vector_MetaData *, uint32_t * );
+api_Err_Status transpose_2d_inplace( void *, Vector_MetaData * );
+api_Err_Status parse_permutation( uint32_t *, uint8_t *, uint32_t );
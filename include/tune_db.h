@@ -0,0 +1,47 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * Persistent tuning database. Winners of autotune sweeps are stored per
+ * CPU model, knob and problem size class (log2 of the size) in a text file,
+ * HETERO_TUNE_DB or ~/.hetero_tune.db :
+ *
+ *     # cpu-model knob size-class value
+ *     Intel(R)_Xeon(R)_CPU_@_2.20GHz  stencil.float.tile_y  24  32
+ *
+ * Lookups fall back to the entry of the nearest size class for the same
+ * knob when the size lies between tuned classes, or at most
+ * TUNE_NEAREST_CLASSES classes outside them; otherwise to the caller's
+ * default. HETERO_TUNE=off ignores the database.
+ */
+#define TUNE_NAME_LEN    96
+#define TUNE_NEAREST_CLASSES  1          /* extrapolation beyond the tuned classes */
+#define TUNE_DB_FILE     ".hetero_tune.db"
+
+uint32_t tune_size_class( uint64_t );
+const char *tune_cpu_model( void );
+const char *tune_db_path( void );
+api_Err_Status tune_db_load( void );
+api_Err_Status tune_db_save( void );
+uint64_t tune_lookup( const char *, uint64_t, uint64_t );
+api_Err_Status tune_store( const char *, uint64_t, uint64_t );
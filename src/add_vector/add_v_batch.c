@@ -0,0 +1,318 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "add_v_options.h"
+#include "thread_pool.h"
+#include "time_eval.h"
+#include "huge_pages.h"
+#include "add_v_batch.h"
+
+
+#define BATCH_MAX_ARGS     128       /* words on one manifest line, program name included */
+
+
+typedef struct __Batch_Job__
+{
+    Program_Options opt ;
+    uint64_t line ;                  /* manifest line, for messages */
+    api_Err_Status err ;
+} Batch_Job ;
+
+
+typedef struct __Batch_Ctx__
+{
+    Batch_Job *job ;
+    Batch_Job_Fn run ;
+} Batch_Ctx ;
+
+
+static api_Err_Status _batch_parse( char *, char *, Program_Options *, Batch_Job **, uint64_t * );
+static uint32_t _batch_split( char *, char **, uint32_t );
+static void _batch_task( void *, uint64_t, uint32_t );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Run every job of a manifest. All lines are parsed up front so a
+ *         malformed manifest runs nothing; jobs are then handed out to the
+ *         default thread pool, one job per task, and kernels inside a job run
+ *         on the thread executing it
+ * \param  *prog - program name, argv[0] of every job
+ * \param  *defaults - options given with -b : manifest path and defaults
+ * \param  run - executes one job
+ * \return returns api_Success if every job succeeded
+ */
+/*****************************************************************************/
+api_Err_Status batch_run( char *prog, Program_Options *defaults, Batch_Job_Fn run )
+{
+    api_Err_Status err = api_Success ;
+    uint8_t *text = NULL ;
+    uint64_t size = 0 , no_jobs = 0 , failed = 0 , idx_i = 0 ;
+    Batch_Job *jobs = NULL ;
+    Batch_Ctx ctx ;
+    struct timespec begin , end ;
+
+    if((prog == NULL) || (defaults == NULL) || (defaults->batch == NULL) || (run == NULL)) {
+        debug("Invalid params prog = %p, defaults = %p, run = %p", prog, defaults, run);
+        err = api_Err_Param ;
+        goto err_batch_run ;
+    }
+
+    err = read_text( &text, &size, (char *)defaults->batch );
+    if( err != api_Success ) {
+        debug("Could not read manifest [%s]. err = %d", defaults->batch, err);
+        goto err_batch_run ;
+    }
+    err = _batch_parse( prog, (char *)text, defaults, &jobs, &no_jobs );
+    if( err != api_Success )
+        goto err_batch_jobs ;
+    if( no_jobs == 0 ) {
+        debug("Manifest [%s] holds no jobs", defaults->batch);
+        err = api_Err_Param ;
+        goto err_batch_jobs ;
+    }
+
+    ctx.job = jobs ;
+    ctx.run = run ;
+    start_wall_timer( begin );
+    err = tpool_parallel_for( tpool_default(), no_jobs, _batch_task, &ctx );
+    stop_wall_timer( end );
+
+    for( idx_i=0 ; idx_i < no_jobs ; idx_i++ ) {
+        if( jobs[idx_i].err != api_Success ) {
+            log_error("Job on manifest line %llu failed. err = %d", (unsigned long long)jobs[idx_i].line, jobs[idx_i].err);
+            failed++ ;
+        }
+    }
+    debug("Batch : %llu jobs, %llu failed, %.4f s on %u threads", (unsigned long long)no_jobs,
+                (unsigned long long)failed, wall_time_taken( begin, end ), tpool_size( tpool_default()));
+    err = ((err == api_Success) && (failed != 0)) ? api_Err_Failure : err ;
+
+err_batch_jobs :
+    for( idx_i=0 ; (jobs != NULL) && (idx_i < no_jobs) ; idx_i++ )
+        clean_cmdline_opts( &jobs[idx_i].opt );
+    jobs = (jobs != NULL) ? free(jobs), NULL : NULL ;
+    text = (text != NULL) ? huge_free(text), NULL : NULL ;
+
+err_batch_run :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Parse every job line of a manifest with the command-line parser
+ * \param  *prog - program name
+ * \param  *text - manifest content, modified in place
+ * \param  *defaults - data-type and separators for jobs without them, and
+ *                     strict conversion for all jobs
+ * \param  **jobs - output array of jobs, free()'d by the caller
+ * \param  *no_jobs - number of jobs
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _batch_parse( char *prog, char *text, Program_Options *defaults, Batch_Job **jobs, uint64_t *no_jobs )
+{
+    api_Err_Status err = api_Success ;
+    char *line = NULL , *next = NULL , *eol = NULL ;
+    uint64_t line_no = 0 , max_jobs = 0 ;
+    uint32_t words = 0 ;
+    Batch_Job *grown = NULL , *job = NULL ;
+
+    *jobs = NULL ;
+    *no_jobs = 0 ;
+    for( line=text ; *line != '\0' ; line=next ) {
+        eol = strchr( line, '\n' );
+        next = (eol != NULL) ? eol + 1 : line + strlen(line) ;
+        if( eol != NULL )
+            *eol = '\0' ;
+        line_no++ ;
+
+        if( *no_jobs == max_jobs ) {
+            max_jobs = (max_jobs != 0) ? 2 * max_jobs : 64 ;
+            grown = realloc( *jobs, max_jobs * sizeof(Batch_Job));
+            if( grown == NULL ) {
+                debug("Could not grow the job list to %llu jobs", (unsigned long long)max_jobs);
+                err = api_Err_Memory ;
+                goto err_batch_parse ;
+            }
+            *jobs = grown ;
+        }
+        job = &(*jobs)[*no_jobs] ;
+        memset( job, 0, sizeof(Batch_Job));
+        job->line = line_no ;
+
+        err = batch_line_options( prog, line, defaults, &job->opt, &words );
+        if( err != api_Success ) {
+            log_error("Manifest line %llu : could not parse job options. err = %d", (unsigned long long)line_no, err);
+            goto err_batch_parse ;
+        }
+        if( words == 0 )
+            continue ;
+        (*no_jobs)++ ;
+    }
+
+err_batch_parse :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Options of one job written as a manifest line. Also used for the
+ *         requests of the daemon
+ * \param  *prog - program name
+ * \param  *line - NUL-terminated line, modified in place
+ * \param  *defaults - data-type and separators for jobs without them
+ * \param  *opt - output options, released with clean_cmdline_opts()
+ * \param  *words - number of words on the line, 0 for blank or comment lines
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status batch_line_options( char *prog, char *line, Program_Options *defaults, Program_Options *opt, uint32_t *words )
+{
+    api_Err_Status err = api_Success ;
+    char *argv[BATCH_MAX_ARGS + 1] ;
+    uint32_t argc = 0 ;
+
+    memset( opt, 0, sizeof(Program_Options));
+    opt->type = DataType_MaxTypes ;
+    argc = _batch_split( line, &argv[1], BATCH_MAX_ARGS - 1 );
+    *words = argc ;
+    if( argc == 0 )
+        goto err_line_options ;
+    if( argc >= BATCH_MAX_ARGS ) {
+        debug("More than %u words on one line", BATCH_MAX_ARGS - 1);
+        err = api_Err_Param ;
+        goto err_line_options ;
+    }
+    argv[0] = prog ;
+    argv[argc + 1] = NULL ;
+
+    err = parse_cmdline((int)argc + 1, argv, opt );
+    if( err != api_Success ) {
+        err = api_Err_Param ;
+        goto err_line_options ;
+    }
+    if((opt->batch != NULL) || (opt->daemon != NULL)) {
+        debug("Jobs cannot start a batch or a daemon");
+        err = api_Err_Param ;
+        goto err_line_options_opt ;
+    }
+    if((opt->hugepages >= 0) || (opt->mem_limit != 0)) {
+        debug("-H and -M apply to the whole process : give them with -b or -D, not per job");
+        err = api_Err_Param ;
+        goto err_line_options_opt ;
+    }
+    if( opt->type == DataType_MaxTypes )
+        opt->type = defaults->type ;
+    opt->strict |= defaults->strict ;
+    if((opt->sep == NULL) && (defaults->sep != NULL)) {
+        opt->sep = (uint8_t *)strdup((char *)defaults->sep);
+        if( opt->sep == NULL ) {
+            err = api_Err_Memory ;
+            goto err_line_options_opt ;
+        }
+    }
+    return err ;
+
+err_line_options_opt :
+    clean_cmdline_opts( opt );
+err_line_options :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Split a manifest line into words, in place. Words are separated by
+ *         white-space, quotes group words and are removed, \n \t and \\ are
+ *         unescaped. A '#' starting a word comments out the rest of the line
+ * \param  *line - NUL-terminated line
+ * \param  **argv - output words
+ * \param  max_args - room in argv
+ * \return number of words, max_args + 1 if there were more
+ */
+/*****************************************************************************/
+static uint32_t _batch_split( char *line, char **argv, uint32_t max_args )
+{
+    char *r = line , *w = NULL ;
+    char quote = 0 ;
+    uint32_t argc = 0 ;
+
+    while( *r != '\0' ) {
+        while( isspace((unsigned char)*r) )
+            r++ ;
+        if((*r == '\0') || (*r == '#'))
+            break ;
+        if( argc == max_args )
+            return max_args + 1 ;
+
+        argv[argc++] = w = r ;
+        for( quote=0 ; (*r != '\0') && (quote || !isspace((unsigned char)*r)) ; r++ ) {
+            if( quote && (*r == quote)) {
+                quote = 0 ;
+            } else if( !quote && ((*r == '"') || (*r == '\''))) {
+                quote = *r ;
+            } else if((*r == '\\') && (r[1] != '\0')) {
+                r++ ;
+                *w++ = (*r == 'n') ? '\n' : (*r == 't') ? '\t' : *r ;
+            } else {
+                *w++ = *r ;
+            }
+        }
+        if( *r != '\0' )
+            r++ ;
+        *w = '\0' ;
+    }
+    return argc ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : run one job
+ */
+/*****************************************************************************/
+static void _batch_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Batch_Ctx *ctx = (Batch_Ctx *)arg ;
+
+    (void)thread_idx ;
+    ctx->job[task].err = ctx->run( &ctx->job[task].opt );
+    return ;
+}
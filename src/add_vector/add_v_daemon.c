@@ -0,0 +1,477 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "add_v_options.h"
+#include "time_eval.h"
+#include "add_v_batch.h"
+#include "array_cache.h"
+#include "add_v_daemon.h"
+#include "shm_array.h"
+
+
+#define DAEMON_MAX_CLIENTS    64
+#define DAEMON_LINE_MAX       8192       /* longest request line */
+#define DAEMON_CACHE_MB       1024       /* default HETERO_CACHE_MB */
+#define DAEMON_BACKLOG        16
+
+
+struct __Daemon_Reply__
+{
+    char shm[64] ;                       /* shared memory object holding the result */
+    Vector_MetaData meta ;
+    uint64_t bytes ;
+    uint32_t ready ;
+};
+
+
+typedef struct __Daemon_Client__
+{
+    int fd ;
+    uint32_t used ;
+    char line[DAEMON_LINE_MAX] ;
+} Daemon_Client ;
+
+
+typedef struct __Daemon_Ctx__
+{
+    char *prog ;
+    Program_Options *defaults ;
+    Daemon_Job_Fn run ;
+    Array_Cache *cache ;
+    uint64_t requests ;
+    uint64_t failed ;
+    uint64_t seq ;                       /* shared memory names */
+    uint32_t stop ;
+} Daemon_Ctx ;
+
+
+static volatile sig_atomic_t g_daemon_signal = 0 ;
+
+
+static api_Err_Status _daemon_listen( char *, int * );
+static api_Err_Status _daemon_read( Daemon_Ctx *, Daemon_Client * );
+static void _daemon_request( Daemon_Ctx *, int, char * );
+static api_Err_Status _daemon_send( int, char * );
+static void _daemon_on_signal( int );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Serve requests on a unix socket until "shutdown", SIGINT or
+ *         SIGTERM. Requests are executed one at a time, in arrival order, and
+ *         each uses the whole default thread pool for its kernels
+ * \param  *prog - program name, argv[0] of every request
+ * \param  *defaults - options given with -D : socket path and defaults
+ * \param  run - executes one request
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status daemon_run( char *prog, Program_Options *defaults, Daemon_Job_Fn run )
+{
+    api_Err_Status err = api_Success ;
+    Daemon_Ctx ctx ;
+    Daemon_Client *client = NULL ;
+    struct pollfd pfd[DAEMON_MAX_CLIENTS + 1] ;
+    struct sigaction act , old_int , old_term ;
+    Cache_Stats stats ;
+    uint64_t budget = DAEMON_CACHE_MB ;
+    uint32_t idx_i = 0 , no_pfd = 0 ;
+    int fd = -1 , conn = -1 ;
+    char *env = NULL ;
+
+    if((prog == NULL) || (defaults == NULL) || (defaults->daemon == NULL) || (run == NULL)) {
+        debug("Invalid params prog = %p, defaults = %p, run = %p", prog, defaults, run);
+        err = api_Err_Param ;
+        goto err_daemon_run ;
+    }
+
+    memset( &ctx, 0, sizeof(ctx));
+    ctx.prog = prog ;
+    ctx.defaults = defaults ;
+    ctx.run = run ;
+
+    env = getenv("HETERO_CACHE_MB");
+    if((env != NULL) && (*env != '\0'))
+        budget = strtoull( env, NULL, 10 );
+    err = cache_create( &ctx.cache, budget << 20 );
+    if( err != api_Success )
+        goto err_daemon_run ;
+
+    client = calloc( DAEMON_MAX_CLIENTS, sizeof(Daemon_Client));
+    if( client == NULL ) {
+        debug("Could not allocate %u client slots", DAEMON_MAX_CLIENTS);
+        err = api_Err_Memory ;
+        goto err_daemon_cache ;
+    }
+    for( idx_i=0 ; idx_i < DAEMON_MAX_CLIENTS ; idx_i++ )
+        client[idx_i].fd = -1 ;
+
+    err = _daemon_listen((char *)defaults->daemon, &fd );
+    if( err != api_Success )
+        goto err_daemon_client ;
+
+    /* no SA_RESTART : a signal wakes poll() up */
+    memset( &act, 0, sizeof(act));
+    act.sa_handler = _daemon_on_signal ;
+    sigemptyset( &act.sa_mask );
+    g_daemon_signal = 0 ;
+    sigaction( SIGINT, &act, &old_int );
+    sigaction( SIGTERM, &act, &old_term );
+
+    debug("Daemon listening on [%s], input cache %llu MiB", defaults->daemon, (unsigned long long)budget);
+    while( !ctx.stop && !g_daemon_signal ) {
+        pfd[0].fd = fd ;
+        pfd[0].events = POLLIN ;
+        pfd[0].revents = 0 ;
+        for( idx_i=0, no_pfd=1 ; idx_i < DAEMON_MAX_CLIENTS ; idx_i++ ) {
+            pfd[idx_i + 1].fd = client[idx_i].fd ;      /* negative fds are ignored */
+            pfd[idx_i + 1].events = POLLIN ;
+            pfd[idx_i + 1].revents = 0 ;
+            no_pfd++ ;
+        }
+        if( poll( pfd, no_pfd, -1 ) < 0 ) {
+            if( errno == EINTR )
+                continue ;
+            log_error("poll() failed. errno = %d", errno);
+            err = api_Err_Failure ;
+            break ;
+        }
+
+        for( idx_i=0 ; (idx_i < DAEMON_MAX_CLIENTS) && !ctx.stop ; idx_i++ ) {
+            if((client[idx_i].fd < 0) || !(pfd[idx_i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue ;
+            if( _daemon_read( &ctx, &client[idx_i] ) != api_Success ) {
+                close( client[idx_i].fd );
+                client[idx_i].fd = -1 ;
+                client[idx_i].used = 0 ;
+            }
+        }
+
+        if( pfd[0].revents & POLLIN ) {
+            conn = accept( fd, NULL, NULL );
+            if( conn < 0 )
+                continue ;
+            for( idx_i=0 ; (idx_i < DAEMON_MAX_CLIENTS) && (client[idx_i].fd >= 0) ; idx_i++ )
+                ;
+            if( idx_i == DAEMON_MAX_CLIENTS ) {
+                debug("More than %u clients : connection refused", DAEMON_MAX_CLIENTS);
+                close( conn );
+                continue ;
+            }
+            client[idx_i].fd = conn ;
+            client[idx_i].used = 0 ;
+        }
+    }
+
+    cache_stats( ctx.cache, &stats );
+    debug("Daemon : %llu requests, %llu failed, cache %llu hits / %llu misses / %llu evictions, %llu blocks parsed for slices",
+                (unsigned long long)ctx.requests, (unsigned long long)ctx.failed,
+                (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.evictions,
+                (unsigned long long)stats.block_misses);
+
+    sigaction( SIGINT, &old_int, NULL );
+    sigaction( SIGTERM, &old_term, NULL );
+    close( fd );
+    unlink((char *)defaults->daemon );
+
+err_daemon_client :
+    for( idx_i=0 ; (client != NULL) && (idx_i < DAEMON_MAX_CLIENTS) ; idx_i++ ) {
+        if( client[idx_i].fd >= 0 )
+            close( client[idx_i].fd );
+    }
+    client = (client != NULL) ? free(client), NULL : NULL ;
+err_daemon_cache :
+    cache_destroy( &ctx.cache );
+err_daemon_run :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Copy a result into a new shared memory object for the reply
+ * \param  *reply - reply of the request being served
+ * \param  *buff - result array
+ * \param  *meta - meta-data of the result
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status daemon_reply_array( Daemon_Reply *reply, void *buff, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    void *payload = NULL ;
+    Shm_Array sa ;
+
+    payload = data_payload( buff, meta );
+    if((reply == NULL) || (payload == NULL) || reply->ready || (reply->shm[0] == '\0')) {
+        debug("Invalid params reply = %p, buff = %p, meta = %p", reply, buff, meta);
+        err = api_Err_Param ;
+        goto err_reply_array ;
+    }
+
+    err = shm_array_create( &sa, reply->shm, meta );
+    if( err != api_Success )
+        goto err_reply_array ;
+    reply->meta = *meta ;
+    reply->bytes = sa.hdr->payload_bytes ;
+    memcpy( data_payload( sa.buff, &sa.meta ), payload, reply->bytes );
+    shm_array_close( &sa, 0 );
+    reply->ready = 1 ;
+
+err_reply_array :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create the listening socket. A socket left behind by a previous
+ *         daemon is replaced; any other file at the path is an error
+ * \param  *path - socket path
+ * \param  *fd - output listening descriptor
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _daemon_listen( char *path, int *fd )
+{
+    api_Err_Status err = api_Success ;
+    struct sockaddr_un addr ;
+    struct stat sb ;
+    mode_t mask ;
+    int rc = 0 ;
+
+    if( strlen( path ) >= sizeof(addr.sun_path)) {
+        debug("Socket path [%s] longer than %zu characters", path, sizeof(addr.sun_path) - 1);
+        err = api_Err_Param ;
+        goto err_daemon_listen ;
+    }
+    if( lstat( path, &sb ) == 0 ) {
+        if( !S_ISSOCK( sb.st_mode )) {
+            debug("[%s] exists and is not a socket", path);
+            err = api_Err_File ;
+            goto err_daemon_listen ;
+        }
+        unlink( path );
+    }
+
+    *fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if( *fd < 0 ) {
+        debug("Could not create socket. errno = %d", errno);
+        err = api_Err_Init ;
+        goto err_daemon_listen ;
+    }
+    memset( &addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX ;
+    strcpy( addr.sun_path, path );
+
+    /* requests name arbitrary files : only the owner may connect */
+    mask = umask( 0077 );
+    rc = bind( *fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask( mask );
+    if((rc != 0) || (listen( *fd, DAEMON_BACKLOG ) != 0)) {
+        debug("Could not listen on [%s]. errno = %d", path, errno);
+        err = api_Err_Init ;
+        goto err_daemon_listen_fd ;
+    }
+    return err ;
+
+err_daemon_listen_fd :
+    close( *fd );
+    *fd = -1 ;
+err_daemon_listen :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Receive from a client and serve every complete line
+ * \param  *ctx - daemon state
+ * \param  *client - readable client
+ * \return api_Success while the connection stays open
+ */
+/*****************************************************************************/
+static api_Err_Status _daemon_read( Daemon_Ctx *ctx, Daemon_Client *client )
+{
+    char *line = NULL , *eol = NULL ;
+    ssize_t got = 0 ;
+    uint32_t done = 0 ;
+
+    got = recv( client->fd, client->line + client->used, DAEMON_LINE_MAX - 1 - client->used, 0 );
+    if( got <= 0 )
+        return api_Err_File ;
+    client->used += (uint32_t)got ;
+    client->line[client->used] = '\0' ;
+
+    for( line=client->line ; !ctx->stop && ((eol = strchr( line, '\n' )) != NULL) ; line=eol + 1 ) {
+        *eol = '\0' ;
+        if((eol > line) && (eol[-1] == '\r'))
+            eol[-1] = '\0' ;
+        _daemon_request( ctx, client->fd, line );
+    }
+    done = (uint32_t)(line - client->line) ;
+    memmove( client->line, line, client->used - done + 1 );
+    client->used -= done ;
+
+    if( client->used == DAEMON_LINE_MAX - 1 ) {
+        log_warn("Request longer than %u characters", DAEMON_LINE_MAX - 1);
+        return api_Err_Param ;
+    }
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Serve one request line and send its reply
+ * \param  *ctx - daemon state
+ * \param  fd - client connection
+ * \param  *line - NUL-terminated request, modified in place
+ * \return void
+ */
+/*****************************************************************************/
+static void _daemon_request( Daemon_Ctx *ctx, int fd, char *line )
+{
+    api_Err_Status err = api_Success ;
+    Program_Options opt ;
+    Daemon_Reply reply ;
+    Cache_Stats stats ;
+    struct timespec begin , end ;
+    char text[256] ;
+    uint32_t words = 0 , len = 0 , idx_i = 0 ;
+
+    while((*line == ' ') || (*line == '\t'))
+        line++ ;
+    if( strcmp( line, "shutdown" ) == 0 ) {
+        ctx->stop = 1 ;
+        _daemon_send( fd, "OK\n" );
+        return ;
+    }
+    if( strcmp( line, "stats" ) == 0 ) {
+        cache_stats( ctx->cache, &stats );
+        snprintf( text, sizeof(text), "STATS %llu %llu %llu %llu %llu %u %llu %llu %llu %llu\n",
+                  (unsigned long long)ctx->requests, (unsigned long long)ctx->failed,
+                  (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+                  (unsigned long long)stats.evictions, stats.entries, (unsigned long long)stats.bytes,
+                  (unsigned long long)stats.blocks, (unsigned long long)stats.block_hits,
+                  (unsigned long long)stats.block_misses );
+        _daemon_send( fd, text );
+        return ;
+    }
+
+    start_wall_timer( begin );
+    err = batch_line_options( ctx->prog, line, ctx->defaults, &opt, &words );
+    if((err == api_Success) && (words == 0))
+        return ;                                        /* blank line or comment */
+    ctx->requests++ ;
+
+    memset( &reply, 0, sizeof(reply));
+    snprintf( reply.shm, sizeof(reply.shm), "/hetero-%ld-%llu", (long)getpid(), (unsigned long long)ctx->seq++ );
+    if( err == api_Success ) {
+        err = ctx->run( &opt, ctx->cache, &reply );
+        clean_cmdline_opts( &opt );
+    }
+    if((err == api_Success) && !reply.ready)
+        err = api_Err_Failure ;                         /* job did not produce an array */
+
+    if( err == api_Success ) {
+        len = (uint32_t)snprintf( text, sizeof(text), "OK %s %s %u", reply.shm,
+                                  datatype_name( reply.meta.type ), reply.meta.no_dims );
+        for( idx_i=0 ; idx_i < reply.meta.no_dims ; idx_i++ )
+            len += (uint32_t)snprintf( text + len, sizeof(text) - len, " %llu", (unsigned long long)reply.meta.dim.shape[idx_i] );
+        snprintf( text + len, sizeof(text) - len, " %llu\n", (unsigned long long)reply.bytes );
+        /* nobody will unlink the result if the client is gone */
+        if( _daemon_send( fd, text ) != api_Success )
+            shm_unlink( reply.shm );
+    } else {
+        ctx->failed++ ;
+        if( reply.ready )
+            shm_unlink( reply.shm );
+        snprintf( text, sizeof(text), "ERR %d\n", err );
+        _daemon_send( fd, text );
+    }
+    stop_wall_timer( end );
+    debug("Request %llu : err = %d, %.6f s", (unsigned long long)ctx->requests, err, wall_time_taken( begin, end ));
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Write a whole reply to a client
+ */
+/*****************************************************************************/
+static api_Err_Status _daemon_send( int fd, char *text )
+{
+    size_t len = strlen( text ) ;
+    ssize_t sent = 0 ;
+
+    while( len != 0 ) {
+        sent = send( fd, text, len, MSG_NOSIGNAL );
+        if((sent < 0) && (errno == EINTR))
+            continue ;
+        if( sent <= 0 )
+            return api_Err_File ;
+        text += sent ;
+        len -= (size_t)sent ;
+    }
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  SIGINT / SIGTERM : leave the event loop
+ */
+/*****************************************************************************/
+static void _daemon_on_signal( int sig )
+{
+    (void)sig ;
+    g_daemon_signal = 1 ;
+    return ;
+}
@@ -25,103 +25,796 @@
 #include <string.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <time.h>
+#include <errno.h>
 
 #include "api_err.h"
 #include "debug.h"
 #include "datatype.h"
 #include "add_v_options.h"
 #include "program_options.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "expr_eval.h"
+#include "transpose.h"
+#include "sparse.h"
+#include "ragged.h"
+#include "half.h"
+#include "add_v_batch.h"
+#include "array_cache.h"
+#include "add_v_daemon.h"
+#include "shm_array.h"
+#include "huge_pages.h"
+#include "mem_track.h"
+
+
+/*!
+ * State of a dense job. show / show_meta point at the array to output : an
+ * input, the expression result or the permuted result
+ */
+typedef struct __Dense_Job__
+{
+    void *buff[MAX_INPUT_FILES] ;
+    Vector_MetaData meta[MAX_INPUT_FILES] ;
+    Sparse_Data sp[MAX_INPUT_FILES] ;
+    Sparse_Data sp_sum ;                 /* sparse inputs only : the result */
+    void *result ;
+    Vector_MetaData res_meta ;
+    void *permuted ;
+    Vector_MetaData perm_meta ;
+    void *show ;
+    Vector_MetaData *show_meta ;
+    Expr_Node *expr ;
+    Array_Cache *cache ;                 /* inputs are borrowed from a daemon cache */
+    Shm_Array shm[MAX_INPUT_FILES] ;     /* -x : inputs, result and permuted result */
+    Shm_Array shm_res ;                  /*      live in shared memory */
+    Shm_Array shm_perm ;
+    uint32_t shared ;                    /* some inputs are borrowed : do not modify them */
+    uint32_t sliced ;                    /* inputs are slices copied from the cache : owned */
+} Dense_Job ;
+
+#define SHM_INPUT_PREFIX   "shm:"        /* -f shm:/name maps an exported array */
+
+static uint32_t g_out_seq = 0 ;          /* temporary output names of concurrent batch jobs */
+
+static void _print_value( FILE *, void *, Data_Type, uint64_t );
+static void display_data( FILE *, void *, Vector_MetaData * );
+static void display_sparse( FILE *, Sparse_Data * );
+static void display_ragged( FILE *, Ragged_Data * );
+static api_Err_Status run_job( Program_Options * );
+static api_Err_Status dense_main( Program_Options *, FILE * );
+static api_Err_Status dense_eval( Program_Options *, Dense_Job * );
+static void dense_release( Dense_Job * );
+static api_Err_Status dense_alloc( Program_Options *, Shm_Array *, char *, void **, Vector_MetaData * );
+static void dense_free( Shm_Array *, void **, Vector_MetaData * );
+static api_Err_Status daemon_job( Program_Options *, Array_Cache *, Daemon_Reply * );
+static api_Err_Status ragged_main( Program_Options *, FILE * );
 
 int main( int argc , char *argv[] )
 {
     api_Err_Status err = api_Success ;
-    uint16_t  *buff1D = NULL , **buff2D = NULL , ***buff3D = NULL ;
-    uint32_t idx_i, idx_j, idx_k ;
+    uint32_t idx_i ;
 
     Program_Options p_opt ;
-    Vector_MetaData meta ;
 
     memset(&p_opt, 0, sizeof(Program_Options));
-    memset(&meta, 0, sizeof(Vector_MetaData));
 
     err = parse_cmdline( argc, argv, &p_opt);
     if( err != api_Success ) {
-        debug("Error parsing cmdline options. err=%d", err );
+        log_error("Error parsing cmdline options. err=%d", err );
+        goto err_main ;
+    }
+    if( p_opt.hugepages >= 0 )
+        huge_set_policy((Huge_Policy)p_opt.hugepages );
+    if( p_opt.mem_limit != 0 )
+        mem_set_limit( p_opt.mem_limit );
+
+    /* many jobs sharing this process and its thread pool */
+    if( p_opt.batch != NULL ) {
+        debug("Batch manifest : [%s]", p_opt.batch);
+        err = batch_run( argv[0], &p_opt, run_job );
+        goto err_main ;
+    }
+    if( p_opt.daemon != NULL ) {
+        debug("Daemon socket : [%s]", p_opt.daemon);
+        err = daemon_run( argv[0], &p_opt, daemon_job );
         goto err_main ;
     }
 
     debug("===============================================");
     debug("Command-line Options :");
-    debug("File-name : [%s]", p_opt.file);
+    for( idx_i=0 ; idx_i < p_opt.no_files ; idx_i++ )
+        debug("File-name (%c) : [%s]", 'a' + idx_i, p_opt.file[idx_i]);
+    for( idx_i=0 ; idx_i < p_opt.no_sparse ; idx_i++ )
+        debug("Sparse file : [%s]", p_opt.sparse[idx_i]);
     debug("Separator String : [%s]", p_opt.sep);
     debug("DataType-value: [%u]", p_opt.type);
+    if( p_opt.expr != NULL )
+        debug("Expression : [%s]", p_opt.expr);
+    if( p_opt.perm != NULL )
+        debug("Permutation : [%s]", p_opt.perm);
+    if( p_opt.output != NULL )
+        debug("Output : [%s]", p_opt.output);
+    if( p_opt.shm_prefix != NULL )
+        debug("Shared memory : [%s]", p_opt.shm_prefix);
     debug("===============================================");
 
-    meta.type = p_opt.type ;
-#if 0
-    err = read_data((void **)&buff1D, &meta, p_opt.file, p_opt.sep );
+    err = run_job( &p_opt );
+
+err_main :
+    clean_cmdline_opts( &p_opt );
+    tpool_default_release();
+    perf_report();
+    huge_summary();
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Run one job : check its options, compute and write the result.
+ *         Also called concurrently for the lines of a batch manifest
+ * \param  *p_opt - options of the job
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status run_job( Program_Options *p_opt )
+{
+    api_Err_Status err = api_Success ;
+    FILE *out = stdout ;
+    char tmp[4096] ;
+
+    if(((p_opt->no_files == 0) && (p_opt->no_sparse == 0)) || (p_opt->sep == NULL) || (p_opt->type == DataType_MaxTypes)) {
+        log_error("Input file, separators and data-type have to be provided");
+        err = api_Err_Param ;
+        goto err_run_job ;
+    }
+    if((p_opt->shm_prefix != NULL) && (p_opt->ragged || (p_opt->shm_prefix[0] != '/') ||
+                                       (strchr((char *)p_opt->shm_prefix + 1, '/') != NULL))) {
+        log_error("Shared memory name [%s] must be /<name>, and ragged inputs cannot be exported", p_opt->shm_prefix);
+        err = api_Err_Param ;
+        goto err_run_job ;
+    }
+
+    /* written under a temporary name and renamed once the job succeeded :
+       a failed job leaves no output, nor truncates an earlier one */
+    if( p_opt->output != NULL ) {
+        snprintf( tmp, sizeof(tmp), "%s.%ld.%u.tmp", (char *)p_opt->output, (long)getpid(),
+                  __atomic_fetch_add( &g_out_seq, 1, __ATOMIC_RELAXED ));
+        out = fopen( tmp, "w");
+        if( out == NULL ) {
+            log_error("Could not open output file [%s]. errno = %d", tmp, errno);
+            err = api_Err_File ;
+            goto err_run_job ;
+        }
+    }
+
+    err = (p_opt->ragged) ? ragged_main( p_opt, out ) : dense_main( p_opt, out );
+
+    if( out != stdout ) {
+        if( fclose( out ) != 0 ) {
+            log_error("Error closing output file [%s]. errno = %d", p_opt->output, errno);
+            err = (err == api_Success) ? api_Err_File : err ;
+        }
+        if((err == api_Success) && (rename( tmp, (char *)p_opt->output ) != 0)) {
+            log_error("Could not rename [%s] to [%s]. errno = %d", tmp, p_opt->output, errno);
+            err = api_Err_File ;
+        }
+        if( err != api_Success )
+            unlink( tmp );
+    }
+
+err_run_job :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Dense inputs (plus optional sparse inputs) : compute and display
+ * \param  *p_opt - options of the job
+ * \param  *out - stream the result is written to
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status dense_main( Program_Options *p_opt, FILE *out )
+{
+    api_Err_Status err = api_Success ;
+    Dense_Job job ;
+    Mem_Stage stage = Mem_Other ;
+
+    memset( &job, 0, sizeof(job));
+    err = dense_eval( p_opt, &job );
+    if( err == api_Success ) {
+        stage = mem_stage_set( Mem_Write );
+        if( job.show == NULL )
+            display_sparse( out, &job.sp_sum );
+        else
+            display_data( out, job.show, job.show_meta );
+        mem_stage_set( stage );
+    }
+    dense_release( &job );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Daemon request : compute a dense job over cached inputs and hand
+ *         the result to the reply
+ * \param  *p_opt - options of the request
+ * \param  *cache - resident inputs
+ * \param  *reply - reply of the request
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status daemon_job( Program_Options *p_opt, Array_Cache *cache, Daemon_Reply *reply )
+{
+    api_Err_Status err = api_Success ;
+    Dense_Job job ;
+
+    memset( &job, 0, sizeof(job));
+    if((p_opt->no_files == 0) || (p_opt->sep == NULL) || (p_opt->type == DataType_MaxTypes) ||
+       p_opt->ragged || (p_opt->output != NULL) || (p_opt->shm_prefix != NULL)) {
+        log_error("Daemon requests need dense inputs, separators and a data-type, and cannot be ragged or use -o/-x");
+        err = api_Err_Param ;
+        goto err_daemon_job ;
+    }
+
+    job.cache = cache ;
+    err = dense_eval( p_opt, &job );
+    if( err == api_Success )
+        err = daemon_reply_array( reply, job.show, job.show_meta );
+
+err_daemon_job :
+    dense_release( &job );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Dense inputs (plus optional sparse inputs) : read, evaluate the
+ *         expression, scatter sparse inputs and permute. On return job->show
+ *         is the array to output, or NULL when only sparse inputs were given
+ *         and job->sp_sum holds their sum
+ * \param  *p_opt - options of the job
+ * \param  *job - job state, zeroed by the caller (job->cache may be set)
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status dense_eval( Program_Options *p_opt, Dense_Job *job )
+{
+    api_Err_Status err = api_Success ;
+    Sparse_Data sp_tmp ;
+    uint32_t perm[PERMUTE_MAX_DIMS] ;
+    uint32_t idx_i ;
+    char name[SHM_ARRAY_NAME_MAX] ;
+    Mem_Stage stage = mem_stage();
+
+    memset(&sp_tmp, 0, sizeof(sp_tmp));
+
+    job->shared = (job->cache != NULL) ;
+    parse_set_strict( p_opt->strict ? 1 : -1 );
+    if( p_opt->slice && (p_opt->shm_prefix != NULL)) {
+        log_error("Slices (-l) are loaded from files : not with -x");
+        err = api_Err_Param ;
+        goto err_dense_eval ;
+    }
+    for( idx_i=0 ; idx_i < p_opt->no_files ; idx_i++ ) {
+        job->meta[idx_i].type = p_opt->type ;
+        if( strncmp((char *)p_opt->file[idx_i], SHM_INPUT_PREFIX, strlen(SHM_INPUT_PREFIX)) == 0 ) {
+            /* exported by another process : mapped read-only, not parsed */
+            err = shm_array_open( &job->shm[idx_i], (char *)p_opt->file[idx_i] + strlen(SHM_INPUT_PREFIX), -1 );
+            job->buff[idx_i] = job->shm[idx_i].buff ;
+            job->meta[idx_i] = job->shm[idx_i].meta ;
+            job->shared = 1 ;
+            if((err == api_Success) && (job->meta[idx_i].type != p_opt->type)) {
+                log_error("[%s] holds %s values", p_opt->file[idx_i], datatype_name( job->meta[idx_i].type ));
+                err = api_Err_Param ;
+            } else if((err == api_Success) && p_opt->slice) {
+                log_error("[%s] is in shared memory : slices (-l) are loaded from files", p_opt->file[idx_i]);
+                err = api_Err_Param ;
+            }
+        } else if((job->cache != NULL) && p_opt->slice ) {
+            /* only the blocks of records the slice covers are parsed */
+            err = cache_get_range( job->cache, (char *)p_opt->file[idx_i], p_opt->sep, p_opt->slice_first,
+                                   p_opt->slice_count, &job->buff[idx_i], &job->meta[idx_i] );
+            job->sliced = 1 ;
+        } else if( job->cache != NULL ) {
+            err = cache_get( job->cache, (char *)p_opt->file[idx_i], p_opt->sep, &job->buff[idx_i], &job->meta[idx_i] );
+        } else if( p_opt->shm_prefix != NULL ) {
+            /* parsed straight into the shared object */
+            snprintf( name, sizeof(name), "%s.%c", p_opt->shm_prefix, 'a' + idx_i );
+            err = shm_array_load( &job->shm[idx_i], name, (char *)p_opt->file[idx_i], p_opt->sep, p_opt->type );
+            job->buff[idx_i] = job->shm[idx_i].buff ;
+            job->meta[idx_i] = job->shm[idx_i].meta ;
+            if( err == api_Success )
+                debug("Exported [%s]", name);
+        } else if( p_opt->slice ) {
+            err = read_data_range( &job->buff[idx_i], &job->meta[idx_i], (char *)p_opt->file[idx_i], p_opt->sep,
+                                   p_opt->slice_first, p_opt->slice_count );
+        } else {
+            err = read_data(&job->buff[idx_i], &job->meta[idx_i], p_opt->file[idx_i], p_opt->sep );
+        }
+        if( err != api_Success ) {
+            log_error("Could not read data from file[%s]. separator-list[%s]. Error = %d"
+                                                 , p_opt->file[idx_i], p_opt->sep, err);
+            goto err_dense_eval ;
+        }
+        debug("[%s] : text hash %016llx, data hash %016llx", p_opt->file[idx_i],
+                    (unsigned long long)job->meta[idx_i].text_hash, (unsigned long long)job->meta[idx_i].data_hash);
+    }
+
+    for( idx_i=0 ; idx_i < p_opt->no_sparse ; idx_i++ ) {
+        job->sp[idx_i].meta.type = p_opt->type ;
+        err = sparse_read( &job->sp[idx_i], p_opt->sparse[idx_i], p_opt->sep );
+        if( err != api_Success ) {
+            log_error("Could not read sparse data from file[%s]. Error = %d", p_opt->sparse[idx_i], err);
+            goto err_dense_eval ;
+        }
+    }
+
+    /* sparse inputs only : the sum stays sparse */
+    if( p_opt->no_files == 0 ) {
+        if((p_opt->expr != NULL) || (p_opt->perm != NULL)) {
+            log_error("Expressions and permutations need at least one dense input");
+            err = api_Err_Param ;
+            goto err_dense_eval ;
+        }
+        job->sp_sum = job->sp[0] ;
+        memset( &job->sp[0], 0, sizeof(job->sp[0]));
+        for( idx_i=1 ; idx_i < p_opt->no_sparse ; idx_i++ ) {
+            err = sparse_add( &sp_tmp, &job->sp_sum, &job->sp[idx_i] );
+            if( err != api_Success ) {
+                log_error("Could not add sparse input [%s]. err = %d", p_opt->sparse[idx_i], err);
+                goto err_dense_eval ;
+            }
+            sparse_free( &job->sp_sum );
+            job->sp_sum = sp_tmp ;
+            memset( &sp_tmp, 0, sizeof(sp_tmp));
+        }
+        goto err_dense_eval ;
+    }
+
+    job->show = job->buff[0] ;
+    job->show_meta = &job->meta[0] ;
+    stage = mem_stage_set( Mem_Compute );
+    if((p_opt->expr == NULL) && (p_opt->shm_prefix == NULL) && (!job->shared || (p_opt->no_sparse == 0)))
+        goto sparse_main ;
+
+    /* fused evaluation of the expression over all inputs. Borrowed inputs
+       are shared and exported inputs stay as read : sparse inputs go to a
+       copy, made by the expression "a" */
+    err = expr_parse( &job->expr, (p_opt->expr != NULL) ? p_opt->expr : (uint8_t *)"a", job->buff, job->meta, p_opt->no_files );
     if( err != api_Success ) {
-        debug("Could not read data from file[%s]. separator-list[%s]. Error = %d"
-                                                         , p_opt.file, p_opt.sep, err);
-        goto err_main ;
+        log_error("Could not parse expression [%s]. err = %d", p_opt->expr, err);
+        goto err_dense_eval ;
     }
 
+    /* operands of other shapes broadcast : the result takes the larger extents */
+    err = expr_result_meta( job->expr, &job->res_meta );
+    if( err != api_Success ) {
+        log_error("Operands of expression [%s] do not broadcast to one shape. err = %d", p_opt->expr, err);
+        goto err_dense_eval ;
+    }
 
-    /* Display data */
-    debug("Data :") ;
-    for(idx_i=0 ; idx_i < meta.dim.dim_1d.items ; idx_i++ ) {
-        if((idx_i % 16) == 0 )
-            printf("\n [%04x] ", idx_i);
-        printf("% 4d ", buff1D[idx_i]);
+    /* a += b : the result goes over the first input, no third array. Only
+       for inputs this job owns, and shaped like the result */
+    if( p_opt->in_place && !job->shared && (p_opt->shm_prefix == NULL) &&
+        data_same_shape( &job->res_meta, &job->meta[0] )) {
+        err = expr_evaluate( job->expr, job->buff[0], &job->meta[0] );
+        if( err != api_Success ) {
+            log_error("Could not evaluate expression [%s]. err = %d", p_opt->expr, err);
+            goto err_dense_eval ;
+        }
+        goto sparse_main ;
     }
-    printf("\n");
-    debug("===============================================");
-#endif
-#if 0
-    err = read_data((void **)&buff2D, &meta, p_opt.file, p_opt.sep );
+    if( p_opt->in_place )
+        log_warn("Input [%s] is shared, exported or smaller than the result : result goes to a new array", p_opt->file[0]);
+
+    err = dense_alloc( p_opt, &job->shm_res, "out", &job->result, &job->res_meta );
     if( err != api_Success ) {
-        debug("Could not read data from file[%s]. separator-list[%s]. Error = %d"
-                                                         , p_opt.file, p_opt.sep, err);
-        goto err_main ;
+        log_error("Could not allocate result array. err = %d", err);
+        goto err_dense_eval ;
+    }
+
+    err = expr_evaluate( job->expr, job->result, &job->res_meta );
+    if( err != api_Success ) {
+        log_error("Could not evaluate expression [%s]. err = %d", p_opt->expr, err);
+        goto err_dense_eval ;
+    }
+    job->show = job->result ;
+    job->show_meta = &job->res_meta ;
+
+sparse_main :
+    /* scatter sparse inputs into the dense result where it lies */
+    for( idx_i=0 ; idx_i < p_opt->no_sparse ; idx_i++ ) {
+        err = sparse_add_dense( job->show, job->show_meta, &job->sp[idx_i], job->show, job->show_meta );
+        if( err != api_Success ) {
+            log_error("Could not add sparse input [%s]. err = %d", p_opt->sparse[idx_i], err);
+            goto err_dense_eval ;
+        }
     }
 
-    /* Display data */
+    if( p_opt->perm != NULL ) {
+        err = parse_permutation( perm, p_opt->perm, job->show_meta->no_dims );
+        if( err == api_Success )
+            err = permute_result_meta( &job->perm_meta, job->show_meta, perm );
+        if( err != api_Success ) {
+            log_error("Invalid permutation [%s] for %u-D data. err = %d", p_opt->perm, job->show_meta->no_dims, err);
+            goto err_dense_eval ;
+        }
+
+        /* a square result owned by us is transposed where it lies */
+        if((job->show == job->result) && (job->show_meta->no_dims == 2) && (perm[0] == 1) &&
+           (job->show_meta->dim.dim_2d.rows == job->show_meta->dim.dim_2d.cols)) {
+            err = transpose_2d_inplace( job->show, job->show_meta );
+        } else {
+            err = dense_alloc( p_opt, &job->shm_perm, "perm", &job->permuted, &job->perm_meta );
+            if( err == api_Success )
+                err = permute_axes( job->permuted, &job->perm_meta, job->show, job->show_meta, perm );
+            job->show = job->permuted ;
+            job->show_meta = &job->perm_meta ;
+        }
+        if( err != api_Success ) {
+            log_error("Could not permute axes [%s]. err = %d", p_opt->perm, err);
+            goto err_dense_eval ;
+        }
+    }
+
+err_dense_eval :
+    mem_stage_set( stage );
+    sparse_free( &sp_tmp );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release everything a dense job holds. Cached inputs are handed
+ *         back to the cache
+ * \param  *job - job state
+ * \return void
+ */
+/*****************************************************************************/
+static void dense_release( Dense_Job *job )
+{
+    uint32_t idx_i ;
+
+    expr_free( &job->expr );
+    dense_free( &job->shm_res, &job->result, &job->res_meta );
+    dense_free( &job->shm_perm, &job->permuted, &job->perm_meta );
+    for( idx_i=0 ; idx_i < MAX_INPUT_FILES ; idx_i++ ) {
+        if((job->cache != NULL) && !job->sliced && (job->buff[idx_i] != NULL) && (job->shm[idx_i].hdr == NULL))
+            cache_put( job->cache, job->buff[idx_i] );
+        else
+            dense_free( &job->shm[idx_i], &job->buff[idx_i], &job->meta[idx_i] );
+        job->buff[idx_i] = NULL ;
+        sparse_free( &job->sp[idx_i] );
+    }
+    sparse_free( &job->sp_sum );
+    job->show = NULL ;
+    job->show_meta = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate a result array, in shared memory as /<prefix>.<suffix>
+ *         when the job exports its arrays
+ * \param  *p_opt - options of the job
+ * \param  *sa - shared memory array, used with -x
+ * \param  *suffix - name of the array within the export
+ * \param  **out - output array
+ * \param  *meta - type and dimensions of the array
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status dense_alloc( Program_Options *p_opt, Shm_Array *sa, char *suffix, void **out, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    char name[SHM_ARRAY_NAME_MAX] ;
+
+    if( p_opt->shm_prefix == NULL )
+        return alloc_data( out, meta );
+
+    snprintf( name, sizeof(name), "%s.%s", p_opt->shm_prefix, suffix );
+    err = shm_array_create( sa, name, meta );
+    if( err == api_Success ) {
+        *out = sa->buff ;
+        debug("Exported [%s]", name);
+    }
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release an array of a dense job. Exported arrays are unmapped and
+ *         left in shared memory
+ * \param  *sa - shared memory array, unused unless mapped
+ * \param  **buff - array, set to NULL
+ * \param  *meta - meta-data of the array
+ * \return void
+ */
+/*****************************************************************************/
+static void dense_free( Shm_Array *sa, void **buff, Vector_MetaData *meta )
+{
+    if( sa->hdr != NULL ) {
+        shm_array_close( sa, 0 );
+        *buff = NULL ;
+    } else {
+        clean_data( buff, meta );
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Ragged inputs : the expression is evaluated over the value buffers
+ *         of inputs sharing one shape, the result keeps that shape
+ * \param  *p_opt - options of the job
+ * \param  *out - stream the result is written to
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status ragged_main( Program_Options *p_opt, FILE *out )
+{
+    api_Err_Status err = api_Success ;
+    Ragged_Data rg[MAX_INPUT_FILES] , res ;
+    Vector_MetaData meta[MAX_INPUT_FILES] , res_meta ;
+    void *vals[MAX_INPUT_FILES] ;
+    Expr_Node *expr = NULL ;
+    uint32_t idx_i = 0 ;
+
+    memset( rg, 0, sizeof(rg));
+    memset( &res, 0, sizeof(res));
+    memset( vals, 0, sizeof(vals));
+
+    if((p_opt->no_files == 0) || (p_opt->no_sparse != 0) || (p_opt->perm != NULL) || p_opt->slice) {
+        log_error("Ragged inputs are given with -f and cannot be mixed with sparse inputs, permutations or slices");
+        err = api_Err_Param ;
+        goto err_ragged_main ;
+    }
+
+    for( idx_i=0 ; idx_i < p_opt->no_files ; idx_i++ ) {
+        rg[idx_i].type = p_opt->type ;
+        err = ragged_read( &rg[idx_i], p_opt->file[idx_i], p_opt->sep );
+        if( err != api_Success ) {
+            log_error("Could not read ragged data from file[%s]. Error = %d", p_opt->file[idx_i], err);
+            goto err_ragged_main ;
+        }
+        if( !ragged_same_shape( &rg[0], &rg[idx_i] )) {
+            log_error("Row lengths of [%s] differ from [%s]", p_opt->file[idx_i], p_opt->file[0]);
+            err = api_Err_Param ;
+            goto err_ragged_main ;
+        }
+        ragged_values( &rg[idx_i], &meta[idx_i] );
+        vals[idx_i] = rg[idx_i].val ;
+    }
+
+    if( p_opt->expr == NULL ) {
+        display_ragged( out, &rg[0] );
+        goto err_ragged_main ;
+    }
+
+    err = expr_parse( &expr, p_opt->expr, vals, meta, p_opt->no_files );
+    if( err != api_Success ) {
+        log_error("Could not parse expression [%s]. err = %d", p_opt->expr, err);
+        goto err_ragged_main ;
+    }
+    if( p_opt->in_place ) {
+        err = expr_evaluate( expr, rg[0].val, &meta[0] );
+    } else {
+        err = ragged_alloc_like( &res, &rg[0] );
+        if( err != api_Success )
+            goto err_ragged_main ;
+        ragged_values( &res, &res_meta );
+        err = expr_evaluate( expr, res.val, &res_meta );
+    }
+    if( err != api_Success ) {
+        log_error("Could not evaluate expression [%s]. err = %d", p_opt->expr, err);
+        goto err_ragged_main ;
+    }
+    display_ragged( out, p_opt->in_place ? &rg[0] : &res );
+
+err_ragged_main :
+    expr_free( &expr );
+    ragged_free( &res );
+    for( idx_i=0 ; idx_i < MAX_INPUT_FILES ; idx_i++ )
+        ragged_free( &rg[idx_i] );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Display an array read by read_data() (or computed from one)
+ * \param  *out - output stream
+ * \param  *buff - N-dimensional array
+ * \param  *meta - meta-data of the array
+ * \return void
+ */
+/*****************************************************************************/
+static void display_data( FILE *out, void *buff, Vector_MetaData *meta )
+{
+    uint64_t idx_i, idx_j, idx_k , rows = 0 ;
+    uint64_t sub[DATA_MAX_DIMS] ;
+    uint32_t axis = 0 ;
+    void *payload = data_payload( buff, meta );
+
+    if( payload == NULL ) {
+        debug("Nothing to display");
+        return ;
+    }
+
+    /* queued messages first; batch jobs sharing stdout : keep a result in one piece */
     debug("Data :") ;
-    for(idx_i=0 ; idx_i < meta.dim.dim_2d.rows ; idx_i++ ) {
-        printf("\n[%u] ", idx_i);
-        for(idx_j=0 ; idx_j < meta.dim.dim_2d.cols ; idx_j++ )
-            printf("% 4d ", buff2D[idx_i][idx_j] );
+    log_flush();
+    flockfile( out );
+    switch( meta->no_dims )
+    {
+        case 1 :
+            for(idx_i=0 ; idx_i < meta->dim.dim_1d.items ; idx_i++ ) {
+                if((idx_i % 16) == 0 )
+                    fprintf( out, "\n [%04llx] ", (unsigned long long)idx_i);
+                _print_value( out, payload, meta->type, idx_i );
+            }
+            break ;
+        case 2 :
+            for(idx_i=0 ; idx_i < meta->dim.dim_2d.rows ; idx_i++ ) {
+                fprintf( out, "\n[%llu] ", (unsigned long long)idx_i);
+                for(idx_j=0 ; idx_j < meta->dim.dim_2d.cols ; idx_j++ )
+                    _print_value( out, payload, meta->type, (idx_i * meta->dim.dim_2d.cols) + idx_j );
+            }
+            break ;
+        case 3 :
+            for(idx_i=0 ; idx_i < meta->dim.dim_3d.dim_z ; idx_i++ ) {
+                fprintf( out, "\n[z-%llu] ", (unsigned long long)idx_i);
+                for(idx_j=0 ; idx_j < meta->dim.dim_3d.dim_y ; idx_j++ ) {
+                    fprintf( out, "| <y-%llu> ", (unsigned long long)idx_j);
+                    for(idx_k=0 ; idx_k < meta->dim.dim_3d.dim_x ; idx_k++ )
+                        _print_value( out, payload, meta->type,
+                                      (((idx_i * meta->dim.dim_3d.dim_y) + idx_j) * meta->dim.dim_3d.dim_x) + idx_k );
+                }
+            }
+            break ;
+        default :
+            if((meta->no_dims > DATA_MAX_DIMS) || (data_items( meta ) == 0)) {
+                log_warn("Cannot display %u-dimensional data", meta->no_dims);
+                break ;
+            }
+            /* one line per innermost row, prefixed with its outer subscripts */
+            rows = data_items( meta ) / meta->dim.shape[meta->no_dims - 1] ;
+            for(idx_i=0 ; idx_i < rows ; idx_i++ ) {
+                fprintf( out, "\n[");
+                for(axis=0, idx_j=idx_i ; (axis + 1) < meta->no_dims ; axis++ ) {
+                    idx_k = meta->no_dims - 2 - axis ;
+                    sub[idx_k] = idx_j % meta->dim.shape[idx_k] ;
+                    idx_j /= meta->dim.shape[idx_k] ;
+                }
+                for(axis=0 ; (axis + 1) < meta->no_dims ; axis++ )
+                    fprintf( out, (axis == 0) ? "%llu" : ",%llu", (unsigned long long)sub[axis]);
+                fprintf( out, "] ");
+                for(idx_k=0 ; idx_k < meta->dim.shape[meta->no_dims - 1] ; idx_k++ )
+                    _print_value( out, payload, meta->type, (idx_i * meta->dim.shape[meta->no_dims - 1]) + idx_k );
+            }
+            break ;
     }
-    printf("\n");
+    fprintf( out, "\n");
+    funlockfile( out );
     debug("===============================================");
-#endif
-//#if 0
-    err = read_data((void **)&buff3D, &meta, p_opt.file, p_opt.sep );
-    if( err != api_Success ) {
-        debug("Could not read data from file[%s]. separator-list[%s]. Error = %d"
-                                                         , p_opt.file, p_opt.sep, err);
-        goto err_main ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Display the stored entries of a sparse array, as index:value
+ * \param  *out - output stream
+ * \param  *sp - sparse array
+ * \return void
+ */
+/*****************************************************************************/
+static void display_sparse( FILE *out, Sparse_Data *sp )
+{
+    uint64_t row = 0 , rows = 0 , idx_k = 0 ;
+
+    rows = (sp->meta.no_dims == 2) ? sp->meta.dim.dim_2d.rows : 1 ;
+    debug("Sparse data : %llu entries", (unsigned long long)sp->nnz) ;
+    log_flush();
+    flockfile( out );
+    for( row=0 ; row < rows ; row++ ) {
+        fprintf( out, "\n[%llu] ", (unsigned long long)row);
+        for( idx_k=sp->row_ptr[row] ; idx_k < sp->row_ptr[row + 1] ; idx_k++ ) {
+            fprintf( out, "%llu%c", (unsigned long long)sp->col[idx_k], SPARSE_INDEX_SEP);
+            _print_value( out, sp->val, sp->meta.type, idx_k );
+        }
     }
+    fprintf( out, "\n");
+    funlockfile( out );
+    debug("===============================================");
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Display a ragged array, one row per line
+ * \param  *out - output stream
+ * \param  *rg - ragged array
+ * \return void
+ */
+/*****************************************************************************/
+static void display_ragged( FILE *out, Ragged_Data *rg )
+{
+    uint64_t *row_off = rg->offset[rg->no_dims - 2] ;
+    uint64_t idx_p = 0 , idx_r = 0 , idx_k = 0 , first = 0 , last = rg->count[0] ;
 
-    /* Display data */
     debug("Data :") ;
-    for(idx_i=0 ; idx_i < meta.dim.dim_3d.dim_z ; idx_i++ ) {
-        printf("\n[z-%u] ", idx_i);
-        for(idx_j=0 ; idx_j < meta.dim.dim_3d.dim_y ; idx_j++ ) {
-            printf("| <y-%u> ", idx_j);
-            for(idx_k=0 ; idx_k < meta.dim.dim_3d.dim_x ; idx_k++ )
-                printf("%d,", buff3D[idx_i][idx_j][idx_k] );
+    log_flush();
+    flockfile( out );
+    for( idx_p=0 ; idx_p < ((rg->no_dims == 3) ? rg->count[0] : 1) ; idx_p++ ) {
+        if( rg->no_dims == 3 ) {
+            fprintf( out, "\n[z-%llu] ", (unsigned long long)idx_p);
+            first = rg->offset[0][idx_p] ;
+            last = rg->offset[0][idx_p + 1] ;
+        }
+        for( idx_r=first ; idx_r < last ; idx_r++ ) {
+            if( rg->no_dims == 3 )
+                fprintf( out, "| <y-%llu> ", (unsigned long long)(idx_r - first));
+            else
+                fprintf( out, "\n[%llu] ", (unsigned long long)idx_r);
+            for( idx_k=row_off[idx_r] ; idx_k < row_off[idx_r + 1] ; idx_k++ )
+                _print_value( out, rg->val, rg->type, idx_k );
         }
     }
-    printf("\n");
+    fprintf( out, "\n");
+    funlockfile( out );
     debug("===============================================");
-//#endif
+    return ;
+}
 
 
-err_main :
-    clean_data((void **)&buff1D, &meta );
-    clean_data((void **)&buff2D, &meta );
-    clean_data((void **)&buff3D, &meta );
-    clean_cmdline_opts( &p_opt );
-    return err ;
+
+/*****************************************************************************/
+/*!
+ * \brief  Print one element of a contiguous array of the given type
+ * \return void
+ */
+/*****************************************************************************/
+static void _print_value( FILE *out, void *payload, Data_Type type, uint64_t idx )
+{
+    switch( type )
+    {
+        case DataType_uint8       : fprintf( out, "%u ",   ((uint8_t *)payload)[idx]) ; break ;
+        case DataType_uint16      : fprintf( out, "%u ",   ((uint16_t *)payload)[idx]) ; break ;
+        case DataType_uint32      : fprintf( out, "%u ",   ((uint32_t *)payload)[idx]) ; break ;
+        case DataType_uint64      : fprintf( out, "%llu ", (unsigned long long)((uint64_t *)payload)[idx]) ; break ;
+        case DataType_int8        : fprintf( out, "%d ",   ((int8_t *)payload)[idx]) ; break ;
+        case DataType_int16       : fprintf( out, "%d ",   ((int16_t *)payload)[idx]) ; break ;
+        case DataType_int32       : fprintf( out, "%d ",   ((int32_t *)payload)[idx]) ; break ;
+        case DataType_int64       : fprintf( out, "%lld ", (long long)((int64_t *)payload)[idx]) ; break ;
+        case DataType_float       : fprintf( out, "%g ",   ((float *)payload)[idx]) ; break ;
+        case DataType_double      : fprintf( out, "%g ",   ((double *)payload)[idx]) ; break ;
+        case DataType_long_double : fprintf( out, "%Lg ",  ((long double *)payload)[idx]) ; break ;
+        case DataType_float16     : fprintf( out, "%g ",   half_to_f32(((uint16_t *)payload)[idx])) ; break ;
+        case DataType_bfloat16    : fprintf( out, "%g ",   bf16_to_f32(((uint16_t *)payload)[idx])) ; break ;
+        default : break ;
+    }
+    return ;
 }
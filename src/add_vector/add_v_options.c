@@ -28,15 +28,30 @@
 
 #include "api_err.h"
 #include "datatype.h"
+#include "huge_pages.h"
+#include "mem_track.h"
 #include "add_v_options.h"
 #include "program_options.h"
 #include "debug.h"
 
 Option_Help g_help_strings[] =
 {
-    { .option = 'f', .option_text = "-f,--file...input data file. Each data point is line-separated"                                 },
-    { .option = 'd', .option_text = "-d,--dtype..data-types. Use (u)int8,(u)int16,(u)int32,(u)int64,float,double,longdouble"         },
-    { .option = 's', .option_text = "-s,--sep....Separator list. Separators should be in reverse order. [^:|] implies x->^,y->:,z->|"},
+    { .option = 'f', .option_text = "-f,--file...input data file, or shm:/<name> exported with -x. Repeat for inputs a,b,c,... in expressions"},
+    { .option = 'S', .option_text = "-S,--sparse.sparse index:value input file, added to the result. Repeatable"                    },
+    { .option = 'd', .option_text = "-d,--dtype..data-types. Use (u)int8,(u)int16,(u)int32,(u)int64,float,double,longdouble,float16,bfloat16"},
+    { .option = 's', .option_text = "-s,--sep....Separator list. Separators should be in reverse order. [^:|] implies x->^,y->:,z->|, up to 8 axes"},
+    { .option = 'e', .option_text = "-e,--expr...element-wise expression over inputs, e.g. \"a + b + c*d - e\". Integer x/0 gives 0, with a warning"},
+    { .option = 'p', .option_text = "-p,--permute.axis order of the output, outermost first. \"1,0\" transposes 2D, \"2,1,0\" reverses 3D"},
+    { .option = 'i', .option_text = "-i,--in-place.the expression result overwrites input a instead of a new array"           },
+    { .option = 'r', .option_text = "-r,--ragged.inputs have rows of varying length. Expression is applied along the values"        },
+    { .option = 'c', .option_text = "-c,--strict.check every value's syntax and range for the data-type, report line:column of the first bad one"},
+    { .option = 'H', .option_text = "-H,--hugepages.off|thp|explicit : page size of file text and arrays. Whole process, default HETERO_HUGEPAGES"},
+    { .option = 'l', .option_text = "-l,--slice..first[:count] : load only these rows (planes, ...) of each input, via its .idx row index"},
+    { .option = 'M', .option_text = "-M,--mem-limit.bytes (K/M/G suffix) the process may allocate; input text is streamed to stay under it. Whole process"},
+    { .option = 'o', .option_text = "-o,--output.write the result to a file instead of stdout"                                      },
+    { .option = 'x', .option_text = "-x,--export.place inputs and results in shared memory /<name>.a,.b,...,.out,.perm with an array header"},
+    { .option = 'b', .option_text = "-b,--batch..manifest of jobs, one set of these options per line. -d/-s/-c given here are defaults"},
+    { .option = 'D', .option_text = "-D,--daemon.serve job requests on this unix socket, results in shared memory. -d/-s/-c are defaults"},
     { .option = 'h', .option_text = "-h,--help...this help menu"                                                                     },
     { .option =  0 , .option_text = NULL                                                                                             },
 };
@@ -44,8 +59,21 @@ Option_Help g_help_strings[] =
 
 struct option g_option_list[] = {
     {.name = "file" , .has_arg = required_argument, .flag = NULL, .val = 'f'},
+    {.name = "sparse", .has_arg = required_argument, .flag = NULL, .val = 'S'},
     {.name = "dtype", .has_arg = required_argument, .flag = NULL, .val = 'd'},
     {.name = "sep"  , .has_arg = required_argument, .flag = NULL, .val = 's'},
+    {.name = "expr" , .has_arg = required_argument, .flag = NULL, .val = 'e'},
+    {.name = "permute", .has_arg = required_argument, .flag = NULL, .val = 'p'},
+    {.name = "in-place", .has_arg = no_argument  , .flag = NULL, .val = 'i'},
+    {.name = "ragged", .has_arg = no_argument    , .flag = NULL, .val = 'r'},
+    {.name = "strict", .has_arg = no_argument    , .flag = NULL, .val = 'c'},
+    {.name = "hugepages", .has_arg = required_argument, .flag = NULL, .val = 'H'},
+    {.name = "slice", .has_arg = required_argument, .flag = NULL, .val = 'l'},
+    {.name = "mem-limit", .has_arg = required_argument, .flag = NULL, .val = 'M'},
+    {.name = "output", .has_arg = required_argument, .flag = NULL, .val = 'o'},
+    {.name = "export", .has_arg = required_argument, .flag = NULL, .val = 'x'},
+    {.name = "batch", .has_arg = required_argument, .flag = NULL, .val = 'b'},
+    {.name = "daemon", .has_arg = required_argument, .flag = NULL, .val = 'D'},
     {.name = "help" , .has_arg = no_argument      , .flag = NULL, .val = 'h'},
     {.name = NULL,    .has_arg = 0                , .flag = NULL, .val =  0 }
 };
@@ -67,7 +95,8 @@ struct option g_option_list[] = {
 api_Err_Status parse_cmdline( int argc , char **argv , Program_Options *p_opt)
 {
     api_Err_Status err = api_Success ;
-    char *short_opt = NULL ;
+    Huge_Policy policy = Huge_Off ;
+    char *short_opt = NULL , *end = NULL ;
     int opt = 0 ;
 
     if( argv == NULL ) {
@@ -92,8 +121,25 @@ api_Err_Status parse_cmdline( int argc , char **argv , Program_Options *p_opt)
 
     /* initialise with default values */
     p_opt->type = DataType_MaxTypes ;
-    p_opt->file = NULL ;
+    memset( p_opt->file, 0, sizeof(p_opt->file));
+    p_opt->no_files = 0 ;
+    memset( p_opt->sparse, 0, sizeof(p_opt->sparse));
+    p_opt->no_sparse = 0 ;
     p_opt->sep = NULL ;
+    p_opt->expr = NULL ;
+    p_opt->perm = NULL ;
+    p_opt->in_place = 0 ;
+    p_opt->ragged = 0 ;
+    p_opt->strict = 0 ;
+    p_opt->hugepages = -1 ;
+    p_opt->mem_limit = 0 ;
+    p_opt->slice = 0 ;
+    p_opt->slice_first = 0 ;
+    p_opt->slice_count = 0 ;
+    p_opt->output = NULL ;
+    p_opt->shm_prefix = NULL ;
+    p_opt->batch = NULL ;
+    p_opt->daemon = NULL ;
 
     short_opt = gen_opt_string( g_option_list );
     if( short_opt == NULL ) {
@@ -102,7 +148,9 @@ api_Err_Status parse_cmdline( int argc , char **argv , Program_Options *p_opt)
         goto err_cmdline_parse ;
     }
 
-    optind = 1 ;
+    /* 0, not 1 : batch and daemon jobs parse many argument lists, and glibc
+       only forgets its place in the previous one on a full reset */
+    optind = 0 ;
     for( opt = getopt_long(argc, argv, short_opt, g_option_list, NULL) ;
          opt != -1 ; opt = getopt_long(argc, argv, short_opt, g_option_list, NULL)) {
         switch( opt )
@@ -114,12 +162,110 @@ api_Err_Status parse_cmdline( int argc , char **argv , Program_Options *p_opt)
                 err = api_Stat_Complete ;
                 goto err_cmdline_parse ;
             case 'f' :
-                p_opt->file = strdup(optarg);
-                if( p_opt->file == NULL ) {
+                if( p_opt->no_files == MAX_INPUT_FILES ) {
+                    debug("At most %u input files supported", MAX_INPUT_FILES);
+                    err = api_Err_Param ;
+                    goto err_cmdline_parse ;
+                }
+                p_opt->file[p_opt->no_files] = strdup(optarg);
+                if( p_opt->file[p_opt->no_files] == NULL ) {
                     debug("Could not alloc memory to hold file-name [%s]", optarg);
                     err = api_Err_Memory ;
                     goto err_cmdline_parse ;
                 }
+                p_opt->no_files++ ;
+                break ;
+            case 'S' :
+                if( p_opt->no_sparse == MAX_INPUT_FILES ) {
+                    debug("At most %u sparse input files supported", MAX_INPUT_FILES);
+                    err = api_Err_Param ;
+                    goto err_cmdline_parse ;
+                }
+                p_opt->sparse[p_opt->no_sparse] = strdup(optarg);
+                if( p_opt->sparse[p_opt->no_sparse] == NULL ) {
+                    debug("Could not alloc memory to hold file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                p_opt->no_sparse++ ;
+                break ;
+            case 'e' :
+                p_opt->expr = strdup(optarg);
+                if( p_opt->expr == NULL ) {
+                    debug("Could not alloc memory to hold expression [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'p' :
+                p_opt->perm = strdup(optarg);
+                if( p_opt->perm == NULL ) {
+                    debug("Could not alloc memory to hold permutation [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'i' :
+                p_opt->in_place = 1 ;
+                break ;
+            case 'r' :
+                p_opt->ragged = 1 ;
+                break ;
+            case 'c' :
+                p_opt->strict = 1 ;
+                break ;
+            case 'H' :
+                err = huge_policy_parse( optarg, &policy );
+                if( err != api_Success )
+                    goto err_cmdline_parse ;
+                p_opt->hugepages = (int32_t)policy ;
+                break ;
+            case 'l' :
+                p_opt->slice_first = strtoull( optarg, &end, 10 );
+                p_opt->slice_count = (*end == ':') ? strtoull( end + 1, &end, 10 ) : 0 ;
+                if((end == optarg) || (*end != '\0') || (optarg[0] == '-')) {
+                    log_error("Invalid slice [%s] : expected first[:count]", optarg);
+                    err = api_Err_Param ;
+                    goto err_cmdline_parse ;
+                }
+                p_opt->slice = 1 ;
+                break ;
+            case 'M' :
+                err = mem_size_parse( optarg, &p_opt->mem_limit );
+                if( err != api_Success )
+                    goto err_cmdline_parse ;
+                break ;
+            case 'o' :
+                p_opt->output = strdup(optarg);
+                if( p_opt->output == NULL ) {
+                    debug("Could not alloc memory to hold output file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'x' :
+                p_opt->shm_prefix = strdup(optarg);
+                if( p_opt->shm_prefix == NULL ) {
+                    debug("Could not alloc memory to hold shared memory name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'b' :
+                p_opt->batch = strdup(optarg);
+                if( p_opt->batch == NULL ) {
+                    debug("Could not alloc memory to hold manifest file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'D' :
+                p_opt->daemon = strdup(optarg);
+                if( p_opt->daemon == NULL ) {
+                    debug("Could not alloc memory to hold socket path [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
                 break ;
             case 's' :
                 p_opt->sep = strdup(optarg);
@@ -166,11 +312,24 @@ err_cmdline_parse :
 /*****************************************************************************/
 void clean_cmdline_opts( Program_Options *p_opt )
 {
+    uint32_t idx_i ;
+
     if( p_opt == NULL )
         return ;
 
-    p_opt->file = (p_opt->file != NULL) ? free(p_opt->file), NULL : NULL ;
+    for( idx_i=0 ; idx_i < p_opt->no_files ; idx_i++ )
+        p_opt->file[idx_i] = (p_opt->file[idx_i] != NULL) ? free(p_opt->file[idx_i]), NULL : NULL ;
+    p_opt->no_files = 0 ;
+    for( idx_i=0 ; idx_i < p_opt->no_sparse ; idx_i++ )
+        p_opt->sparse[idx_i] = (p_opt->sparse[idx_i] != NULL) ? free(p_opt->sparse[idx_i]), NULL : NULL ;
+    p_opt->no_sparse = 0 ;
     p_opt->sep = (p_opt->sep != NULL) ? free(p_opt->sep), NULL : NULL ;
+    p_opt->expr = (p_opt->expr != NULL) ? free(p_opt->expr), NULL : NULL ;
+    p_opt->perm = (p_opt->perm != NULL) ? free(p_opt->perm), NULL : NULL ;
+    p_opt->output = (p_opt->output != NULL) ? free(p_opt->output), NULL : NULL ;
+    p_opt->shm_prefix = (p_opt->shm_prefix != NULL) ? free(p_opt->shm_prefix), NULL : NULL ;
+    p_opt->batch = (p_opt->batch != NULL) ? free(p_opt->batch), NULL : NULL ;
+    p_opt->daemon = (p_opt->daemon != NULL) ? free(p_opt->daemon), NULL : NULL ;
     p_opt->type = DataType_MaxTypes ;
     return ;
 }
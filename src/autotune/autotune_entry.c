@@ -0,0 +1,712 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "time_eval.h"
+#include "thread_pool.h"
+#include "tune_db.h"
+#include "expr_eval.h"
+#include "stencil.h"
+#include "gemm.h"
+#include "half.h"
+#include "autotune_options.h"
+
+
+/* one timed run of a candidate configuration */
+typedef api_Err_Status (*Trial_Fn)( void * );
+
+typedef struct __Read_Trial__
+{
+    char *path ;
+    uint8_t *sep ;
+    Data_Type type ;
+} Read_Trial ;
+
+typedef struct __Expr_Trial__
+{
+    Expr_Node *root ;
+    void *buff[3] ;
+    Vector_MetaData meta[3] ;
+    void *out ;
+    Vector_MetaData out_meta ;
+} Expr_Trial ;
+
+typedef struct __Stencil_Trial__
+{
+    void *in , *out ;
+    Vector_MetaData meta ;
+    Stencil_Coeffs coeffs ;
+    Stencil_Tiling tiling ;
+    uint32_t iterations ;
+} Stencil_Trial ;
+
+typedef struct __Gemm_Trial__
+{
+    void *a , *b , *c ;
+    Vector_MetaData a_meta , b_meta , c_meta ;
+    Gemm_Blocking blocking ;
+} Gemm_Trial ;
+
+
+static api_Err_Status _time_trial( Trial_Fn, void *, uint32_t, double * );
+static api_Err_Status _generate( void **, Vector_MetaData *, Data_Type, uint32_t, uint64_t, uint64_t, uint64_t );
+static api_Err_Status _read_trial( void * );
+static api_Err_Status _expr_trial( void * );
+static api_Err_Status _stencil_trial( void * );
+static api_Err_Status _gemm_trial( void * );
+static api_Err_Status _expr_setup( Expr_Trial *, Autotune_Options * );
+static void _expr_teardown( Expr_Trial * );
+static api_Err_Status _gemm_setup( Gemm_Trial *, Autotune_Options * );
+static void _gemm_teardown( Gemm_Trial * );
+static api_Err_Status _tune_read( Autotune_Options * );
+static api_Err_Status _tune_threads( Autotune_Options * );
+static api_Err_Status _tune_expr( Autotune_Options * );
+static api_Err_Status _tune_stencil( Autotune_Options *, Stencil_Type );
+static api_Err_Status _tune_gemm( Autotune_Options * );
+
+int main( int argc , char *argv[] )
+{
+    api_Err_Status err = api_Success ;
+    Autotune_Options at_opt ;
+
+    memset( &at_opt, 0, sizeof(at_opt));
+
+    err = parse_autotune_cmdline( argc, argv, &at_opt );
+    if( err != api_Success ) {
+        debug("Error parsing cmdline options. err=%d", err );
+        goto err_main ;
+    }
+
+    err = tune_db_load();
+    if( err != api_Success ) {
+        debug("Could not load tuning database [%s]. err = %d", tune_db_path(), err);
+        goto err_main ;
+    }
+
+    debug("===============================================");
+    debug("CPU model : %s", tune_cpu_model());
+    debug("Database  : %s", tune_db_path());
+    debug("Data-type : %s, %u repetitions per candidate", datatype_name( at_opt.type ), at_opt.reps);
+
+    if( at_opt.what & TUNE_READ )
+        err = _tune_read( &at_opt );
+    if((err == api_Success) && (at_opt.what & TUNE_THREADS))
+        err = _tune_threads( &at_opt );
+    if((err == api_Success) && (at_opt.what & TUNE_EXPR))
+        err = _tune_expr( &at_opt );
+    if((err == api_Success) && (at_opt.what & TUNE_STENCIL)) {
+        err = _tune_stencil( &at_opt, Stencil_7pt );
+        if( err == api_Success )
+            err = _tune_stencil( &at_opt, Stencil_27pt );
+    }
+    if((err == api_Success) && (at_opt.what & TUNE_GEMM))
+        err = _tune_gemm( &at_opt );
+    if( err != api_Success ) {
+        debug("Tuning failed. err = %d", err);
+        goto err_main ;
+    }
+
+    if( at_opt.dry_run ) {
+        debug("Dry run : database not written");
+    } else {
+        err = tune_db_save();
+        if( err == api_Success )
+            debug("Winners saved to %s", tune_db_path());
+    }
+    debug("===============================================");
+
+err_main :
+    clean_autotune_opts( &at_opt );
+    tpool_default_release();
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Best wall time of reps runs of a trial
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _time_trial( Trial_Fn fn, void *ctx, uint32_t reps, double *best )
+{
+    api_Err_Status err = api_Success ;
+    struct timespec begin , end ;
+    uint32_t idx_i = 0 ;
+    double secs = 0.0 ;
+
+    *best = 0.0 ;
+    for( idx_i=0 ; idx_i < reps ; idx_i++ ) {
+        start_wall_timer( begin );
+        err = fn( ctx );
+        stop_wall_timer( end );
+        if( err != api_Success )
+            break ;
+        secs = wall_time_taken( begin, end );
+        *best = ((idx_i == 0) || (secs < *best)) ? secs : *best ;
+    }
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate a 1D/2D/3D array of small pseudo-random values
+ * \param  **buff - output array
+ * \param  *meta - output meta-data
+ * \param  type - element type
+ * \param  no_dims - 1, 2 or 3
+ * \param  d0 , d1 , d2 - extents, outermost first
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _generate( void **buff, Vector_MetaData *meta, Data_Type type, uint32_t no_dims,
+                                 uint64_t d0, uint64_t d1, uint64_t d2 )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t idx_i = 0 , items = 0 ;
+    uint32_t seed = 7 , value = 0 ;
+    void *p = NULL ;
+
+    memset( meta, 0, sizeof(Vector_MetaData));
+    meta->type = type ;
+    meta->no_dims = no_dims ;
+    if( no_dims == 1 ) {
+        meta->dim.dim_1d.items = d0 ;
+    } else if( no_dims == 2 ) {
+        meta->dim.dim_2d.rows = d0 ;
+        meta->dim.dim_2d.cols = d1 ;
+    } else {
+        meta->dim.dim_3d.dim_z = d0 ;
+        meta->dim.dim_3d.dim_y = d1 ;
+        meta->dim.dim_3d.dim_x = d2 ;
+    }
+
+    err = alloc_data( buff, meta );
+    if( err != api_Success )
+        goto err_generate ;
+
+    p = data_payload( *buff, meta );
+    items = data_items( meta );
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        seed = (seed * 1103515245u) + 12345u ;
+        value = (seed >> 16) & 0x3f ;
+        switch( type )
+        {
+            case DataType_uint8       : ((uint8_t *)p)[idx_i] = (uint8_t)value ; break ;
+            case DataType_uint16      : ((uint16_t *)p)[idx_i] = (uint16_t)value ; break ;
+            case DataType_uint32      : ((uint32_t *)p)[idx_i] = value ; break ;
+            case DataType_uint64      : ((uint64_t *)p)[idx_i] = value ; break ;
+            case DataType_int8        : ((int8_t *)p)[idx_i] = (int8_t)value - 32 ; break ;
+            case DataType_int16       : ((int16_t *)p)[idx_i] = (int16_t)value - 32 ; break ;
+            case DataType_int32       : ((int32_t *)p)[idx_i] = (int32_t)value - 32 ; break ;
+            case DataType_int64       : ((int64_t *)p)[idx_i] = (int64_t)value - 32 ; break ;
+            case DataType_float       : ((float *)p)[idx_i] = (float)value / 64.0f ; break ;
+            case DataType_double      : ((double *)p)[idx_i] = (double)value / 64.0 ; break ;
+            case DataType_float16     : ((uint16_t *)p)[idx_i] = f32_to_half((float)value / 64.0f) ; break ;
+            case DataType_bfloat16    : ((uint16_t *)p)[idx_i] = f32_to_bf16((float)value / 64.0f) ; break ;
+            default                   : ((long double *)p)[idx_i] = (long double)value / 64.0L ; break ;
+        }
+    }
+
+err_generate :
+    return err ;
+}
+
+
+
+/*!
+ * Trials
+ */
+static api_Err_Status _read_trial( void *arg )
+{
+    Read_Trial *t = (Read_Trial *)arg ;
+    Vector_MetaData meta ;
+    void *buff = NULL ;
+    api_Err_Status err = api_Success ;
+
+    memset( &meta, 0, sizeof(meta));
+    meta.type = t->type ;
+    err = read_data( &buff, &meta, t->path, t->sep );
+    clean_data( &buff, &meta );
+    return err ;
+}
+
+static api_Err_Status _expr_trial( void *arg )
+{
+    Expr_Trial *t = (Expr_Trial *)arg ;
+
+    return expr_evaluate( t->root, t->out, &t->out_meta );
+}
+
+static api_Err_Status _stencil_trial( void *arg )
+{
+    Stencil_Trial *t = (Stencil_Trial *)arg ;
+
+    return stencil_3d( t->out, t->in, &t->meta, &t->coeffs, t->iterations, &t->tiling );
+}
+
+static api_Err_Status _gemm_trial( void *arg )
+{
+    Gemm_Trial *t = (Gemm_Trial *)arg ;
+
+    return gemm( t->c, &t->c_meta, t->a, &t->a_meta, t->b, &t->b_meta, &t->blocking );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Inputs and output of the element-wise trial : a + b * c
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_setup( Expr_Trial *t, Autotune_Options *at_opt )
+{
+    api_Err_Status err = api_Success ;
+    uint32_t idx_i = 0 ;
+
+    memset( t, 0, sizeof(Expr_Trial));
+    for( idx_i=0 ; (idx_i < 3) && (err == api_Success) ; idx_i++ )
+        err = _generate( &t->buff[idx_i], &t->meta[idx_i], at_opt->type, 1, at_opt->items, 0, 0 );
+    if( err == api_Success ) {
+        t->out_meta = t->meta[0] ;
+        err = alloc_data( &t->out, &t->out_meta );
+    }
+    if( err == api_Success )
+        err = expr_parse( &t->root, "a + b * c", t->buff, t->meta, 3 );
+    if( err != api_Success ) {
+        debug("Could not set up the element-wise trial. err = %d", err);
+        _expr_teardown( t );
+    }
+    return err ;
+}
+
+static void _expr_teardown( Expr_Trial *t )
+{
+    uint32_t idx_i = 0 ;
+
+    expr_free( &t->root );
+    clean_data( &t->out, &t->out_meta );
+    for( idx_i=0 ; idx_i < 3 ; idx_i++ )
+        clean_data( &t->buff[idx_i], &t->meta[idx_i] );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Square matrices for the multiply trial
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _gemm_setup( Gemm_Trial *t, Autotune_Options *at_opt )
+{
+    api_Err_Status err = api_Success ;
+
+    memset( t, 0, sizeof(Gemm_Trial));
+    err = _generate( &t->a, &t->a_meta, at_opt->type, 2, at_opt->mat, at_opt->mat, 0 );
+    if( err == api_Success )
+        err = _generate( &t->b, &t->b_meta, at_opt->type, 2, at_opt->mat, at_opt->mat, 0 );
+    if( err == api_Success )
+        err = gemm_result_meta( &t->c_meta, &t->a_meta, &t->b_meta );
+    if( err == api_Success )
+        err = alloc_data( &t->c, &t->c_meta );
+    if( err != api_Success ) {
+        debug("Could not set up the multiply trial. err = %d", err);
+        _gemm_teardown( t );
+    }
+    return err ;
+}
+
+static void _gemm_teardown( Gemm_Trial *t )
+{
+    clean_data( &t->c, &t->c_meta );
+    clean_data( &t->b, &t->b_meta );
+    clean_data( &t->a, &t->a_meta );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sweep the chunk size read() is called with on a sample file
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_read( Autotune_Options *at_opt )
+{
+    static const uint64_t chunks[] = { 4096, 16384, 65536, 262144, 1048576, 4194304 } ;
+    api_Err_Status err = api_Success ;
+    Read_Trial t = { .path = (char *)at_opt->file, .sep = at_opt->sep, .type = at_opt->type } ;
+    struct stat sb ;
+    uint64_t best_val = LINE_SIZE ;
+    double secs = 0.0 , best = 0.0 ;
+    uint32_t idx_i = 0 ;
+    char *env = NULL , *was = NULL ;
+
+    if( stat( t.path, &sb ) != 0 ) {
+        debug("Cannot stat sample file [%s]", t.path);
+        return api_Err_File ;
+    }
+
+    /* time the read alone : no row index built and saved next to the file */
+    env = getenv("HETERO_ROW_INDEX");
+    was = (env != NULL) ? strdup( env ) : NULL ;
+    setenv( "HETERO_ROW_INDEX", "0", 1 );
+    for( idx_i=0 ; idx_i < sizeof(chunks) / sizeof(chunks[0]) ; idx_i++ ) {
+        tune_store( "read.chunk", sb.st_size, chunks[idx_i] );
+        err = _time_trial( _read_trial, &t, at_opt->reps, &secs );
+        if( err != api_Success ) {
+            debug("Could not read sample file [%s]. err = %d", t.path, err);
+            goto err_tune_read ;
+        }
+        debug("  read.chunk %8llu : %.4f s", (unsigned long long)chunks[idx_i], secs);
+        if((idx_i == 0) || (secs < best)) {
+            best = secs ;
+            best_val = chunks[idx_i] ;
+        }
+    }
+    debug("read.chunk = %llu for %lld byte files", (unsigned long long)best_val, (long long)sb.st_size);
+    err = tune_store( "read.chunk", sb.st_size, best_val );
+
+err_tune_read :
+    if( was != NULL )
+        setenv( "HETERO_ROW_INDEX", was, 1 );
+    else
+        unsetenv( "HETERO_ROW_INDEX" );
+    was = (was != NULL) ? free(was), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sweep the size of the shared pool over a memory-bound
+ *         (element-wise) and a compute-bound (multiply) trial. The winner
+ *         has the lowest sum of times relative to each trial's best
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_threads( Autotune_Options *at_opt )
+{
+    api_Err_Status err = api_Success ;
+    Expr_Trial et ;
+    Gemm_Trial gt ;
+    uint64_t cand[16] ;
+    double t_expr[16] , t_gemm[16] , best_expr = 0.0 , best_gemm = 0.0 , score = 0.0 , best = 0.0 ;
+    long no_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    uint32_t no_cand = 0 , idx_i = 0 , has_gemm = 0 , winner = 0 ;
+
+    if( getenv("HETERO_THREADS") != NULL ) {
+        debug("HETERO_THREADS is set and overrides pool.threads : skipping the thread sweep");
+        return api_Success ;
+    }
+    no_cpus = (no_cpus > 0) ? no_cpus : 1 ;
+    for( cand[0] = 1, no_cand = 1 ; ((cand[no_cand-1] * 2) < (uint64_t)no_cpus) && (no_cand < 15) ; no_cand++ )
+        cand[no_cand] = cand[no_cand-1] * 2 ;
+    if( cand[no_cand-1] != (uint64_t)no_cpus )
+        cand[no_cand++] = no_cpus ;
+
+    has_gemm = (at_opt->type == DataType_float) || (at_opt->type == DataType_double) ||
+               (at_opt->type == DataType_int8) || (at_opt->type == DataType_int16) ;
+    err = _expr_setup( &et, at_opt );
+    if( err != api_Success )
+        return err ;
+    if( has_gemm ) {
+        err = _gemm_setup( &gt, at_opt );
+        if( err != api_Success )
+            goto err_tune_threads ;
+    }
+
+    for( idx_i=0 ; (idx_i < no_cand) && (err == api_Success) ; idx_i++ ) {
+        tpool_default_release();
+        tune_store( "pool.threads", 0, cand[idx_i] );
+        t_gemm[idx_i] = 0.0 ;
+        err = _time_trial( _expr_trial, &et, at_opt->reps, &t_expr[idx_i] );
+        if((err == api_Success) && has_gemm )
+            err = _time_trial( _gemm_trial, &gt, at_opt->reps, &t_gemm[idx_i] );
+        debug("  pool.threads %3llu : element-wise %.4f s, multiply %.4f s", (unsigned long long)cand[idx_i], t_expr[idx_i], t_gemm[idx_i]);
+        best_expr = ((idx_i == 0) || (t_expr[idx_i] < best_expr)) ? t_expr[idx_i] : best_expr ;
+        best_gemm = ((idx_i == 0) || (t_gemm[idx_i] < best_gemm)) ? t_gemm[idx_i] : best_gemm ;
+    }
+    if( err != api_Success )
+        goto err_tune_threads ;
+
+    for( idx_i=0 ; idx_i < no_cand ; idx_i++ ) {
+        score = (t_expr[idx_i] / best_expr) + (has_gemm ? (t_gemm[idx_i] / best_gemm) : 0.0) ;
+        if((idx_i == 0) || (score < best)) {
+            best = score ;
+            winner = idx_i ;
+        }
+    }
+    debug("pool.threads = %llu", (unsigned long long)cand[winner]);
+    tpool_default_release();
+    err = tune_store( "pool.threads", 0, cand[winner] );
+
+err_tune_threads :
+    _expr_teardown( &et );
+    if( has_gemm )
+        _gemm_teardown( &gt );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sweep the number of blocks per pool task of the element-wise
+ *         engine, then its prefetch distance and streaming stores
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_expr( Autotune_Options *at_opt )
+{
+    static const uint64_t blocks[] = { 8, 16, 32, 64, 128, 256, 512 } ;
+    static const uint64_t ahead[] = { 0, 1, 2, 4, 8, 16 } ;
+    api_Err_Status err = api_Success ;
+    Expr_Trial et ;
+    uint64_t best_val = 0 , out_bytes = 0 ;
+    double secs = 0.0 , best = 0.0 ;
+    uint32_t idx_i = 0 ;
+
+    err = _expr_setup( &et, at_opt );
+    if( err != api_Success )
+        return err ;
+
+    for( idx_i=0 ; idx_i < sizeof(blocks) / sizeof(blocks[0]) ; idx_i++ ) {
+        tune_store( "expr.task_blocks", at_opt->items, blocks[idx_i] );
+        err = _time_trial( _expr_trial, &et, at_opt->reps, &secs );
+        if( err != api_Success )
+            goto err_tune_expr ;
+        debug("  expr.task_blocks %4llu : %.4f s", (unsigned long long)blocks[idx_i], secs);
+        if((idx_i == 0) || (secs < best)) {
+            best = secs ;
+            best_val = blocks[idx_i] ;
+        }
+    }
+    debug("expr.task_blocks = %llu for %llu items", (unsigned long long)best_val, (unsigned long long)at_opt->items);
+    err = tune_store( "expr.task_blocks", at_opt->items, best_val );
+    if( err != api_Success )
+        goto err_tune_expr ;
+
+    /* the engine reads "expr.prefetch" and "expr.stream" only for data
+       larger than the last level cache : tune those with a large -e */
+    for( idx_i=0 ; idx_i < sizeof(ahead) / sizeof(ahead[0]) ; idx_i++ ) {
+        tune_store( "expr.prefetch", at_opt->items, ahead[idx_i] );
+        err = _time_trial( _expr_trial, &et, at_opt->reps, &secs );
+        if( err != api_Success )
+            goto err_tune_expr ;
+        debug("  expr.prefetch %4llu : %.4f s", (unsigned long long)ahead[idx_i], secs);
+        if((idx_i == 0) || (secs < best)) {
+            best = secs ;
+            best_val = ahead[idx_i] ;
+        }
+    }
+    debug("expr.prefetch = %llu for %llu items", (unsigned long long)best_val, (unsigned long long)at_opt->items);
+    err = tune_store( "expr.prefetch", at_opt->items, best_val );
+    if( err != api_Success )
+        goto err_tune_expr ;
+
+    /* streaming stores are keyed by the size of the result */
+    out_bytes = data_items( &et.out_meta ) * sizeof_datatype( et.out_meta.type ) ;
+    for( idx_i=0 ; idx_i < 2 ; idx_i++ ) {
+        tune_store( "expr.stream", out_bytes, idx_i );
+        err = _time_trial( _expr_trial, &et, at_opt->reps, &secs );
+        if( err != api_Success )
+            goto err_tune_expr ;
+        debug("  expr.stream %u : %.4f s", idx_i, secs);
+        if((idx_i == 0) || (secs < best)) {
+            best = secs ;
+            best_val = idx_i ;
+        }
+    }
+    debug("expr.stream = %llu for %llu bytes", (unsigned long long)best_val, (unsigned long long)out_bytes);
+    err = tune_store( "expr.stream", out_bytes, best_val );
+
+err_tune_expr :
+    _expr_teardown( &et );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sweep the tile and temporal blocking of a 3D stencil
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_stencil( Autotune_Options *at_opt, Stencil_Type type )
+{
+    static const uint32_t tx[] = { 32, 64, 128, 256, 512 } ;
+    static const uint32_t ty[] = { 4, 8, 16, 32, 64 } ;
+    static const uint32_t tb[] = { 1, 2, 4, 8 } ;
+    api_Err_Status err = api_Success ;
+    Stencil_Trial st ;
+    Stencil_Tiling best_tile ;
+    Vector_MetaData out_meta ;
+    char knob[TUNE_NAME_LEN] ;
+    uint64_t bytes = 0 ;
+    uint32_t idx_x = 0 , idx_y = 0 , idx_t = 0 , first = 1 ;
+    double secs = 0.0 , best = 0.0 ;
+
+    if((at_opt->type != DataType_float) && (at_opt->type != DataType_double)) {
+        debug("Stencils run on float or double only : skipping the stencil sweep");
+        return api_Success ;
+    }
+
+    memset( &st, 0, sizeof(st));
+    memset( &best_tile, 0, sizeof(best_tile));
+    stencil_default_coeffs( &st.coeffs, type );
+    st.iterations = 8 ;
+    err = _generate( &st.in, &st.meta, at_opt->type, 3, at_opt->edge, at_opt->edge, at_opt->edge );
+    out_meta = st.meta ;
+    if( err == api_Success )
+        err = alloc_data( &st.out, &out_meta );
+    if( err != api_Success ) {
+        debug("Could not set up the stencil trial. err = %d", err);
+        goto err_tune_stencil ;
+    }
+    bytes = data_items( &st.meta ) * sizeof_datatype( st.meta.type ) ;
+
+    for( idx_t=0 ; idx_t < sizeof(tb) / sizeof(tb[0]) ; idx_t++ ) {
+        for( idx_x=0 ; idx_x < sizeof(tx) / sizeof(tx[0]) ; idx_x++ ) {
+            if((idx_x != 0) && (tx[idx_x-1] >= at_opt->edge))
+                break ;
+            for( idx_y=0 ; idx_y < sizeof(ty) / sizeof(ty[0]) ; idx_y++ ) {
+                if((idx_y != 0) && (ty[idx_y-1] >= at_opt->edge))
+                    break ;
+                st.tiling.tile_x = tx[idx_x] ;
+                st.tiling.tile_y = ty[idx_y] ;
+                st.tiling.time_block = tb[idx_t] ;
+                err = _time_trial( _stencil_trial, &st, at_opt->reps, &secs );
+                if( err != api_Success )
+                    goto err_tune_stencil ;
+                if( first || (secs < best)) {
+                    best = secs ;
+                    best_tile = st.tiling ;
+                    first = 0 ;
+                }
+            }
+        }
+    }
+
+    stencil_tune_knob( knob, sizeof(knob), type, at_opt->type, "tile_x" );
+    err = tune_store( knob, bytes, best_tile.tile_x );
+    stencil_tune_knob( knob, sizeof(knob), type, at_opt->type, "tile_y" );
+    if( err == api_Success )
+        err = tune_store( knob, bytes, best_tile.tile_y );
+    stencil_tune_knob( knob, sizeof(knob), type, at_opt->type, "time_block" );
+    if( err == api_Success )
+        err = tune_store( knob, bytes, best_tile.time_block );
+    debug("stencil.%s.%s : tile_x %u, tile_y %u, time_block %u (%.4f s for %u sweeps of %llu^3)",
+                (type == Stencil_27pt) ? "27pt" : "7pt", datatype_name( at_opt->type ), best_tile.tile_x,
+                best_tile.tile_y, best_tile.time_block, best, st.iterations, (unsigned long long)at_opt->edge);
+
+err_tune_stencil :
+    clean_data( &st.out, &out_meta );
+    clean_data( &st.in, &st.meta );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sweep the cache blocking of the matrix multiply
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_gemm( Autotune_Options *at_opt )
+{
+    static const uint32_t mc[] = { 48, 96, 144, 192 } ;
+    static const uint32_t kc[] = { 128, 256, 384, 512 } ;
+    static const uint32_t nc[] = { 1024, 2048, 4096 } ;
+    api_Err_Status err = api_Success ;
+    Gemm_Trial gt ;
+    Gemm_Blocking best_blk ;
+    char knob[TUNE_NAME_LEN] ;
+    uint64_t size = at_opt->mat * at_opt->mat * at_opt->mat ;
+    uint32_t idx_m = 0 , idx_k = 0 , idx_n = 0 , first = 1 ;
+    double secs = 0.0 , best = 0.0 ;
+
+    if((at_opt->type != DataType_float) && (at_opt->type != DataType_double) &&
+       (at_opt->type != DataType_int8) && (at_opt->type != DataType_int16)) {
+        debug("The multiply runs on float, double, int8 or int16 only : skipping the multiply sweep");
+        return api_Success ;
+    }
+
+    memset( &best_blk, 0, sizeof(best_blk));
+    err = _gemm_setup( &gt, at_opt );
+    if( err != api_Success )
+        return err ;
+
+    for( idx_m=0 ; idx_m < sizeof(mc) / sizeof(mc[0]) ; idx_m++ ) {
+        for( idx_k=0 ; idx_k < sizeof(kc) / sizeof(kc[0]) ; idx_k++ ) {
+            for( idx_n=0 ; idx_n < sizeof(nc) / sizeof(nc[0]) ; idx_n++ ) {
+                gt.blocking.mc = mc[idx_m] ;
+                gt.blocking.kc = kc[idx_k] ;
+                gt.blocking.nc = nc[idx_n] ;
+                err = _time_trial( _gemm_trial, &gt, at_opt->reps, &secs );
+                if( err != api_Success )
+                    goto err_tune_gemm ;
+                if( first || (secs < best)) {
+                    best = secs ;
+                    best_blk = gt.blocking ;
+                    first = 0 ;
+                }
+            }
+        }
+    }
+
+    gemm_tune_knob( knob, sizeof(knob), at_opt->type, "mc" );
+    err = tune_store( knob, size, best_blk.mc );
+    gemm_tune_knob( knob, sizeof(knob), at_opt->type, "kc" );
+    if( err == api_Success )
+        err = tune_store( knob, size, best_blk.kc );
+    gemm_tune_knob( knob, sizeof(knob), at_opt->type, "nc" );
+    if( err == api_Success )
+        err = tune_store( knob, size, best_blk.nc );
+    debug("gemm.%s : mc %u, kc %u, nc %u (%.2f GFLOP/s at %llu^3)", datatype_name( at_opt->type ),
+                best_blk.mc, best_blk.kc, best_blk.nc, 2.0 * (double)size / best / 1e9, (unsigned long long)at_opt->mat);
+
+err_tune_gemm :
+    _gemm_teardown( &gt );
+    return err ;
+}
@@ -0,0 +1,202 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "api_err.h"
+#include "datatype.h"
+#include "autotune_options.h"
+#include "program_options.h"
+#include "debug.h"
+
+Option_Help g_help_strings[] =
+{
+    { .option = 'k', .option_text = "-k,--knobs......comma list of read,threads,expr,stencil,gemm (default all; read needs -f)"},
+    { .option = 'f', .option_text = "-f,--file.......sample input file for the read chunk sweep"                              },
+    { .option = 's', .option_text = "-s,--sep........Separator list of the sample file"                                       },
+    { .option = 'd', .option_text = "-d,--dtype......data-type to tune for (default float)"                                   },
+    { .option = 'n', .option_text = "-n,--edge.......edge of the stencil volume (default 128)"                                },
+    { .option = 'm', .option_text = "-m,--mat........size of the square matrices (default 512)"                               },
+    { .option = 'e', .option_text = "-e,--items......length of element-wise vectors (default 16M)"                            },
+    { .option = 'r', .option_text = "-r,--reps.......timed repetitions per candidate, best is kept (default 3)"              },
+    { .option = 'x', .option_text = "-x,--dry-run....report winners without writing the database"                            },
+    { .option = 'h', .option_text = "-h,--help.......this help menu"                                                          },
+    { .option =  0 , .option_text = NULL                                                                                       },
+};
+
+
+struct option g_option_list[] = {
+    {.name = "knobs"  , .has_arg = required_argument, .flag = NULL, .val = 'k'},
+    {.name = "file"   , .has_arg = required_argument, .flag = NULL, .val = 'f'},
+    {.name = "sep"    , .has_arg = required_argument, .flag = NULL, .val = 's'},
+    {.name = "dtype"  , .has_arg = required_argument, .flag = NULL, .val = 'd'},
+    {.name = "edge"   , .has_arg = required_argument, .flag = NULL, .val = 'n'},
+    {.name = "mat"    , .has_arg = required_argument, .flag = NULL, .val = 'm'},
+    {.name = "items"  , .has_arg = required_argument, .flag = NULL, .val = 'e'},
+    {.name = "reps"   , .has_arg = required_argument, .flag = NULL, .val = 'r'},
+    {.name = "dry-run", .has_arg = no_argument      , .flag = NULL, .val = 'x'},
+    {.name = "help"   , .has_arg = no_argument      , .flag = NULL, .val = 'h'},
+    {.name = NULL,      .has_arg = 0                , .flag = NULL, .val =  0 }
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  parse command-line options of the autotuner
+ *
+ * \param  argc - number of params from cmdline inclusive of program name
+ * \param  *argv[] - list of commandline options
+ * \param  *at_opt - structure to store options provided on cmdline
+ * \return api_Success on success
+ */
+/*****************************************************************************/
+api_Err_Status parse_autotune_cmdline( int argc , char **argv , Autotune_Options *at_opt )
+{
+    api_Err_Status err = api_Success ;
+    char *short_opt = NULL , *knobs = NULL , *tok = NULL , *save = NULL ;
+    int opt = 0 ;
+
+    if((argv == NULL) || (at_opt == NULL)) {
+        debug("Invalid params argv = %p, at_opt = %p", argv, at_opt);
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    /* initialise with default values */
+    memset( at_opt, 0, sizeof(Autotune_Options));
+    at_opt->type = DataType_float ;
+    at_opt->edge = 128 ;
+    at_opt->mat = 512 ;
+    at_opt->items = 16 * 1024 * 1024 ;
+    at_opt->reps = 3 ;
+
+    short_opt = gen_opt_string( g_option_list );
+    if( short_opt == NULL ) {
+        debug("Could not gen short opt-string for parsing cmdline opts");
+        err = api_Err_Failure ;
+        goto err_cmdline_parse ;
+    }
+
+    optind = 1 ;
+    for( opt = getopt_long(argc, argv, short_opt, g_option_list, NULL) ;
+         opt != -1 ; opt = getopt_long(argc, argv, short_opt, g_option_list, NULL)) {
+        switch( opt )
+        {
+            case '?' :   /* intentional fall-through */
+            case 'h' :   /* intentional fall-through */
+            case ':' :
+                usage( argv[0] , g_option_list , g_help_strings);
+                err = api_Stat_Complete ;
+                goto err_cmdline_parse ;
+            case 'k' :
+                knobs = strdup(optarg);
+                if( knobs == NULL ) {
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                for( tok = strtok_r( knobs, ",", &save ) ; tok != NULL ; tok = strtok_r( NULL, ",", &save )) {
+                    if( strcmp( tok, "read" ) == 0 )         at_opt->what |= TUNE_READ ;
+                    else if( strcmp( tok, "threads" ) == 0 ) at_opt->what |= TUNE_THREADS ;
+                    else if( strcmp( tok, "expr" ) == 0 )    at_opt->what |= TUNE_EXPR ;
+                    else if( strcmp( tok, "stencil" ) == 0 ) at_opt->what |= TUNE_STENCIL ;
+                    else if( strcmp( tok, "gemm" ) == 0 )    at_opt->what |= TUNE_GEMM ;
+                    else {
+                        debug("Unknown knob group [%s]", tok);
+                        err = api_Err_Param ;
+                        goto err_cmdline_parse ;
+                    }
+                }
+                knobs = (knobs != NULL) ? free(knobs), NULL : NULL ;
+                break ;
+            case 'f' :
+                at_opt->file = strdup(optarg);
+                if( at_opt->file == NULL ) {
+                    debug("Could not alloc memory to hold file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 's' :
+                at_opt->sep = strdup(optarg);
+                if( at_opt->sep == NULL ) {
+                    debug("Could not alloc memory to hold separators [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'd' :
+                err = map_data_types( &(at_opt->type), optarg);
+                if( err != api_Success ) {
+                    debug("Error mapping cmdline data-type [%s] to known type. err = %d", optarg, err );
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'n' : at_opt->edge = strtoull( optarg, NULL, 0 ); break ;
+            case 'm' : at_opt->mat = strtoull( optarg, NULL, 0 ); break ;
+            case 'e' : at_opt->items = strtoull( optarg, NULL, 0 ); break ;
+            case 'r' : at_opt->reps = (uint32_t)strtoul( optarg, NULL, 0 ); break ;
+            case 'x' : at_opt->dry_run = 1 ; break ;
+        }
+    }
+
+    if( at_opt->what == 0 )
+        at_opt->what = TUNE_THREADS | TUNE_EXPR | TUNE_STENCIL | TUNE_GEMM | ((at_opt->file != NULL) ? TUNE_READ : 0) ;
+    if((at_opt->what & TUNE_READ) && ((at_opt->file == NULL) || (at_opt->sep == NULL))) {
+        debug("The read sweep needs a sample file (-f) and its separators (-s)");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+    at_opt->reps = (at_opt->reps != 0) ? at_opt->reps : 1 ;
+
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+
+err_cmdline_parse :
+    knobs = (knobs != NULL) ? free(knobs), NULL : NULL ;
+    clean_autotune_opts( at_opt ) ;
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Clean up data structure holding command-line params
+ * \param  *at_opt - options structure
+ * \return void
+ */
+/*****************************************************************************/
+void clean_autotune_opts( Autotune_Options *at_opt )
+{
+    if( at_opt == NULL )
+        return ;
+
+    at_opt->file = (at_opt->file != NULL) ? free(at_opt->file), NULL : NULL ;
+    at_opt->sep = (at_opt->sep != NULL) ? free(at_opt->sep), NULL : NULL ;
+    return ;
+}
@@ -0,0 +1,580 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "hash.h"
+#include "lazy_array.h"
+#include "array_cache.h"
+
+
+typedef struct __Cache_Entry__
+{
+    char *path ;
+    char *sep ;
+    Data_Type type ;
+    uint32_t strict ;            /* values were checked by a strict read */
+    dev_t dev ;
+    ino_t ino ;
+    off_t size ;
+    struct timespec mtime ;
+
+    void *buff ;
+    Vector_MetaData meta ;
+    uint64_t bytes ;
+    uint32_t refs ;
+    uint32_t stale ;             /* file changed while borrowed : drop on last put */
+    uint64_t last_use ;
+} Cache_Entry ;
+
+
+typedef struct __Lazy_Entry__
+{
+    char *path ;
+    char *sep ;
+    Data_Type type ;
+    uint32_t strict ;
+    Lazy_Array *la ;
+    uint64_t bytes ;             /* parsed blocks held, as of the last release */
+    uint32_t refs ;
+    uint32_t stale ;             /* file changed while in use : drop on last release */
+    uint64_t last_use ;
+} Lazy_Entry ;
+
+#define CACHE_MAX_LAZY      16           /* files mapped for slices at once */
+
+
+struct __Array_Cache__
+{
+    pthread_mutex_t lock ;
+    Cache_Entry *entry ;
+    uint32_t no_entries ;
+    uint32_t max_entries ;
+    uint64_t budget ;
+    uint64_t clock ;             /* use counter for LRU */
+    Cache_Stats stats ;
+    Lazy_Entry lazy[CACHE_MAX_LAZY] ;    /* files slices are copied from */
+    uint32_t no_lazy ;
+};
+
+
+static void _cache_drop( Array_Cache *, uint32_t );
+static void _cache_evict( Array_Cache * );
+static void _cache_lazy_drop( Array_Cache *, uint32_t );
+static void _cache_lazy_release( Array_Cache *, Lazy_Array * );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create an array cache
+ * \param  **cache - output handle
+ * \param  budget - bytes of payload kept once arrays are handed back
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status cache_create( Array_Cache **cache, uint64_t budget )
+{
+    api_Err_Status err = api_Success ;
+
+    if( cache == NULL ) {
+        debug("Cannot return cache in NULL pointer");
+        err = api_Err_Param ;
+        goto err_cache_create ;
+    }
+    *cache = calloc( 1, sizeof(Array_Cache));
+    if( *cache == NULL ) {
+        debug("Could not allocate array cache");
+        err = api_Err_Memory ;
+        goto err_cache_create ;
+    }
+    pthread_mutex_init( &(*cache)->lock, NULL );
+    (*cache)->budget = budget ;
+
+err_cache_create :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Borrow the array of a file, reading it on a miss
+ * \param  *cache - array cache
+ * \param  *path - file path
+ * \param  *sep - separator list, as for read_data()
+ * \param  **buff - output array, returned with cache_put()
+ * \param  *meta - output meta-data. meta->type selects the data-type
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status cache_get( Array_Cache *cache, char *path, uint8_t *sep, void **buff, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    Cache_Entry *e = NULL , *grown = NULL ;
+    struct stat sb ;
+    uint32_t idx_i = 0 , max_entries = 0 , same = 0 , hashed = 0 , rescan = 0 , strict = parse_strict() ;
+    uint64_t hash = 0 ;
+    void *held = NULL ;
+    Data_Type type ;
+
+    if((cache == NULL) || (path == NULL) || (sep == NULL) || (buff == NULL) || (meta == NULL)) {
+        debug("Invalid params cache = %p, path = %p, sep = %p, buff = %p, meta = %p", cache, path, sep, buff, meta);
+        return api_Err_Param ;
+    }
+    *buff = NULL ;
+    type = meta->type ;
+    if( stat( path, &sb ) != 0 ) {
+        debug("Could not stat file[%s]. errno = %d", path, errno);
+        return api_Err_File ;
+    }
+
+    pthread_mutex_lock( &cache->lock );
+    for( idx_i=0 ; idx_i < cache->no_entries ; idx_i++ ) {
+        e = &cache->entry[idx_i] ;
+        if( e->stale || (e->type != type) || strcmp( e->path, path ) || strcmp( e->sep, (char *)sep ))
+            continue ;
+        same = (e->dev == sb.st_dev) && (e->ino == sb.st_ino) && (e->size == sb.st_size) &&
+               (e->mtime.tv_sec == sb.st_mtim.tv_sec) && (e->mtime.tv_nsec == sb.st_mtim.tv_nsec) &&
+               (e->strict >= strict) ;
+        rescan = 0 ;
+        if( !same && (e->size == sb.st_size) && (e->strict >= strict) && (e->meta.text_hash != 0)) {
+            /* touched or copied over with the same bytes : hashing beats parsing
+               again. Hashed outside the lock, as a miss is read : the reference
+               keeps the entry, which may move meanwhile */
+            e->refs++ ;
+            held = e->buff ;
+            pthread_mutex_unlock( &cache->lock );
+            hashed = (hash_file( path, &hash ) == api_Success) ;
+            pthread_mutex_lock( &cache->lock );
+            for( idx_i=0 ; cache->entry[idx_i].buff != held ; idx_i++ )
+                ;
+            e = &cache->entry[idx_i] ;
+            e->refs-- ;
+            if( hashed && (hash == e->meta.text_hash) && !e->stale ) {
+                e->dev = sb.st_dev ;
+                e->ino = sb.st_ino ;
+                e->mtime = sb.st_mtim ;
+                same = 1 ;
+            }
+            rescan = 1 ;
+        }
+        if( same ) {
+            e->refs++ ;
+            e->last_use = ++cache->clock ;
+            cache->stats.hits++ ;
+            *buff = e->buff ;
+            *meta = e->meta ;
+            pthread_mutex_unlock( &cache->lock );
+            return api_Success ;
+        }
+        /* file changed since it was read, or a strict read is wanted */
+        if( e->refs != 0 ) {
+            e->stale = 1 ;
+        } else {
+            _cache_drop( cache, idx_i );
+            idx_i-- ;
+        }
+        if( rescan )
+            idx_i = UINT32_MAX ;                      /* entries may have moved : start over */
+    }
+    cache->stats.misses++ ;
+    pthread_mutex_unlock( &cache->lock );
+
+    /* read outside the lock : other files can be served meanwhile */
+    err = read_data( buff, meta, path, sep );
+    if( err != api_Success )
+        return err ;
+
+    pthread_mutex_lock( &cache->lock );
+    if( cache->no_entries == cache->max_entries ) {
+        max_entries = (cache->max_entries != 0) ? 2 * cache->max_entries : 16 ;
+        grown = realloc( cache->entry, max_entries * sizeof(Cache_Entry));
+        if( grown == NULL ) {
+            pthread_mutex_unlock( &cache->lock );
+            debug("Could not grow the array cache to %u entries", max_entries);
+            clean_data( buff, meta );
+            return api_Err_Memory ;
+        }
+        cache->entry = grown ;
+        cache->max_entries = max_entries ;
+    }
+    e = &cache->entry[cache->no_entries] ;
+    memset( e, 0, sizeof(Cache_Entry));
+    e->path = strdup( path );
+    e->sep = strdup((char *)sep );
+    if((e->path == NULL) || (e->sep == NULL)) {
+        e->path = (e->path != NULL) ? free(e->path), NULL : NULL ;
+        e->sep = (e->sep != NULL) ? free(e->sep), NULL : NULL ;
+        pthread_mutex_unlock( &cache->lock );
+        clean_data( buff, meta );
+        return api_Err_Memory ;
+    }
+    e->type = type ;
+    e->strict = strict ;
+    e->dev = sb.st_dev ;
+    e->ino = sb.st_ino ;
+    e->size = sb.st_size ;
+    e->mtime = sb.st_mtim ;
+    e->buff = *buff ;
+    e->meta = *meta ;
+    e->bytes = data_items( meta ) * sizeof_datatype( type );
+    e->refs = 1 ;
+    e->last_use = ++cache->clock ;
+    cache->no_entries++ ;
+    cache->stats.bytes += e->bytes ;
+    cache->stats.entries = cache->no_entries ;
+    _cache_evict( cache );
+    pthread_mutex_unlock( &cache->lock );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Copy a range of records of a file into a new array. The file is
+ *         mapped once and parsed lazily (see lazy_array.h) : only the blocks
+ *         of records slices touch are parsed, and they stay resident between
+ *         calls within the cache budget
+ * \param  *cache - array cache
+ * \param  *path - file path
+ * \param  *sep - separator list, as for read_data()
+ * \param  first - first record
+ * \param  count - records to copy, 0 : to the end. Clamped to the end
+ * \param  **buff - output array, owned by the caller : released with
+ *                  clean_data(), not cache_put()
+ * \param  *meta - output meta-data. meta->type selects the data-type
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status cache_get_range( Array_Cache *cache, char *path, uint8_t *sep, uint64_t first, uint64_t count,
+                                void **buff, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    Lazy_Entry *e = NULL ;
+    Lazy_Array *la = NULL ;
+    uint32_t idx_i = 0 , victim = 0 , strict = parse_strict() ;
+    uint64_t oldest = 0 ;
+    Data_Type type ;
+
+    if((cache == NULL) || (path == NULL) || (sep == NULL) || (buff == NULL) || (meta == NULL)) {
+        debug("Invalid params cache = %p, path = %p, sep = %p, buff = %p, meta = %p", cache, path, sep, buff, meta);
+        return api_Err_Param ;
+    }
+    *buff = NULL ;
+    type = meta->type ;
+
+    pthread_mutex_lock( &cache->lock );
+    for( idx_i=0 ; idx_i < cache->no_lazy ; idx_i++ ) {
+        e = &cache->lazy[idx_i] ;
+        if( e->stale || (e->type != type) || (e->strict < strict) || strcmp( e->path, path ) || strcmp( e->sep, (char *)sep ))
+            continue ;
+        if( lazy_current( e->la )) {
+            la = e->la ;
+            break ;
+        }
+        /* file changed since it was mapped */
+        if( e->refs != 0 ) {
+            e->stale = 1 ;
+        } else {
+            _cache_lazy_drop( cache, idx_i );
+            idx_i-- ;
+        }
+    }
+
+    if( la == NULL ) {
+        pthread_mutex_unlock( &cache->lock );
+        err = lazy_open( &la, path, sep, meta, cache->budget );
+        if( err != api_Success )
+            return err ;
+        pthread_mutex_lock( &cache->lock );
+        if( cache->no_lazy == CACHE_MAX_LAZY ) {
+            for( idx_i=0, victim=CACHE_MAX_LAZY, oldest=UINT64_MAX ; idx_i < cache->no_lazy ; idx_i++ ) {
+                if((cache->lazy[idx_i].refs == 0) && (cache->lazy[idx_i].last_use < oldest)) {
+                    oldest = cache->lazy[idx_i].last_use ;
+                    victim = idx_i ;
+                }
+            }
+            if( victim != CACHE_MAX_LAZY ) {
+                _cache_lazy_drop( cache, victim );
+                cache->stats.evictions++ ;
+            }
+        }
+        if( cache->no_lazy == CACHE_MAX_LAZY ) {
+            /* every mapped file is in use : this one is not kept */
+            pthread_mutex_unlock( &cache->lock );
+            err = lazy_read_range( la, first, count, buff, meta );
+            lazy_close( &la );
+            return err ;
+        }
+        e = &cache->lazy[cache->no_lazy] ;
+        memset( e, 0, sizeof(Lazy_Entry));
+        e->path = strdup( path );
+        e->sep = strdup((char *)sep );
+        if((e->path == NULL) || (e->sep == NULL)) {
+            e->path = (e->path != NULL) ? free(e->path), NULL : NULL ;
+            e->sep = (e->sep != NULL) ? free(e->sep), NULL : NULL ;
+            pthread_mutex_unlock( &cache->lock );
+            lazy_close( &la );
+            return api_Err_Memory ;
+        }
+        e->type = type ;
+        e->strict = strict ;
+        e->la = la ;
+        cache->no_lazy++ ;
+        cache->stats.misses++ ;
+    } else {
+        cache->stats.hits++ ;
+    }
+    e->refs++ ;
+    e->last_use = ++cache->clock ;
+    pthread_mutex_unlock( &cache->lock );
+
+    /* copied outside the lock : blocks are parsed on first use */
+    err = lazy_read_range( la, first, count, buff, meta );
+
+    pthread_mutex_lock( &cache->lock );
+    _cache_lazy_release( cache, la );
+    _cache_evict( cache );
+    pthread_mutex_unlock( &cache->lock );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Hand back an array borrowed with cache_get()
+ * \param  *cache - array cache
+ * \param  *buff - array
+ * \return void
+ */
+/*****************************************************************************/
+void cache_put( Array_Cache *cache, void *buff )
+{
+    uint32_t idx_i = 0 ;
+
+    if((cache == NULL) || (buff == NULL))
+        return ;
+
+    pthread_mutex_lock( &cache->lock );
+    for( idx_i=0 ; idx_i < cache->no_entries ; idx_i++ ) {
+        if( cache->entry[idx_i].buff != buff )
+            continue ;
+        if( cache->entry[idx_i].refs != 0 )
+            cache->entry[idx_i].refs-- ;
+        if((cache->entry[idx_i].refs == 0) && cache->entry[idx_i].stale )
+            _cache_drop( cache, idx_i );
+        break ;
+    }
+    _cache_evict( cache );
+    pthread_mutex_unlock( &cache->lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Counters of the cache
+ * \param  *cache - array cache
+ * \param  *stats - output counters
+ * \return void
+ */
+/*****************************************************************************/
+void cache_stats( Array_Cache *cache, Cache_Stats *stats )
+{
+    Lazy_Stats ls ;
+    uint32_t idx_i = 0 ;
+
+    if((cache == NULL) || (stats == NULL))
+        return ;
+    pthread_mutex_lock( &cache->lock );
+    *stats = cache->stats ;
+    for( idx_i=0 ; idx_i < cache->no_lazy ; idx_i++ ) {
+        lazy_stats( cache->lazy[idx_i].la, &ls );
+        stats->blocks += ls.resident ;
+        stats->block_hits += ls.hits ;
+        stats->block_misses += ls.misses ;
+    }
+    pthread_mutex_unlock( &cache->lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release the cache and every array it holds. No array may be
+ *         borrowed any more
+ * \param  **cache - cache handle, set to NULL on return
+ * \return void
+ */
+/*****************************************************************************/
+void cache_destroy( Array_Cache **cache )
+{
+    if((cache == NULL) || (*cache == NULL))
+        return ;
+
+    while((*cache)->no_entries != 0 )
+        _cache_drop( *cache, (*cache)->no_entries - 1 );
+    while((*cache)->no_lazy != 0 )
+        _cache_lazy_drop( *cache, (*cache)->no_lazy - 1 );
+    (*cache)->entry = ((*cache)->entry != NULL) ? free((*cache)->entry), NULL : NULL ;
+    pthread_mutex_destroy( &(*cache)->lock );
+    free( *cache );
+    *cache = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Free an entry and close the gap. Called with the lock held
+ */
+/*****************************************************************************/
+static void _cache_drop( Array_Cache *cache, uint32_t idx )
+{
+    Cache_Entry *e = &cache->entry[idx] ;
+
+    cache->stats.bytes -= e->bytes ;
+    clean_data( &e->buff, &e->meta );
+    e->path = (e->path != NULL) ? free(e->path), NULL : NULL ;
+    e->sep = (e->sep != NULL) ? free(e->sep), NULL : NULL ;
+    cache->entry[idx] = cache->entry[cache->no_entries - 1] ;
+    cache->no_entries-- ;
+    cache->stats.entries = cache->no_entries ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Drop unreferenced entries, or the parsed blocks of files no slice
+ *         is being copied from, least recently used first, until the cache
+ *         fits its budget. Called with the lock held
+ */
+/*****************************************************************************/
+static void _cache_evict( Array_Cache *cache )
+{
+    Lazy_Entry *l = NULL ;
+    uint32_t idx_i = 0 , victim = 0 , lazy = 0 ;
+    uint64_t oldest = 0 , held = 0 ;
+
+    while( cache->stats.bytes > cache->budget ) {
+        for( idx_i=0, victim=cache->no_entries, oldest=UINT64_MAX ; idx_i < cache->no_entries ; idx_i++ ) {
+            if((cache->entry[idx_i].refs == 0) && (cache->entry[idx_i].last_use < oldest)) {
+                oldest = cache->entry[idx_i].last_use ;
+                victim = idx_i ;
+            }
+        }
+        for( idx_i=0, lazy=cache->no_lazy ; idx_i < cache->no_lazy ; idx_i++ ) {
+            l = &cache->lazy[idx_i] ;
+            if((l->refs == 0) && (l->bytes != 0) && (l->last_use < oldest)) {
+                oldest = l->last_use ;
+                lazy = idx_i ;
+            }
+        }
+        if( lazy != cache->no_lazy ) {
+            /* the file stays mapped : only its values are parsed again */
+            l = &cache->lazy[lazy] ;
+            held = lazy_trim( l->la, 0 );
+            cache->stats.bytes = cache->stats.bytes - l->bytes + held ;
+            if( held == l->bytes )
+                break ;                               /* its blocks are all borrowed */
+            l->bytes = held ;
+        } else if( victim != cache->no_entries ) {
+            _cache_drop( cache, victim );
+        } else {
+            break ;                                   /* everything left is borrowed */
+        }
+        cache->stats.evictions++ ;
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Unmap a lazily parsed file and close the gap. Its block counters
+ *         are kept. Called with the lock held
+ */
+/*****************************************************************************/
+static void _cache_lazy_drop( Array_Cache *cache, uint32_t idx )
+{
+    Lazy_Entry *e = &cache->lazy[idx] ;
+    Lazy_Stats ls ;
+
+    lazy_stats( e->la, &ls );
+    cache->stats.block_hits += ls.hits ;
+    cache->stats.block_misses += ls.misses ;
+    cache->stats.bytes -= e->bytes ;
+    lazy_close( &e->la );
+    e->path = (e->path != NULL) ? free(e->path), NULL : NULL ;
+    e->sep = (e->sep != NULL) ? free(e->sep), NULL : NULL ;
+    cache->lazy[idx] = cache->lazy[cache->no_lazy - 1] ;
+    cache->no_lazy-- ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Done copying from a lazily parsed file : charge its parsed blocks
+ *         to the cache, drop it if it changed meanwhile. Called with the
+ *         lock held
+ */
+/*****************************************************************************/
+static void _cache_lazy_release( Array_Cache *cache, Lazy_Array *la )
+{
+    Lazy_Stats ls ;
+    uint32_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < cache->no_lazy ; idx_i++ ) {
+        if( cache->lazy[idx_i].la != la )
+            continue ;
+        lazy_stats( la, &ls );
+        cache->stats.bytes = cache->stats.bytes - cache->lazy[idx_i].bytes + ls.bytes ;
+        cache->lazy[idx_i].bytes = ls.bytes ;
+        if( cache->lazy[idx_i].refs != 0 )
+            cache->lazy[idx_i].refs-- ;
+        if((cache->lazy[idx_i].refs == 0) && cache->lazy[idx_i].stale )
+            _cache_lazy_drop( cache, idx_i );
+        break ;
+    }
+    return ;
+}
@@ -0,0 +1,238 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "simd.h"
+#include "time_eval.h"
+#include "thread_pool.h"
+#include "bandwidth.h"
+
+
+#define BW_TASK_ELEMS   (64 * 1024)
+#define BW_SCALAR       3.0
+
+
+typedef struct __Bw_Ctx__
+{
+    double *a ;
+    double *b ;
+    double *c ;
+    uint64_t elems ;
+} Bw_Ctx ;
+
+
+static const char *g_bw_names[Bw_MaxKernels] =
+{
+    [Bw_Copy]  = "copy" ,
+    [Bw_Scale] = "scale",
+    [Bw_Add]   = "add"  ,
+    [Bw_Triad] = "triad",
+};
+
+/* arrays each kernel reads and writes */
+static const uint32_t g_bw_arrays[Bw_MaxKernels] =
+{
+    [Bw_Copy]  = 2 ,
+    [Bw_Scale] = 2 ,
+    [Bw_Add]   = 3 ,
+    [Bw_Triad] = 3 ,
+};
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : initialise (and fault in) the arrays in parallel so
+ *         page faults are not part of the measurement
+ */
+/*****************************************************************************/
+static void _bw_init_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Bw_Ctx *ctx = (Bw_Ctx *)arg ;
+    uint64_t idx_i = task * BW_TASK_ELEMS , end = idx_i + BW_TASK_ELEMS ;
+
+    end = (end > ctx->elems) ? ctx->elems : end ;
+    for( ; idx_i < end ; idx_i++ ) {
+        ctx->a[idx_i] = 1.0 ;
+        ctx->b[idx_i] = 2.0 ;
+        ctx->c[idx_i] = 0.0 ;
+    }
+    return ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool tasks : the four STREAM kernels
+ */
+/*****************************************************************************/
+SIMD_KERNEL
+static void _bw_copy_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Bw_Ctx *ctx = (Bw_Ctx *)arg ;
+    uint64_t idx_i = task * BW_TASK_ELEMS , end = idx_i + BW_TASK_ELEMS ;
+    double *restrict a = ctx->a , *restrict c = ctx->c ;
+
+    end = (end > ctx->elems) ? ctx->elems : end ;
+    for( ; idx_i < end ; idx_i++ )
+        c[idx_i] = a[idx_i] ;
+    return ;
+}
+
+SIMD_KERNEL
+static void _bw_scale_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Bw_Ctx *ctx = (Bw_Ctx *)arg ;
+    uint64_t idx_i = task * BW_TASK_ELEMS , end = idx_i + BW_TASK_ELEMS ;
+    double *restrict b = ctx->b , *restrict c = ctx->c ;
+
+    end = (end > ctx->elems) ? ctx->elems : end ;
+    for( ; idx_i < end ; idx_i++ )
+        b[idx_i] = BW_SCALAR * c[idx_i] ;
+    return ;
+}
+
+SIMD_KERNEL
+static void _bw_add_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Bw_Ctx *ctx = (Bw_Ctx *)arg ;
+    uint64_t idx_i = task * BW_TASK_ELEMS , end = idx_i + BW_TASK_ELEMS ;
+    double *restrict a = ctx->a , *restrict b = ctx->b , *restrict c = ctx->c ;
+
+    end = (end > ctx->elems) ? ctx->elems : end ;
+    for( ; idx_i < end ; idx_i++ )
+        c[idx_i] = a[idx_i] + b[idx_i] ;
+    return ;
+}
+
+SIMD_KERNEL
+static void _bw_triad_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Bw_Ctx *ctx = (Bw_Ctx *)arg ;
+    uint64_t idx_i = task * BW_TASK_ELEMS , end = idx_i + BW_TASK_ELEMS ;
+    double *restrict a = ctx->a , *restrict b = ctx->b , *restrict c = ctx->c ;
+
+    end = (end > ctx->elems) ? ctx->elems : end ;
+    for( ; idx_i < end ; idx_i++ )
+        a[idx_i] = b[idx_i] + BW_SCALAR * c[idx_i] ;
+    return ;
+}
+
+static const tpool_task_fn g_bw_tasks[Bw_MaxKernels] =
+{
+    [Bw_Copy]  = _bw_copy_task ,
+    [Bw_Scale] = _bw_scale_task,
+    [Bw_Add]   = _bw_add_task  ,
+    [Bw_Triad] = _bw_triad_task,
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Name of a STREAM kernel
+ * \param  kernel - kernel
+ * \return name, "unknown" for invalid kernels
+ */
+/*****************************************************************************/
+const char *bw_kernel_name( Bw_Kernel kernel )
+{
+    return (kernel < Bw_MaxKernels) ? g_bw_names[kernel] : "unknown" ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Measure sustainable bandwidth of one STREAM kernel
+ * \param  kernel - copy, scale, add or triad
+ * \param  *pool - threads to run on. NULL selects the default pool
+ * \param  bytes - size of each of the three arrays. 0 selects BW_DEFAULT_BYTES
+ * \param  reps - number of timed repetitions. 0 selects BW_DEFAULT_REPS
+ * \return best observed bandwidth in GB/s (10^9 bytes). 0 on failure
+ */
+/*****************************************************************************/
+double bw_stream( Bw_Kernel kernel, Thread_Pool *pool, uint64_t bytes, uint32_t reps )
+{
+    Bw_Ctx ctx ;
+    struct timespec begin , end ;
+    uint64_t no_tasks = 0 ;
+    uint32_t idx_r = 0 ;
+    double best = 0.0 , secs = 0.0 , moved = 0.0 ;
+
+    memset( &ctx, 0, sizeof(ctx));
+    if( kernel >= Bw_MaxKernels ) {
+        debug("Invalid bandwidth kernel %d", kernel);
+        goto err_bw_stream ;
+    }
+    pool = (pool == NULL) ? tpool_default() : pool ;
+    bytes = (bytes == 0) ? BW_DEFAULT_BYTES : bytes ;
+    reps = (reps == 0) ? BW_DEFAULT_REPS : reps ;
+
+    ctx.elems = bytes / sizeof(double) ;
+    if((posix_memalign((void **)&ctx.a, SIMD_ALIGN, ctx.elems * sizeof(double)) != 0) ||
+       (posix_memalign((void **)&ctx.b, SIMD_ALIGN, ctx.elems * sizeof(double)) != 0) ||
+       (posix_memalign((void **)&ctx.c, SIMD_ALIGN, ctx.elems * sizeof(double)) != 0)) {
+        debug("Could not allocate 3 x %llu bytes for bandwidth probe", (unsigned long long)bytes);
+        goto err_bw_stream ;
+    }
+
+    no_tasks = (ctx.elems + BW_TASK_ELEMS - 1) / BW_TASK_ELEMS ;
+    tpool_parallel_for( pool, no_tasks, _bw_init_task, &ctx );
+
+    moved = (double)g_bw_arrays[kernel] * ctx.elems * sizeof(double) ;
+    for( idx_r=0 ; idx_r < reps ; idx_r++ ) {
+        start_wall_timer( begin );
+        tpool_parallel_for( pool, no_tasks, g_bw_tasks[kernel], &ctx );
+        stop_wall_timer( end );
+        secs = wall_time_taken( begin, end );
+        if((secs > 0.0) && (moved / secs / 1e9 > best))
+            best = moved / secs / 1e9 ;
+    }
+
+err_bw_stream :
+    ctx.a = (ctx.a != NULL) ? free(ctx.a), NULL : NULL ;
+    ctx.b = (ctx.b != NULL) ? free(ctx.b), NULL : NULL ;
+    ctx.c = (ctx.c != NULL) ? free(ctx.c), NULL : NULL ;
+    return best ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Measure sustainable copy bandwidth of the host using the default
+ *         thread pool
+ * \param  bytes - size of each array. 0 selects BW_DEFAULT_BYTES
+ * \param  reps - number of timed repetitions. 0 selects BW_DEFAULT_REPS
+ * \return best observed bandwidth in GB/s (10^9 bytes). 0 on failure
+ */
+/*****************************************************************************/
+double bw_stream_copy( uint64_t bytes, uint32_t reps )
+{
+    return bw_stream( Bw_Copy, NULL, bytes, reps );
+}
@@ -149,6 +149,10 @@ api_Err_Status map_data_types( Data_Type *dtype, uint8_t *type_str )
         *dtype = DataType_int32 ;
     } else if( strncasecmp(type_str , "int64" , strlen("int64")) == 0 ) {
         *dtype = DataType_int64 ;
+    } else if( strncasecmp(type_str , "float16" , strlen("float16")) == 0 ) {
+        *dtype = DataType_float16 ;
+    } else if( strncasecmp(type_str , "bfloat16" , strlen("bfloat16")) == 0 ) {
+        *dtype = DataType_bfloat16 ;
     } else if( strncasecmp(type_str , "float" , strlen("float")) == 0 ) {
         *dtype = DataType_float ;
     } else if( strncasecmp(type_str , "double" , strlen("double")) == 0 ) {
@@ -0,0 +1,632 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_ZSTD
+  #include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+  #include <lz4.h>
+  #include <lz4frame.h>
+#endif
+
+#include "debug.h"
+#include "api_err.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "decompress.h"
+#include "huge_pages.h"
+
+
+#define DC_ZSTD_MAGIC      0xFD2FB528u
+#define DC_LZ4_MAGIC       0x184D2204u
+#define DC_SKIP_MAGIC      0x184D2A50u    /* skippable frames, shared by both formats */
+#define DC_SKIP_MASK       0xFFFFFFF0u
+#define DC_MIN_GROW        (64 * 1024)    /* first private buffer of a unit of unknown size */
+
+
+/*!
+ * Independently decodable pieces of a compressed file
+ */
+typedef enum __Dc_Unit_Kind__
+{
+    Dc_Zstd_Frame       =  0 ,
+    Dc_Lz4_Frame             ,   /* linked blocks : decoded as a whole frame */
+    Dc_Lz4_Block             ,   /* block of a frame with independent blocks */
+    Dc_Raw_Block                 /* stored (incompressible) lz4 block */
+} Dc_Unit_Kind ;
+
+
+typedef struct __Dc_Unit__
+{
+    const uint8_t *src ;
+    uint64_t src_size ;
+    uint64_t cap ;           /* inflated size, or an upper bound. 0 if unknown */
+    uint8_t *dst ;           /* slice of the output, or a private buffer */
+    uint64_t out_size ;
+    uint32_t kind ;
+    api_Err_Status err ;
+} Dc_Unit ;
+
+
+typedef struct __Dc_Ctx__
+{
+    Dc_Unit *unit ;
+    uint64_t no_units ;
+    uint64_t max_units ;
+    uint32_t in_place ;      /* every unit has a cap : decode into the output directly */
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx **zctx ;       /* one per pool thread, created on first use */
+#endif
+} Dc_Ctx ;
+
+
+
+static api_Err_Status _dc_split( Dc_Ctx *, const uint8_t *, uint64_t, Compress_Format, char * );
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+static api_Err_Status _dc_add( Dc_Ctx *, uint32_t, const uint8_t *, uint64_t, uint64_t );
+static api_Err_Status _dc_grow( Dc_Unit * );
+#endif
+static void _dc_task( void *, uint64_t, uint32_t );
+#ifdef HAVE_ZSTD
+static api_Err_Status _dc_zstd_stream( Dc_Unit *, ZSTD_DCtx * );
+#endif
+#ifdef HAVE_LZ4
+static api_Err_Status _dc_lz4_split( Dc_Ctx *, const uint8_t *, uint64_t, uint64_t * );
+static api_Err_Status _dc_lz4_frame( Dc_Unit * );
+#endif
+
+
+static const char *g_dc_names[Compress_MaxFormats] =
+{
+    [Compress_None] = "none",
+    [Compress_Zstd] = "zstd",
+    [Compress_Lz4]  = "lz4",
+};
+
+
+
+static inline uint32_t _dc_le32( const uint8_t *p )
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24) ;
+}
+
+
+
+static inline uint64_t _dc_le64( const uint8_t *p )
+{
+    return (uint64_t)_dc_le32( p ) | ((uint64_t)_dc_le32( p + 4 ) << 32) ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Recognise a compressed buffer from its first frame's magic number
+ * \param  *buff - start of the file content
+ * \param  size - bytes available
+ * \return compression format, Compress_None for plain text
+ */
+/*****************************************************************************/
+Compress_Format compress_format( const uint8_t *buff, uint64_t size )
+{
+    uint32_t magic = 0 ;
+
+    if((buff == NULL) || (size < 4))
+        return Compress_None ;
+
+    magic = _dc_le32( buff );
+    if( magic == DC_ZSTD_MAGIC )
+        return Compress_Zstd ;
+    if( magic == DC_LZ4_MAGIC )
+        return Compress_Lz4 ;
+    return Compress_None ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Printable name of a compression format
+ */
+/*****************************************************************************/
+const char *compress_name( Compress_Format fmt )
+{
+    return (fmt < Compress_MaxFormats) ? g_dc_names[fmt] : "unknown" ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Inflate a zstd or lz4 file image into a NUL-terminated text buffer.
+ *         The image is split into independently decodable frames (and lz4
+ *         blocks) which are inflated in parallel on the thread pool. When the
+ *         inflated size of every piece is known up front, pieces are decoded
+ *         straight into their slice of the output; otherwise each piece grows
+ *         a private buffer and the pieces are concatenated at the end
+ * \param  **buff - output text, released with huge_free()
+ * \param  *size - inflated bytes (excluding the terminator)
+ * \param  *in - compressed file image
+ * \param  in_size - bytes in *in
+ * \param  *path - file name, for messages
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status decompress_text( uint8_t **buff, uint64_t *size, const uint8_t *in, uint64_t in_size, char *path )
+{
+    api_Err_Status err = api_Success ;
+    Compress_Format fmt = Compress_None ;
+    Dc_Ctx ctx ;
+    uint64_t idx_i = 0 , total = 0 , pos = 0 ;
+    uint32_t no_threads = 0 ;
+    uint8_t *out = NULL ;
+    Perf_Sample ps ;
+
+    memset( &ctx, 0, sizeof(ctx));
+    if((buff == NULL) || (size == NULL) || (in == NULL)) {
+        debug("Invalid params buff = %p, size = %p, in = %p", buff, size, in);
+        err = api_Err_Param ;
+        goto err_decompress ;
+    }
+    *buff = NULL ;
+    *size = 0 ;
+
+    fmt = compress_format( in, in_size );
+    perf_begin( &ps );
+    err = _dc_split( &ctx, in, in_size, fmt, path );
+    if( err != api_Success )
+        goto err_decompress_units ;
+
+    no_threads = tpool_size( tpool_default());
+#ifdef HAVE_ZSTD
+    ctx.zctx = calloc( no_threads, sizeof(ZSTD_DCtx *));
+    if( ctx.zctx == NULL ) {
+        debug("Could not allocate %u zstd contexts", no_threads);
+        err = api_Err_Memory ;
+        goto err_decompress_units ;
+    }
+#endif
+
+    /* decode in place when every piece has a known (upper bound of its) size */
+    ctx.in_place = 1 ;
+    for( idx_i=0 ; idx_i < ctx.no_units ; idx_i++ ) {
+        ctx.in_place &= (ctx.unit[idx_i].cap != 0) ;
+        total += ctx.unit[idx_i].cap ;
+    }
+    if( ctx.in_place ) {
+        out = huge_alloc( total + 1, 0 );
+        if( out == NULL ) {
+            debug("Could not alloc(%llu) bytes to inflate [%s]", (unsigned long long)total + 1, path);
+            err = api_Err_Memory ;
+            goto err_decompress_units ;
+        }
+        for( idx_i=0, pos=0 ; idx_i < ctx.no_units ; pos += ctx.unit[idx_i].cap, idx_i++ )
+            ctx.unit[idx_i].dst = out + pos ;
+    }
+
+    err = tpool_parallel_for( tpool_default(), ctx.no_units, _dc_task, &ctx );
+    for( idx_i=0 ; (idx_i < ctx.no_units) && (err == api_Success) ; idx_i++ ) {
+        if( ctx.unit[idx_i].err != api_Success ) {
+            debug("[%s] : %s data at offset %llu is corrupt or truncated", path, compress_name( fmt ),
+                        (unsigned long long)(ctx.unit[idx_i].src - in));
+            err = ctx.unit[idx_i].err ;
+        }
+    }
+    if( err != api_Success )
+        goto err_decompress_out ;
+
+    if( ctx.in_place ) {
+        /* pieces that came out short of their bound leave gaps : close them */
+        for( idx_i=0, pos=0 ; idx_i < ctx.no_units ; pos += ctx.unit[idx_i].out_size, idx_i++ ) {
+            if( ctx.unit[idx_i].dst != out + pos )
+                memmove( out + pos, ctx.unit[idx_i].dst, ctx.unit[idx_i].out_size );
+            ctx.unit[idx_i].dst = NULL ;
+        }
+        /* the slack of short pieces is kept : out may be a huge page mapping */
+        *buff = out ;
+        out = NULL ;
+    } else {
+        for( idx_i=0, pos=0 ; idx_i < ctx.no_units ; idx_i++ )
+            pos += ctx.unit[idx_i].out_size ;
+        *buff = huge_alloc( pos + 1, 0 );
+        if( *buff == NULL ) {
+            debug("Could not alloc(%llu) bytes to inflate [%s]", (unsigned long long)pos + 1, path);
+            err = api_Err_Memory ;
+            goto err_decompress_out ;
+        }
+        for( idx_i=0, pos=0 ; idx_i < ctx.no_units ; pos += ctx.unit[idx_i].out_size, idx_i++ )
+            memcpy( *buff + pos, ctx.unit[idx_i].dst, ctx.unit[idx_i].out_size );
+    }
+    (*buff)[pos] = '\0' ;
+    *size = pos ;
+    perf_end( &ps, Perf_Inflate, pos );
+    debug("[%s] : %s, %llu bytes inflated to %llu in %llu pieces on %u threads", path, compress_name( fmt ),
+                (unsigned long long)in_size, (unsigned long long)pos, (unsigned long long)ctx.no_units, no_threads);
+
+err_decompress_out :
+    out = (out != NULL) ? huge_free(out), NULL : NULL ;
+
+err_decompress_units :
+    for( idx_i=0 ; (ctx.unit != NULL) && (idx_i < ctx.no_units) ; idx_i++ ) {
+        if( !ctx.in_place && (ctx.unit[idx_i].dst != NULL))
+            free( ctx.unit[idx_i].dst );
+    }
+    ctx.unit = (ctx.unit != NULL) ? free(ctx.unit), NULL : NULL ;
+#ifdef HAVE_ZSTD
+    for( idx_i=0 ; (ctx.zctx != NULL) && (idx_i < no_threads) ; idx_i++ )
+        ZSTD_freeDCtx( ctx.zctx[idx_i] );
+    ctx.zctx = (ctx.zctx != NULL) ? free(ctx.zctx), NULL : NULL ;
+#endif
+
+err_decompress :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Cut a compressed image into independently decodable pieces.
+ *         Skippable frames are dropped, frames of either format may follow
+ *         each other (e.g. concatenated files or a multi-frame pzstd output)
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _dc_split( Dc_Ctx *ctx, const uint8_t *in, uint64_t in_size, Compress_Format fmt, char *path )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t pos = 0 , frame = 0 ;
+    uint32_t magic = 0 ;
+#ifdef HAVE_ZSTD
+    unsigned long long content = 0 ;
+#endif
+
+    for( pos=0 ; pos < in_size ; pos += frame ) {
+        if((in_size - pos) < 8) {
+            debug("[%s] : %llu trailing bytes after the last %s frame", path, (unsigned long long)(in_size - pos), compress_name( fmt ));
+            err = api_Err_File ;
+            goto err_split ;
+        }
+        magic = _dc_le32( in + pos );
+        if((magic & DC_SKIP_MASK) == DC_SKIP_MAGIC ) {
+            frame = 8 + (uint64_t)_dc_le32( in + pos + 4 );
+        } else if( magic == DC_ZSTD_MAGIC ) {
+#ifdef HAVE_ZSTD
+            frame = ZSTD_findFrameCompressedSize( in + pos, in_size - pos );
+            if( ZSTD_isError( frame )) {
+                debug("[%s] : bad zstd frame at offset %llu : %s", path, (unsigned long long)pos, ZSTD_getErrorName( frame ));
+                err = api_Err_File ;
+                goto err_split ;
+            }
+            content = ZSTD_getFrameContentSize( in + pos, frame );
+            content = ((content == ZSTD_CONTENTSIZE_UNKNOWN) || (content == ZSTD_CONTENTSIZE_ERROR)) ? 0 : content ;
+            err = _dc_add( ctx, Dc_Zstd_Frame, in + pos, frame, content );
+            if( err != api_Success )
+                goto err_split ;
+#else
+            debug("[%s] is zstd-compressed : built without zstd support. Rebuild with make ZSTD=1", path);
+            err = api_Err_File ;
+            goto err_split ;
+#endif
+        } else if( magic == DC_LZ4_MAGIC ) {
+#ifdef HAVE_LZ4
+            err = _dc_lz4_split( ctx, in + pos, in_size - pos, &frame );
+            if( err != api_Success ) {
+                debug("[%s] : bad lz4 frame at offset %llu", path, (unsigned long long)pos);
+                goto err_split ;
+            }
+#else
+            debug("[%s] is lz4-compressed : built without lz4 support. Rebuild with make LZ4=1", path);
+            err = api_Err_File ;
+            goto err_split ;
+#endif
+        } else {
+            debug("[%s] : unknown frame magic 0x%08x at offset %llu", path, magic, (unsigned long long)pos);
+            err = api_Err_File ;
+            goto err_split ;
+        }
+        if( frame > (in_size - pos)) {
+            debug("[%s] : frame at offset %llu runs past the end of the file", path, (unsigned long long)pos);
+            err = api_Err_File ;
+            goto err_split ;
+        }
+    }
+
+err_split :
+    return err ;
+}
+
+
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/*****************************************************************************/
+/*!
+ * \brief  Append a piece to the split list
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _dc_add( Dc_Ctx *ctx, uint32_t kind, const uint8_t *src, uint64_t src_size, uint64_t cap )
+{
+    Dc_Unit *grown = NULL ;
+    uint64_t max_units = 0 ;
+
+    if( ctx->no_units == ctx->max_units ) {
+        max_units = (ctx->max_units != 0) ? 2 * ctx->max_units : 64 ;
+        grown = realloc( ctx->unit, max_units * sizeof(Dc_Unit));
+        if( grown == NULL ) {
+            debug("Could not grow the frame list to %llu entries", (unsigned long long)max_units);
+            return api_Err_Memory ;
+        }
+        ctx->unit = grown ;
+        ctx->max_units = max_units ;
+    }
+    memset( &ctx->unit[ctx->no_units], 0, sizeof(Dc_Unit));
+    ctx->unit[ctx->no_units].kind = kind ;
+    ctx->unit[ctx->no_units].src = src ;
+    ctx->unit[ctx->no_units].src_size = src_size ;
+    ctx->unit[ctx->no_units].cap = cap ;
+    ctx->no_units++ ;
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Double the private buffer of a piece of unknown inflated size
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _dc_grow( Dc_Unit *u )
+{
+    uint64_t cap = 0 ;
+    uint8_t *grown = NULL ;
+
+    cap = (u->cap != 0) ? 2 * u->cap : 4 * u->src_size ;
+    cap = (cap > DC_MIN_GROW) ? cap : DC_MIN_GROW ;
+    grown = realloc( u->dst, cap );
+    if( grown == NULL )
+        return api_Err_Memory ;
+    u->dst = grown ;
+    u->cap = cap ;
+    return api_Success ;
+}
+#endif
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : inflate one piece
+ */
+/*****************************************************************************/
+static void _dc_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Dc_Ctx *ctx = (Dc_Ctx *)arg ;
+    Dc_Unit *u = &ctx->unit[task] ;
+#ifdef HAVE_LZ4
+    int bytes = 0 ;
+#endif
+#ifdef HAVE_ZSTD
+    size_t ret = 0 ;
+#endif
+
+    (void)thread_idx ;
+    if( !ctx->in_place && (u->cap != 0)) {
+        u->dst = malloc( u->cap );
+        if( u->dst == NULL ) {
+            u->err = api_Err_Memory ;
+            return ;
+        }
+    }
+
+    switch( u->kind )
+    {
+        case Dc_Raw_Block :
+            memcpy( u->dst, u->src, u->src_size );
+            u->out_size = u->src_size ;
+            break ;
+#ifdef HAVE_LZ4
+        case Dc_Lz4_Block :
+            bytes = LZ4_decompress_safe((const char *)u->src, (char *)u->dst, (int)u->src_size, (int)u->cap );
+            u->err = (bytes < 0) ? api_Err_File : api_Success ;
+            u->out_size = (bytes < 0) ? 0 : (uint64_t)bytes ;
+            break ;
+        case Dc_Lz4_Frame :
+            u->err = _dc_lz4_frame( u );
+            break ;
+#endif
+#ifdef HAVE_ZSTD
+        case Dc_Zstd_Frame :
+            if( ctx->zctx[thread_idx] == NULL )
+                ctx->zctx[thread_idx] = ZSTD_createDCtx();
+            if( ctx->zctx[thread_idx] == NULL ) {
+                u->err = api_Err_Memory ;
+            } else if( u->cap != 0 ) {
+                ret = ZSTD_decompressDCtx( ctx->zctx[thread_idx], u->dst, u->cap, u->src, u->src_size );
+                u->err = ZSTD_isError( ret ) ? api_Err_File : api_Success ;
+                u->out_size = ZSTD_isError( ret ) ? 0 : ret ;
+            } else {
+                u->err = _dc_zstd_stream( u, ctx->zctx[thread_idx] );
+            }
+            break ;
+#endif
+        default :
+            u->err = api_Err_Param ;
+            break ;
+    }
+    return ;
+}
+
+
+
+#ifdef HAVE_ZSTD
+/*****************************************************************************/
+/*!
+ * \brief  Inflate a zstd frame that does not record its content size into a
+ *         growing private buffer
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _dc_zstd_stream( Dc_Unit *u, ZSTD_DCtx *zctx )
+{
+    ZSTD_inBuffer zin = { u->src, u->src_size, 0 } ;
+    ZSTD_outBuffer zout = { NULL, 0, 0 } ;
+    size_t ret = 1 ;
+
+    ZSTD_DCtx_reset( zctx, ZSTD_reset_session_only );
+    while( ret != 0 ) {
+        if( u->out_size == u->cap ) {
+            if( _dc_grow( u ) != api_Success )
+                return api_Err_Memory ;
+        }
+        zout.dst = u->dst ;
+        zout.size = u->cap ;
+        zout.pos = u->out_size ;
+        ret = ZSTD_decompressStream( zctx, &zout, &zin );
+        if( ZSTD_isError( ret ))
+            return api_Err_File ;
+        u->out_size = zout.pos ;
+        if((ret != 0) && (zin.pos == zin.size) && (zout.pos < zout.size))
+            return api_Err_File ;                               /* truncated */
+    }
+    return api_Success ;
+}
+#endif
+
+
+
+#ifdef HAVE_LZ4
+/*****************************************************************************/
+/*!
+ * \brief  Walk the blocks of an lz4 frame. Frames with independent blocks are
+ *         split per block (each inflating to at most the frame's block size),
+ *         frames with linked blocks or a dictionary are kept whole
+ * \param  *frame - bytes taken by the frame, checksums included
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _dc_lz4_split( Dc_Ctx *ctx, const uint8_t *p, uint64_t avail, uint64_t *frame )
+{
+    api_Err_Status err = api_Success ;
+    uint8_t flg = 0 , bd = 0 ;
+    uint64_t hdr = 0 , pos = 0 , block = 0 , bmax = 0 , content = 0 , first = 0 ;
+    uint32_t indep = 0 , bsum = 0 , raw = 0 ;
+
+    if( avail < 7 )
+        return api_Err_File ;
+    flg = p[4] ;
+    bd = p[5] ;
+    if(((flg >> 6) != 1) || (((bd >> 4) & 7) < 4))
+        return api_Err_File ;
+
+    bmax = (uint64_t)1 << (8 + 2 * ((bd >> 4) & 7)) ;
+    hdr = 7 + ((flg & 0x08) ? 8 : 0) + ((flg & 0x01) ? 4 : 0) ;
+    if( avail < hdr )
+        return api_Err_File ;
+    content = (flg & 0x08) ? _dc_le64( p + 6 ) : 0 ;
+    indep = ((flg & 0x20) != 0) && ((flg & 0x01) == 0) ;
+    bsum = (flg & 0x10) ? 4 : 0 ;
+
+    first = ctx->no_units ;
+    for( pos=hdr ; ; pos += block + bsum ) {
+        if((avail - pos) < 4 )
+            return api_Err_File ;
+        block = _dc_le32( p + pos );
+        pos += 4 ;
+        if( block == 0 )
+            break ;                                             /* end mark */
+        raw = (block >> 31) ;
+        block &= 0x7FFFFFFFu ;
+        if((block > bmax) || ((avail - pos) < (block + bsum)))
+            return api_Err_File ;
+        if( indep ) {
+            err = _dc_add( ctx, raw ? Dc_Raw_Block : Dc_Lz4_Block, p + pos, block, raw ? block : bmax );
+            if( err != api_Success )
+                return err ;
+        }
+    }
+    pos += (flg & 0x04) ? 4 : 0 ;                               /* content checksum */
+    if( pos > avail )
+        return api_Err_File ;
+
+    /* a single block frame that records its size needs no more room than that */
+    if( indep && ((ctx->no_units - first) == 1) && (content != 0) && (ctx->unit[first].kind == Dc_Lz4_Block))
+        ctx->unit[first].cap = (content < bmax) ? content : bmax ;
+    if( !indep )
+        err = _dc_add( ctx, Dc_Lz4_Frame, p, pos, content );
+    *frame = pos ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Inflate a whole lz4 frame (linked blocks), into its slice when the
+ *         frame records its content size, else into a growing private buffer
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _dc_lz4_frame( Dc_Unit *u )
+{
+    api_Err_Status err = api_Success ;
+    LZ4F_dctx *dctx = NULL ;
+    size_t ret = 1 , in_sz = 0 , out_sz = 0 ;
+    uint64_t in = 0 ;
+    uint32_t grow = (u->cap == 0) ;
+
+    if( LZ4F_isError( LZ4F_createDecompressionContext( &dctx, LZ4F_VERSION )))
+        return api_Err_Memory ;
+
+    while( ret != 0 ) {
+        if( grow && (u->out_size == u->cap)) {
+            err = _dc_grow( u );
+            if( err != api_Success )
+                goto err_lz4_frame ;
+        }
+        in_sz = u->src_size - in ;
+        out_sz = u->cap - u->out_size ;
+        ret = LZ4F_decompress( dctx, u->dst + u->out_size, &out_sz, u->src + in, &in_sz, NULL );
+        if( LZ4F_isError( ret )) {
+            err = api_Err_File ;
+            goto err_lz4_frame ;
+        }
+        in += in_sz ;
+        u->out_size += out_sz ;
+        if((ret != 0) && (in_sz == 0) && (out_sz == 0) && !(grow && (u->out_size == u->cap))) {
+            err = api_Err_File ;                                /* truncated, or larger than recorded */
+            goto err_lz4_frame ;
+        }
+    }
+
+err_lz4_frame :
+    LZ4F_freeDecompressionContext( dctx );
+    return err ;
+}
+#endif
@@ -0,0 +1,1517 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+  #include <immintrin.h>
+#endif
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "tune_db.h"
+#include "half.h"
+#include "expr_eval.h"
+
+
+#define EXPR_BLOCK          512     /* elements per register - fits L1 for 8-byte types */
+#define EXPR_TASK_BLOCKS    128     /* default blocks handed to a pool thread at a time */
+#define EXPR_MAX_REGS       32
+#define EXPR_MAX_CONSTS     32
+#define EXPR_MAX_LEAVES     64
+#define EXPR_MAX_INSTR      128
+#define EXPR_COPY           Expr_MaxOps    /* internal op : dst = src1 */
+#define EXPR_HALF_TMP       2       /* float blocks widened operands go through */
+#define EXPR_LLC_DEFAULT    (32ULL * 1024 * 1024)  /* last level cache when sysconf() does not know */
+#define EXPR_PREFETCH       2       /* default prefetch distance in blocks, "expr.prefetch" */
+#define EXPR_LINE           64
+
+
+/*!
+ * Operand of a compiled instruction
+ */
+typedef enum __Expr_Src_Kind__
+{
+    Expr_Src_Reg     =  0 ,   /* block-sized scratch register */
+    Expr_Src_Leaf         ,   /* operand array, at current block offset */
+    Expr_Src_Const        ,   /* constant, pre-splatted into a scratch block */
+    Expr_Src_Out              /* output array, at current block offset */
+} Expr_Src_Kind ;
+
+typedef struct __Expr_Src__
+{
+    uint8_t kind ;
+    uint8_t idx ;
+} Expr_Src ;
+
+/*!
+ * How an operand of another shape is read (NumPy broadcasting). The axes
+ * of the result are merged where the operand steps through them alike ;
+ * per block, the operand is gathered from cache into a staging block
+ */
+typedef struct __Expr_Bcast__
+{
+    uint32_t slot ;                     /* staging block in scratch */
+    uint32_t no_axes ;                  /* merged axes, outermost first */
+    uint64_t ext[DATA_MAX_DIMS] ;       /* extents of the result */
+    uint64_t stride[DATA_MAX_DIMS] ;    /* operand elements per step, 0 : repeated */
+} Expr_Bcast ;
+
+typedef struct __Expr_Instr__
+{
+    uint32_t op ;
+    Expr_Src dst ;
+    Expr_Src src1 ;
+    Expr_Src src2 ;
+} Expr_Instr ;
+
+
+/*!
+ * Register program compiled from an expression tree
+ */
+typedef struct __Expr_Program__
+{
+    Data_Type type ;
+    uint32_t type_size ;
+    uint32_t reg_size ;                 /* register element : float for 16-bit floats */
+    uint64_t items ;
+    uint32_t no_dims ;
+    Data_Dimensions dim ;
+
+    uint32_t no_instr ;
+    Expr_Instr instr[EXPR_MAX_INSTR] ;
+
+    uint32_t no_regs ;                  /* high-water mark of registers */
+    uint32_t reg_busy ;                 /* bitmask of live registers */
+
+    uint32_t no_leaves ;
+    void *leaf[EXPR_MAX_LEAVES] ;       /* contiguous payload of operands */
+    uint64_t bcast_mask ;               /* leaves broadcast to the result */
+    uint32_t no_bcast ;
+    Expr_Bcast bcast[EXPR_MAX_LEAVES] ;
+
+    uint32_t no_consts ;
+    double consts[EXPR_MAX_CONSTS] ;
+
+    uint64_t div_zero ;                 /* integer divisions by zero, each giving 0 */
+} Expr_Program ;
+
+
+typedef void (*Expr_Block_Fn)( Expr_Program *, void *, uint64_t, uint32_t, void * );
+typedef void (*Expr_Widen_Fn)( float *, const uint16_t *, uint64_t );
+
+
+/*!
+ * State shared by the tasks of one evaluation
+ */
+typedef struct __Expr_Eval_Ctx__
+{
+    Expr_Program *prog ;
+    Expr_Block_Fn block_fn ;
+    void *out ;
+    uint8_t *scratch ;                  /* per-thread registers and constants */
+    uint64_t scratch_stride ;           /* bytes of scratch per thread */
+    uint64_t task_blocks ;              /* blocks per pool task, "expr.task_blocks" */
+    uint32_t stream ;                   /* result bypasses the cache, "expr.stream" */
+    uint64_t stage_offset ;             /* stream : block staging area within scratch */
+    uint64_t prefetch ;                 /* operands are prefetched this many blocks ahead */
+} Expr_Eval_Ctx ;
+
+
+static api_Err_Status _expr_compile( Expr_Node *, Expr_Program *, Expr_Src * );
+static api_Err_Status _expr_shape( Expr_Node *, Vector_MetaData *, uint32_t * );
+static api_Err_Status _expr_alloc_reg( Expr_Program *, Expr_Src * );
+static api_Err_Status _expr_add_const( Expr_Program *, double, Expr_Src * );
+static api_Err_Status _expr_emit( Expr_Program *, uint32_t, Expr_Src, Expr_Src, Expr_Src );
+static void _expr_splat_consts( Expr_Program *, void * );
+static void _expr_task( void *, uint64_t, uint32_t );
+static void _expr_prefetch( Expr_Program *, uint64_t, uint32_t );
+static api_Err_Status _expr_bcast_plan( Expr_Program *, Vector_MetaData *, Expr_Bcast * );
+static void _expr_gather( Expr_Program *, void *, uint64_t, uint32_t );
+static void _expr_stream_store( uint8_t *, const uint8_t *, uint64_t );
+static uint64_t _expr_llc_bytes( void );
+static float *_expr_half_src( Expr_Program *, Expr_Src, void *, uint64_t, uint32_t, float *, float *, float *, uint16_t *, Expr_Widen_Fn );
+
+static api_Err_Status _expr_parse_sum( Expr_Node **, char **, void **, Vector_MetaData *, uint32_t );
+static api_Err_Status _expr_parse_product( Expr_Node **, char **, void **, Vector_MetaData *, uint32_t );
+static api_Err_Status _expr_parse_unary( Expr_Node **, char **, void **, Vector_MetaData *, uint32_t );
+static api_Err_Status _expr_parse_primary( Expr_Node **, char **, void **, Vector_MetaData *, uint32_t );
+
+
+
+/*!
+ * Per-type block kernels. T is the storage type, U the type arithmetic is
+ * carried out in (unsigned for signed integers so that overflow wraps
+ * instead of being undefined), DIV the division operator and ZDIV whether a
+ * divisor is one DIV maps to 0 (integers only : floats give inf or nan).
+ * Operands are read at element start, out points at the block of the
+ * result. Broadcast operands are read from their staging block.
+ */
+#define _ZDIV_FP( y )             0
+#define _ZDIV_INT( y )            ((y) == 0)
+#define _DIV_FP( T, U, x, y )     ((x) / (y))
+#define _DIV_UINT( T, U, x, y )   (((y) == 0) ? 0 : (T)((x) / (y)))
+#define _DIV_SINT( T, U, x, y )   (((y) == 0) ? 0 : ((y) == (T)-1) ? (T)(0 - (U)(x)) : (T)((x) / (y)))
+
+#define _EXPR_LEAF_PTR( T, prog, idx, start, stage )                                     \
+    ((((prog)->bcast_mask >> (idx)) & 1) ? (stage) + ((uint64_t)(prog)->bcast[idx].slot * EXPR_BLOCK) : \
+                                          (T *)((prog)->leaf[idx]) + (start))
+
+#define _EXPR_SRC_PTR( T, prog, src, out, start, regs, consts, stage )                   \
+    (((src).kind == Expr_Src_Reg)   ? (regs) + ((uint64_t)(src).idx * EXPR_BLOCK)   :   \
+     ((src).kind == Expr_Src_Const) ? (consts) + ((uint64_t)(src).idx * EXPR_BLOCK) :   \
+     ((src).kind == Expr_Src_Leaf)  ? _EXPR_LEAF_PTR( T, prog, (src).idx, start, stage ) : \
+                                      (T *)(out))
+
+#define EXPR_BLOCK_KERNEL( T, U, DIV, ZDIV, SUFFIX )                                     \
+SIMD_KERNEL                                                                              \
+static void _expr_block_##SUFFIX( Expr_Program *prog, void *out, uint64_t start,         \
+                                  uint32_t n, void *scratch )                            \
+{                                                                                        \
+    T *regs = (T *)scratch ;                                                             \
+    T *consts = regs + ((uint64_t)prog->no_regs * EXPR_BLOCK) ;                          \
+    T *stage = consts + ((uint64_t)prog->no_consts * EXPR_BLOCK) ;                       \
+    T *d = NULL , *a = NULL , *b = NULL ;                                                \
+    Expr_Instr *ins = NULL ;                                                             \
+    uint32_t idx_i = 0 , idx_j = 0 ;                                                     \
+    uint64_t zeros = 0 ;                                                                 \
+                                                                                         \
+    if( prog->no_bcast != 0 )                                                            \
+        _expr_gather( prog, stage, start, n );                                           \
+    for( idx_i=0 ; idx_i < prog->no_instr ; idx_i++ ) {                                  \
+        ins = &prog->instr[idx_i] ;                                                      \
+        d = _EXPR_SRC_PTR( T, prog, ins->dst, out, start, regs, consts, stage );         \
+        a = _EXPR_SRC_PTR( T, prog, ins->src1, out, start, regs, consts, stage );        \
+        b = _EXPR_SRC_PTR( T, prog, ins->src2, out, start, regs, consts, stage );        \
+        switch( ins->op )                                                                \
+        {                                                                                \
+            case Expr_Add :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = (T)((U)a[idx_j] + (U)b[idx_j]) ;                          \
+                break ;                                                                  \
+            case Expr_Sub :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = (T)((U)a[idx_j] - (U)b[idx_j]) ;                          \
+                break ;                                                                  \
+            case Expr_Mul :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = (T)((U)a[idx_j] * (U)b[idx_j]) ;                          \
+                break ;                                                                  \
+            case Expr_Div :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    zeros += ZDIV( b[idx_j] ) ;                                          \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = DIV( T, U, a[idx_j], b[idx_j] ) ;                         \
+                break ;                                                                  \
+            case Expr_Neg :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = (T)(0 - (U)a[idx_j]) ;                                    \
+                break ;                                                                  \
+            case EXPR_COPY :                                                             \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = a[idx_j] ;                                                \
+                break ;                                                                  \
+            default :                                                                    \
+                break ;                                                                  \
+        }                                                                                \
+    }                                                                                    \
+    if( zeros != 0 )                                                                     \
+        __atomic_fetch_add( &prog->div_zero, zeros, __ATOMIC_RELAXED );                  \
+    return ;                                                                             \
+}
+
+EXPR_BLOCK_KERNEL( uint8_t    , uint8_t     , _DIV_UINT , _ZDIV_INT , uint8  )
+EXPR_BLOCK_KERNEL( uint16_t   , uint16_t    , _DIV_UINT , _ZDIV_INT , uint16 )
+EXPR_BLOCK_KERNEL( uint32_t   , uint32_t    , _DIV_UINT , _ZDIV_INT , uint32 )
+EXPR_BLOCK_KERNEL( uint64_t   , uint64_t    , _DIV_UINT , _ZDIV_INT , uint64 )
+EXPR_BLOCK_KERNEL( int8_t     , uint8_t     , _DIV_SINT , _ZDIV_INT , int8   )
+EXPR_BLOCK_KERNEL( int16_t    , uint16_t    , _DIV_SINT , _ZDIV_INT , int16  )
+EXPR_BLOCK_KERNEL( int32_t    , uint32_t    , _DIV_SINT , _ZDIV_INT , int32  )
+EXPR_BLOCK_KERNEL( int64_t    , uint64_t    , _DIV_SINT , _ZDIV_INT , int64  )
+EXPR_BLOCK_KERNEL( float      , float       , _DIV_FP   , _ZDIV_FP  , float  )
+EXPR_BLOCK_KERNEL( double     , double      , _DIV_FP   , _ZDIV_FP  , double )
+EXPR_BLOCK_KERNEL( long double, long double , _DIV_FP   , _ZDIV_FP  , ldouble)
+
+
+/*!
+ * 16-bit float kernels : registers and constants are floats, operands and
+ * the output are widened / narrowed a block at a time, so all arithmetic
+ * accumulates in float32 while memory traffic stays at 2 bytes per value
+ */
+#define EXPR_HALF_KERNEL( WIDEN, NARROW, SUFFIX )                                        \
+SIMD_KERNEL                                                                              \
+static void _expr_block_##SUFFIX( Expr_Program *prog, void *out, uint64_t start,         \
+                                  uint32_t n, void *scratch )                            \
+{                                                                                        \
+    float *regs = (float *)scratch ;                                                     \
+    float *consts = regs + ((uint64_t)prog->no_regs * EXPR_BLOCK) ;                      \
+    float *tmp = consts + ((uint64_t)prog->no_consts * EXPR_BLOCK) ;                     \
+    uint16_t *stage = (uint16_t *)(tmp + ((uint64_t)EXPR_HALF_TMP * EXPR_BLOCK)) ;       \
+    float *d = NULL , *a = NULL , *b = NULL ;                                            \
+    Expr_Instr *ins = NULL ;                                                             \
+    uint32_t idx_i = 0 , idx_j = 0 ;                                                     \
+                                                                                         \
+    if( prog->no_bcast != 0 )                                                            \
+        _expr_gather( prog, stage, start, n );                                           \
+    for( idx_i=0 ; idx_i < prog->no_instr ; idx_i++ ) {                                  \
+        ins = &prog->instr[idx_i] ;                                                      \
+        a = _expr_half_src( prog, ins->src1, out, start, n, regs, consts, tmp, stage, WIDEN ); \
+        b = ((ins->src2.kind == ins->src1.kind) && (ins->src2.idx == ins->src1.idx)) ? a : \
+            _expr_half_src( prog, ins->src2, out, start, n, regs, consts,                \
+                            tmp + EXPR_BLOCK, stage, WIDEN );                            \
+        d = (ins->dst.kind == Expr_Src_Out) ? tmp : regs + ((uint64_t)ins->dst.idx * EXPR_BLOCK) ; \
+        switch( ins->op )                                                                \
+        {                                                                                \
+            case Expr_Add :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = a[idx_j] + b[idx_j] ;                                     \
+                break ;                                                                  \
+            case Expr_Sub :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = a[idx_j] - b[idx_j] ;                                     \
+                break ;                                                                  \
+            case Expr_Mul :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = a[idx_j] * b[idx_j] ;                                     \
+                break ;                                                                  \
+            case Expr_Div :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = a[idx_j] / b[idx_j] ;                                     \
+                break ;                                                                  \
+            case Expr_Neg :                                                              \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = -a[idx_j] ;                                               \
+                break ;                                                                  \
+            case EXPR_COPY :                                                             \
+                SIMD_IVDEP                                                               \
+                for( idx_j=0 ; idx_j < n ; idx_j++ )                                     \
+                    d[idx_j] = a[idx_j] ;                                                \
+                break ;                                                                  \
+            default :                                                                    \
+                break ;                                                                  \
+        }                                                                                \
+        if( ins->dst.kind == Expr_Src_Out )                                              \
+            NARROW((uint16_t *)out, d, n );                                      \
+    }                                                                                    \
+    return ;                                                                             \
+}
+
+EXPR_HALF_KERNEL( half_to_float,     float_to_half,     float16  )
+EXPR_HALF_KERNEL( bfloat16_to_float, float_to_bfloat16, bfloat16 )
+
+
+static const Expr_Block_Fn g_expr_block_fns[DataType_MaxTypes] =
+{
+    [DataType_uint8]       = _expr_block_uint8   ,
+    [DataType_uint16]      = _expr_block_uint16  ,
+    [DataType_uint32]      = _expr_block_uint32  ,
+    [DataType_uint64]      = _expr_block_uint64  ,
+    [DataType_int8]        = _expr_block_int8    ,
+    [DataType_int16]       = _expr_block_int16   ,
+    [DataType_int32]       = _expr_block_int32   ,
+    [DataType_int64]       = _expr_block_int64   ,
+    [DataType_float]       = _expr_block_float   ,
+    [DataType_double]      = _expr_block_double  ,
+    [DataType_long_double] = _expr_block_ldouble ,
+    [DataType_float16]     = _expr_block_float16 ,
+    [DataType_bfloat16]    = _expr_block_bfloat16,
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a leaf node referring to an array returned by read_data()
+ * \param  **node - output node
+ * \param  *buff - N-dimensional array
+ * \param  *meta - meta-data of the array. Must stay valid while the
+ *                 expression is in use
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status expr_leaf( Expr_Node **node, void *buff, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+
+    if((node == NULL) || (buff == NULL) || (meta == NULL)) {
+        debug("Invalid params node = %p, buff = %p, meta = %p", node, buff, meta);
+        err = api_Err_Param ;
+        goto err_expr_leaf ;
+    }
+
+    *node = calloc( 1, sizeof(Expr_Node));
+    if( *node == NULL ) {
+        debug("Could not allocate expression node");
+        err = api_Err_Memory ;
+        goto err_expr_leaf ;
+    }
+    (*node)->op = Expr_Leaf ;
+    (*node)->data = buff ;
+    (*node)->meta = meta ;
+
+err_expr_leaf :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a scalar constant node
+ * \param  **node - output node
+ * \param  value - value of the constant. Converted to the type of the result
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status expr_const( Expr_Node **node, double value )
+{
+    api_Err_Status err = api_Success ;
+
+    if( node == NULL ) {
+        debug("Cannot return node in NULL pointer");
+        err = api_Err_Param ;
+        goto err_expr_const ;
+    }
+
+    *node = calloc( 1, sizeof(Expr_Node));
+    if( *node == NULL ) {
+        debug("Could not allocate expression node");
+        err = api_Err_Memory ;
+        goto err_expr_const ;
+    }
+    (*node)->op = Expr_Const ;
+    (*node)->value = value ;
+
+err_expr_const :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a unary operation node. Takes ownership of the operand
+ * \param  **node - output node
+ * \param  op - operation (Expr_Neg)
+ * \param  *operand - operand sub-tree
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status expr_unary( Expr_Node **node, Expr_Op op, Expr_Node *operand )
+{
+    api_Err_Status err = api_Success ;
+
+    if((node == NULL) || (operand == NULL) || (op != Expr_Neg)) {
+        debug("Invalid params node = %p, operand = %p, op = %d", node, operand, op);
+        err = api_Err_Param ;
+        goto err_expr_unary ;
+    }
+
+    *node = calloc( 1, sizeof(Expr_Node));
+    if( *node == NULL ) {
+        debug("Could not allocate expression node");
+        err = api_Err_Memory ;
+        goto err_expr_unary ;
+    }
+    (*node)->op = op ;
+    (*node)->lhs = operand ;
+
+err_expr_unary :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a binary operation node. Takes ownership of both operands
+ * \param  **node - output node
+ * \param  op - operation (Expr_Add, Expr_Sub, Expr_Mul, Expr_Div)
+ * \param  *lhs - left operand sub-tree
+ * \param  *rhs - right operand sub-tree
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status expr_binary( Expr_Node **node, Expr_Op op, Expr_Node *lhs, Expr_Node *rhs )
+{
+    api_Err_Status err = api_Success ;
+
+    if((node == NULL) || (lhs == NULL) || (rhs == NULL)) {
+        debug("Invalid params node = %p, lhs = %p, rhs = %p", node, lhs, rhs);
+        err = api_Err_Param ;
+        goto err_expr_binary ;
+    }
+    if((op != Expr_Add) && (op != Expr_Sub) && (op != Expr_Mul) && (op != Expr_Div)) {
+        debug("Operation %d is not a binary operation", op);
+        err = api_Err_Param ;
+        goto err_expr_binary ;
+    }
+
+    *node = calloc( 1, sizeof(Expr_Node));
+    if( *node == NULL ) {
+        debug("Could not allocate expression node");
+        err = api_Err_Memory ;
+        goto err_expr_binary ;
+    }
+    (*node)->op = op ;
+    (*node)->lhs = lhs ;
+    (*node)->rhs = rhs ;
+
+err_expr_binary :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release an expression tree (the operand arrays are not touched)
+ * \param  **node - root of tree, set to NULL on return
+ * \return void
+ */
+/*****************************************************************************/
+void expr_free( Expr_Node **node )
+{
+    if((node == NULL) || (*node == NULL))
+        return ;
+
+    expr_free( &((*node)->lhs) );
+    expr_free( &((*node)->rhs) );
+    free( *node );
+    *node = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Build an expression tree from a string such as "a + b + c*d - e".
+ *         Operands are single letters, 'a' naming the first array. Supports
+ *         + - * / , unary minus, parentheses and numeric constants
+ * \param  **root - output tree
+ * \param  *str - expression string
+ * \param  **buffs - operand arrays from read_data()
+ * \param  *metas - meta-data of the operand arrays
+ * \param  no_operands - number of entries in buffs/metas
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status expr_parse( Expr_Node **root, char *str, void **buffs, Vector_MetaData *metas, uint32_t no_operands )
+{
+    api_Err_Status err = api_Success ;
+    char *pos = str ;
+
+    if((root == NULL) || (str == NULL)) {
+        debug("Invalid params root = %p, str = %p", root, str);
+        err = api_Err_Param ;
+        goto err_expr_parse ;
+    }
+    *root = NULL ;
+
+    if( no_operands > EXPR_MAX_OPERANDS ) {
+        debug("Only %u operands can be named in an expression", EXPR_MAX_OPERANDS);
+        err = api_Err_Param ;
+        goto err_expr_parse ;
+    }
+
+    err = _expr_parse_sum( root, &pos, buffs, metas, no_operands );
+    if( err != api_Success )
+        goto err_expr_parse ;
+
+    while( isspace((unsigned char)*pos))
+        pos++ ;
+    if( *pos != '\0' ) {
+        debug("Unexpected character '%c' at offset %ld of expression [%s]", *pos, (long)(pos - str), str);
+        err = api_Err_Param ;
+        goto err_expr_parse ;
+    }
+    return err ;
+
+err_expr_parse :
+    if( root != NULL )
+        expr_free( root );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Type and dimensions of the result of an expression, following
+ *         NumPy broadcasting : shapes are aligned at the innermost axis, and
+ *         along each axis the extents must match or be 1 (or missing), the
+ *         result taking the larger. A bias vector of cols values thus adds
+ *         to every row of a rows x cols matrix without being replicated
+ * \param  *root - expression tree
+ * \param  *out_meta - output : type, number of dimensions and dimensions
+ * \return returns api_Success on success, api_Err_Param when the operands
+ *         do not broadcast
+ */
+/*****************************************************************************/
+api_Err_Status expr_result_meta( Expr_Node *root, Vector_MetaData *out_meta )
+{
+    api_Err_Status err = api_Success ;
+    uint32_t seen = 0 ;
+
+    if((root == NULL) || (out_meta == NULL)) {
+        debug("Invalid params root = %p, out_meta = %p", root, out_meta);
+        err = api_Err_Param ;
+        goto err_expr_result ;
+    }
+    memset( out_meta, 0, sizeof(*out_meta));
+
+    err = _expr_shape( root, out_meta, &seen );
+    if( err != api_Success )
+        goto err_expr_result ;
+    if( !seen ) {
+        debug("Expression has no operand arrays");
+        err = api_Err_Param ;
+    }
+
+err_expr_result :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Evaluate an expression into an output array in one fused pass
+ * \param  *root - expression tree
+ * \param  *out - output array, allocated with alloc_data() for out_meta
+ * \param  *out_meta - type and dimensions of the result. All operands must
+ *                     have the same type and broadcast to these dimensions
+ *                     (see expr_result_meta())
+ * \return returns api_Success on success.
+ * \note   The output may be one of the operands (in-place evaluation).
+ *         Results larger than the last level cache are written with
+ *         streaming stores unless "expr.stream" is 0, operands larger than
+ *         it are prefetched "expr.prefetch" blocks ahead
+ */
+/*****************************************************************************/
+api_Err_Status expr_evaluate( Expr_Node *root, void *out, Vector_MetaData *out_meta )
+{
+    api_Err_Status err = api_Success ;
+    Expr_Program *prog = NULL ;
+    Expr_Eval_Ctx ctx ;
+    Expr_Src res ;
+    Thread_Pool *pool = NULL ;
+    uint32_t no_threads = 0 , idx_i = 0 ;
+    uint64_t no_blocks = 0 , no_tasks = 0 , out_bytes = 0 ;
+    Perf_Sample ps ;
+
+    memset( &ctx, 0, sizeof(ctx));
+
+    if((root == NULL) || (out == NULL) || (out_meta == NULL)) {
+        debug("Invalid params root = %p, out = %p, out_meta = %p", root, out, out_meta);
+        err = api_Err_Param ;
+        goto err_expr_eval ;
+    }
+    if((out_meta->type >= DataType_MaxTypes) || (g_expr_block_fns[out_meta->type] == NULL)) {
+        debug("No expression kernel for data-type %d", out_meta->type);
+        err = api_Err_Param ;
+        goto err_expr_eval ;
+    }
+
+    prog = calloc( 1, sizeof(Expr_Program));
+    if( prog == NULL ) {
+        debug("Could not allocate expression program");
+        err = api_Err_Memory ;
+        goto err_expr_eval ;
+    }
+    prog->type = out_meta->type ;
+    prog->type_size = sizeof_datatype( out_meta->type );
+    prog->reg_size = ((prog->type == DataType_float16) || (prog->type == DataType_bfloat16)) ? sizeof(float) : prog->type_size ;
+    prog->items = data_items( out_meta );
+    prog->no_dims = out_meta->no_dims ;
+    prog->dim = out_meta->dim ;
+
+    /* compile tree into register program, result of the root goes to out */
+    err = _expr_compile( root, prog, &res );
+    if( err != api_Success ) {
+        debug("Could not compile expression. err = %d", err);
+        goto err_expr_eval_mem ;
+    }
+    if((res.kind == Expr_Src_Reg) && (prog->no_instr != 0)) {
+        prog->instr[prog->no_instr-1].dst.kind = Expr_Src_Out ;
+    } else {
+        err = _expr_emit( prog, EXPR_COPY, (Expr_Src){ Expr_Src_Out, 0 }, res, res );
+        if( err != api_Success )
+            goto err_expr_eval_mem ;
+    }
+
+    ctx.prog = prog ;
+    ctx.block_fn = g_expr_block_fns[prog->type] ;
+    ctx.out = data_payload( out, out_meta );
+
+    /* a result larger than the last level cache is evicted before it is
+       used again : write it with streaming stores and save the read for
+       ownership of every line. Not when it overwrites an operand, whose
+       lines the pass has just read. Tuning may only turn it off */
+    out_bytes = prog->items * prog->type_size ;
+    for( idx_i=0 ; (idx_i < prog->no_leaves) && (prog->leaf[idx_i] != ctx.out) ; idx_i++ )
+        ;
+    ctx.stream = (idx_i == prog->no_leaves) && (out_bytes > _expr_llc_bytes()) &&
+                 (tune_lookup( "expr.stream", out_bytes, 1 ) != 0) ;
+    /* prefetches only pay off for operands streamed from memory; the tuned
+       distance applies above that size */
+    ctx.prefetch = 0 ;
+    if(((prog->no_leaves - prog->no_bcast) * out_bytes) > _expr_llc_bytes())
+        ctx.prefetch = tune_lookup( "expr.prefetch", prog->items, EXPR_PREFETCH );
+    log_dbg("Expression over %llu items : streaming stores %s, prefetch %llu blocks ahead",
+            (unsigned long long)prog->items, ctx.stream ? "on" : "off", (unsigned long long)ctx.prefetch);
+
+    /* per-thread scratch : registers followed by splatted constants (and
+       widening blocks), the staging blocks of broadcast operands, then the
+       block a streamed result is staged in */
+    pool = tpool_default();
+    no_threads = tpool_size( pool );
+    ctx.scratch_stride = (uint64_t)(prog->no_regs + prog->no_consts) * EXPR_BLOCK * prog->reg_size ;
+    if( prog->reg_size != prog->type_size )
+        ctx.scratch_stride += (uint64_t)EXPR_HALF_TMP * EXPR_BLOCK * prog->reg_size ;
+    ctx.scratch_stride += (uint64_t)prog->no_bcast * EXPR_BLOCK * prog->type_size ;
+    ctx.scratch_stride = (ctx.scratch_stride + SIMD_ALIGN - 1) & ~((uint64_t)SIMD_ALIGN - 1) ;
+    if( ctx.stream ) {
+        ctx.stage_offset = ctx.scratch_stride ;
+        ctx.scratch_stride += ((uint64_t)EXPR_BLOCK * prog->type_size + SIMD_ALIGN - 1) & ~((uint64_t)SIMD_ALIGN - 1) ;
+    }
+    if( ctx.scratch_stride != 0 ) {
+        if( posix_memalign((void **)&ctx.scratch, SIMD_ALIGN, ctx.scratch_stride * no_threads) != 0 ) {
+            debug("Could not allocate %llu bytes of scratch", (unsigned long long)(ctx.scratch_stride * no_threads));
+            ctx.scratch = NULL ;
+            err = api_Err_Memory ;
+            goto err_expr_eval_mem ;
+        }
+        for( idx_i=0 ; idx_i < no_threads ; idx_i++ )
+            _expr_splat_consts( prog, ctx.scratch + (idx_i * ctx.scratch_stride));
+    }
+
+    no_blocks = (prog->items + EXPR_BLOCK - 1) / EXPR_BLOCK ;
+    ctx.task_blocks = tune_lookup( "expr.task_blocks", prog->items, EXPR_TASK_BLOCKS );
+    ctx.task_blocks = (ctx.task_blocks != 0) ? ctx.task_blocks : EXPR_TASK_BLOCKS ;
+    no_tasks = (no_blocks + ctx.task_blocks - 1) / ctx.task_blocks ;
+    perf_begin( &ps );
+    err = tpool_parallel_for( pool, no_tasks, _expr_task, &ctx );
+    perf_end( &ps, Perf_Expr, prog->items );
+    if( err != api_Success )
+        debug("Error evaluating expression. err = %d", err);
+    else if( prog->div_zero != 0 )
+        log_warn("%llu integer divisions by zero : those results are 0", (unsigned long long)prog->div_zero);
+
+err_expr_eval_mem :
+    ctx.scratch = (ctx.scratch != NULL) ? free(ctx.scratch), NULL : NULL ;
+    prog = (prog != NULL) ? free(prog), NULL : NULL ;
+err_expr_eval :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Evaluate one pool task (task_blocks blocks of the result)
+ * \param  *arg - Expr_Eval_Ctx
+ * \param  task - task index
+ * \param  thread_idx - index of executing thread, selects the scratch area
+ * \return void
+ */
+/*****************************************************************************/
+static void _expr_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Expr_Eval_Ctx *ctx = (Expr_Eval_Ctx *)arg ;
+    Expr_Program *prog = ctx->prog ;
+    uint64_t start = task * ctx->task_blocks * EXPR_BLOCK ;
+    uint64_t end = start + (ctx->task_blocks * EXPR_BLOCK) ;
+    uint64_t ahead = ctx->prefetch * EXPR_BLOCK ;
+    uint8_t *scratch = ctx->scratch + (thread_idx * ctx->scratch_stride) ;
+    uint8_t *dst = NULL ;
+    uint32_t n = 0 ;
+
+    if( end > prog->items )
+        end = prog->items ;
+
+    for( ; start < end ; start += EXPR_BLOCK ) {
+        n = ((end - start) > EXPR_BLOCK) ? EXPR_BLOCK : (uint32_t)(end - start) ;
+        if((ahead != 0) && (start + ahead < prog->items))
+            _expr_prefetch( prog, start + ahead,
+                            ((prog->items - start - ahead) > EXPR_BLOCK) ? EXPR_BLOCK : (uint32_t)(prog->items - start - ahead));
+        dst = (uint8_t *)ctx->out + (start * prog->type_size) ;
+        if( ctx->stream ) {
+            ctx->block_fn( prog, scratch + ctx->stage_offset, start, n, scratch );
+            _expr_stream_store( dst, scratch + ctx->stage_offset, (uint64_t)n * prog->type_size );
+        } else {
+            ctx->block_fn( prog, dst, start, n, scratch );
+        }
+    }
+#if defined(__x86_64__)
+    /* streaming stores are weakly ordered : drain them before the task ends */
+    if( ctx->stream )
+        _mm_sfence();
+#endif
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Prefetch the operands of a block that is evaluated later
+ * \param  *prog - compiled program
+ * \param  start - first element of the block
+ * \param  n - elements in the block
+ * \return void
+ */
+/*****************************************************************************/
+static void _expr_prefetch( Expr_Program *prog, uint64_t start, uint32_t n )
+{
+    const uint8_t *p = NULL ;
+    uint64_t bytes = (uint64_t)n * prog->type_size , off = 0 ;
+    uint32_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < prog->no_leaves ; idx_i++ ) {
+        if((prog->bcast_mask >> idx_i) & 1 )
+            continue ;                  /* gathered from cache */
+        p = (const uint8_t *)prog->leaf[idx_i] + (start * prog->type_size) ;
+        for( off=0 ; off < bytes ; off += EXPR_LINE )
+            __builtin_prefetch( p + off, 0, 3 );
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Plan how an operand is read for a result of the program's shape.
+ *         Axes of extent 1 in the result are dropped, and neighbouring axes
+ *         along which the operand is repeated, or contiguous, are merged
+ * \param  *prog - program being built : type and shape of the result
+ * \param  *meta - meta-data of the operand
+ * \param  *bc - output plan. no_axes = 0 : the operand has the layout of
+ *               the result and is read in place
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_bcast_plan( Expr_Program *prog, Vector_MetaData *meta, Expr_Bcast *bc )
+{
+    uint64_t ext[DATA_MAX_DIMS] , stride[DATA_MAX_DIMS] ;
+    uint64_t step = 1 , oe = 0 , le = 0 , s = 0 ;
+    uint32_t no_axes = 0 , repeat = 0 , idx_i = 0 ;
+    int32_t axis = 0 , lax = 0 ;
+
+    memset( bc, 0, sizeof(*bc));
+    if((meta->no_dims == 0) || (meta->no_dims > prog->no_dims) || (prog->no_dims > DATA_MAX_DIMS)) {
+        debug("Operand of %u dimensions does not broadcast to %u dimensions", meta->no_dims, prog->no_dims);
+        return api_Err_Param ;
+    }
+
+    /* innermost axis first : ext[0], stride[0] */
+    for( axis=(int32_t)prog->no_dims - 1 ; axis >= 0 ; axis-- ) {
+        oe = prog->dim.shape[axis] ;
+        lax = axis - (int32_t)(prog->no_dims - meta->no_dims) ;
+        le = (lax >= 0) ? meta->dim.shape[lax] : 1 ;
+        if((le != oe) && (le != 1)) {
+            debug("Operand extent %llu does not broadcast to %llu along axis %d",
+                        (unsigned long long)le, (unsigned long long)oe, axis);
+            return api_Err_Param ;
+        }
+        if( oe == 1 )
+            continue ;
+        s = (le == 1) ? 0 : step ;
+        step *= le ;
+        repeat |= (s == 0) ;
+        if((no_axes != 0) && (((s == 0) && (stride[no_axes-1] == 0)) ||
+                              ((s != 0) && (stride[no_axes-1] != 0) && (s == stride[no_axes-1] * ext[no_axes-1])))) {
+            ext[no_axes-1] *= oe ;
+            continue ;
+        }
+        ext[no_axes] = oe ;
+        stride[no_axes] = s ;
+        no_axes++ ;
+    }
+
+    if( !repeat )
+        return api_Success ;
+    bc->no_axes = no_axes ;
+    for( idx_i=0 ; idx_i < no_axes ; idx_i++ ) {
+        bc->ext[idx_i] = ext[no_axes - 1 - idx_i] ;
+        bc->stride[idx_i] = stride[no_axes - 1 - idx_i] ;
+    }
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Gather the elements of each broadcast operand that line up with a
+ *         block of the result into the operand's staging block. The operand
+ *         is read in runs along the innermost merged axis : copied when it
+ *         steps along it, a repeated value otherwise
+ * \param  *prog - compiled program
+ * \param  *stage - staging blocks of the executing thread
+ * \param  start - first element of the block
+ * \param  n - elements in the block
+ * \return void
+ */
+/*****************************************************************************/
+static void _expr_gather( Expr_Program *prog, void *stage, uint64_t start, uint32_t n )
+{
+    Expr_Bcast *bc = NULL ;
+    uint64_t sub[DATA_MAX_DIMS] ;
+    uint64_t rem = 0 , off = 0 , run = 0 , size = prog->type_size , idx_j = 0 ;
+    uint32_t leaf = 0 , left = 0 , last = 0 ;
+    int32_t axis = 0 ;
+    const uint8_t *src = NULL , *v = NULL ;
+    uint8_t *dst = NULL ;
+
+    for( leaf=0 ; leaf < prog->no_leaves ; leaf++ ) {
+        if( !((prog->bcast_mask >> leaf) & 1))
+            continue ;
+        bc = &prog->bcast[leaf] ;
+        src = (const uint8_t *)prog->leaf[leaf] ;
+        dst = (uint8_t *)stage + ((uint64_t)bc->slot * EXPR_BLOCK * size) ;
+        last = bc->no_axes - 1 ;
+
+        /* subscripts of the first element, and where it lies in the operand */
+        for( axis=(int32_t)last, rem=start, off=0 ; axis >= 0 ; axis-- ) {
+            sub[axis] = rem % bc->ext[axis] ;
+            rem /= bc->ext[axis] ;
+            off += sub[axis] * bc->stride[axis] ;
+        }
+
+        for( left=n ; left != 0 ; left -= (uint32_t)run ) {
+            run = bc->ext[last] - sub[last] ;
+            run = (run > left) ? left : run ;
+            if( bc->stride[last] != 0 ) {
+                memcpy( dst, src + (off * size), run * size );
+            } else {
+                v = src + (off * size) ;
+                switch( size )
+                {
+                    case 1 : memset( dst, *v, run ) ; break ;
+                    case 2 : for( idx_j=0 ; idx_j < run ; idx_j++ ) ((uint16_t *)dst)[idx_j] = *(const uint16_t *)v ; break ;
+                    case 4 : for( idx_j=0 ; idx_j < run ; idx_j++ ) ((uint32_t *)dst)[idx_j] = *(const uint32_t *)v ; break ;
+                    case 8 : for( idx_j=0 ; idx_j < run ; idx_j++ ) ((uint64_t *)dst)[idx_j] = *(const uint64_t *)v ; break ;
+                    default :
+                        for( idx_j=0 ; idx_j < run ; idx_j++ )
+                            memcpy( dst + (idx_j * size), v, size );
+                        break ;
+                }
+            }
+            dst += run * size ;
+
+            /* step the subscripts past the run, carrying outwards */
+            sub[last] += run ;
+            off += run * bc->stride[last] ;
+            if( sub[last] < bc->ext[last] )
+                continue ;
+            off -= bc->ext[last] * bc->stride[last] ;
+            sub[last] = 0 ;
+            for( axis=(int32_t)last - 1 ; axis >= 0 ; axis-- ) {
+                off += bc->stride[axis] ;
+                if( ++sub[axis] < bc->ext[axis] )
+                    break ;
+                off -= bc->ext[axis] * bc->stride[axis] ;
+                sub[axis] = 0 ;
+            }
+        }
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Copy a staged block to the result with non-temporal stores. The
+ *         unaligned head and tail are copied normally
+ * \param  *dst - result block
+ * \param  *src - staged block, SIMD_ALIGN aligned
+ * \param  bytes - size of the block
+ * \return void
+ */
+/*****************************************************************************/
+static void _expr_stream_store( uint8_t *dst, const uint8_t *src, uint64_t bytes )
+{
+#if defined(__x86_64__)
+    uint64_t head = (16 - ((uintptr_t)dst & 15)) & 15 ;
+
+    if( head > bytes )
+        head = bytes ;
+    memcpy( dst, src, head );
+    dst += head ;
+    src += head ;
+    bytes -= head ;
+    for( ; bytes >= 64 ; bytes -= 64, dst += 64, src += 64 ) {
+        _mm_stream_si128((__m128i *)(dst +  0), _mm_loadu_si128((const __m128i *)(src +  0)));
+        _mm_stream_si128((__m128i *)(dst + 16), _mm_loadu_si128((const __m128i *)(src + 16)));
+        _mm_stream_si128((__m128i *)(dst + 32), _mm_loadu_si128((const __m128i *)(src + 32)));
+        _mm_stream_si128((__m128i *)(dst + 48), _mm_loadu_si128((const __m128i *)(src + 48)));
+    }
+    for( ; bytes >= 16 ; bytes -= 16, dst += 16, src += 16 )
+        _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+#endif
+    memcpy( dst, src, bytes );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Size of the last level cache, streaming threshold of results
+ * \return bytes
+ */
+/*****************************************************************************/
+static uint64_t _expr_llc_bytes( void )
+{
+    static uint64_t llc = 0 ;
+    long bytes = 0 ;
+
+    if( __atomic_load_n( &llc, __ATOMIC_RELAXED ) == 0 ) {
+        bytes = sysconf( _SC_LEVEL3_CACHE_SIZE );
+        if( bytes <= 0 )
+            bytes = sysconf( _SC_LEVEL2_CACHE_SIZE );
+        __atomic_store_n( &llc, (bytes > 0) ? (uint64_t)bytes : EXPR_LLC_DEFAULT, __ATOMIC_RELAXED );
+    }
+    return __atomic_load_n( &llc, __ATOMIC_RELAXED );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Float view of an operand of a 16-bit float program. Registers and
+ *         constants are used in place, arrays (or their staging block when
+ *         broadcast) are widened into *tmp
+ * \return pointer to n floats
+ */
+/*****************************************************************************/
+static float *_expr_half_src( Expr_Program *prog, Expr_Src src, void *out, uint64_t start, uint32_t n,
+                              float *regs, float *consts, float *tmp, uint16_t *stage, Expr_Widen_Fn widen )
+{
+    switch( src.kind )
+    {
+        case Expr_Src_Reg :
+            return regs + ((uint64_t)src.idx * EXPR_BLOCK) ;
+        case Expr_Src_Const :
+            return consts + ((uint64_t)src.idx * EXPR_BLOCK) ;
+        case Expr_Src_Leaf :
+            widen( tmp, _EXPR_LEAF_PTR( uint16_t, prog, src.idx, start, stage ), n );
+            return tmp ;
+        default :
+            widen( tmp, (const uint16_t *)out, n );
+            return tmp ;
+    }
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Fill the constant area of a thread's scratch with block-sized
+ *         copies of each constant, converted to the result type
+ * \param  *prog - compiled program
+ * \param  *scratch - scratch area of one thread
+ * \return void
+ */
+/*****************************************************************************/
+static void _expr_splat_consts( Expr_Program *prog, void *scratch )
+{
+    uint8_t *area = (uint8_t *)scratch + ((uint64_t)prog->no_regs * EXPR_BLOCK * prog->reg_size) ;
+    uint32_t idx_i = 0 , idx_j = 0 ;
+    double v = 0.0 ;
+
+    for( idx_i=0 ; idx_i < prog->no_consts ; idx_i++ ) {
+        v = prog->consts[idx_i] ;
+        for( idx_j=0 ; idx_j < EXPR_BLOCK ; idx_j++, area += prog->reg_size ) {
+            switch( prog->type )
+            {
+                case DataType_uint8       : *(uint8_t *)area     = (uint8_t)(int64_t)v  ; break ;
+                case DataType_uint16      : *(uint16_t *)area    = (uint16_t)(int64_t)v ; break ;
+                case DataType_uint32      : *(uint32_t *)area    = (uint32_t)(int64_t)v ; break ;
+                case DataType_uint64      : *(uint64_t *)area    = (v < 0) ? (uint64_t)(int64_t)v : (uint64_t)v ; break ;
+                case DataType_int8        : *(int8_t *)area      = (int8_t)(int64_t)v   ; break ;
+                case DataType_int16       : *(int16_t *)area     = (int16_t)(int64_t)v  ; break ;
+                case DataType_int32       : *(int32_t *)area     = (int32_t)(int64_t)v  ; break ;
+                case DataType_int64       : *(int64_t *)area     = (int64_t)v           ; break ;
+                case DataType_float       : *(float *)area       = (float)v             ; break ;
+                case DataType_double      : *(double *)area      = v                    ; break ;
+                case DataType_long_double : *(long double *)area = (long double)v       ; break ;
+                case DataType_float16     : /* intentional fall-through : registers are float */
+                case DataType_bfloat16    : *(float *)area       = (float)v             ; break ;
+                default : break ;
+            }
+        }
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Broadcast the shapes of the operands of a sub-tree into *meta
+ * \param  *node - sub-tree
+ * \param  *meta - shape so far, type of the first operand
+ * \param  *seen - set once an operand was seen
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_shape( Expr_Node *node, Vector_MetaData *meta, uint32_t *seen )
+{
+    api_Err_Status err = api_Success ;
+    Vector_MetaData *m = NULL ;
+    uint64_t shape[DATA_MAX_DIMS] ;
+    uint64_t e1 = 0 , e2 = 0 ;
+    uint32_t no_dims = 0 , axis = 0 ;
+
+    if( node == NULL )
+        return api_Success ;
+    if( node->op != Expr_Leaf ) {
+        err = _expr_shape( node->lhs, meta, seen );
+        return (err == api_Success) ? _expr_shape( node->rhs, meta, seen ) : err ;
+    }
+
+    m = node->meta ;
+    if((m == NULL) || (m->no_dims == 0) || (m->no_dims > DATA_MAX_DIMS)) {
+        debug("Operand has invalid meta-data");
+        return api_Err_Param ;
+    }
+    if( !*seen ) {
+        *seen = 1 ;
+        meta->type = m->type ;
+        meta->no_dims = m->no_dims ;
+        meta->dim = m->dim ;
+        return api_Success ;
+    }
+    if( m->type != meta->type ) {
+        debug("Operand type %d does not match type %d", m->type, meta->type);
+        return api_Err_Param ;
+    }
+
+    /* aligned at the innermost axis */
+    no_dims = (m->no_dims > meta->no_dims) ? m->no_dims : meta->no_dims ;
+    for( axis=0 ; axis < no_dims ; axis++ ) {
+        e1 = (axis < meta->no_dims) ? meta->dim.shape[meta->no_dims - 1 - axis] : 1 ;
+        e2 = (axis < m->no_dims) ? m->dim.shape[m->no_dims - 1 - axis] : 1 ;
+        if((e1 != e2) && (e1 != 1) && (e2 != 1)) {
+            debug("Extents %llu and %llu do not broadcast", (unsigned long long)e1, (unsigned long long)e2);
+            return api_Err_Param ;
+        }
+        shape[no_dims - 1 - axis] = (e1 == 1) ? e2 : e1 ;
+    }
+    meta->no_dims = no_dims ;
+    memcpy( meta->dim.shape, shape, no_dims * sizeof(uint64_t));
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Compile a sub-tree into the program. Constant sub-trees are folded
+ * \param  *node - sub-tree
+ * \param  *prog - program being built
+ * \param  *res - output : where the value of the sub-tree lives
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_compile( Expr_Node *node, Expr_Program *prog, Expr_Src *res )
+{
+    api_Err_Status err = api_Success ;
+    Expr_Src lhs , rhs , dst ;
+    void *payload = NULL ;
+    double value = 0.0 ;
+    uint32_t idx_i = 0 ;
+
+    if( node == NULL ) {
+        debug("Incomplete expression tree");
+        err = api_Err_Param ;
+        goto err_expr_compile ;
+    }
+
+    switch( node->op )
+    {
+        case Expr_Leaf :
+            if((node->meta == NULL) || (node->meta->type != prog->type)) {
+                debug("Operand type %d does not match result type %d",
+                                      node->meta ? (int)node->meta->type : -1, prog->type);
+                err = api_Err_Param ;
+                goto err_expr_compile ;
+            }
+            payload = data_payload( node->data, node->meta );
+            for( idx_i=0 ; (idx_i < prog->no_leaves) && (prog->leaf[idx_i] != payload) ; idx_i++ )
+                ;
+            if( idx_i == prog->no_leaves ) {
+                if( prog->no_leaves == EXPR_MAX_LEAVES ) {
+                    debug("Expression has more than %u operands", EXPR_MAX_LEAVES);
+                    err = api_Err_Param ;
+                    goto err_expr_compile ;
+                }
+                err = _expr_bcast_plan( prog, node->meta, &prog->bcast[idx_i] );
+                if( err != api_Success )
+                    goto err_expr_compile ;
+                if( prog->bcast[idx_i].no_axes != 0 ) {
+                    prog->bcast[idx_i].slot = prog->no_bcast++ ;
+                    prog->bcast_mask |= (1ULL << idx_i) ;
+                }
+                prog->leaf[prog->no_leaves++] = payload ;
+            }
+            res->kind = Expr_Src_Leaf ;
+            res->idx = idx_i ;
+            break ;
+
+        case Expr_Const :
+            err = _expr_add_const( prog, node->value, res );
+            break ;
+
+        case Expr_Neg :
+            err = _expr_compile( node->lhs, prog, &lhs );
+            if( err != api_Success )
+                goto err_expr_compile ;
+
+            if( lhs.kind == Expr_Src_Const ) {
+                err = _expr_add_const( prog, -prog->consts[lhs.idx], res );
+                break ;
+            }
+            dst = lhs ;
+            if( lhs.kind != Expr_Src_Reg ) {
+                err = _expr_alloc_reg( prog, &dst );
+                if( err != api_Success )
+                    goto err_expr_compile ;
+            }
+            err = _expr_emit( prog, Expr_Neg, dst, lhs, lhs );
+            if( err != api_Success )
+                goto err_expr_compile ;
+            *res = dst ;
+            break ;
+
+        case Expr_Add :
+        case Expr_Sub :
+        case Expr_Mul :
+        case Expr_Div :
+            err = _expr_compile( node->lhs, prog, &lhs );
+            if( err != api_Success )
+                goto err_expr_compile ;
+            err = _expr_compile( node->rhs, prog, &rhs );
+            if( err != api_Success )
+                goto err_expr_compile ;
+
+            if((lhs.kind == Expr_Src_Const) && (rhs.kind == Expr_Src_Const)) {
+                value = prog->consts[lhs.idx] ;
+                switch( node->op )
+                {
+                    case Expr_Add : value += prog->consts[rhs.idx] ; break ;
+                    case Expr_Sub : value -= prog->consts[rhs.idx] ; break ;
+                    case Expr_Mul : value *= prog->consts[rhs.idx] ; break ;
+                    default       : value /= prog->consts[rhs.idx] ; break ;
+                }
+                err = _expr_add_const( prog, value, res );
+                break ;
+            }
+
+            /* re-use a register operand for the result, release the other */
+            if( lhs.kind == Expr_Src_Reg ) {
+                dst = lhs ;
+                if( rhs.kind == Expr_Src_Reg )
+                    prog->reg_busy &= ~(1u << rhs.idx) ;
+            } else if( rhs.kind == Expr_Src_Reg ) {
+                dst = rhs ;
+            } else {
+                err = _expr_alloc_reg( prog, &dst );
+                if( err != api_Success )
+                    goto err_expr_compile ;
+            }
+            err = _expr_emit( prog, node->op, dst, lhs, rhs );
+            if( err != api_Success )
+                goto err_expr_compile ;
+            *res = dst ;
+            break ;
+
+        default :
+            debug("Unknown expression operation %d", node->op);
+            err = api_Err_Param ;
+            goto err_expr_compile ;
+    }
+
+err_expr_compile :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Reserve a free scratch register
+ * \param  *prog - program being built
+ * \param  *reg - output register
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_alloc_reg( Expr_Program *prog, Expr_Src *reg )
+{
+    uint32_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < EXPR_MAX_REGS ; idx_i++ ) {
+        if((prog->reg_busy & (1u << idx_i)) == 0 ) {
+            prog->reg_busy |= (1u << idx_i) ;
+            if( idx_i >= prog->no_regs )
+                prog->no_regs = idx_i + 1 ;
+            reg->kind = Expr_Src_Reg ;
+            reg->idx = idx_i ;
+            return api_Success ;
+        }
+    }
+    debug("Expression nests too deeply. Only %u registers available", EXPR_MAX_REGS);
+    return api_Err_Param ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Find or add a constant in the constant table
+ * \param  *prog - program being built
+ * \param  value - constant value
+ * \param  *res - output : constant operand
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_add_const( Expr_Program *prog, double value, Expr_Src *res )
+{
+    uint32_t idx_i = 0 ;
+
+    for( idx_i=0 ; (idx_i < prog->no_consts) && (prog->consts[idx_i] != value) ; idx_i++ )
+        ;
+    if( idx_i == prog->no_consts ) {
+        if( prog->no_consts == EXPR_MAX_CONSTS ) {
+            debug("Expression has more than %u constants", EXPR_MAX_CONSTS);
+            return api_Err_Param ;
+        }
+        prog->consts[prog->no_consts++] = value ;
+    }
+    res->kind = Expr_Src_Const ;
+    res->idx = idx_i ;
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Append an instruction to the program
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _expr_emit( Expr_Program *prog, uint32_t op, Expr_Src dst, Expr_Src src1, Expr_Src src2 )
+{
+    if( prog->no_instr == EXPR_MAX_INSTR ) {
+        debug("Expression has more than %u operations", EXPR_MAX_INSTR);
+        return api_Err_Param ;
+    }
+    prog->instr[prog->no_instr].op = op ;
+    prog->instr[prog->no_instr].dst = dst ;
+    prog->instr[prog->no_instr].src1 = src1 ;
+    prog->instr[prog->no_instr].src2 = src2 ;
+    prog->no_instr++ ;
+    return api_Success ;
+}
+
+
+
+/*!
+ * Recursive descent parser for expression strings
+ *    sum     := product (('+'|'-') product)*
+ *    product := unary (('*'|'/') unary)*
+ *    unary   := '-' unary | primary
+ *    primary := operand | number | '(' sum ')'
+ */
+static api_Err_Status _expr_parse_sum( Expr_Node **node, char **pos, void **buffs, Vector_MetaData *metas, uint32_t no_operands )
+{
+    api_Err_Status err = api_Success ;
+    Expr_Node *rhs = NULL , *lhs = NULL ;
+    Expr_Op op ;
+
+    err = _expr_parse_product( &lhs, pos, buffs, metas, no_operands );
+    if( err != api_Success )
+        goto err_parse_sum ;
+
+    for( ;; ) {
+        while( isspace((unsigned char)**pos))
+            (*pos)++ ;
+        if((**pos != '+') && (**pos != '-'))
+            break ;
+        op = (**pos == '+') ? Expr_Add : Expr_Sub ;
+        (*pos)++ ;
+
+        err = _expr_parse_product( &rhs, pos, buffs, metas, no_operands );
+        if( err != api_Success )
+            goto err_parse_sum ;
+        err = expr_binary( node, op, lhs, rhs );
+        if( err != api_Success )
+            goto err_parse_sum ;
+        lhs = *node ;
+        rhs = NULL ;
+    }
+    *node = lhs ;
+    return err ;
+
+err_parse_sum :
+    expr_free( &lhs );
+    expr_free( &rhs );
+    *node = NULL ;
+    return err ;
+}
+
+static api_Err_Status _expr_parse_product( Expr_Node **node, char **pos, void **buffs, Vector_MetaData *metas, uint32_t no_operands )
+{
+    api_Err_Status err = api_Success ;
+    Expr_Node *rhs = NULL , *lhs = NULL ;
+    Expr_Op op ;
+
+    err = _expr_parse_unary( &lhs, pos, buffs, metas, no_operands );
+    if( err != api_Success )
+        goto err_parse_product ;
+
+    for( ;; ) {
+        while( isspace((unsigned char)**pos))
+            (*pos)++ ;
+        if((**pos != '*') && (**pos != '/'))
+            break ;
+        op = (**pos == '*') ? Expr_Mul : Expr_Div ;
+        (*pos)++ ;
+
+        err = _expr_parse_unary( &rhs, pos, buffs, metas, no_operands );
+        if( err != api_Success )
+            goto err_parse_product ;
+        err = expr_binary( node, op, lhs, rhs );
+        if( err != api_Success )
+            goto err_parse_product ;
+        lhs = *node ;
+        rhs = NULL ;
+    }
+    *node = lhs ;
+    return err ;
+
+err_parse_product :
+    expr_free( &lhs );
+    expr_free( &rhs );
+    *node = NULL ;
+    return err ;
+}
+
+static api_Err_Status _expr_parse_unary( Expr_Node **node, char **pos, void **buffs, Vector_MetaData *metas, uint32_t no_operands )
+{
+    api_Err_Status err = api_Success ;
+    Expr_Node *operand = NULL ;
+
+    while( isspace((unsigned char)**pos))
+        (*pos)++ ;
+    if( **pos != '-' )
+        return _expr_parse_primary( node, pos, buffs, metas, no_operands );
+
+    (*pos)++ ;
+    err = _expr_parse_unary( &operand, pos, buffs, metas, no_operands );
+    if( err != api_Success )
+        goto err_parse_unary ;
+    err = expr_unary( node, Expr_Neg, operand );
+    if( err != api_Success )
+        goto err_parse_unary ;
+    return err ;
+
+err_parse_unary :
+    expr_free( &operand );
+    *node = NULL ;
+    return err ;
+}
+
+static api_Err_Status _expr_parse_primary( Expr_Node **node, char **pos, void **buffs, Vector_MetaData *metas, uint32_t no_operands )
+{
+    api_Err_Status err = api_Success ;
+    char *end = NULL ;
+    double value = 0.0 ;
+    uint32_t operand = 0 ;
+
+    while( isspace((unsigned char)**pos))
+        (*pos)++ ;
+
+    if( **pos == '(' ) {
+        (*pos)++ ;
+        err = _expr_parse_sum( node, pos, buffs, metas, no_operands );
+        if( err != api_Success )
+            goto err_parse_primary ;
+        while( isspace((unsigned char)**pos))
+            (*pos)++ ;
+        if( **pos != ')' ) {
+            debug("Missing ')' in expression at [%s]", *pos);
+            expr_free( node );
+            err = api_Err_Param ;
+            goto err_parse_primary ;
+        }
+        (*pos)++ ;
+    } else if((**pos >= 'a') && (**pos <= 'z')) {
+        operand = (uint32_t)(**pos - 'a') ;
+        if((operand >= no_operands) || (buffs == NULL) || (metas == NULL)) {
+            debug("Operand '%c' used but only %u input arrays provided", **pos, no_operands);
+            err = api_Err_Param ;
+            goto err_parse_primary ;
+        }
+        (*pos)++ ;
+        err = expr_leaf( node, buffs[operand], &metas[operand] );
+    } else {
+        value = strtod( *pos, &end );
+        if( end == *pos ) {
+            debug("Expected operand, number or '(' in expression at [%s]", *pos);
+            err = api_Err_Param ;
+            goto err_parse_primary ;
+        }
+        *pos = end ;
+        err = expr_const( node, value );
+    }
+
+err_parse_primary :
+    return err ;
+}
@@ -0,0 +1,820 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include <time.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "tune_db.h"
+#include "gemm.h"
+
+
+/*!
+ * Register blocking : the micro-kernel keeps an MR x NR tile of C in
+ * registers (6 x 16 floats / 6 x 8 doubles / 6 x 16 int32 = 12 AVX2
+ * accumulators)
+ */
+#define GEMM_MR            6
+#define GEMM_NR_FLOAT      16
+#define GEMM_NR_DOUBLE     8
+#define GEMM_NR_INT        16
+
+#define GEMM_DEFAULT_MC    96
+#define GEMM_DEFAULT_KC    256
+#define GEMM_DEFAULT_NC    3072
+
+
+/* C[MR x NR] (+)= packed A panel x packed B panel, first != 0 overwrites */
+typedef void (*Gemm_Ukr_Fn)( uint64_t, const void *, const void *, void *, uint64_t, uint32_t );
+/* pack a rows x cols block of a row-major matrix with leading dimension ld */
+typedef void (*Gemm_Pack_Fn)( void *, const void *, uint64_t, uint64_t, uint64_t );
+/* C[rows x cols] (+)= tile[rows x NR] for partial tiles at the matrix edge */
+typedef void (*Gemm_Edge_Fn)( void *, uint64_t, const void *, uint64_t, uint64_t, uint64_t, uint32_t );
+
+
+/*!
+ * Data-type specific parts of the algorithm
+ */
+typedef struct __Gemm_Type_Ops__
+{
+    uint32_t in_size ;           /* element size of A and B */
+    uint32_t pack_size ;         /* element size of packed panels */
+    uint32_t c_size ;            /* element size of C */
+    uint32_t nr ;
+    uint32_t kstep ;             /* k values interleaved in packed panels */
+    Gemm_Pack_Fn pack_a ;        /* into MR-row panels */
+    Gemm_Pack_Fn pack_b ;        /* one NR-column panel */
+    Gemm_Ukr_Fn ukr ;
+    Gemm_Edge_Fn edge ;
+} Gemm_Type_Ops ;
+
+
+/*!
+ * State shared by the tasks working on one kc x nc block of B
+ */
+typedef struct __Gemm_Ctx__
+{
+    Gemm_Type_Ops ops ;
+    uint8_t *a , *b , *c ;
+    uint64_t m , n , k ;
+    uint64_t mc ;
+    uint64_t jc , pc , nb , kb ;      /* current block of B */
+    uint64_t kp ;                     /* kb rounded up to ops.kstep */
+    uint32_t first ;                  /* first kc block : overwrite C */
+    uint8_t *bpack ;
+    uint8_t *apack ;                  /* per-thread packed block of A */
+    uint64_t apack_stride ;
+} Gemm_Ctx ;
+
+
+static api_Err_Status _gemm_check( Vector_MetaData *, Vector_MetaData *, Vector_MetaData * );
+static api_Err_Status _gemm_type_ops( Data_Type, Gemm_Type_Ops * );
+static void _gemm_pack_b_task( void *, uint64_t, uint32_t );
+static void _gemm_block_task( void *, uint64_t, uint32_t );
+
+
+
+/*!
+ * Packing. A is packed into panels of MR rows stored k-major (MR values
+ * per k), B into panels of NR columns stored k-major (NR values per k),
+ * so the micro-kernel streams both with unit stride. Partial panels are
+ * padded with zeros.
+ */
+#define GEMM_PACK_A( TI, TP, SUFFIX )                                                    \
+static void _gemm_pack_a_##SUFFIX( void *dst, const void *src, uint64_t ld,              \
+                                   uint64_t rows, uint64_t cols )                        \
+{                                                                                        \
+    TP *d = (TP *)dst ;                                                                  \
+    const TI *s = (const TI *)src ;                                                      \
+    uint64_t p , k , i ;                                                                 \
+                                                                                         \
+    for( p=0 ; p < rows ; p += GEMM_MR ) {                                               \
+        for( k=0 ; k < cols ; k++ ) {                                                    \
+            for( i=0 ; i < GEMM_MR ; i++ )                                               \
+                *d++ = ((p + i) < rows) ? (TP)s[((p + i) * ld) + k] : (TP)0 ;            \
+        }                                                                                \
+    }                                                                                    \
+    return ;                                                                             \
+}
+
+#define GEMM_PACK_B( TI, TP, NR, SUFFIX )                                                \
+static void _gemm_pack_b_##SUFFIX( void *dst, const void *src, uint64_t ld,              \
+                                   uint64_t rows, uint64_t cols )                        \
+{                                                                                        \
+    TP *d = (TP *)dst ;                                                                  \
+    const TI *s = (const TI *)src ;                                                      \
+    uint64_t k , j ;                                                                     \
+                                                                                         \
+    if( cols == NR ) {                                                                   \
+        for( k=0 ; k < rows ; k++, d += NR )                                             \
+            for( j=0 ; j < NR ; j++ )                                                    \
+                d[j] = (TP)s[(k * ld) + j] ;                                             \
+        return ;                                                                         \
+    }                                                                                    \
+    for( k=0 ; k < rows ; k++, d += NR )                                                 \
+        for( j=0 ; j < NR ; j++ )                                                        \
+            d[j] = (j < cols) ? (TP)s[(k * ld) + j] : (TP)0 ;                            \
+    return ;                                                                             \
+}
+
+/*!
+ * Portable micro-kernel, vectorised by the compiler along NR
+ */
+#define GEMM_UKR( TP, TC, NR, SUFFIX )                                                   \
+SIMD_KERNEL                                                                              \
+static void _gemm_ukr_##SUFFIX( uint64_t kc, const void *pa, const void *pb,             \
+                                void *pc, uint64_t ldc, uint32_t first )                 \
+{                                                                                        \
+    const TP *a = (const TP *)pa , *b = (const TP *)pb ;                                 \
+    TC *c = (TC *)pc ;                                                                   \
+    TC acc[GEMM_MR][NR] ;                                                                \
+    TC ai ;                                                                              \
+    uint64_t k , i , j ;                                                                 \
+                                                                                         \
+    memset( acc, 0, sizeof(acc));                                                        \
+    for( k=0 ; k < kc ; k++, a += GEMM_MR, b += NR ) {                                   \
+        for( i=0 ; i < GEMM_MR ; i++ ) {                                                 \
+            ai = (TC)a[i] ;                                                              \
+            for( j=0 ; j < NR ; j++ )                                                    \
+                acc[i][j] += ai * (TC)b[j] ;                                             \
+        }                                                                                \
+    }                                                                                    \
+    for( i=0 ; i < GEMM_MR ; i++ )                                                       \
+        for( j=0 ; j < NR ; j++ )                                                        \
+            c[(i * ldc) + j] = first ? acc[i][j] : c[(i * ldc) + j] + acc[i][j] ;        \
+    return ;                                                                             \
+}
+
+#define GEMM_EDGE( TC, SUFFIX )                                                          \
+static void _gemm_edge_##SUFFIX( void *pc, uint64_t ldc, const void *ptile, uint64_t nr, \
+                                 uint64_t rows, uint64_t cols, uint32_t first )          \
+{                                                                                        \
+    TC *c = (TC *)pc ;                                                                   \
+    const TC *t = (const TC *)ptile ;                                                    \
+    uint64_t i , j ;                                                                     \
+                                                                                         \
+    for( i=0 ; i < rows ; i++ )                                                          \
+        for( j=0 ; j < cols ; j++ )                                                      \
+            c[(i * ldc) + j] = first ? t[(i * nr) + j] : c[(i * ldc) + j] + t[(i * nr) + j] ; \
+    return ;                                                                             \
+}
+
+/*!
+ * Integer panels hold k in pairs for pmaddwd, which multiplies adjacent
+ * int16 values and adds each pair into one int32 : an A panel stores
+ * a[i][k], a[i][k+1] for its MR rows, a B panel b[k][j], b[k+1][j] for its
+ * NR columns. An odd k is padded with a zero row.
+ */
+#define GEMM_PACK_A_PAIRS( TI, SUFFIX )                                                  \
+static void _gemm_pack_a_##SUFFIX( void *dst, const void *src, uint64_t ld,              \
+                                   uint64_t rows, uint64_t cols )                        \
+{                                                                                        \
+    int16_t *d = (int16_t *)dst ;                                                        \
+    const TI *s = (const TI *)src ;                                                      \
+    uint64_t p , k , i ;                                                                 \
+                                                                                         \
+    for( p=0 ; p < rows ; p += GEMM_MR ) {                                               \
+        for( k=0 ; k < cols ; k += 2 ) {                                                 \
+            for( i=0 ; i < GEMM_MR ; i++, d += 2 ) {                                     \
+                d[0] = ((p + i) < rows) ? (int16_t)s[((p + i) * ld) + k] : 0 ;           \
+                d[1] = (((p + i) < rows) && ((k + 1) < cols)) ?                          \
+                                  (int16_t)s[((p + i) * ld) + k + 1] : 0 ;               \
+            }                                                                            \
+        }                                                                                \
+    }                                                                                    \
+    return ;                                                                             \
+}
+
+#define GEMM_PACK_B_PAIRS( TI, NR, SUFFIX )                                              \
+static void _gemm_pack_b_##SUFFIX( void *dst, const void *src, uint64_t ld,              \
+                                   uint64_t rows, uint64_t cols )                        \
+{                                                                                        \
+    int16_t *d = (int16_t *)dst ;                                                        \
+    const TI *s = (const TI *)src ;                                                      \
+    uint64_t k , j ;                                                                     \
+                                                                                         \
+    for( k=0 ; k < rows ; k += 2, d += 2 * NR ) {                                        \
+        for( j=0 ; j < NR ; j++ ) {                                                      \
+            d[2 * j] = (j < cols) ? (int16_t)s[(k * ld) + j] : 0 ;                       \
+            d[(2 * j) + 1] = ((j < cols) && ((k + 1) < rows)) ? (int16_t)s[((k + 1) * ld) + j] : 0 ; \
+        }                                                                                \
+    }                                                                                    \
+    return ;                                                                             \
+}
+
+/*!
+ * Portable integer micro-kernel over k pairs. Sums are carried in uint32_t
+ * so that an int32 result which overflows wraps, as pmaddwd / paddd do,
+ * instead of being undefined
+ */
+SIMD_KERNEL
+static void _gemm_ukr_int16( uint64_t kc, const void *pa, const void *pb,
+                             void *pc, uint64_t ldc, uint32_t first )
+{
+    const int16_t *a = (const int16_t *)pa , *b = (const int16_t *)pb ;
+    int32_t *c = (int32_t *)pc ;
+    uint32_t acc[GEMM_MR][GEMM_NR_INT] ;
+    uint32_t a0 , a1 ;
+    uint64_t k , i , j ;
+
+    memset( acc, 0, sizeof(acc));
+    for( k=0 ; k < kc ; k += 2, a += 2 * GEMM_MR, b += 2 * GEMM_NR_INT ) {
+        for( i=0 ; i < GEMM_MR ; i++ ) {
+            a0 = (uint32_t)(int32_t)a[2 * i] ;
+            a1 = (uint32_t)(int32_t)a[(2 * i) + 1] ;
+            for( j=0 ; j < GEMM_NR_INT ; j++ )
+                acc[i][j] += (a0 * (uint32_t)(int32_t)b[2 * j]) + (a1 * (uint32_t)(int32_t)b[(2 * j) + 1]) ;
+        }
+    }
+    for( i=0 ; i < GEMM_MR ; i++ )
+        for( j=0 ; j < GEMM_NR_INT ; j++ )
+            c[(i * ldc) + j] = (int32_t)(first ? acc[i][j] : (uint32_t)c[(i * ldc) + j] + acc[i][j]) ;
+    return ;
+}
+
+GEMM_PACK_A( float  , float  , float  )
+GEMM_PACK_A( double , double , double )
+GEMM_PACK_A_PAIRS( int8_t , int8  )
+GEMM_PACK_A_PAIRS( int16_t, int16 )
+
+GEMM_PACK_B( float  , float  , GEMM_NR_FLOAT , float  )
+GEMM_PACK_B( double , double , GEMM_NR_DOUBLE, double )
+GEMM_PACK_B_PAIRS( int8_t , GEMM_NR_INT, int8  )
+GEMM_PACK_B_PAIRS( int16_t, GEMM_NR_INT, int16 )
+
+GEMM_UKR( float  , float  , GEMM_NR_FLOAT , float  )
+GEMM_UKR( double , double , GEMM_NR_DOUBLE, double )
+
+GEMM_EDGE( float  , float  )
+GEMM_EDGE( double , double )
+GEMM_EDGE( uint32_t, int32 )
+
+
+
+#if defined(__x86_64__)
+/*****************************************************************************/
+/*!
+ * \brief  AVX2/FMA micro-kernel : 6 x 16 tile of C in 12 ymm accumulators,
+ *         one broadcast of A and two loads of B per k and row
+ */
+/*****************************************************************************/
+__attribute__((target("avx2,fma")))
+static void _gemm_ukr_float_avx2( uint64_t kc, const void *pa, const void *pb,
+                                  void *pc, uint64_t ldc, uint32_t first )
+{
+    const float *a = (const float *)pa , *b = (const float *)pb ;
+    float *c = (float *)pc ;
+    __m256 acc[GEMM_MR][2] , b0 , b1 , ai ;
+    uint64_t k ;
+    uint32_t i ;
+
+    #pragma GCC unroll 6
+    for( i=0 ; i < GEMM_MR ; i++ ) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+
+    for( k=0 ; k < kc ; k++, a += GEMM_MR, b += GEMM_NR_FLOAT ) {
+        b0 = _mm256_load_ps( b );
+        b1 = _mm256_load_ps( b + 8 );
+        #pragma GCC unroll 6
+        for( i=0 ; i < GEMM_MR ; i++ ) {
+            ai = _mm256_broadcast_ss( a + i );
+            acc[i][0] = _mm256_fmadd_ps( ai, b0, acc[i][0] );
+            acc[i][1] = _mm256_fmadd_ps( ai, b1, acc[i][1] );
+        }
+    }
+
+    #pragma GCC unroll 6
+    for( i=0 ; i < GEMM_MR ; i++ ) {
+        if( !first ) {
+            acc[i][0] = _mm256_add_ps( acc[i][0], _mm256_loadu_ps( c + (i * ldc)));
+            acc[i][1] = _mm256_add_ps( acc[i][1], _mm256_loadu_ps( c + (i * ldc) + 8));
+        }
+        _mm256_storeu_ps( c + (i * ldc), acc[i][0] );
+        _mm256_storeu_ps( c + (i * ldc) + 8, acc[i][1] );
+    }
+    return ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  AVX2/FMA micro-kernel : 6 x 8 tile of C in 12 ymm accumulators
+ */
+/*****************************************************************************/
+__attribute__((target("avx2,fma")))
+static void _gemm_ukr_double_avx2( uint64_t kc, const void *pa, const void *pb,
+                                   void *pc, uint64_t ldc, uint32_t first )
+{
+    const double *a = (const double *)pa , *b = (const double *)pb ;
+    double *c = (double *)pc ;
+    __m256d acc[GEMM_MR][2] , b0 , b1 , ai ;
+    uint64_t k ;
+    uint32_t i ;
+
+    #pragma GCC unroll 6
+    for( i=0 ; i < GEMM_MR ; i++ ) {
+        acc[i][0] = _mm256_setzero_pd();
+        acc[i][1] = _mm256_setzero_pd();
+    }
+
+    for( k=0 ; k < kc ; k++, a += GEMM_MR, b += GEMM_NR_DOUBLE ) {
+        b0 = _mm256_load_pd( b );
+        b1 = _mm256_load_pd( b + 4 );
+        #pragma GCC unroll 6
+        for( i=0 ; i < GEMM_MR ; i++ ) {
+            ai = _mm256_broadcast_sd( a + i );
+            acc[i][0] = _mm256_fmadd_pd( ai, b0, acc[i][0] );
+            acc[i][1] = _mm256_fmadd_pd( ai, b1, acc[i][1] );
+        }
+    }
+
+    #pragma GCC unroll 6
+    for( i=0 ; i < GEMM_MR ; i++ ) {
+        if( !first ) {
+            acc[i][0] = _mm256_add_pd( acc[i][0], _mm256_loadu_pd( c + (i * ldc)));
+            acc[i][1] = _mm256_add_pd( acc[i][1], _mm256_loadu_pd( c + (i * ldc) + 4));
+        }
+        _mm256_storeu_pd( c + (i * ldc), acc[i][0] );
+        _mm256_storeu_pd( c + (i * ldc) + 4, acc[i][1] );
+    }
+    return ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  AVX2 integer micro-kernel : 6 x 16 int32 tile of C in 12 ymm
+ *         accumulators. Per k pair, one broadcast of A's pair and pmaddwd
+ *         against two loads of B's interleaved pairs
+ */
+/*****************************************************************************/
+__attribute__((target("avx2")))
+static void _gemm_ukr_int16_avx2( uint64_t kc, const void *pa, const void *pb,
+                                  void *pc, uint64_t ldc, uint32_t first )
+{
+    const int16_t *a = (const int16_t *)pa , *b = (const int16_t *)pb ;
+    int32_t *c = (int32_t *)pc ;
+    __m256i acc[GEMM_MR][2] , b0 , b1 , ai ;
+    uint64_t k ;
+    uint32_t i ;
+
+    #pragma GCC unroll 6
+    for( i=0 ; i < GEMM_MR ; i++ ) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+
+    for( k=0 ; k < kc ; k += 2, a += 2 * GEMM_MR, b += 2 * GEMM_NR_INT ) {
+        b0 = _mm256_load_si256((const __m256i *)b );
+        b1 = _mm256_load_si256((const __m256i *)(b + 16));
+        #pragma GCC unroll 6
+        for( i=0 ; i < GEMM_MR ; i++ ) {
+            ai = _mm256_set1_epi32( *(const int32_t *)(a + (2 * i)));
+            acc[i][0] = _mm256_add_epi32( acc[i][0], _mm256_madd_epi16( ai, b0 ));
+            acc[i][1] = _mm256_add_epi32( acc[i][1], _mm256_madd_epi16( ai, b1 ));
+        }
+    }
+
+    #pragma GCC unroll 6
+    for( i=0 ; i < GEMM_MR ; i++ ) {
+        if( !first ) {
+            acc[i][0] = _mm256_add_epi32( acc[i][0], _mm256_loadu_si256((const __m256i *)(c + (i * ldc))));
+            acc[i][1] = _mm256_add_epi32( acc[i][1], _mm256_loadu_si256((const __m256i *)(c + (i * ldc) + 8)));
+        }
+        _mm256_storeu_si256((__m256i *)(c + (i * ldc)), acc[i][0] );
+        _mm256_storeu_si256((__m256i *)(c + (i * ldc) + 8), acc[i][1] );
+    }
+    return ;
+}
+#endif
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Name of a tuning database knob of the multiply, e.g. "gemm.float.kc"
+ * \param  *knob - output name
+ * \param  len - size of knob
+ * \param  type - element type of A and B
+ * \param  *param - mc, kc or nc
+ * \return void
+ */
+/*****************************************************************************/
+void gemm_tune_knob( char *knob, size_t len, Data_Type type, const char *param )
+{
+    snprintf( knob, len, "gemm.%s.%s", datatype_name( type ), param );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Fill in the meta-data of C = A x B
+ * \param  *c_meta - output meta-data for the result
+ * \param  *a_meta - A : rows x cols
+ * \param  *b_meta - B : rows x cols, B rows == A cols
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status gemm_result_meta( Vector_MetaData *c_meta, Vector_MetaData *a_meta, Vector_MetaData *b_meta )
+{
+    api_Err_Status err = api_Success ;
+
+    if((c_meta == NULL) || (a_meta == NULL) || (b_meta == NULL)) {
+        debug("Invalid params c_meta = %p, a_meta = %p, b_meta = %p", c_meta, a_meta, b_meta);
+        err = api_Err_Param ;
+        goto err_gemm_meta ;
+    }
+
+    memset( c_meta, 0, sizeof(Vector_MetaData));
+    c_meta->no_dims = 2 ;
+    c_meta->dim.dim_2d.rows = a_meta->dim.dim_2d.rows ;
+    c_meta->dim.dim_2d.cols = b_meta->dim.dim_2d.cols ;
+    switch( a_meta->type )
+    {
+        case DataType_float  : c_meta->type = DataType_float ;  break ;
+        case DataType_double : c_meta->type = DataType_double ; break ;
+        case DataType_int8   :   /* intentional fall-through */
+        case DataType_int16  : c_meta->type = DataType_int32 ;  break ;
+        default :
+            debug("Matrix multiply supports float, double, int8 and int16 inputs");
+            err = api_Err_Param ;
+            goto err_gemm_meta ;
+    }
+    err = _gemm_check( c_meta, a_meta, b_meta );
+
+err_gemm_meta :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  C = A x B with packed panels, cache blocking and a register
+ *         blocked micro-kernel. Blocks of A are distributed over the pool
+ * \param  *c - result, allocated with alloc_data() for *c_meta
+ * \param  *c_meta - from gemm_result_meta()
+ * \param  *a - A matrix from read_data()
+ * \param  *a_meta - meta-data of A
+ * \param  *b - B matrix from read_data()
+ * \param  *b_meta - meta-data of B
+ * \param  *blocking - cache blocking. NULL or zero fields : defaults
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status gemm( void *c, Vector_MetaData *c_meta, void *a, Vector_MetaData *a_meta,
+                     void *b, Vector_MetaData *b_meta, Gemm_Blocking *blocking )
+{
+    api_Err_Status err = api_Success ;
+    Gemm_Ctx ctx ;
+    Thread_Pool *pool = NULL ;
+    uint64_t kc = GEMM_DEFAULT_KC , nc = GEMM_DEFAULT_NC , per_thread = 0 ;
+    uint32_t no_threads = 0 ;
+    char knob[TUNE_NAME_LEN] ;
+    Perf_Sample ps ;
+
+    memset( &ctx, 0, sizeof(ctx));
+
+    if((c == NULL) || (a == NULL) || (b == NULL)) {
+        debug("Invalid params c = %p, a = %p, b = %p", c, a, b);
+        err = api_Err_Param ;
+        goto err_gemm ;
+    }
+    err = _gemm_check( c_meta, a_meta, b_meta );
+    if( err != api_Success )
+        goto err_gemm ;
+    err = _gemm_type_ops( a_meta->type, &ctx.ops );
+    if( err != api_Success )
+        goto err_gemm ;
+
+    ctx.a = data_payload( a, a_meta );
+    ctx.b = data_payload( b, b_meta );
+    ctx.c = data_payload( c, c_meta );
+    ctx.m = a_meta->dim.dim_2d.rows ;
+    ctx.k = a_meta->dim.dim_2d.cols ;
+    ctx.n = b_meta->dim.dim_2d.cols ;
+    /* tuned blocking for this machine, overridden by the caller's */
+    gemm_tune_knob( knob, sizeof(knob), a_meta->type, "mc" );
+    ctx.mc = tune_lookup( knob, ctx.m * ctx.n * ctx.k, GEMM_DEFAULT_MC );
+    gemm_tune_knob( knob, sizeof(knob), a_meta->type, "kc" );
+    kc = tune_lookup( knob, ctx.m * ctx.n * ctx.k, GEMM_DEFAULT_KC );
+    gemm_tune_knob( knob, sizeof(knob), a_meta->type, "nc" );
+    nc = tune_lookup( knob, ctx.m * ctx.n * ctx.k, GEMM_DEFAULT_NC );
+
+    if( blocking != NULL ) {
+        ctx.mc = (blocking->mc != 0) ? blocking->mc : ctx.mc ;
+        kc = (blocking->kc != 0) ? blocking->kc : kc ;
+        nc = (blocking->nc != 0) ? blocking->nc : nc ;
+    }
+
+    /* empty product : C is all zeros */
+    if( ctx.k == 0 ) {
+        memset( ctx.c, 0, ctx.m * ctx.n * ctx.ops.c_size );
+        goto err_gemm ;
+    }
+    if((ctx.m == 0) || (ctx.n == 0))
+        goto err_gemm ;
+
+    pool = tpool_default();
+    no_threads = tpool_size( pool );
+
+    /* enough blocks of A to keep every thread busy */
+    ctx.mc = (ctx.mc + GEMM_MR - 1) / GEMM_MR * GEMM_MR ;
+    per_thread = (ctx.m + no_threads - 1) / no_threads ;
+    per_thread = (per_thread + GEMM_MR - 1) / GEMM_MR * GEMM_MR ;
+    if( per_thread < ctx.mc )
+        ctx.mc = per_thread ;
+    nc = (nc + ctx.ops.nr - 1) / ctx.ops.nr * ctx.ops.nr ;
+    kc = (kc < ctx.k) ? kc : ctx.k ;
+    nc = (nc < ctx.n) ? nc : (ctx.n + ctx.ops.nr - 1) / ctx.ops.nr * ctx.ops.nr ;
+
+    ctx.apack_stride = ctx.mc * ((kc + ctx.ops.kstep - 1) / ctx.ops.kstep * ctx.ops.kstep) * ctx.ops.pack_size ;
+    ctx.apack_stride = (ctx.apack_stride + SIMD_ALIGN - 1) & ~((uint64_t)SIMD_ALIGN - 1) ;
+    if((posix_memalign((void **)&ctx.bpack, SIMD_ALIGN, (kc + ctx.ops.kstep - 1) / ctx.ops.kstep * ctx.ops.kstep * nc * ctx.ops.pack_size) != 0) ||
+       (posix_memalign((void **)&ctx.apack, SIMD_ALIGN, ctx.apack_stride * no_threads) != 0)) {
+        debug("Could not allocate packing buffers");
+        err = api_Err_Memory ;
+        goto err_gemm_mem ;
+    }
+
+    /* one element per multiply-add */
+    perf_begin( &ps );
+    for( ctx.jc=0 ; ctx.jc < ctx.n ; ctx.jc += nc ) {
+        ctx.nb = ((ctx.n - ctx.jc) < nc) ? (ctx.n - ctx.jc) : nc ;
+        for( ctx.pc=0 ; ctx.pc < ctx.k ; ctx.pc += kc ) {
+            ctx.kb = ((ctx.k - ctx.pc) < kc) ? (ctx.k - ctx.pc) : kc ;
+            ctx.kp = (ctx.kb + ctx.ops.kstep - 1) / ctx.ops.kstep * ctx.ops.kstep ;
+            ctx.first = (ctx.pc == 0) ;
+
+            err = tpool_parallel_for( pool, (ctx.nb + ctx.ops.nr - 1) / ctx.ops.nr, _gemm_pack_b_task, &ctx );
+            if( err != api_Success )
+                goto err_gemm_mem ;
+            err = tpool_parallel_for( pool, (ctx.m + ctx.mc - 1) / ctx.mc, _gemm_block_task, &ctx );
+            if( err != api_Success )
+                goto err_gemm_mem ;
+        }
+    }
+    perf_end( &ps, Perf_Gemm, ctx.m * ctx.n * ctx.k );
+
+err_gemm_mem :
+    ctx.apack = (ctx.apack != NULL) ? free(ctx.apack), NULL : NULL ;
+    ctx.bpack = (ctx.bpack != NULL) ? free(ctx.bpack), NULL : NULL ;
+err_gemm :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Naive triple loop C = A x B used to verify gemm()
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status gemm_reference( void *c, Vector_MetaData *c_meta, void *a, Vector_MetaData *a_meta,
+                               void *b, Vector_MetaData *b_meta )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t m , n , k , i , j , p ;
+    void *pa , *pb , *pc ;
+
+    if((c == NULL) || (a == NULL) || (b == NULL)) {
+        debug("Invalid params c = %p, a = %p, b = %p", c, a, b);
+        err = api_Err_Param ;
+        goto err_gemm_ref ;
+    }
+    err = _gemm_check( c_meta, a_meta, b_meta );
+    if( err != api_Success )
+        goto err_gemm_ref ;
+
+    pa = data_payload( a, a_meta );
+    pb = data_payload( b, b_meta );
+    pc = data_payload( c, c_meta );
+    m = a_meta->dim.dim_2d.rows ;
+    k = a_meta->dim.dim_2d.cols ;
+    n = b_meta->dim.dim_2d.cols ;
+    memset( pc, 0, m * n * sizeof_datatype( c_meta->type ));
+
+    /* TU : accumulation type, unsigned for integers so int32 sums wrap */
+#define _GEMM_REF( TI, TC, TU )                                                          \
+    for( i=0 ; i < m ; i++ )                                                             \
+        for( p=0 ; p < k ; p++ )                                                         \
+            for( j=0 ; j < n ; j++ )                                                     \
+                ((TU *)pc)[(i * n) + j] += (TU)((TC)((TI *)pa)[(i * k) + p] * (TC)((TI *)pb)[(p * n) + j]) ;
+
+    switch( a_meta->type )
+    {
+        case DataType_float  : _GEMM_REF( float  , float  , float    ) ; break ;
+        case DataType_double : _GEMM_REF( double , double , double   ) ; break ;
+        case DataType_int8   : _GEMM_REF( int8_t , int32_t, uint32_t ) ; break ;
+        case DataType_int16  : _GEMM_REF( int16_t, int32_t, uint32_t ) ; break ;
+        default :
+            err = api_Err_Param ;
+            break ;
+    }
+#undef _GEMM_REF
+
+err_gemm_ref :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : pack one NR-column panel of the current block of B
+ */
+/*****************************************************************************/
+static void _gemm_pack_b_task( void *arg, uint64_t panel, uint32_t thread_idx )
+{
+    Gemm_Ctx *ctx = (Gemm_Ctx *)arg ;
+    uint64_t col = panel * ctx->ops.nr ;
+    uint64_t cols = ((ctx->nb - col) < ctx->ops.nr) ? (ctx->nb - col) : ctx->ops.nr ;
+
+    ctx->ops.pack_b( ctx->bpack + (panel * ctx->kp * ctx->ops.nr * ctx->ops.pack_size),
+                     ctx->b + (((ctx->pc * ctx->n) + ctx->jc + col) * ctx->ops.in_size),
+                     ctx->n, ctx->kb, cols );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : pack one mc x kb block of A and multiply it with the
+ *         packed block of B, one MR x NR tile of C at a time
+ */
+/*****************************************************************************/
+static void _gemm_block_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Gemm_Ctx *ctx = (Gemm_Ctx *)arg ;
+    uint8_t *apack = ctx->apack + (thread_idx * ctx->apack_stride) ;
+    uint64_t ic = task * ctx->mc ;
+    uint64_t mb = ((ctx->m - ic) < ctx->mc) ? (ctx->m - ic) : ctx->mc ;
+    uint64_t jr , ir , rows , cols ;
+    uint64_t nr = ctx->ops.nr ;
+    uint8_t *ap , *bp , *cp ;
+    uint8_t tile[GEMM_MR * GEMM_NR_INT * sizeof(double)] __attribute__((aligned(SIMD_ALIGN))) ;
+
+    ctx->ops.pack_a( apack, ctx->a + (((ic * ctx->k) + ctx->pc) * ctx->ops.in_size),
+                     ctx->k, mb, ctx->kb );
+
+    for( jr=0 ; jr < ctx->nb ; jr += nr ) {
+        cols = ((ctx->nb - jr) < nr) ? (ctx->nb - jr) : nr ;
+        bp = ctx->bpack + (jr * ctx->kp * ctx->ops.pack_size) ;
+        for( ir=0 ; ir < mb ; ir += GEMM_MR ) {
+            rows = ((mb - ir) < GEMM_MR) ? (mb - ir) : GEMM_MR ;
+            ap = apack + (ir * ctx->kp * ctx->ops.pack_size) ;
+            cp = ctx->c + ((((ic + ir) * ctx->n) + ctx->jc + jr) * ctx->ops.c_size) ;
+
+            if((rows == GEMM_MR) && (cols == nr)) {
+                ctx->ops.ukr( ctx->kp, ap, bp, cp, ctx->n, ctx->first );
+            } else {
+                ctx->ops.ukr( ctx->kp, ap, bp, tile, nr, 1 );
+                ctx->ops.edge( cp, ctx->n, tile, nr, rows, cols, ctx->first );
+            }
+        }
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Validate dimensions and types of A, B and C
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _gemm_check( Vector_MetaData *c_meta, Vector_MetaData *a_meta, Vector_MetaData *b_meta )
+{
+    api_Err_Status err = api_Success ;
+
+    if((c_meta == NULL) || (a_meta == NULL) || (b_meta == NULL)) {
+        debug("Invalid params c_meta = %p, a_meta = %p, b_meta = %p", c_meta, a_meta, b_meta);
+        err = api_Err_Param ;
+        goto err_gemm_check ;
+    }
+    if((a_meta->no_dims != 2) || (b_meta->no_dims != 2) || (c_meta->no_dims != 2)) {
+        debug("Matrix multiply needs 2-dimensional data");
+        err = api_Err_Param ;
+        goto err_gemm_check ;
+    }
+    if( a_meta->type != b_meta->type ) {
+        debug("A and B have different data-types (%d, %d)", a_meta->type, b_meta->type);
+        err = api_Err_Param ;
+        goto err_gemm_check ;
+    }
+    if( a_meta->dim.dim_2d.cols != b_meta->dim.dim_2d.rows ) {
+        debug("Inner dimensions differ : A is %llux%llu, B is %llux%llu",
+                    (unsigned long long)a_meta->dim.dim_2d.rows, (unsigned long long)a_meta->dim.dim_2d.cols,
+                    (unsigned long long)b_meta->dim.dim_2d.rows, (unsigned long long)b_meta->dim.dim_2d.cols);
+        err = api_Err_Param ;
+        goto err_gemm_check ;
+    }
+    if((c_meta->dim.dim_2d.rows != a_meta->dim.dim_2d.rows) ||
+       (c_meta->dim.dim_2d.cols != b_meta->dim.dim_2d.cols)) {
+        debug("C does not have the dimensions of A x B");
+        err = api_Err_Param ;
+        goto err_gemm_check ;
+    }
+    if(((a_meta->type == DataType_float)  && (c_meta->type != DataType_float))  ||
+       ((a_meta->type == DataType_double) && (c_meta->type != DataType_double)) ||
+       (((a_meta->type == DataType_int8) || (a_meta->type == DataType_int16)) &&
+                                             (c_meta->type != DataType_int32))) {
+        debug("C data-type %d does not match inputs of type %d", c_meta->type, a_meta->type);
+        err = api_Err_Param ;
+        goto err_gemm_check ;
+    }
+
+err_gemm_check :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Select packing and micro-kernels for the input data-type
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _gemm_type_ops( Data_Type type, Gemm_Type_Ops *ops )
+{
+    api_Err_Status err = api_Success ;
+    uint32_t avx2 = 0 ;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ;
+#endif
+
+    memset( ops, 0, sizeof(Gemm_Type_Ops));
+    switch( type )
+    {
+        case DataType_float :
+            *ops = (Gemm_Type_Ops){ sizeof(float), sizeof(float), sizeof(float), GEMM_NR_FLOAT, 1,
+                                    _gemm_pack_a_float, _gemm_pack_b_float, _gemm_ukr_float, _gemm_edge_float };
+#if defined(__x86_64__)
+            ops->ukr = avx2 ? _gemm_ukr_float_avx2 : ops->ukr ;
+#endif
+            break ;
+        case DataType_double :
+            *ops = (Gemm_Type_Ops){ sizeof(double), sizeof(double), sizeof(double), GEMM_NR_DOUBLE, 1,
+                                    _gemm_pack_a_double, _gemm_pack_b_double, _gemm_ukr_double, _gemm_edge_double };
+#if defined(__x86_64__)
+            ops->ukr = avx2 ? _gemm_ukr_double_avx2 : ops->ukr ;
+#endif
+            break ;
+        case DataType_int8 :
+            *ops = (Gemm_Type_Ops){ sizeof(int8_t), sizeof(int16_t), sizeof(int32_t), GEMM_NR_INT, 2,
+                                    _gemm_pack_a_int8, _gemm_pack_b_int8, _gemm_ukr_int16, _gemm_edge_int32 };
+#if defined(__x86_64__)
+            ops->ukr = avx2 ? _gemm_ukr_int16_avx2 : ops->ukr ;
+#endif
+            break ;
+        case DataType_int16 :
+            *ops = (Gemm_Type_Ops){ sizeof(int16_t), sizeof(int16_t), sizeof(int32_t), GEMM_NR_INT, 2,
+                                    _gemm_pack_a_int16, _gemm_pack_b_int16, _gemm_ukr_int16, _gemm_edge_int32 };
+#if defined(__x86_64__)
+            ops->ukr = avx2 ? _gemm_ukr_int16_avx2 : ops->ukr ;
+#endif
+            break ;
+        default :
+            debug("Matrix multiply supports float, double, int8 and int16 inputs");
+            err = api_Err_Param ;
+            break ;
+    }
+    (void)avx2 ;
+    return err ;
+}
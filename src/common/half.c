@@ -0,0 +1,340 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__x86_64__)
+  #include <immintrin.h>
+#endif
+
+#include "simd.h"
+#include "half.h"
+
+
+typedef void (*Half_Widen_Fn)( float *, const uint16_t *, uint64_t );
+typedef void (*Half_Narrow_Fn)( uint16_t *, const float *, uint64_t );
+
+static void _half_widen_scalar( float *, const uint16_t *, uint64_t );
+static void _half_narrow_scalar( uint16_t *, const float *, uint64_t );
+static void _half_select( void );
+
+static Half_Widen_Fn g_half_widen = NULL ;
+static Half_Narrow_Fn g_half_narrow = NULL ;
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Widen one binary16 value, including subnormals, infinities and NaN
+ */
+/*****************************************************************************/
+float half_to_f32( uint16_t h )
+{
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16 ;
+    uint32_t exp = (h >> 10) & 0x1fu ;
+    uint32_t man = h & 0x3ffu ;
+    uint32_t bits = 0 ;
+    float f = 0.0f ;
+
+    if( exp == 0x1fu ) {
+        bits = sign | 0x7f800000u | (man << 13) ;
+    } else if( exp != 0 ) {
+        bits = sign | ((exp + 112u) << 23) | (man << 13) ;
+    } else if( man != 0 ) {
+        /* subnormal : normalise the mantissa */
+        exp = 113u ;
+        while((man & 0x400u) == 0 ) {
+            man <<= 1 ;
+            exp-- ;
+        }
+        bits = sign | (exp << 23) | ((man & 0x3ffu) << 13) ;
+    } else {
+        bits = sign ;
+    }
+    memcpy( &f, &bits, sizeof(f));
+    return f ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Narrow one float to binary16, rounding to nearest even. Values
+ *         beyond the range become infinities, NaN stays NaN
+ */
+/*****************************************************************************/
+uint16_t f32_to_half( float f )
+{
+    uint32_t bits = 0 , sign = 0 , man = 0 , round = 0 ;
+    int32_t exp = 0 ;
+
+    memcpy( &bits, &f, sizeof(bits));
+    sign = (bits >> 16) & 0x8000u ;
+    exp = (int32_t)((bits >> 23) & 0xffu) - 127 + 15 ;
+    man = bits & 0x7fffffu ;
+
+    if(((bits >> 23) & 0xffu) == 0xffu )
+        return (uint16_t)(sign | 0x7c00u | ((man != 0) ? 0x200u | (man >> 13) : 0)) ;
+    if( exp >= 0x1f )
+        return (uint16_t)(sign | 0x7c00u) ;
+    if( exp <= 0 ) {
+        if( exp < -11 )
+            return (uint16_t)sign ;
+        /* subnormal : shift in the implicit bit, round on the bits shifted out */
+        man |= 0x800000u ;
+        round = 14 - exp ;
+        bits = man >> round ;
+        man &= (1u << round) - 1 ;
+        if((man > (1u << (round - 1))) || ((man == (1u << (round - 1))) && (bits & 1u)))
+            bits++ ;
+        return (uint16_t)(sign | bits) ;
+    }
+
+    bits = ((uint32_t)exp << 10) | (man >> 13) ;
+    man &= 0x1fffu ;
+    if((man > 0x1000u) || ((man == 0x1000u) && (bits & 1u)))
+        bits++ ;    /* may carry into the exponent, up to infinity : correct */
+    return (uint16_t)(sign | bits) ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Widen / narrow one bfloat16 value. Narrowing rounds to nearest
+ *         even and keeps NaN quiet
+ */
+/*****************************************************************************/
+float bf16_to_f32( uint16_t b )
+{
+    uint32_t bits = (uint32_t)b << 16 ;
+    float f = 0.0f ;
+
+    memcpy( &f, &bits, sizeof(f));
+    return f ;
+}
+
+uint16_t f32_to_bf16( float f )
+{
+    uint32_t bits = 0 ;
+
+    memcpy( &bits, &f, sizeof(bits));
+    if((bits & 0x7fffffffu) > 0x7f800000u )
+        return (uint16_t)((bits >> 16) | 0x40u) ;
+    bits += 0x7fffu + ((bits >> 16) & 1u) ;
+    return (uint16_t)(bits >> 16) ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Widen an array of binary16 values
+ * \param  *dst - n floats
+ * \param  *src - n binary16 values
+ * \param  n - number of values
+ * \return void
+ */
+/*****************************************************************************/
+void half_to_float( float *dst, const uint16_t *src, uint64_t n )
+{
+    if( g_half_widen == NULL )
+        _half_select();
+    g_half_widen( dst, src, n );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Narrow an array of floats to binary16
+ * \param  *dst - n binary16 values
+ * \param  *src - n floats
+ * \param  n - number of values
+ * \return void
+ */
+/*****************************************************************************/
+void float_to_half( uint16_t *dst, const float *src, uint64_t n )
+{
+    if( g_half_narrow == NULL )
+        _half_select();
+    g_half_narrow( dst, src, n );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Widen an array of bfloat16 values. A shift per element, left to
+ *         the auto-vectoriser
+ */
+/*****************************************************************************/
+SIMD_KERNEL
+void bfloat16_to_float( float *dst, const uint16_t *src, uint64_t n )
+{
+    uint32_t *d = (uint32_t *)dst ;
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        d[idx_i] = (uint32_t)src[idx_i] << 16 ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Narrow an array of floats to bfloat16, branch-free so that it
+ *         vectorises : NaN is selected after the rounding add
+ */
+/*****************************************************************************/
+SIMD_KERNEL
+void float_to_bfloat16( uint16_t *dst, const float *src, uint64_t n )
+{
+    const uint32_t *s = (const uint32_t *)src ;
+    uint32_t bits = 0 , rounded = 0 ;
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < n ; idx_i++ ) {
+        bits = s[idx_i] ;
+        rounded = (bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16 ;
+        dst[idx_i] = (uint16_t)(((bits & 0x7fffffffu) > 0x7f800000u) ? ((bits >> 16) | 0x40u) : rounded) ;
+    }
+    return ;
+}
+
+
+
+#if defined(__x86_64__)
+/*****************************************************************************/
+/*!
+ * \brief  binary16 conversions with F16C, 8 values per instruction
+ */
+/*****************************************************************************/
+__attribute__((target("avx,f16c")))
+static void _half_widen_f16c( float *dst, const uint16_t *src, uint64_t n )
+{
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i + 8 <= n ; idx_i += 8 )
+        _mm256_storeu_ps( dst + idx_i, _mm256_cvtph_ps( _mm_loadu_si128((const __m128i *)(src + idx_i))));
+    _half_widen_scalar( dst + idx_i, src + idx_i, n - idx_i );
+    return ;
+}
+
+__attribute__((target("avx,f16c")))
+static void _half_narrow_f16c( uint16_t *dst, const float *src, uint64_t n )
+{
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i + 8 <= n ; idx_i += 8 )
+        _mm_storeu_si128((__m128i *)(dst + idx_i),
+                         _mm256_cvtps_ph( _mm256_loadu_ps( src + idx_i ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ));
+    _half_narrow_scalar( dst + idx_i, src + idx_i, n - idx_i );
+    return ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  binary16 conversions with AVX-512F, 16 values per instruction
+ */
+/*****************************************************************************/
+__attribute__((target("avx512f")))
+static void _half_widen_avx512( float *dst, const uint16_t *src, uint64_t n )
+{
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i + 16 <= n ; idx_i += 16 )
+        _mm512_storeu_ps( dst + idx_i, _mm512_cvtph_ps( _mm256_loadu_si256((const __m256i *)(src + idx_i))));
+    _half_widen_scalar( dst + idx_i, src + idx_i, n - idx_i );
+    return ;
+}
+
+__attribute__((target("avx512f")))
+static void _half_narrow_avx512( uint16_t *dst, const float *src, uint64_t n )
+{
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i + 16 <= n ; idx_i += 16 )
+        _mm256_storeu_si256((__m256i *)(dst + idx_i),
+                            _mm512_cvtps_ph( _mm512_loadu_ps( src + idx_i ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ));
+    _half_narrow_scalar( dst + idx_i, src + idx_i, n - idx_i );
+    return ;
+}
+#endif
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Portable array conversions, also used for the tails
+ */
+/*****************************************************************************/
+static void _half_widen_scalar( float *dst, const uint16_t *src, uint64_t n )
+{
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        dst[idx_i] = half_to_f32( src[idx_i] );
+    return ;
+}
+
+static void _half_narrow_scalar( uint16_t *dst, const float *src, uint64_t n )
+{
+    uint64_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        dst[idx_i] = f32_to_half( src[idx_i] );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Choose the binary16 conversion kernels for the executing CPU.
+ *         Racing threads all store the same choice
+ * \return void
+ */
+/*****************************************************************************/
+static void _half_select( void )
+{
+    Half_Widen_Fn widen = _half_widen_scalar ;
+    Half_Narrow_Fn narrow = _half_narrow_scalar ;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx512f")) {
+        widen = _half_widen_avx512 ;
+        narrow = _half_narrow_avx512 ;
+    } else if( __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c")) {
+        widen = _half_widen_f16c ;
+        narrow = _half_narrow_f16c ;
+    }
+#endif
+    __atomic_store_n( &g_half_narrow, narrow, __ATOMIC_RELAXED );
+    __atomic_store_n( &g_half_widen, widen, __ATOMIC_RELAXED );
+    return ;
+}
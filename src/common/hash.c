@@ -0,0 +1,417 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "simd.h"
+#include "hash.h"
+
+
+#define PRIME32_1   0x9E3779B1U
+#define PRIME32_2   0x85EBCA77U
+#define PRIME32_3   0xC2B2AE3DU
+#define PRIME64_1   0x9E3779B185EBCA87ULL
+#define PRIME64_2   0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3   0x165667B19E3779F9ULL
+#define PRIME64_4   0x85EBCA77C2B2AE63ULL
+#define PRIME64_5   0x27D4EB2F165667C5ULL
+#define PRIME_MX1   0x165667919E3779F9ULL
+#define PRIME_MX2   0x9FB21C651E98DF25ULL
+
+#define HASH_SECRET_SIZE   192
+#define HASH_MIDSIZE_MAX   240
+#define HASH_FILE_CHUNK    (1024*1024)
+
+static const uint8_t secret[HASH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+
+static inline uint64_t _rd64( const uint8_t * );
+static inline uint32_t _rd32( const uint8_t * );
+static inline uint64_t _mul_fold( uint64_t, uint64_t );
+static inline uint64_t _mix16( const uint8_t *, const uint8_t * );
+static inline uint64_t _avalanche( uint64_t );
+static inline uint64_t _avalanche64( uint64_t );
+static inline uint64_t _rrmxmx( uint64_t, uint64_t );
+static uint64_t _hash_short( const uint8_t *, uint64_t );
+static void _hash_stripes( uint64_t *, const uint8_t *, uint64_t, const uint8_t * );
+static void _hash_block( uint64_t *, const uint8_t * );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Start a new hash
+ * \param  *hs - hash state
+ * \return none
+ */
+/*****************************************************************************/
+void hash_init( Hash_State *hs )
+{
+    hs->acc[0] = PRIME32_3 ; hs->acc[1] = PRIME64_1 ;
+    hs->acc[2] = PRIME64_2 ; hs->acc[3] = PRIME64_3 ;
+    hs->acc[4] = PRIME64_4 ; hs->acc[5] = PRIME32_2 ;
+    hs->acc[6] = PRIME64_5 ; hs->acc[7] = PRIME32_1 ;
+    hs->total = 0 ;
+    hs->buffered = 0 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Feed bytes to a hash. A block is only consumed once input beyond it
+ *         arrives, since the final block is hashed differently.
+ * \param  *hs - hash state from hash_init()
+ * \param  *in - bytes to hash
+ * \param  len - number of bytes
+ * \return none
+ */
+/*****************************************************************************/
+void hash_update( Hash_State *hs, const void *in, uint64_t len )
+{
+    const uint8_t *src = (const uint8_t *)in ;
+    const uint8_t *last = NULL ;
+    uint64_t fill = 0 ;
+
+    hs->total += len ;
+    if((hs->buffered + len) <= HASH_BLOCK) {
+        if( len )
+            memcpy( hs->buff + HASH_STRIPE + hs->buffered, src, len );
+        hs->buffered += len ;
+        return ;
+    }
+
+    /* complete the pending block : more input follows it */
+    if( hs->buffered ) {
+        fill = HASH_BLOCK - hs->buffered ;
+        memcpy( hs->buff + HASH_STRIPE + hs->buffered, src, fill );
+        src += fill ;
+        len -= fill ;
+        _hash_block( hs->acc, hs->buff + HASH_STRIPE );
+        last = hs->buff + HASH_STRIPE ;
+    }
+
+    /* whole blocks straight from the input, keeping at least one byte back */
+    for( ; len > HASH_BLOCK ; src += HASH_BLOCK, len -= HASH_BLOCK ) {
+        _hash_block( hs->acc, src );
+        last = src ;
+    }
+
+    /* the final stripe may reach back into the last consumed block */
+    memcpy( hs->buff, last + HASH_BLOCK - HASH_STRIPE, HASH_STRIPE );
+    memcpy( hs->buff + HASH_STRIPE, src, len );
+    hs->buffered = len ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Value of the bytes fed so far. The state is left unchanged.
+ * \param  *hs - hash state
+ * \return returns the 64-bit hash
+ */
+/*****************************************************************************/
+uint64_t hash_digest( Hash_State *hs )
+{
+    uint64_t acc[8] ;
+    uint64_t res = hs->total * PRIME64_1 ;
+    const uint8_t *tail = hs->buff + HASH_STRIPE ;
+    uint32_t idx_i = 0 ;
+
+    if( hs->total <= HASH_MIDSIZE_MAX )
+        return _hash_short( tail, hs->total );
+
+    memcpy( acc, hs->acc, sizeof(acc));
+    _hash_stripes( acc, tail, (hs->buffered - 1) / HASH_STRIPE, secret );
+    _hash_stripes( acc, tail + hs->buffered - HASH_STRIPE, 1, secret + HASH_SECRET_SIZE - HASH_STRIPE - 7 );
+
+    for( idx_i=0 ; idx_i < 4 ; idx_i++ )
+        res += _mul_fold( acc[2*idx_i] ^ _rd64( secret + 11 + 16*idx_i),
+                          acc[2*idx_i+1] ^ _rd64( secret + 11 + 16*idx_i + 8));
+    return _avalanche( res );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Hash a buffer in one call
+ * \param  *in - bytes to hash
+ * \param  len - number of bytes
+ * \return returns the 64-bit hash
+ */
+/*****************************************************************************/
+uint64_t hash_bytes( const void *in, uint64_t len )
+{
+    Hash_State hs ;
+
+    if( len <= HASH_MIDSIZE_MAX )
+        return _hash_short((const uint8_t *)in, len );
+
+    hash_init( &hs );
+    hash_update( &hs, in, len );
+    return hash_digest( &hs );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Hash the bytes of a file as stored on disk (no inflation)
+ * \param  *path - file to hash
+ * \param  *hash - output hash
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status hash_file( char *path, uint64_t *hash )
+{
+    api_Err_Status err = api_Success ;
+    Hash_State hs ;
+    uint8_t *chunk = NULL ;
+    ssize_t bytes = 0 ;
+    int fd = -1 ;
+
+    if((path == NULL) || (hash == NULL)) {
+        debug("Invalid params path = %p, hash = %p", path, hash);
+        err = api_Err_Param ;
+        goto err_hash_file ;
+    }
+    *hash = 0 ;
+
+    fd = open( path, O_RDONLY );
+    if( fd == -1 ) {
+        debug("Could not open file[%s]. errno = %d", path, errno);
+        err = api_Err_File ;
+        goto err_hash_file ;
+    }
+    chunk = malloc( HASH_FILE_CHUNK );
+    if( chunk == NULL ) {
+        debug("Could not alloc(%u) bytes to hash file [%s]", HASH_FILE_CHUNK, path);
+        err = api_Err_Memory ;
+        goto err_hash_file_fd ;
+    }
+
+    hash_init( &hs );
+    while((bytes = read( fd, chunk, HASH_FILE_CHUNK )) != 0 ) {
+        if( bytes == -1 ) {
+            if( errno == EINTR )
+                continue ;
+            debug("read() failed errno(%d). Hashing file[%s]", errno, path);
+            err = api_Err_File ;
+            goto err_hash_file_mem ;
+        }
+        hash_update( &hs, chunk, (uint64_t)bytes );
+    }
+    *hash = hash_digest( &hs );
+
+err_hash_file_mem :
+    chunk = (chunk != NULL) ? free(chunk), NULL : NULL ;
+
+err_hash_file_fd :
+    close( fd );
+
+err_hash_file :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Accumulate whole 64-byte stripes, the secret advancing 8 bytes per
+ *         stripe. Lane i takes the product of its keyed halves and the raw
+ *         word of its neighbour lane.
+ * \param  *acc - 8 accumulators
+ * \param  *in - stripes
+ * \param  nb_stripes - number of stripes
+ * \param  *key - secret of the first stripe
+ * \return none
+ */
+/*****************************************************************************/
+SIMD_KERNEL
+static void _hash_stripes( uint64_t *acc, const uint8_t *in, uint64_t nb_stripes, const uint8_t *key )
+{
+    uint64_t data[8] , swap[8] , k[8] ;
+    uint64_t idx_s = 0 ;
+    uint32_t idx_i = 0 ;
+
+    for( idx_s=0 ; idx_s < nb_stripes ; idx_s++, in += HASH_STRIPE, key += 8 ) {
+        memcpy( data, in, sizeof(data));
+        memcpy( k, key, sizeof(k));
+        for( idx_i=0 ; idx_i < 8 ; idx_i++ )
+            swap[idx_i] = data[idx_i ^ 1] ;
+        for( idx_i=0 ; idx_i < 8 ; idx_i++ ) {
+            k[idx_i] ^= data[idx_i] ;
+            acc[idx_i] += swap[idx_i] + (k[idx_i] & 0xFFFFFFFFULL) * (k[idx_i] >> 32) ;
+        }
+    }
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Accumulate one block of HASH_BLOCK bytes and scramble
+ * \param  *acc - 8 accumulators
+ * \param  *in - block
+ * \return none
+ */
+/*****************************************************************************/
+static void _hash_block( uint64_t *acc, const uint8_t *in )
+{
+    uint32_t idx_i = 0 ;
+
+    _hash_stripes( acc, in, HASH_BLOCK / HASH_STRIPE, secret );
+    for( idx_i=0 ; idx_i < 8 ; idx_i++ ) {
+        acc[idx_i] ^= acc[idx_i] >> 47 ;
+        acc[idx_i] ^= _rd64( secret + HASH_SECRET_SIZE - HASH_STRIPE + 8*idx_i );
+        acc[idx_i] *= PRIME32_1 ;
+    }
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Inputs of up to HASH_MIDSIZE_MAX bytes
+ * \param  *in - bytes to hash
+ * \param  len - number of bytes
+ * \return returns the 64-bit hash
+ */
+/*****************************************************************************/
+static uint64_t _hash_short( const uint8_t *in, uint64_t len )
+{
+    uint64_t acc = len * PRIME64_1 , acc_end = 0 , lo = 0 , hi = 0 ;
+    uint32_t idx_i = 0 , combined = 0 ;
+
+    if( len == 0 )
+        return _avalanche64( _rd64( secret + 56) ^ _rd64( secret + 64));
+
+    if( len <= 3 ) {
+        combined = ((uint32_t)in[0] << 16) | ((uint32_t)in[len >> 1] << 24) |
+                   (uint32_t)in[len - 1] | ((uint32_t)len << 8) ;
+        return _avalanche64((uint64_t)combined ^ (_rd32( secret) ^ _rd32( secret + 4)));
+    }
+
+    if( len <= 8 ) {
+        lo = (uint64_t)_rd32( in + len - 4) + ((uint64_t)_rd32( in) << 32) ;
+        return _rrmxmx( lo ^ (_rd64( secret + 8) ^ _rd64( secret + 16)), len );
+    }
+
+    if( len <= 16 ) {
+        lo = _rd64( in) ^ _rd64( secret + 24) ^ _rd64( secret + 32) ;
+        hi = _rd64( in + len - 8) ^ _rd64( secret + 40) ^ _rd64( secret + 48) ;
+        return _avalanche( len + __builtin_bswap64( lo) + hi + _mul_fold( lo, hi));
+    }
+
+    if( len <= 128 ) {
+        for( idx_i=0 ; idx_i <= (uint32_t)(len - 1) / 32 ; idx_i++ ) {
+            acc += _mix16( in + 16*idx_i, secret + 32*idx_i );
+            acc += _mix16( in + len - 16*(idx_i + 1), secret + 32*idx_i + 16 );
+        }
+        return _avalanche( acc );
+    }
+
+    for( idx_i=0 ; idx_i < 8 ; idx_i++ )
+        acc += _mix16( in + 16*idx_i, secret + 16*idx_i );
+    acc = _avalanche( acc );
+    acc_end = _mix16( in + len - 16, secret + 136 - 17 );
+    for( idx_i=8 ; idx_i < (uint32_t)len / 16 ; idx_i++ )
+        acc_end += _mix16( in + 16*idx_i, secret + 16*(idx_i - 8) + 3 );
+    return _avalanche( acc + acc_end );
+}
+
+
+
+static inline uint64_t _rd64( const uint8_t *p )
+{
+    uint64_t v ;
+    memcpy( &v, p, sizeof(v));
+    return v ;
+}
+
+static inline uint32_t _rd32( const uint8_t *p )
+{
+    uint32_t v ;
+    memcpy( &v, p, sizeof(v));
+    return v ;
+}
+
+static inline uint64_t _mul_fold( uint64_t a, uint64_t b )
+{
+    unsigned __int128 p = (unsigned __int128)a * b ;
+    return (uint64_t)p ^ (uint64_t)(p >> 64) ;
+}
+
+static inline uint64_t _mix16( const uint8_t *in, const uint8_t *key )
+{
+    return _mul_fold( _rd64( in) ^ _rd64( key), _rd64( in + 8) ^ _rd64( key + 8));
+}
+
+static inline uint64_t _avalanche( uint64_t h )
+{
+    h ^= h >> 37 ;
+    h *= PRIME_MX1 ;
+    return h ^ (h >> 32) ;
+}
+
+static inline uint64_t _avalanche64( uint64_t h )
+{
+    h ^= h >> 33 ;
+    h *= PRIME64_2 ;
+    h ^= h >> 29 ;
+    h *= PRIME64_3 ;
+    return h ^ (h >> 32) ;
+}
+
+static inline uint64_t _rrmxmx( uint64_t h, uint64_t len )
+{
+    h ^= ((h << 49) | (h >> 15)) ^ ((h << 24) | (h >> 40)) ;
+    h *= PRIME_MX2 ;
+    h ^= (h >> 35) + len ;
+    h *= PRIME_MX2 ;
+    return h ^ (h >> 28) ;
+}
@@ -0,0 +1,937 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef HAVE_OPENCL
+  #define CL_TARGET_OPENCL_VERSION 120
+  #include <CL/cl.h>
+#endif
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "simd.h"
+#include "time_eval.h"
+#include "thread_pool.h"
+#include "hetero_sched.h"
+#include "half.h"
+
+
+#define HS_TASK_ITEMS      (32 * 1024)    /* items per pool task inside a CPU chunk */
+#define HS_NAME_LEN        128
+#define HS_PAD             8              /* doubles per thread partial, one cache line */
+#define HS_CL_ITEMS        16384          /* work-items per OpenCL launch */
+#define HS_HALF_CHUNK      256            /* floats widened at a time for 16-bit floats */
+
+
+typedef void (*Hetero_Add_Fn)( void *, const void *, const void *, uint64_t, uint64_t );
+typedef double (*Hetero_Sum_Fn)( const void *, uint64_t, uint64_t );
+
+
+/*!
+ * A device is a set of callbacks. run() executes items [begin, end) of the
+ * job synchronously and returns a partial sum for reductions
+ */
+struct __Hetero_Device__
+{
+    Hetero_Device_Type type ;
+    char name[HS_NAME_LEN] ;
+    api_Err_Status (*prepare)( Hetero_Device *, Hetero_Job * );
+    api_Err_Status (*run)( Hetero_Device *, Hetero_Job *, uint64_t, uint64_t, double * );
+    void (*release)( Hetero_Device * );       /* per-job resources */
+    void (*close)( Hetero_Device * );
+#ifdef HAVE_OPENCL
+    cl_device_id cl_dev ;
+    cl_context ctx ;
+    cl_command_queue queue ;
+    cl_program prog ;
+    cl_kernel k_add ;
+    cl_kernel k_sum ;
+    cl_mem buf_a , buf_b , buf_out , buf_part ;
+    Data_Type prog_type ;
+    uint32_t fp64 ;
+    size_t acc_size ;
+    void *part ;
+#endif
+} ;
+
+
+typedef struct __Hetero_Sched__
+{
+    Hetero_Job *job ;
+    Hetero_Device *dev ;
+    pthread_mutex_t lock ;
+    uint64_t next ;                     /* first item not handed out yet */
+    uint64_t min_chunk ;
+    uint32_t active ;                   /* HETERO_USE_* of the agents taking work */
+    double rate[HETERO_AGENTS] ;        /* items/s, 0 until the first chunk finishes */
+    double sum[HETERO_AGENTS] ;
+    Hetero_Stats *stats ;
+    uint64_t cpu_begin , cpu_end ;      /* chunk being run by the pool */
+    double part[TPOOL_MAX_THREADS * HS_PAD] ;
+} Hetero_Sched ;
+
+
+static uint32_t _hs_grab( Hetero_Sched *, uint32_t, uint64_t *, uint64_t * );
+static void _hs_agent( Hetero_Sched *, uint32_t );
+static void *_hs_dev_thread( void * );
+static api_Err_Status _hs_cpu_chunk( Hetero_Sched *, uint64_t, uint64_t, double * );
+static void _hs_cpu_task( void *, uint64_t, uint32_t );
+static double _hs_host_range( Hetero_Job *, uint64_t, uint64_t );
+static api_Err_Status _hs_host_prepare( Hetero_Device *, Hetero_Job * );
+static api_Err_Status _hs_host_run( Hetero_Device *, Hetero_Job *, uint64_t, uint64_t, double * );
+static void _hs_host_release( Hetero_Device * );
+#ifdef HAVE_OPENCL
+static api_Err_Status _hs_cl_open( Hetero_Device * );
+static api_Err_Status _hs_cl_prepare( Hetero_Device *, Hetero_Job * );
+static api_Err_Status _hs_cl_run( Hetero_Device *, Hetero_Job *, uint64_t, uint64_t, double * );
+static void _hs_cl_release( Hetero_Device * );
+static void _hs_cl_close( Hetero_Device * );
+#endif
+
+
+
+/*!
+ * Native kernels, used by the thread pool and by the emulated device.
+ * Sums accumulate in 64-bit integers or double
+ */
+#define HETERO_KERNELS( T, ACC, SUFFIX )                                              \
+SIMD_KERNEL                                                                           \
+static void _hs_add_##SUFFIX( void *out, const void *a, const void *b,                \
+                              uint64_t begin, uint64_t end )                          \
+{                                                                                     \
+    T *o = (T *)out ;                                                                 \
+    const T *x = (const T *)a , *y = (const T *)b ;                                   \
+    uint64_t idx_i = 0 ;                                                              \
+                                                                                      \
+    SIMD_IVDEP                                                                        \
+    for( idx_i=begin ; idx_i < end ; idx_i++ )                                        \
+        o[idx_i] = (T)(x[idx_i] + y[idx_i]) ;                                         \
+    return ;                                                                          \
+}                                                                                     \
+                                                                                      \
+SIMD_KERNEL                                                                           \
+static double _hs_sum_##SUFFIX( const void *a, uint64_t begin, uint64_t end )         \
+{                                                                                     \
+    const T *x = (const T *)a ;                                                       \
+    ACC s = 0 ;                                                                       \
+    uint64_t idx_i = 0 ;                                                              \
+                                                                                      \
+    for( idx_i=begin ; idx_i < end ; idx_i++ )                                        \
+        s += (ACC)x[idx_i] ;                                                          \
+    return (double)s ;                                                                \
+}
+
+HETERO_KERNELS( uint8_t,     uint64_t,    u8  )
+HETERO_KERNELS( uint16_t,    uint64_t,    u16 )
+HETERO_KERNELS( uint32_t,    uint64_t,    u32 )
+HETERO_KERNELS( uint64_t,    uint64_t,    u64 )
+HETERO_KERNELS( int8_t,      int64_t,     s8  )
+HETERO_KERNELS( int16_t,     int64_t,     s16 )
+HETERO_KERNELS( int32_t,     int64_t,     s32 )
+HETERO_KERNELS( int64_t,     int64_t,     s64 )
+HETERO_KERNELS( float,       double,      f32 )
+HETERO_KERNELS( double,      double,      f64 )
+HETERO_KERNELS( long double, long double, f80 )
+
+/*!
+ * 16-bit float kernels : operands are widened a chunk at a time and added in
+ * float32, sums accumulate in double
+ */
+#define HETERO_HALF_KERNELS( WIDEN, NARROW, SUFFIX )                                  \
+SIMD_KERNEL                                                                           \
+static void _hs_add_##SUFFIX( void *out, const void *a, const void *b,                \
+                              uint64_t begin, uint64_t end )                          \
+{                                                                                     \
+    float x[HS_HALF_CHUNK] , y[HS_HALF_CHUNK] ;                                         \
+    uint64_t idx_i = 0 , idx_j = 0 , n = 0 ;                                          \
+                                                                                      \
+    for( idx_i=begin ; idx_i < end ; idx_i += n ) {                                   \
+        n = ((end - idx_i) < HS_HALF_CHUNK) ? (end - idx_i) : HS_HALF_CHUNK ;         \
+        WIDEN( x, (const uint16_t *)a + idx_i, n );                                   \
+        WIDEN( y, (const uint16_t *)b + idx_i, n );                                   \
+        SIMD_IVDEP                                                                    \
+        for( idx_j=0 ; idx_j < n ; idx_j++ )                                          \
+            x[idx_j] += y[idx_j] ;                                                    \
+        NARROW((uint16_t *)out + idx_i, x, n );                                       \
+    }                                                                                 \
+    return ;                                                                          \
+}                                                                                     \
+                                                                                      \
+static double _hs_sum_##SUFFIX( const void *a, uint64_t begin, uint64_t end )         \
+{                                                                                     \
+    float x[HS_HALF_CHUNK] ;                                                          \
+    double s = 0 ;                                                                    \
+    uint64_t idx_i = 0 , idx_j = 0 , n = 0 ;                                          \
+                                                                                      \
+    for( idx_i=begin ; idx_i < end ; idx_i += n ) {                                   \
+        n = ((end - idx_i) < HS_HALF_CHUNK) ? (end - idx_i) : HS_HALF_CHUNK ;         \
+        WIDEN( x, (const uint16_t *)a + idx_i, n );                                   \
+        for( idx_j=0 ; idx_j < n ; idx_j++ )                                          \
+            s += (double)x[idx_j] ;                                                   \
+    }                                                                                 \
+    return s ;                                                                        \
+}
+
+HETERO_HALF_KERNELS( half_to_float,     float_to_half,     f16  )
+HETERO_HALF_KERNELS( bfloat16_to_float, float_to_bfloat16, bf16 )
+
+static const struct
+{
+    Hetero_Add_Fn add ;
+    Hetero_Sum_Fn sum ;
+} g_hs_kernels[DataType_MaxTypes] =
+{
+    [DataType_uint8]       = { _hs_add_u8 ,  _hs_sum_u8  },
+    [DataType_uint16]      = { _hs_add_u16,  _hs_sum_u16 },
+    [DataType_uint32]      = { _hs_add_u32,  _hs_sum_u32 },
+    [DataType_uint64]      = { _hs_add_u64,  _hs_sum_u64 },
+    [DataType_int8]        = { _hs_add_s8 ,  _hs_sum_s8  },
+    [DataType_int16]       = { _hs_add_s16,  _hs_sum_s16 },
+    [DataType_int32]       = { _hs_add_s32,  _hs_sum_s32 },
+    [DataType_int64]       = { _hs_add_s64,  _hs_sum_s64 },
+    [DataType_float]       = { _hs_add_f32,  _hs_sum_f32 },
+    [DataType_double]      = { _hs_add_f64,  _hs_sum_f64 },
+    [DataType_long_double] = { _hs_add_f80,  _hs_sum_f80 },
+    [DataType_float16]     = { _hs_add_f16,  _hs_sum_f16 },
+    [DataType_bfloat16]    = { _hs_add_bf16, _hs_sum_bf16 },
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Open a device to share work with
+ * \param  **dev - opened device
+ * \param  type - Hetero_Dev_Host or Hetero_Dev_OpenCL. The OpenCL device
+ *         is chosen by HETERO_CL_DEVICE (cpu, gpu, accelerator); without it
+ *         a GPU, then an accelerator, then a CPU implementation is tried
+ * \return returns api_Success on success, api_Err_Hardware if the device
+ *         is not available
+ */
+/*****************************************************************************/
+api_Err_Status hetero_device_open( Hetero_Device **dev, Hetero_Device_Type type )
+{
+    api_Err_Status err = api_Success ;
+    Hetero_Device *d = NULL ;
+
+    if((dev == NULL) || (type == Hetero_Dev_None) || (type >= Hetero_Dev_MaxTypes)) {
+        debug("Invalid params dev = %p, type = %d", dev, type);
+        err = api_Err_Param ;
+        goto err_dev_open ;
+    }
+    *dev = NULL ;
+
+    d = (Hetero_Device *)calloc( 1, sizeof(Hetero_Device));
+    if( d == NULL ) {
+        debug("Could not allocate device");
+        err = api_Err_Memory ;
+        goto err_dev_open ;
+    }
+    d->type = type ;
+
+    if( type == Hetero_Dev_Host ) {
+        snprintf( d->name, sizeof(d->name), "host thread" );
+        d->prepare = _hs_host_prepare ;
+        d->run = _hs_host_run ;
+        d->release = _hs_host_release ;
+    } else {
+#ifdef HAVE_OPENCL
+        d->prepare = _hs_cl_prepare ;
+        d->run = _hs_cl_run ;
+        d->release = _hs_cl_release ;
+        d->close = _hs_cl_close ;
+        err = _hs_cl_open( d );
+        if( err != api_Success )
+            goto err_dev_open ;
+#else
+        debug("Built without OpenCL support. Rebuild with make OPENCL=1");
+        err = api_Err_Hardware ;
+        goto err_dev_open ;
+#endif
+    }
+
+    *dev = d ;
+    return err ;
+
+err_dev_open :
+    if( d != NULL )
+        hetero_device_close( &d );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Close a device opened by hetero_device_open()
+ * \return void
+ */
+/*****************************************************************************/
+void hetero_device_close( Hetero_Device **dev )
+{
+    if((dev == NULL) || (*dev == NULL))
+        return ;
+
+    if((*dev)->release != NULL )
+        (*dev)->release( *dev );
+    if((*dev)->close != NULL )
+        (*dev)->close( *dev );
+    free( *dev );
+    *dev = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Name of the device for reports
+ */
+/*****************************************************************************/
+const char *hetero_device_name( Hetero_Device *dev )
+{
+    return (dev != NULL) ? dev->name : "none" ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Run a job split between the thread pool and a device. Each side
+ *         starts with a probing chunk of min_chunk items to measure its
+ *         throughput, then takes remaining * (own rate / total rate) / 2
+ *         items per chunk, re-estimating its rate after every chunk. If
+ *         the device fails, its chunk is finished on the host and it takes
+ *         no more work
+ * \param  *job - job description, sum filled in for Hetero_Sum
+ * \param  *dev - device, NULL to use the pool only
+ * \param  agents - HETERO_USE_CPU and/or HETERO_USE_DEV
+ * \param  min_chunk - smallest chunk handed out, 0 : HETERO_MIN_CHUNK
+ * \param  *stats - work done by each side, may be NULL
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status hetero_run( Hetero_Job *job, Hetero_Device *dev, uint32_t agents, uint64_t min_chunk, Hetero_Stats *stats )
+{
+    api_Err_Status err = api_Success ;
+    Hetero_Sched *s = NULL ;
+    Hetero_Stats local ;
+    pthread_t dev_thread ;
+    uint32_t thread_started = 0 , prepared = 0 ;
+    struct timespec begin , end ;
+
+    if((job == NULL) || (job->a == NULL) || (job->op >= Hetero_MaxOps) || (job->type >= DataType_MaxTypes) ||
+       ((job->op == Hetero_Add) && ((job->b == NULL) || (job->out == NULL)))) {
+        debug("Invalid job %p", job);
+        err = api_Err_Param ;
+        goto err_hetero_run ;
+    }
+    if( dev == NULL )
+        agents &= ~HETERO_USE_DEV ;
+    if( agents == 0 ) {
+        debug("No agent selected to run the job");
+        err = api_Err_Param ;
+        goto err_hetero_run ;
+    }
+
+    s = (Hetero_Sched *)aligned_alloc( SIMD_ALIGN, (sizeof(Hetero_Sched) + SIMD_ALIGN - 1) / SIMD_ALIGN * SIMD_ALIGN );
+    if( s == NULL ) {
+        debug("Could not allocate scheduler state");
+        err = api_Err_Memory ;
+        goto err_hetero_run ;
+    }
+    memset( s, 0, sizeof(Hetero_Sched));
+    memset( &local, 0, sizeof(local));
+    pthread_mutex_init( &s->lock, NULL );
+    s->job = job ;
+    s->dev = dev ;
+    s->min_chunk = (min_chunk != 0) ? min_chunk : HETERO_MIN_CHUNK ;
+    s->stats = (stats != NULL) ? stats : &local ;
+    memset( s->stats, 0, sizeof(Hetero_Stats));
+
+    if( agents & HETERO_USE_DEV ) {
+        err = dev->prepare( dev, job );
+        if( err != api_Success ) {
+            debug("Device [%s] cannot run this job (err = %d)%s", dev->name, err,
+                        (agents & HETERO_USE_CPU) ? ", using the thread pool only" : "");
+            if((agents & HETERO_USE_CPU) == 0 )
+                goto err_hetero_run ;
+            agents &= ~HETERO_USE_DEV ;
+            err = api_Success ;
+        } else {
+            prepared = 1 ;
+        }
+    }
+    s->active = agents ;
+
+    start_wall_timer( begin );
+    if( agents == (HETERO_USE_CPU | HETERO_USE_DEV)) {
+        if( pthread_create( &dev_thread, NULL, _hs_dev_thread, s ) == 0 ) {
+            thread_started = 1 ;
+        } else {
+            debug("Could not start the device thread, using the thread pool only");
+            pthread_mutex_lock( &s->lock );
+            s->active &= ~HETERO_USE_DEV ;
+            pthread_mutex_unlock( &s->lock );
+        }
+        _hs_agent( s, HETERO_AGENT_CPU );
+        if( thread_started )
+            pthread_join( dev_thread, NULL );
+    } else {
+        _hs_agent( s, (agents & HETERO_USE_CPU) ? HETERO_AGENT_CPU : HETERO_AGENT_DEV );
+    }
+    stop_wall_timer( end );
+
+    s->stats->secs = wall_time_taken( begin, end );
+    s->stats->rate[HETERO_AGENT_CPU] = s->rate[HETERO_AGENT_CPU] ;
+    s->stats->rate[HETERO_AGENT_DEV] = s->rate[HETERO_AGENT_DEV] ;
+    if( job->op == Hetero_Sum )
+        job->sum = s->sum[HETERO_AGENT_CPU] + s->sum[HETERO_AGENT_DEV] ;
+
+err_hetero_run :
+    if( prepared )
+        dev->release( dev );
+    if( s != NULL ) {
+        pthread_mutex_destroy( &s->lock );
+        free( s );
+    }
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Hand out the next chunk to an agent (guided self-scheduling,
+ *         weighted by the measured throughput of the active agents)
+ * \return 1 if a chunk was handed out, 0 when the job is exhausted
+ */
+/*****************************************************************************/
+static uint32_t _hs_grab( Hetero_Sched *s, uint32_t agent, uint64_t *begin, uint64_t *end )
+{
+    uint64_t remaining = 0 , chunk = 0 ;
+    double total = 0.0 , share = 0.0 ;
+    uint32_t idx_i = 0 , ret = 0 ;
+
+    pthread_mutex_lock( &s->lock );
+    remaining = s->job->items - s->next ;
+    if( remaining == 0 )
+        goto err_grab ;
+
+    if( s->rate[agent] <= 0.0 ) {
+        chunk = s->min_chunk ;
+    } else {
+        /* an agent still probing counts as fast as this one */
+        for( idx_i=0 ; idx_i < HETERO_AGENTS ; idx_i++ )
+            if( s->active & (1u << idx_i))
+                total += (s->rate[idx_i] > 0.0) ? s->rate[idx_i] : s->rate[agent] ;
+        share = s->rate[agent] / total ;
+        chunk = (uint64_t)((double)remaining * share / 2.0) ;
+    }
+    chunk = (chunk < s->min_chunk) ? s->min_chunk : chunk ;
+    chunk = (chunk > remaining) ? remaining : chunk ;
+
+    *begin = s->next ;
+    *end = s->next + chunk ;
+    s->next += chunk ;
+    ret = 1 ;
+
+err_grab :
+    pthread_mutex_unlock( &s->lock );
+    return ret ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Work loop of one side : take chunks until none are left
+ * \return void
+ */
+/*****************************************************************************/
+static void _hs_agent( Hetero_Sched *s, uint32_t agent )
+{
+    Hetero_Stats *st = s->stats ;
+    struct timespec t0 , t1 ;
+    uint64_t begin = 0 , end = 0 ;
+    uint32_t failed = 0 , cpu_left = 0 ;
+    double partial = 0.0 , secs = 0.0 , rate = 0.0 ;
+
+    while( _hs_grab( s, agent, &begin, &end )) {
+        partial = 0.0 ;
+        start_wall_timer( t0 );
+        if( agent == HETERO_AGENT_CPU ) {
+            if( _hs_cpu_chunk( s, begin, end, &partial ) != api_Success )
+                partial = _hs_host_range( s->job, begin, end );
+        } else if( failed ) {
+            partial = _hs_host_range( s->job, begin, end );
+        } else if( s->dev->run( s->dev, s->job, begin, end, &partial ) != api_Success ) {
+            debug("Device [%s] failed on items %llu..%llu, finishing on the host",
+                        s->dev->name, (unsigned long long)begin, (unsigned long long)end);
+            partial = _hs_host_range( s->job, begin, end );
+            failed = 1 ;
+            pthread_mutex_lock( &s->lock );
+            s->active &= ~HETERO_USE_DEV ;
+            cpu_left = s->active & HETERO_USE_CPU ;
+            pthread_mutex_unlock( &s->lock );
+        }
+        stop_wall_timer( t1 );
+
+        secs = wall_time_taken( t0, t1 );
+        s->sum[agent] += partial ;
+        st->items[agent] += end - begin ;
+        st->chunks[agent]++ ;
+        st->busy[agent] += secs ;
+
+        /* the pool takes over what is left, unless there is no pool side */
+        if( failed && cpu_left )
+            break ;
+
+        rate = (double)(end - begin) / ((secs > 1e-9) ? secs : 1e-9) ;
+        pthread_mutex_lock( &s->lock );
+        s->rate[agent] = (s->rate[agent] <= 0.0) ? rate : (0.5 * s->rate[agent]) + (0.5 * rate) ;
+        pthread_mutex_unlock( &s->lock );
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Device side of a split job, run on its own thread
+ */
+/*****************************************************************************/
+static void *_hs_dev_thread( void *arg )
+{
+    _hs_agent((Hetero_Sched *)arg, HETERO_AGENT_DEV );
+    return NULL ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Run items [begin, end) on the thread pool
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _hs_cpu_chunk( Hetero_Sched *s, uint64_t begin, uint64_t end, double *partial )
+{
+    api_Err_Status err = api_Success ;
+    Thread_Pool *pool = tpool_default();
+    uint32_t idx_i = 0 , no_threads = tpool_size( pool );
+
+    s->cpu_begin = begin ;
+    s->cpu_end = end ;
+    for( idx_i=0 ; idx_i < no_threads ; idx_i++ )
+        s->part[idx_i * HS_PAD] = 0.0 ;
+
+    err = tpool_parallel_for( pool, (end - begin + HS_TASK_ITEMS - 1) / HS_TASK_ITEMS, _hs_cpu_task, s );
+
+    for( idx_i=0 ; idx_i < no_threads ; idx_i++ )
+        *partial += s->part[idx_i * HS_PAD] ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : HS_TASK_ITEMS items of the current CPU chunk
+ */
+/*****************************************************************************/
+static void _hs_cpu_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Hetero_Sched *s = (Hetero_Sched *)arg ;
+    uint64_t begin = s->cpu_begin + (task * HS_TASK_ITEMS) ;
+    uint64_t end = ((s->cpu_end - begin) < HS_TASK_ITEMS) ? s->cpu_end : begin + HS_TASK_ITEMS ;
+
+    s->part[thread_idx * HS_PAD] += _hs_host_range( s->job, begin, end );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Run items [begin, end) serially on the calling thread
+ * \return partial sum for Hetero_Sum, 0 otherwise
+ */
+/*****************************************************************************/
+static double _hs_host_range( Hetero_Job *job, uint64_t begin, uint64_t end )
+{
+    if( job->op == Hetero_Sum )
+        return g_hs_kernels[job->type].sum( job->a, begin, end );
+
+    g_hs_kernels[job->type].add( job->out, job->a, job->b, begin, end );
+    return 0.0 ;
+}
+
+
+
+/*!
+ * Emulated device : one extra host thread running the native kernels.
+ * Lets the scheduler be exercised where no OpenCL implementation exists
+ */
+static api_Err_Status _hs_host_prepare( Hetero_Device *dev, Hetero_Job *job )
+{
+    return api_Success ;
+}
+
+static api_Err_Status _hs_host_run( Hetero_Device *dev, Hetero_Job *job, uint64_t begin, uint64_t end, double *partial )
+{
+    *partial = _hs_host_range( job, begin, end );
+    return api_Success ;
+}
+
+static void _hs_host_release( Hetero_Device *dev )
+{
+    return ;
+}
+
+
+
+#ifdef HAVE_OPENCL
+/*!
+ * OpenCL device. Each chunk is copied to the device, computed by a
+ * grid-stride kernel and (for Hetero_Add) copied back, so the measured
+ * throughput includes the transfers. T and ACC are set per data-type when
+ * the program is built
+ */
+static const char *g_hs_cl_source =
+    "#ifdef USE_FP64\n"
+    "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+    "#endif\n"
+    "__kernel void hetero_add( __global const T *a, __global const T *b, __global T *out, ulong begin, ulong end )\n"
+    "{\n"
+    "    for( ulong i = begin + get_global_id(0) ; i < end ; i += get_global_size(0) )\n"
+    "        out[i] = (T)(a[i] + b[i]) ;\n"
+    "}\n"
+    "__kernel void hetero_sum( __global const T *a, __global ACC *part, ulong begin, ulong end )\n"
+    "{\n"
+    "    ACC s = 0 ;\n"
+    "    for( ulong i = begin + get_global_id(0) ; i < end ; i += get_global_size(0) )\n"
+    "        s += (ACC)a[i] ;\n"
+    "    part[get_global_id(0)] = s ;\n"
+    "}\n" ;
+
+/* OpenCL C names of the element types, NULL : not supported on devices */
+static const char *g_hs_cl_types[DataType_MaxTypes] =
+{
+    [DataType_uint8]  = "uchar",  [DataType_uint16] = "ushort",
+    [DataType_uint32] = "uint",   [DataType_uint64] = "ulong",
+    [DataType_int8]   = "char",   [DataType_int16]  = "short",
+    [DataType_int32]  = "int",    [DataType_int64]  = "long",
+    [DataType_float]  = "float",  [DataType_double] = "double",
+    [DataType_long_double] = NULL,
+    [DataType_float16] = NULL,    [DataType_bfloat16] = NULL,
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Find an OpenCL device and create its context and queue
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _hs_cl_open( Hetero_Device *dev )
+{
+    api_Err_Status err = api_Success ;
+    cl_platform_id platforms[8] ;
+    cl_device_type types[3] = { CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ACCELERATOR, CL_DEVICE_TYPE_CPU } ;
+    cl_uint no_platforms = 0 , no_devices = 0 , no_types = 3 , idx_i = 0 , idx_j = 0 ;
+    cl_int rc = CL_SUCCESS ;
+    char *env = getenv("HETERO_CL_DEVICE") , *ext = NULL , dev_name[HS_NAME_LEN - 16] ;
+    size_t ext_len = 0 ;
+
+    if( env != NULL ) {
+        no_types = 1 ;
+        if( strcmp( env, "cpu" ) == 0 )
+            types[0] = CL_DEVICE_TYPE_CPU ;
+        else if( strcmp( env, "accelerator" ) == 0 )
+            types[0] = CL_DEVICE_TYPE_ACCELERATOR ;
+        else if( strcmp( env, "gpu" ) == 0 )
+            types[0] = CL_DEVICE_TYPE_GPU ;
+        else
+            types[0] = CL_DEVICE_TYPE_ALL ;
+    }
+
+    rc = clGetPlatformIDs( 8, platforms, &no_platforms );
+    if((rc != CL_SUCCESS) || (no_platforms == 0)) {
+        debug("No OpenCL platform found (rc = %d)", rc);
+        err = api_Err_Hardware ;
+        goto err_cl_open ;
+    }
+    no_platforms = (no_platforms > 8) ? 8 : no_platforms ;
+
+    for( idx_i=0 ; (idx_i < no_types) && (no_devices == 0) ; idx_i++ )
+        for( idx_j=0 ; (idx_j < no_platforms) && (no_devices == 0) ; idx_j++ )
+            if( clGetDeviceIDs( platforms[idx_j], types[idx_i], 1, &dev->cl_dev, &no_devices ) != CL_SUCCESS )
+                no_devices = 0 ;
+    if( no_devices == 0 ) {
+        debug("No OpenCL device of the requested type found");
+        err = api_Err_Hardware ;
+        goto err_cl_open ;
+    }
+
+    dev->ctx = clCreateContext( NULL, 1, &dev->cl_dev, NULL, NULL, &rc );
+    if( rc != CL_SUCCESS ) {
+        debug("clCreateContext failed. rc = %d", rc);
+        err = api_Err_Hardware ;
+        goto err_cl_open ;
+    }
+    dev->queue = clCreateCommandQueue( dev->ctx, dev->cl_dev, 0, &rc );
+    if( rc != CL_SUCCESS ) {
+        debug("clCreateCommandQueue failed. rc = %d", rc);
+        err = api_Err_Hardware ;
+        goto err_cl_open ;
+    }
+
+    memset( dev_name, 0, sizeof(dev_name));
+    clGetDeviceInfo( dev->cl_dev, CL_DEVICE_NAME, sizeof(dev_name) - 1, dev_name, NULL );
+    snprintf( dev->name, sizeof(dev->name), "OpenCL %s", dev_name );
+
+    if((clGetDeviceInfo( dev->cl_dev, CL_DEVICE_EXTENSIONS, 0, NULL, &ext_len ) == CL_SUCCESS) &&
+       ((ext = (char *)calloc( 1, ext_len + 1 )) != NULL)) {
+        if( clGetDeviceInfo( dev->cl_dev, CL_DEVICE_EXTENSIONS, ext_len, ext, NULL ) == CL_SUCCESS )
+            dev->fp64 = (strstr( ext, "cl_khr_fp64" ) != NULL) ;
+        free( ext );
+    }
+    dev->prog_type = DataType_MaxTypes ;
+
+err_cl_open :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Build the kernels for the job's data-type (cached across jobs of
+ *         the same type) and allocate device buffers for the whole job
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _hs_cl_prepare( Hetero_Device *dev, Hetero_Job *job )
+{
+    api_Err_Status err = api_Success ;
+    const char *acc = NULL ;
+    char options[128] , *log = NULL ;
+    size_t log_len = 0 , bytes = 0 ;
+    cl_int rc = CL_SUCCESS ;
+    uint32_t is_fp = (job->type == DataType_float) || (job->type == DataType_double) ;
+
+    if((g_hs_cl_types[job->type] == NULL) || ((job->type == DataType_double) && !dev->fp64)) {
+        debug("Data-type %d is not supported by [%s]", job->type, dev->name);
+        err = api_Err_Hardware ;
+        goto err_cl_prepare ;
+    }
+
+    if( is_fp ) {
+        acc = dev->fp64 ? "double" : "float" ;
+        dev->acc_size = dev->fp64 ? sizeof(double) : sizeof(float) ;
+    } else {
+        acc = (job->type <= DataType_uint64) ? "ulong" : "long" ;
+        dev->acc_size = sizeof(uint64_t) ;
+    }
+
+    if( dev->prog_type != job->type ) {
+        if( dev->k_add != NULL )
+            clReleaseKernel( dev->k_add );
+        if( dev->k_sum != NULL )
+            clReleaseKernel( dev->k_sum );
+        if( dev->prog != NULL )
+            clReleaseProgram( dev->prog );
+        dev->k_add = NULL ;
+        dev->k_sum = NULL ;
+        dev->prog_type = DataType_MaxTypes ;
+
+        snprintf( options, sizeof(options), "-DT=%s -DACC=%s%s", g_hs_cl_types[job->type], acc,
+                    (is_fp && dev->fp64) ? " -DUSE_FP64" : "" );
+        dev->prog = clCreateProgramWithSource( dev->ctx, 1, &g_hs_cl_source, NULL, &rc );
+        if( rc == CL_SUCCESS )
+            rc = clBuildProgram( dev->prog, 1, &dev->cl_dev, options, NULL, NULL );
+        if( rc != CL_SUCCESS ) {
+            debug("Could not build kernels with [%s]. rc = %d", options, rc);
+            if((dev->prog != NULL) &&
+               (clGetProgramBuildInfo( dev->prog, dev->cl_dev, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_len ) == CL_SUCCESS) &&
+               ((log = (char *)calloc( 1, log_len + 1 )) != NULL)) {
+                clGetProgramBuildInfo( dev->prog, dev->cl_dev, CL_PROGRAM_BUILD_LOG, log_len, log, NULL );
+                debug("%s", log);
+                free( log );
+            }
+            err = api_Err_Hardware ;
+            goto err_cl_prepare ;
+        }
+        dev->k_add = clCreateKernel( dev->prog, "hetero_add", &rc );
+        if( rc == CL_SUCCESS )
+            dev->k_sum = clCreateKernel( dev->prog, "hetero_sum", &rc );
+        if( rc != CL_SUCCESS ) {
+            debug("clCreateKernel failed. rc = %d", rc);
+            err = api_Err_Hardware ;
+            goto err_cl_prepare ;
+        }
+        dev->prog_type = job->type ;
+    }
+
+    bytes = job->items * sizeof_datatype( job->type );
+    dev->buf_a = clCreateBuffer( dev->ctx, CL_MEM_READ_ONLY, bytes, NULL, &rc );
+    if((rc == CL_SUCCESS) && (job->op == Hetero_Add)) {
+        dev->buf_b = clCreateBuffer( dev->ctx, CL_MEM_READ_ONLY, bytes, NULL, &rc );
+        if( rc == CL_SUCCESS )
+            dev->buf_out = clCreateBuffer( dev->ctx, CL_MEM_WRITE_ONLY, bytes, NULL, &rc );
+    } else if( rc == CL_SUCCESS ) {
+        dev->buf_part = clCreateBuffer( dev->ctx, CL_MEM_WRITE_ONLY, HS_CL_ITEMS * dev->acc_size, NULL, &rc );
+        dev->part = malloc( HS_CL_ITEMS * dev->acc_size );
+        if( dev->part == NULL )
+            rc = CL_OUT_OF_HOST_MEMORY ;
+    }
+    if( rc != CL_SUCCESS ) {
+        debug("Could not allocate device buffers for %llu items. rc = %d", (unsigned long long)job->items, rc);
+        err = api_Err_Memory ;
+    }
+
+err_cl_prepare :
+    if( err != api_Success )
+        _hs_cl_release( dev );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Copy items [begin, end) in, run the kernel, copy results back
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _hs_cl_run( Hetero_Device *dev, Hetero_Job *job, uint64_t begin, uint64_t end, double *partial )
+{
+    api_Err_Status err = api_Success ;
+    size_t esize = sizeof_datatype( job->type ) ;
+    size_t offset = begin * esize , bytes = (end - begin) * esize ;
+    size_t global = ((end - begin) < HS_CL_ITEMS) ? (end - begin) : HS_CL_ITEMS ;
+    cl_ulong cl_begin = begin , cl_end = end ;
+    cl_kernel k = (job->op == Hetero_Add) ? dev->k_add : dev->k_sum ;
+    cl_int rc = CL_SUCCESS ;
+    size_t idx_i = 0 ;
+
+    rc = clEnqueueWriteBuffer( dev->queue, dev->buf_a, CL_FALSE, offset, bytes, (const uint8_t *)job->a + offset, 0, NULL, NULL );
+    if( job->op == Hetero_Add ) {
+        rc |= clEnqueueWriteBuffer( dev->queue, dev->buf_b, CL_FALSE, offset, bytes, (const uint8_t *)job->b + offset, 0, NULL, NULL );
+        rc |= clSetKernelArg( k, 0, sizeof(cl_mem), &dev->buf_a );
+        rc |= clSetKernelArg( k, 1, sizeof(cl_mem), &dev->buf_b );
+        rc |= clSetKernelArg( k, 2, sizeof(cl_mem), &dev->buf_out );
+        rc |= clSetKernelArg( k, 3, sizeof(cl_ulong), &cl_begin );
+        rc |= clSetKernelArg( k, 4, sizeof(cl_ulong), &cl_end );
+    } else {
+        rc |= clSetKernelArg( k, 0, sizeof(cl_mem), &dev->buf_a );
+        rc |= clSetKernelArg( k, 1, sizeof(cl_mem), &dev->buf_part );
+        rc |= clSetKernelArg( k, 2, sizeof(cl_ulong), &cl_begin );
+        rc |= clSetKernelArg( k, 3, sizeof(cl_ulong), &cl_end );
+    }
+    if( rc == CL_SUCCESS )
+        rc = clEnqueueNDRangeKernel( dev->queue, k, 1, NULL, &global, NULL, 0, NULL, NULL );
+    if( rc != CL_SUCCESS ) {
+        debug("Could not launch kernel. rc = %d", rc);
+        err = api_Err_Hardware ;
+        goto err_cl_run ;
+    }
+
+    if( job->op == Hetero_Add ) {
+        rc = clEnqueueReadBuffer( dev->queue, dev->buf_out, CL_TRUE, offset, bytes, (uint8_t *)job->out + offset, 0, NULL, NULL );
+    } else {
+        rc = clEnqueueReadBuffer( dev->queue, dev->buf_part, CL_TRUE, 0, global * dev->acc_size, dev->part, 0, NULL, NULL );
+        for( idx_i=0 ; (rc == CL_SUCCESS) && (idx_i < global) ; idx_i++ ) {
+            if((job->type == DataType_float) || (job->type == DataType_double))
+                *partial += (dev->acc_size == sizeof(double)) ? ((double *)dev->part)[idx_i] : ((float *)dev->part)[idx_i] ;
+            else if( job->type <= DataType_uint64 )
+                *partial += (double)((uint64_t *)dev->part)[idx_i] ;
+            else
+                *partial += (double)((int64_t *)dev->part)[idx_i] ;
+        }
+    }
+    if( rc != CL_SUCCESS ) {
+        debug("Could not read results back. rc = %d", rc);
+        err = api_Err_Hardware ;
+    }
+
+err_cl_run :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Free the buffers of the last job
+ */
+/*****************************************************************************/
+static void _hs_cl_release( Hetero_Device *dev )
+{
+    if( dev->buf_a != NULL )
+        clReleaseMemObject( dev->buf_a );
+    if( dev->buf_b != NULL )
+        clReleaseMemObject( dev->buf_b );
+    if( dev->buf_out != NULL )
+        clReleaseMemObject( dev->buf_out );
+    if( dev->buf_part != NULL )
+        clReleaseMemObject( dev->buf_part );
+    dev->buf_a = NULL ;
+    dev->buf_b = NULL ;
+    dev->buf_out = NULL ;
+    dev->buf_part = NULL ;
+    dev->part = (dev->part != NULL) ? free(dev->part), NULL : NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release kernels, program, queue and context
+ */
+/*****************************************************************************/
+static void _hs_cl_close( Hetero_Device *dev )
+{
+    if( dev->k_add != NULL )
+        clReleaseKernel( dev->k_add );
+    if( dev->k_sum != NULL )
+        clReleaseKernel( dev->k_sum );
+    if( dev->prog != NULL )
+        clReleaseProgram( dev->prog );
+    if( dev->queue != NULL )
+        clReleaseCommandQueue( dev->queue );
+    if( dev->ctx != NULL )
+        clReleaseContext( dev->ctx );
+    return ;
+}
+#endif
@@ -0,0 +1,448 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "huge_pages.h"
+#include "mem_track.h"
+
+
+#define HUGE_SHIFT_2M      21
+#define HUGE_SHIFT_1G      30
+#define HUGE_ROUND(x, a)   (((x) + (a) - 1) & ~((a) - 1))
+#define HUGE_MIB(x)        ((unsigned long long)((x) >> 20))
+
+typedef struct __Huge_Map__
+{
+    void *ptr ;
+    uint64_t map_bytes ;
+    uint64_t bytes ;                         /* charged to stage */
+    Huge_Kind kind ;
+    Mem_Stage stage ;
+} Huge_Map ;
+
+static pthread_mutex_t g_huge_lock = PTHREAD_MUTEX_INITIALIZER ;
+static Huge_Map *g_huge_map = NULL ;         /* live buffers, for huge_free() */
+static uint32_t g_no_maps = 0 ;
+static uint32_t g_max_maps = 0 ;
+static Huge_Stats g_huge_stats ;
+static int32_t g_policy = -1 ;               /* -1 : not read from HETERO_HUGEPAGES yet */
+
+static const char *g_kind_name[Huge_MaxKinds] = { "small", "transparent huge", "2 MiB", "1 GiB" } ;
+
+
+static void *_huge_pool( uint64_t, uint64_t, uint32_t, uint64_t * );
+static void *_huge_advised( uint64_t, uint64_t * );
+static api_Err_Status _huge_register( void *, uint64_t, Huge_Kind, uint64_t, Mem_Stage );
+static uint64_t _huge_smaps( void * );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Policy from its name
+ * \param  *name - "off", "thp" or "explicit"
+ * \param  *policy - output policy
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status huge_policy_parse( const char *name, Huge_Policy *policy )
+{
+    static const char *names[Huge_MaxPolicies] = { "off", "thp", "explicit" } ;
+    uint32_t idx_i = 0 ;
+
+    if((name == NULL) || (policy == NULL))
+        return api_Err_Param ;
+    for( idx_i=0 ; idx_i < Huge_MaxPolicies ; idx_i++ ) {
+        if( strcmp( name, names[idx_i] ) == 0 ) {
+            *policy = (Huge_Policy)idx_i ;
+            return api_Success ;
+        }
+    }
+    debug("Unknown huge page policy [%s] : use off, thp or explicit", name);
+    return api_Err_Param ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Set the policy for later allocations
+ * \param  policy - huge page policy
+ * \return none
+ */
+/*****************************************************************************/
+void huge_set_policy( Huge_Policy policy )
+{
+    __atomic_store_n( &g_policy, (int32_t)policy, __ATOMIC_RELAXED );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Current policy, HETERO_HUGEPAGES unless set with huge_set_policy()
+ * \return huge page policy
+ */
+/*****************************************************************************/
+Huge_Policy huge_policy( void )
+{
+    Huge_Policy policy = Huge_Off ;
+    int32_t cur = __atomic_load_n( &g_policy, __ATOMIC_RELAXED );
+    char *env = NULL ;
+
+    if( cur >= 0 )
+        return (Huge_Policy)cur ;
+    env = getenv("HETERO_HUGEPAGES");
+    if((env == NULL) || (huge_policy_parse( env, &policy ) != api_Success))
+        policy = Huge_Off ;
+    __atomic_store_n( &g_policy, (int32_t)policy, __ATOMIC_RELAXED );
+    return policy ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate a buffer under the huge page policy
+ * \param  bytes - size of the buffer
+ * \param  zero - the buffer must be zeroed (mappings always are)
+ * \return the buffer, released with huge_free(). NULL on failure, or when
+ *         it would exceed the memory limit (see mem_track.h)
+ */
+/*****************************************************************************/
+void *huge_alloc( uint64_t bytes, uint32_t zero )
+{
+    Huge_Policy policy = huge_policy();
+    Huge_Kind kind = Huge_Small , wanted = Huge_Small ;
+    Mem_Stage stage = Mem_Other ;
+    uint64_t map_bytes = 0 ;
+    void *p = NULL ;
+
+    if( mem_charge( bytes, &stage ) != api_Success )
+        return NULL ;
+
+    if((policy != Huge_Off) && (bytes >= HUGE_MIN_BYTES)) {
+        wanted = (policy == Huge_Explicit) ? Huge_Pool_2M : Huge_Advised ;
+        if((policy == Huge_Explicit) && (bytes >= HUGE_PAGE_1G)) {
+            p = _huge_pool( bytes, HUGE_PAGE_1G, HUGE_SHIFT_1G, &map_bytes );
+            kind = Huge_Pool_1G ;
+        }
+        if((policy == Huge_Explicit) && (p == NULL)) {
+            p = _huge_pool( bytes, HUGE_PAGE_2M, HUGE_SHIFT_2M, &map_bytes );
+            kind = Huge_Pool_2M ;
+        }
+        if( p == NULL ) {
+            p = _huge_advised( bytes, &map_bytes );
+            kind = Huge_Advised ;
+        }
+        if((p != NULL) && (_huge_register( p, map_bytes, kind, bytes, stage ) != api_Success)) {
+            munmap( p, map_bytes );
+            p = NULL ;
+        }
+    }
+
+    if( p == NULL ) {
+        kind = Huge_Small ;
+        p = zero ? calloc( 1, bytes ) : malloc( bytes );
+        if((p != NULL) && (_huge_register( p, bytes, kind, bytes, stage ) != api_Success))
+            p = (p != NULL) ? free(p), NULL : NULL ;
+        if( p == NULL ) {
+            mem_release( bytes, stage );
+            return NULL ;
+        }
+    }
+
+    pthread_mutex_lock( &g_huge_lock );
+    g_huge_stats.bytes[kind] += bytes ;
+    g_huge_stats.allocs[kind]++ ;
+    g_huge_stats.fallbacks += (kind < wanted) ;
+    pthread_mutex_unlock( &g_huge_lock );
+    if( kind < wanted )
+        log_dbg("%llu MiB : wanted %s pages, got %s pages", HUGE_MIB(bytes), g_kind_name[wanted], g_kind_name[kind]);
+    return p ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release a buffer from huge_alloc(), or from malloc()
+ * \param  *p - buffer, NULL is ignored
+ * \return none
+ */
+/*****************************************************************************/
+void huge_free( void *p )
+{
+    Huge_Map map ;
+    uint32_t idx_i = 0 ;
+
+    if( p == NULL )
+        return ;
+
+    pthread_mutex_lock( &g_huge_lock );
+    for( idx_i=0 ; (idx_i < g_no_maps) && (g_huge_map[idx_i].ptr != p) ; idx_i++ )
+        ;
+    if( idx_i == g_no_maps ) {
+        pthread_mutex_unlock( &g_huge_lock );
+        free( p );
+        return ;
+    }
+    map = g_huge_map[idx_i] ;
+    g_huge_map[idx_i] = g_huge_map[--g_no_maps] ;
+    pthread_mutex_unlock( &g_huge_lock );
+
+    mem_release( map.bytes, map.stage );
+    if( map.kind == Huge_Small )
+        free( map.ptr );
+    else
+        munmap( map.ptr, map.map_bytes );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Log the pages actually backing a buffer, once it has been
+ *         touched. Silent when the policy is off and for small buffers
+ * \param  *what - name of the buffer
+ * \param  *p - buffer from huge_alloc()
+ * \param  bytes - size of the buffer
+ * \return none
+ */
+/*****************************************************************************/
+void huge_report( const char *what, void *p, uint64_t bytes )
+{
+    Huge_Kind kind = Huge_Small ;
+    uint64_t backed = 0 ;
+    uint32_t idx_i = 0 ;
+
+    if((p == NULL) || (bytes < HUGE_MIN_BYTES) || (huge_policy() == Huge_Off))
+        return ;
+
+    pthread_mutex_lock( &g_huge_lock );
+    for( idx_i=0 ; idx_i < g_no_maps ; idx_i++ ) {
+        if( g_huge_map[idx_i].ptr == p ) {
+            kind = g_huge_map[idx_i].kind ;
+            break ;
+        }
+    }
+    pthread_mutex_unlock( &g_huge_lock );
+
+    switch( kind )
+    {
+        case Huge_Advised :
+            backed = _huge_smaps( p );
+            backed = (backed < bytes) ? backed : bytes ;
+            debug("%s : %llu MiB, %llu MiB of it on transparent huge pages", what, HUGE_MIB(bytes), HUGE_MIB(backed));
+            break ;
+        case Huge_Pool_2M :
+        case Huge_Pool_1G :
+            debug("%s : %llu MiB on %s pages", what, HUGE_MIB(bytes), g_kind_name[kind]);
+            break ;
+        default :
+            debug("%s : %llu KiB on small pages", what, (unsigned long long)(bytes >> 10));
+            break ;
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  What the allocations so far obtained
+ * \param  *stats - output counters
+ * \return none
+ */
+/*****************************************************************************/
+void huge_stats( Huge_Stats *stats )
+{
+    if( stats == NULL )
+        return ;
+    pthread_mutex_lock( &g_huge_lock );
+    *stats = g_huge_stats ;
+    pthread_mutex_unlock( &g_huge_lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Log what the allocations obtained, when a policy is set
+ * \return none
+ */
+/*****************************************************************************/
+void huge_summary( void )
+{
+    Huge_Stats hs ;
+
+    if( huge_policy() == Huge_Off )
+        return ;
+    huge_stats( &hs );
+    debug("Huge pages : %llu MiB on 1 GiB pages, %llu MiB on 2 MiB pages, %llu MiB advised for THP, "
+          "%llu MiB small. %llu fallbacks", HUGE_MIB(hs.bytes[Huge_Pool_1G]), HUGE_MIB(hs.bytes[Huge_Pool_2M]),
+          HUGE_MIB(hs.bytes[Huge_Advised]), HUGE_MIB(hs.bytes[Huge_Small]), (unsigned long long)hs.fallbacks);
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Mapping from the reserved huge page pool
+ * \param  bytes - size wanted
+ * \param  page - huge page size
+ * \param  shift - log2 of the page size, for MAP_HUGE_SHIFT
+ * \param  *map_bytes - output size of the mapping
+ * \return the mapping, NULL when the pool cannot hold it
+ */
+/*****************************************************************************/
+static void *_huge_pool( uint64_t bytes, uint64_t page, uint32_t shift, uint64_t *map_bytes )
+{
+    void *p = NULL ;
+
+    *map_bytes = HUGE_ROUND( bytes, page );
+    p = mmap( NULL, *map_bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0 );
+    if( p == MAP_FAILED ) {
+        log_dbg("MAP_HUGETLB of %llu MiB in %llu KiB pages failed. errno = %d", HUGE_MIB(*map_bytes),
+                    (unsigned long long)(page >> 10), errno);
+        return NULL ;
+    }
+    return p ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  2 MiB aligned anonymous mapping advised for transparent huge
+ *         pages. The kernel may still back it with small pages
+ * \param  bytes - size wanted
+ * \param  *map_bytes - output size of the mapping
+ * \return the mapping, NULL on failure
+ */
+/*****************************************************************************/
+static void *_huge_advised( uint64_t bytes, uint64_t *map_bytes )
+{
+    uint8_t *raw = NULL , *p = NULL ;
+    uint64_t len = HUGE_ROUND( bytes, HUGE_PAGE_2M ) , head = 0 ;
+
+    /* over-map by a page and trim to a 2 MiB boundary */
+    raw = mmap( NULL, len + HUGE_PAGE_2M, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( raw == MAP_FAILED ) {
+        log_dbg("Could not map %llu MiB. errno = %d", HUGE_MIB(len), errno);
+        return NULL ;
+    }
+    p = (uint8_t *)HUGE_ROUND((uintptr_t)raw, HUGE_PAGE_2M );
+    head = (uint64_t)(p - raw) ;
+    if( head != 0 )
+        munmap( raw, head );
+    if( HUGE_PAGE_2M - head != 0 )
+        munmap( p + len, HUGE_PAGE_2M - head );
+
+    if( madvise( p, len, MADV_HUGEPAGE ) != 0 )
+        log_dbg("madvise(MADV_HUGEPAGE) failed, transparent huge pages disabled? errno = %d", errno);
+    *map_bytes = len ;
+    return p ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Remember a buffer for huge_free() : how to release it and the
+ *         stage it was charged to
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _huge_register( void *p, uint64_t map_bytes, Huge_Kind kind, uint64_t bytes, Mem_Stage stage )
+{
+    Huge_Map *grown = NULL ;
+    uint32_t max_maps = 0 ;
+
+    pthread_mutex_lock( &g_huge_lock );
+    if( g_no_maps == g_max_maps ) {
+        max_maps = (g_max_maps != 0) ? 2 * g_max_maps : 32 ;
+        grown = realloc( g_huge_map, max_maps * sizeof(Huge_Map));
+        if( grown == NULL ) {
+            pthread_mutex_unlock( &g_huge_lock );
+            return api_Err_Memory ;
+        }
+        g_huge_map = grown ;
+        g_max_maps = max_maps ;
+    }
+    g_huge_map[g_no_maps].ptr = p ;
+    g_huge_map[g_no_maps].map_bytes = map_bytes ;
+    g_huge_map[g_no_maps].bytes = bytes ;
+    g_huge_map[g_no_maps].kind = kind ;
+    g_huge_map[g_no_maps].stage = stage ;
+    g_no_maps++ ;
+    pthread_mutex_unlock( &g_huge_lock );
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Bytes of transparent huge pages in the mapping holding p, from
+ *         /proc/self/smaps. Adjacent anonymous mappings may have been merged
+ *         with it by the kernel
+ * \return bytes on huge pages, 0 when unknown
+ */
+/*****************************************************************************/
+static uint64_t _huge_smaps( void *p )
+{
+    FILE *fp = NULL ;
+    char line[512] ;
+    unsigned long lo = 0 , hi = 0 , kb = 0 ;
+    uint32_t inside = 0 ;
+    uint64_t backed = 0 ;
+
+    fp = fopen( "/proc/self/smaps", "r" );
+    if( fp == NULL )
+        return 0 ;
+    while( fgets( line, sizeof(line), fp ) != NULL ) {
+        if( sscanf( line, "%lx-%lx ", &lo, &hi ) == 2 ) {
+            if( inside )
+                break ;
+            inside = ((uintptr_t)p >= lo) && ((uintptr_t)p < hi) ;
+        } else if( inside && (sscanf( line, "AnonHugePages: %lu kB", &kb ) == 1)) {
+            backed = (uint64_t)kb << 10 ;
+            break ;
+        }
+    }
+    fclose( fp );
+    return backed ;
+}
@@ -0,0 +1,543 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "hash.h"
+#include "huge_pages.h"
+#include "row_index.h"
+#include "lazy_array.h"
+
+
+typedef struct __Lazy_Block__
+{
+    void *buff ;                 /* parsed records, NULL until first asked for */
+    Vector_MetaData meta ;
+    uint64_t bytes ;
+    uint32_t refs ;
+    uint32_t busy ;              /* being parsed by some thread */
+    struct __Lazy_Block__ *prev ;        /* next older resident block */
+    struct __Lazy_Block__ *next ;        /* next newer resident block */
+} Lazy_Block ;
+
+
+struct __Lazy_Array__
+{
+    pthread_mutex_t lock ;
+    pthread_cond_t parsed ;      /* signalled when a block is no longer busy */
+    char *path ;
+    uint8_t *sep ;
+    uint8_t *text ;              /* the file, mapped read-only */
+    uint64_t size ;
+    Row_Index idx ;
+    Vector_MetaData meta ;       /* the whole array */
+    uint64_t rec_items ;         /* values per record */
+    uint32_t strict ;
+    Lazy_Block *block ;          /* one per indexed offset */
+    Lazy_Block *oldest ;         /* resident blocks, least recently used first */
+    Lazy_Block *newest ;
+    uint64_t budget ;
+    Lazy_Stats stats ;
+};
+
+
+static api_Err_Status _lazy_parse( Lazy_Array *, uint64_t, void **, Vector_MetaData * );
+static void _lazy_drop( Lazy_Array *, Lazy_Block * );
+static void _lazy_link( Lazy_Array *, Lazy_Block * );
+static void _lazy_unlink( Lazy_Array *, Lazy_Block * );
+static void _lazy_evict( Lazy_Array *, uint64_t );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Map a file for lazy parsing. Only the row index is read, or built
+ *         when the file has no current one
+ * \param  **la - output handle, released with lazy_close()
+ * \param  *path - file path
+ * \param  *sep - separator list, as for read_data()
+ * \param  *meta - output dimensions of the whole array. meta->type selects
+ *                 the data-type
+ * \param  budget - bytes of parsed values kept once blocks are handed back
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status lazy_open( Lazy_Array **la, char *path, uint8_t *sep, Vector_MetaData *meta, uint64_t budget )
+{
+    api_Err_Status err = api_Success ;
+    Lazy_Array *l = NULL ;
+    Vector_MetaData scratch ;
+    struct stat sb ;
+    uint32_t idx_i = 0 ;
+    int fd = -1 ;
+
+    if((la == NULL) || (path == NULL) || (sep == NULL) || (meta == NULL) || (sizeof_datatype( meta->type ) == 0)) {
+        debug("Invalid params la = %p, path = %p, sep = %p, meta = %p", la, path, sep, meta);
+        err = api_Err_Param ;
+        goto err_lazy_open ;
+    }
+    *la = NULL ;
+    l = calloc( 1, sizeof(Lazy_Array));
+    if( l == NULL ) {
+        debug("Could not allocate lazy array of [%s]", path);
+        err = api_Err_Memory ;
+        goto err_lazy_open ;
+    }
+    pthread_mutex_init( &l->lock, NULL );
+    pthread_cond_init( &l->parsed, NULL );
+    l->budget = budget ;
+    l->strict = parse_strict();
+    l->path = strdup( path );
+    l->sep = (uint8_t *)strdup((char *)sep );
+    if((l->path == NULL) || (l->sep == NULL)) {
+        err = api_Err_Memory ;
+        goto err_lazy_open_mem ;
+    }
+
+    memset( &scratch, 0, sizeof(scratch));
+    scratch.type = meta->type ;
+    err = read_data_index( &l->idx, &scratch, path, sep );
+    if( err != api_Success ) {
+        debug("No row index of [%s] : cannot parse it lazily. err = %d", path, err);
+        goto err_lazy_open_mem ;
+    }
+
+    /* the index is current : the file is as it was indexed */
+    fd = open( path, O_RDONLY | O_CLOEXEC );
+    if((fd < 0) || (fstat( fd, &sb ) != 0) || ((uint64_t)sb.st_size != l->idx.hdr.file_size) || (sb.st_size == 0)) {
+        debug("Could not open [%s] as indexed. errno = %d", path, errno);
+        err = api_Err_File ;
+        goto err_lazy_open_mem ;
+    }
+    l->size = (uint64_t)sb.st_size ;
+    l->text = mmap( NULL, (size_t)l->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if( l->text == MAP_FAILED ) {
+        debug("Could not map [%s]. errno = %d", path, errno);
+        l->text = NULL ;
+        err = api_Err_File ;
+        goto err_lazy_open_mem ;
+    }
+    madvise( l->text, (size_t)l->size, MADV_RANDOM );
+
+    l->meta.type = meta->type ;
+    l->meta.no_dims = l->idx.hdr.no_dims ;
+    memcpy( l->meta.dim.shape, l->idx.hdr.shape, sizeof(l->meta.dim.shape));
+    l->meta.dim.shape[0] = l->idx.hdr.records ;
+    for( idx_i=1, l->rec_items=1 ; idx_i < l->meta.no_dims ; idx_i++ )
+        l->rec_items *= l->meta.dim.shape[idx_i] ;
+
+    l->block = calloc( l->idx.hdr.no_offsets, sizeof(Lazy_Block));
+    if( l->block == NULL ) {
+        debug("Could not allocate %llu blocks", (unsigned long long)l->idx.hdr.no_offsets);
+        err = api_Err_Memory ;
+        goto err_lazy_open_mem ;
+    }
+    close( fd );
+
+    *meta = l->meta ;
+    *la = l ;
+    log_dbg("[%s] : %llu records in %llu blocks, mapped for lazy parsing", path,
+                (unsigned long long)l->idx.hdr.records, (unsigned long long)l->idx.hdr.no_offsets);
+    return err ;
+
+err_lazy_open_mem :
+    if( fd >= 0 )
+        close( fd );
+    lazy_close( &l );
+err_lazy_open :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Borrow a block of records, parsing it on first use
+ * \param  *la - lazy array
+ * \param  block - block number, of ROW_INDEX_STRIDE records
+ * \param  **values - output : values of the block's records, row-major.
+ *                    Valid until lazy_block_put()
+ * \param  *first - output : first record of the block
+ * \param  *records - output : records in the block
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status lazy_block( Lazy_Array *la, uint64_t block, void **values, uint64_t *first, uint64_t *records )
+{
+    api_Err_Status err = api_Success ;
+    Lazy_Block *b = NULL ;
+    Vector_MetaData meta ;
+    void *buff = NULL ;
+
+    if((la == NULL) || (values == NULL) || (first == NULL) || (records == NULL) || (block >= la->idx.hdr.no_offsets)) {
+        debug("Invalid params la = %p, block = %llu, values = %p, first = %p, records = %p",
+                    la, (unsigned long long)block, values, first, records);
+        return api_Err_Param ;
+    }
+
+    pthread_mutex_lock( &la->lock );
+    b = &la->block[block] ;
+    while( b->busy )
+        pthread_cond_wait( &la->parsed, &la->lock );
+    if( b->buff != NULL ) {
+        la->stats.hits++ ;
+        _lazy_unlink( la, b );
+    } else {
+        /* parsed without the lock : other blocks stay available */
+        b->busy = 1 ;
+        la->stats.misses++ ;
+        pthread_mutex_unlock( &la->lock );
+        err = _lazy_parse( la, block, &buff, &meta );
+        pthread_mutex_lock( &la->lock );
+        b->busy = 0 ;
+        if( err == api_Success ) {
+            b->buff = buff ;
+            b->meta = meta ;
+            b->bytes = data_items( &meta ) * sizeof_datatype( meta.type );
+            la->stats.bytes += b->bytes ;
+            la->stats.resident++ ;
+        }
+        pthread_cond_broadcast( &la->parsed );
+    }
+    if( err == api_Success ) {
+        b->refs++ ;
+        _lazy_link( la, b );
+        *values = data_payload( b->buff, &b->meta );
+        *first = block * la->idx.hdr.stride ;
+        *records = b->meta.dim.shape[0] ;
+        _lazy_evict( la, la->budget );
+    }
+    pthread_mutex_unlock( &la->lock );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Hand back a block borrowed with lazy_block()
+ * \param  *la - lazy array
+ * \param  block - block number
+ * \return void
+ */
+/*****************************************************************************/
+void lazy_block_put( Lazy_Array *la, uint64_t block )
+{
+    if((la == NULL) || (block >= la->idx.hdr.no_offsets))
+        return ;
+
+    pthread_mutex_lock( &la->lock );
+    if( la->block[block].refs != 0 )
+        la->block[block].refs-- ;
+    _lazy_evict( la, la->budget );
+    pthread_mutex_unlock( &la->lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Copy a range of records into a new array, parsing only the blocks
+ *         it covers. As read_data_range(), over the mapped file
+ * \param  *la - lazy array
+ * \param  first - first record
+ * \param  count - records to copy, 0 : to the end. Clamped to the end
+ * \param  **out - output array, released with clean_data()
+ * \param  *meta - output dimensions, shape[0] = records copied
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status lazy_read_range( Lazy_Array *la, uint64_t first, uint64_t count, void **out, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    uint8_t *dst = NULL , *src = NULL ;
+    uint64_t rec_bytes = 0 , block = 0 , b_first = 0 , b_count = 0 , lo = 0 , hi = 0 ;
+    void *values = NULL ;
+
+    if((la == NULL) || (out == NULL) || (*out != NULL) || (meta == NULL)) {
+        debug("Invalid params la = %p, out = %p, meta = %p", la, out, meta);
+        return api_Err_Param ;
+    }
+    if( first >= la->idx.hdr.records ) {
+        log_error("[%s] has %llu records, cannot load from record %llu", la->path,
+                    (unsigned long long)la->idx.hdr.records, (unsigned long long)first);
+        return api_Err_Param ;
+    }
+    count = ((count == 0) || (count > la->idx.hdr.records - first)) ? la->idx.hdr.records - first : count ;
+
+    *meta = la->meta ;
+    meta->dim.shape[0] = count ;
+    err = alloc_data( out, meta );
+    if( err != api_Success )
+        return err ;
+    dst = data_payload( *out, meta );
+    rec_bytes = la->rec_items * sizeof_datatype( meta->type );
+
+    for( block = first / la->idx.hdr.stride ; block <= (first + count - 1) / la->idx.hdr.stride ; block++ ) {
+        err = lazy_block( la, block, &values, &b_first, &b_count );
+        if( err != api_Success ) {
+            debug("Could not parse block %llu of [%s]. err = %d", (unsigned long long)block, la->path, err);
+            clean_data( out, meta );
+            return err ;
+        }
+        lo = (first > b_first) ? first : b_first ;
+        hi = ((first + count) < (b_first + b_count)) ? (first + count) : (b_first + b_count) ;
+        src = (uint8_t *)values + (lo - b_first) * rec_bytes ;
+        memcpy( dst + (lo - first) * rec_bytes, src, (size_t)((hi - lo) * rec_bytes));
+        lazy_block_put( la, block );
+    }
+    meta->data_hash = hash_bytes( dst, count * rec_bytes );
+    debug("[%s] : records %llu to %llu from blocks %llu to %llu", la->path, (unsigned long long)first,
+                (unsigned long long)(first + count - 1), (unsigned long long)(first / la->idx.hdr.stride),
+                (unsigned long long)((first + count - 1) / la->idx.hdr.stride));
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Drop unreferenced blocks, least recently used first, until at most
+ *         bytes of parsed values are held
+ * \param  *la - lazy array
+ * \param  bytes - parsed values to keep at most
+ * \return bytes of parsed values still held
+ */
+/*****************************************************************************/
+uint64_t lazy_trim( Lazy_Array *la, uint64_t bytes )
+{
+    uint64_t held = 0 ;
+
+    if( la == NULL )
+        return 0 ;
+    pthread_mutex_lock( &la->lock );
+    _lazy_evict( la, bytes );
+    held = la->stats.bytes ;
+    pthread_mutex_unlock( &la->lock );
+    return held ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Whether the file is still as it was mapped : same size and
+ *         modification time as when it was indexed
+ * \param  *la - lazy array
+ * \return 1 when current, 0 otherwise
+ */
+/*****************************************************************************/
+uint32_t lazy_current( Lazy_Array *la )
+{
+    struct stat sb ;
+
+    if((la == NULL) || (stat( la->path, &sb ) != 0))
+        return 0 ;
+    return ((uint64_t)sb.st_size == la->idx.hdr.file_size) &&
+           ((int64_t)sb.st_mtim.tv_sec == la->idx.hdr.mtime_sec) &&
+           ((int64_t)sb.st_mtim.tv_nsec == la->idx.hdr.mtime_nsec) ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Counters of a lazy array
+ * \param  *la - lazy array
+ * \param  *stats - output counters
+ * \return void
+ */
+/*****************************************************************************/
+void lazy_stats( Lazy_Array *la, Lazy_Stats *stats )
+{
+    if((la == NULL) || (stats == NULL))
+        return ;
+    pthread_mutex_lock( &la->lock );
+    *stats = la->stats ;
+    pthread_mutex_unlock( &la->lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Unmap a file and release its parsed blocks. No block may be
+ *         borrowed any more
+ * \param  **la - lazy array, set to NULL on return
+ * \return void
+ */
+/*****************************************************************************/
+void lazy_close( Lazy_Array **la )
+{
+    uint64_t idx_i = 0 ;
+
+    if((la == NULL) || (*la == NULL))
+        return ;
+
+    if((*la)->block != NULL ) {
+        for( idx_i=0 ; idx_i < (*la)->idx.hdr.no_offsets ; idx_i++ )
+            _lazy_drop( *la, &(*la)->block[idx_i] );
+        free( (*la)->block );
+    }
+    if((*la)->text != NULL )
+        munmap( (*la)->text, (size_t)(*la)->size );
+    row_index_free( &(*la)->idx );
+    (*la)->path = ((*la)->path != NULL) ? free((*la)->path), NULL : NULL ;
+    (*la)->sep = ((*la)->sep != NULL) ? free((*la)->sep), NULL : NULL ;
+    pthread_cond_destroy( &(*la)->parsed );
+    pthread_mutex_destroy( &(*la)->lock );
+    free( *la );
+    *la = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Parse one block from the mapped text. The records are copied out
+ *         first : parsing writes into its text
+ */
+/*****************************************************************************/
+static api_Err_Status _lazy_parse( Lazy_Array *la, uint64_t block, void **buff, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t from = 0 , to = 0 , first = block * la->idx.hdr.stride ;
+    uint8_t *text = NULL ;
+
+    from = la->idx.offset[block] ;
+    to = (block + 1 < la->idx.hdr.no_offsets) ? la->idx.offset[block + 1] : la->idx.hdr.file_size ;
+    text = huge_alloc( to - from + 1, 0 );
+    if( text == NULL ) {
+        debug("Could not alloc(%llu) bytes for block %llu of [%s]", (unsigned long long)(to - from + 1),
+                    (unsigned long long)block, la->path);
+        return api_Err_Memory ;
+    }
+    memcpy( text, la->text + from, (size_t)(to - from));
+    text[to - from] = '\0' ;
+
+    *meta = la->meta ;
+    meta->dim.shape[0] = ((la->idx.hdr.records - first) < la->idx.hdr.stride) ? (la->idx.hdr.records - first) : la->idx.hdr.stride ;
+    *buff = NULL ;
+    err = parse_records( buff, meta, text, la->sep, la->path, from, la->strict );
+    huge_free( text );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Free the values of a block. Called with the lock held
+ */
+/*****************************************************************************/
+static void _lazy_drop( Lazy_Array *la, Lazy_Block *b )
+{
+    if( b->buff == NULL )
+        return ;
+    _lazy_unlink( la, b );
+    clean_data( &b->buff, &b->meta );
+    b->buff = NULL ;
+    la->stats.bytes -= b->bytes ;
+    la->stats.resident-- ;
+    b->bytes = 0 ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Make a resident block the most recently used. Called with the
+ *         lock held
+ */
+/*****************************************************************************/
+static void _lazy_link( Lazy_Array *la, Lazy_Block *b )
+{
+    b->prev = la->newest ;
+    b->next = NULL ;
+    if( la->newest != NULL )
+        la->newest->next = b ;
+    else
+        la->oldest = b ;
+    la->newest = b ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Take a resident block off the LRU list. Called with the lock held
+ */
+/*****************************************************************************/
+static void _lazy_unlink( Lazy_Array *la, Lazy_Block *b )
+{
+    if( b->prev != NULL )
+        b->prev->next = b->next ;
+    else
+        la->oldest = b->next ;
+    if( b->next != NULL )
+        b->next->prev = b->prev ;
+    else
+        la->newest = b->prev ;
+    b->prev = NULL ;
+    b->next = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Drop unreferenced blocks, least recently used first, until the
+ *         array holds at most bytes. Only resident blocks are visited.
+ *         Called with the lock held
+ */
+/*****************************************************************************/
+static void _lazy_evict( Lazy_Array *la, uint64_t bytes )
+{
+    Lazy_Block *b = NULL , *newer = NULL ;
+
+    for( b = la->oldest ; (b != NULL) && (la->stats.bytes > bytes) ; b = newer ) {
+        newer = b->next ;
+        if( b->refs != 0 )
+            continue ;                                /* borrowed */
+        _lazy_drop( la, b );
+        la->stats.evictions++ ;
+    }
+    return ;
+}
@@ -0,0 +1,434 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "debug.h"
+
+
+#define LOG_RING_SIZE     256        /* records per thread, power of 2 */
+#define LOG_TEXT_SIZE     480
+#define LOG_IDLE_MS       50         /* drain thread wakes at least this often */
+#define LOG_FULL_SPINS    10000      /* yields while a ring is full before dropping */
+
+
+typedef struct __Log_Record__
+{
+    uint64_t seq ;                   /* global order of the messages */
+    const char *func ;
+    int line ;
+    int level ;
+    char text[LOG_TEXT_SIZE] ;
+} Log_Record ;
+
+
+/*!
+ * Single producer (the owning thread), single consumer (whoever holds
+ * g_log.drain). head and tail only grow; slot = index % LOG_RING_SIZE.
+ * dead is set when the owner exits; the drain thread frees the ring once
+ * it is empty
+ */
+typedef struct __Log_Ring__
+{
+    uint64_t head ;
+    uint64_t tail ;
+    uint32_t dead ;
+    struct __Log_Ring__ *next ;
+    Log_Record rec[LOG_RING_SIZE] ;
+} Log_Ring ;
+
+
+typedef struct __Log_State__
+{
+    pthread_mutex_t lock ;           /* ring list, thread start/stop */
+    pthread_mutex_t drain ;          /* one consumer at a time */
+    pthread_cond_t wake ;
+    pthread_t thread ;
+    pthread_key_t key ;              /* destructor marks the ring dead */
+    Log_Ring *rings ;
+    uint64_t seq ;
+    uint64_t dropped ;
+    uint32_t dead ;                  /* rings marked dead, not yet freed */
+    uint32_t sleeping ;
+    uint32_t running ;               /* drain thread started */
+    uint32_t stop ;
+    uint32_t sync ;                  /* HETERO_LOG_SYNC : no ring, no thread */
+} Log_State ;
+
+
+int g_log_level = DEFAULT_LOG_LEVEL ;
+
+static Log_State g_log = {
+    .lock  = PTHREAD_MUTEX_INITIALIZER ,
+    .drain = PTHREAD_MUTEX_INITIALIZER ,
+    .wake  = PTHREAD_COND_INITIALIZER ,
+};
+
+static __thread Log_Ring *t_log_ring = NULL ;
+
+
+static Log_Ring *_log_ring( void );
+static uint32_t _log_drain( void );
+static void _log_reap( void );
+static void _log_ring_exit( void * );
+static void *_log_thread( void * );
+static void _log_print( const char *, int, const char * );
+static void _log_init( void ) __attribute__((constructor)) ;
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Queue one message. Called through the log_*() / debug() macros
+ * \param  level - Debug_Level of the message
+ * \param  *func - calling function
+ * \param  line - calling line
+ * \param  *format - printf format
+ * \return void
+ */
+/*****************************************************************************/
+void log_write( int level, const char *func, int line, const char *format, ... )
+{
+    Log_Ring *ring = NULL ;
+    Log_Record *rec = NULL ;
+    uint32_t spins = 0 ;
+    char text[LOG_TEXT_SIZE] ;
+    va_list ap ;
+
+    ring = (g_log.sync || (level >= err_level_fatal)) ? NULL : _log_ring() ;
+    if( ring == NULL ) {
+        /* synchronous : after whatever is queued */
+        va_start( ap, format );
+        vsnprintf( text, sizeof(text), format, ap );
+        va_end( ap );
+        log_flush();
+        _log_print( func, line, text );
+        fflush( stdout );
+        return ;
+    }
+
+    while( ring->head - __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE ) == LOG_RING_SIZE ) {
+        /* never block for good : the consumer may be waiting on us for stdout */
+        if( ++spins == LOG_FULL_SPINS ) {
+            __atomic_fetch_add( &g_log.dropped, 1, __ATOMIC_RELAXED );
+            return ;
+        }
+        pthread_cond_signal( &g_log.wake );
+        sched_yield();
+    }
+
+    rec = &ring->rec[ring->head % LOG_RING_SIZE] ;
+    rec->seq = __atomic_fetch_add( &g_log.seq, 1, __ATOMIC_RELAXED );
+    rec->func = func ;
+    rec->line = line ;
+    rec->level = level ;
+    va_start( ap, format );
+    vsnprintf( rec->text, sizeof(rec->text), format, ap );
+    va_end( ap );
+    __atomic_store_n( &ring->head, ring->head + 1, __ATOMIC_RELEASE );
+
+    if( __atomic_load_n( &g_log.sleeping, __ATOMIC_ACQUIRE ))
+        pthread_cond_signal( &g_log.wake );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Write every message queued so far, from the calling thread. The
+ *         caller must not hold the stdout lock
+ * \return void
+ */
+/*****************************************************************************/
+void log_flush( void )
+{
+    pthread_mutex_lock( &g_log.drain );
+    _log_drain();
+    pthread_mutex_unlock( &g_log.drain );
+    fflush( stdout );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Stop the drain thread and write what is left. Registered with
+ *         atexit() when the thread starts; later messages are synchronous
+ * \return void
+ */
+/*****************************************************************************/
+void log_shutdown( void )
+{
+    uint64_t dropped = 0 ;
+
+    pthread_mutex_lock( &g_log.lock );
+    if( g_log.running ) {
+        g_log.stop = 1 ;
+        pthread_cond_signal( &g_log.wake );
+        pthread_mutex_unlock( &g_log.lock );
+        pthread_join( g_log.thread, NULL );
+        pthread_mutex_lock( &g_log.lock );
+        g_log.running = 0 ;
+    }
+    log_flush();
+    g_log.sync = 1 ;
+    pthread_mutex_unlock( &g_log.lock );
+
+    dropped = __atomic_load_n( &g_log.dropped, __ATOMIC_RELAXED );
+    if( dropped != 0 ) {
+        printf("[%s:%d] | %llu log messages dropped on full rings\n", __FUNCTION__, __LINE__, (unsigned long long)dropped);
+        fflush( stdout );
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Ring of the calling thread, created and registered on first use.
+ *         Starts the drain thread with the first ring
+ * \return ring, NULL to log synchronously
+ */
+/*****************************************************************************/
+static Log_Ring *_log_ring( void )
+{
+    Log_Ring *ring = t_log_ring ;
+
+    if( ring != NULL )
+        return ring ;
+
+    ring = calloc( 1, sizeof(Log_Ring));
+    if( ring == NULL )
+        return NULL ;
+
+    pthread_mutex_lock( &g_log.lock );
+    if( g_log.sync ) {
+        pthread_mutex_unlock( &g_log.lock );
+        free( ring );
+        return NULL ;
+    }
+    if( !g_log.running ) {
+        if( pthread_key_create( &g_log.key, _log_ring_exit ) != 0 ) {
+            g_log.sync = 1 ;
+            pthread_mutex_unlock( &g_log.lock );
+            free( ring );
+            return NULL ;
+        }
+        if( pthread_create( &g_log.thread, NULL, _log_thread, NULL ) != 0 ) {
+            pthread_key_delete( g_log.key );
+            g_log.sync = 1 ;
+            pthread_mutex_unlock( &g_log.lock );
+            free( ring );
+            return NULL ;
+        }
+        g_log.running = 1 ;
+        atexit( log_shutdown );
+    }
+    ring->next = g_log.rings ;
+    __atomic_store_n( &g_log.rings, ring, __ATOMIC_RELEASE );
+    pthread_setspecific( g_log.key, ring );
+    pthread_mutex_unlock( &g_log.lock );
+
+    t_log_ring = ring ;
+    return ring ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Thread exit : hand the ring over to the drain thread. Messages
+ *         logged by later destructors get a new ring
+ * \param  *arg - ring of the exiting thread
+ * \return void
+ */
+/*****************************************************************************/
+static void _log_ring_exit( void *arg )
+{
+    Log_Ring *ring = arg ;
+
+    t_log_ring = NULL ;
+    __atomic_store_n( &ring->dead, 1, __ATOMIC_RELEASE );
+    __atomic_fetch_add( &g_log.dead, 1, __ATOMIC_RELEASE );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Unlink and free the rings of exited threads that are empty.
+ *         Called with g_log.lock then g_log.drain held : no producer is
+ *         adding a ring and no consumer is walking the list
+ * \return void
+ */
+/*****************************************************************************/
+static void _log_reap( void )
+{
+    Log_Ring **link = &g_log.rings , *ring = NULL ;
+
+    while((ring = *link) != NULL ) {
+        if( __atomic_load_n( &ring->dead, __ATOMIC_ACQUIRE ) &&
+            (__atomic_load_n( &ring->head, __ATOMIC_ACQUIRE ) == ring->tail)) {
+            __atomic_store_n( link, ring->next, __ATOMIC_RELEASE );
+            __atomic_fetch_sub( &g_log.dead, 1, __ATOMIC_RELAXED );
+            free( ring );
+            continue ;
+        }
+        link = &ring->next ;
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Write queued messages of all rings in sequence order. Called
+ *         with g_log.drain held
+ * \return number of messages written
+ */
+/*****************************************************************************/
+static uint32_t _log_drain( void )
+{
+    Log_Ring *ring = NULL , *first = NULL ;
+    Log_Record *rec = NULL , *oldest = NULL ;
+    uint32_t written = 0 ;
+
+    flockfile( stdout );
+    for( ;; ) {
+        first = NULL ;
+        oldest = NULL ;
+        for( ring=__atomic_load_n( &g_log.rings, __ATOMIC_ACQUIRE ) ; ring != NULL ; ring=ring->next ) {
+            if( __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE ) == ring->tail )
+                continue ;
+            rec = &ring->rec[ring->tail % LOG_RING_SIZE] ;
+            if((oldest == NULL) || (rec->seq < oldest->seq)) {
+                oldest = rec ;
+                first = ring ;
+            }
+        }
+        if( first == NULL )
+            break ;
+        _log_print( oldest->func, oldest->line, oldest->text );
+        __atomic_store_n( &first->tail, first->tail + 1, __ATOMIC_RELEASE );
+        written++ ;
+    }
+    funlockfile( stdout );
+    return written ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Drain thread : write messages as they arrive, sleep when idle
+ */
+/*****************************************************************************/
+static void *_log_thread( void *arg )
+{
+    struct timespec until ;
+
+    (void)arg ;
+    for( ;; ) {
+        pthread_mutex_lock( &g_log.drain );
+        _log_drain();
+        pthread_mutex_unlock( &g_log.drain );
+        fflush( stdout );
+
+        pthread_mutex_lock( &g_log.lock );
+        if( g_log.stop ) {
+            pthread_mutex_unlock( &g_log.lock );
+            break ;
+        }
+        if( __atomic_load_n( &g_log.dead, __ATOMIC_ACQUIRE ) != 0 ) {
+            /* same order as log_shutdown() : lock, then drain */
+            pthread_mutex_lock( &g_log.drain );
+            _log_drain();
+            _log_reap();
+            pthread_mutex_unlock( &g_log.drain );
+        }
+        /* producers only signal a sleeping thread; the timeout covers a
+           message queued between the last drain and sleeping = 1 */
+        __atomic_store_n( &g_log.sleeping, 1, __ATOMIC_RELEASE );
+        clock_gettime( CLOCK_REALTIME, &until );
+        until.tv_nsec += LOG_IDLE_MS * 1000000L ;
+        until.tv_sec += until.tv_nsec / 1000000000L ;
+        until.tv_nsec %= 1000000000L ;
+        pthread_cond_timedwait( &g_log.wake, &g_log.lock, &until );
+        __atomic_store_n( &g_log.sleeping, 0, __ATOMIC_RELEASE );
+        pthread_mutex_unlock( &g_log.lock );
+    }
+    return NULL ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Format of every message
+ */
+/*****************************************************************************/
+static void _log_print( const char *func, int line, const char *text )
+{
+    printf("[%s:%d] | %s\n", func, line, text );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Runtime level and mode from the environment, before main()
+ */
+/*****************************************************************************/
+static void _log_init( void )
+{
+    static const char *names[err_level_Max] = {
+        "dbg", "info", "warn", "error", "critical", "fatal", "off"
+    } ;
+    char *env = NULL ;
+    int level = 0 ;
+
+    env = getenv("HETERO_LOG_LEVEL");
+    for( level=0 ; (env != NULL) && (level < err_level_Max) ; level++ ) {
+        if( strcasecmp( env, names[level] ) == 0 ) {
+            g_log_level = level ;
+            break ;
+        }
+    }
+    env = getenv("HETERO_LOG_SYNC");
+    g_log.sync = ((env != NULL) && (strcmp( env, "1" ) == 0)) ;
+    return ;
+}
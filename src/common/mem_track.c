@@ -0,0 +1,309 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "mem_track.h"
+
+
+#define MEM_MIB(x)         ((double)(x) / (double)(1ULL << 20))
+
+static pthread_mutex_t g_mem_lock = PTHREAD_MUTEX_INITIALIZER ;
+static Mem_Stats g_mem_stage[Mem_MaxStages] ;
+static Mem_Stats g_mem_total ;
+static int64_t g_mem_limit = -1 ;           /* -1 : not read from HETERO_MEM_LIMIT yet, 0 : none */
+static __thread int32_t t_mem_stage = Mem_Other ;
+
+static const char *g_mem_stage_names[Mem_MaxStages] =
+{
+    [Mem_Read]    = "read",
+    [Mem_Detect]  = "detect",
+    [Mem_Alloc]   = "alloc",
+    [Mem_Parse]   = "parse",
+    [Mem_Compute] = "compute",
+    [Mem_Write]   = "write",
+    [Mem_Other]   = "other",
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Charge the allocations of the calling thread to a stage
+ * \param  stage - stage entered
+ * \return the stage left, to restore with mem_stage_set()
+ */
+/*****************************************************************************/
+Mem_Stage mem_stage_set( Mem_Stage stage )
+{
+    Mem_Stage prev = (Mem_Stage)t_mem_stage ;
+
+    t_mem_stage = (stage < Mem_MaxStages) ? (int32_t)stage : Mem_Other ;
+    return prev ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Stage of the calling thread
+ */
+/*****************************************************************************/
+Mem_Stage mem_stage( void )
+{
+    return (Mem_Stage)t_mem_stage ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Account for a buffer about to be allocated by the calling thread
+ * \param  bytes - size of the buffer
+ * \param  *stage - output stage charged, to pass to mem_release()
+ * \return api_Err_Memory when the buffer would take the process past the
+ *         limit (nothing is charged), api_Success otherwise
+ */
+/*****************************************************************************/
+api_Err_Status mem_charge( uint64_t bytes, Mem_Stage *stage )
+{
+    uint64_t limit = mem_limit();
+    Mem_Stats *s = NULL ;
+
+    *stage = (Mem_Stage)t_mem_stage ;
+    s = &g_mem_stage[*stage] ;
+
+    pthread_mutex_lock( &g_mem_lock );
+    if((limit != 0) && (g_mem_total.live + bytes > limit)) {
+        pthread_mutex_unlock( &g_mem_lock );
+        log_warn("%.2f MiB in %s would exceed the memory limit : %.2f of %.2f MiB in use", MEM_MIB(bytes),
+                    g_mem_stage_names[*stage], MEM_MIB(g_mem_total.live), MEM_MIB(limit));
+        return api_Err_Memory ;
+    }
+    g_mem_total.allocs++ ;
+    g_mem_total.bytes += bytes ;
+    g_mem_total.live += bytes ;
+    g_mem_total.peak = (g_mem_total.live > g_mem_total.peak) ? g_mem_total.live : g_mem_total.peak ;
+    g_mem_total.total_peak = g_mem_total.peak ;
+
+    s->allocs++ ;
+    s->bytes += bytes ;
+    s->live += bytes ;
+    s->peak = (s->live > s->peak) ? s->live : s->peak ;
+    s->total_peak = (g_mem_total.live > s->total_peak) ? g_mem_total.live : s->total_peak ;
+    pthread_mutex_unlock( &g_mem_lock );
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Account for a buffer released, in any thread
+ * \param  bytes - size the buffer was charged with
+ * \param  stage - stage it was charged to
+ * \return none
+ */
+/*****************************************************************************/
+void mem_release( uint64_t bytes, Mem_Stage stage )
+{
+    Mem_Stats *s = &g_mem_stage[(stage < Mem_MaxStages) ? stage : Mem_Other] ;
+
+    pthread_mutex_lock( &g_mem_lock );
+    g_mem_total.frees++ ;
+    g_mem_total.live -= (bytes < g_mem_total.live) ? bytes : g_mem_total.live ;
+    s->frees++ ;
+    s->live -= (bytes < s->live) ? bytes : s->live ;
+    pthread_mutex_unlock( &g_mem_lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Size from text : bytes with an optional K, M, G or T (binary)
+ *         suffix, e.g. "512M"
+ * \param  *str - text
+ * \param  *bytes - output size
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status mem_size_parse( const char *str, uint64_t *bytes )
+{
+    unsigned long long v = 0 ;
+    char *end = NULL ;
+    uint32_t shift = 0 ;
+
+    if((str == NULL) || (bytes == NULL))
+        return api_Err_Param ;
+
+    errno = 0 ;
+    v = strtoull( str, &end, 0 );
+    switch( *end )
+    {
+        case 'k' : case 'K' : shift = 10 ; end++ ; break ;
+        case 'm' : case 'M' : shift = 20 ; end++ ; break ;
+        case 'g' : case 'G' : shift = 30 ; end++ ; break ;
+        case 't' : case 'T' : shift = 40 ; end++ ; break ;
+        default  : break ;
+    }
+    if((end == str) || (*end != '\0') || (errno == ERANGE) || (str[0] == '-') || ((v << shift) >> shift != v)) {
+        debug("Invalid size [%s] : use bytes, or a number with a K, M, G or T suffix", str);
+        return api_Err_Param ;
+    }
+    *bytes = (uint64_t)v << shift ;
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Set the limit for later allocations
+ * \param  bytes - limit, 0 for none
+ * \return none
+ */
+/*****************************************************************************/
+void mem_set_limit( uint64_t bytes )
+{
+    __atomic_store_n( &g_mem_limit, (int64_t)(bytes & INT64_MAX), __ATOMIC_RELAXED );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Current limit, HETERO_MEM_LIMIT unless set with mem_set_limit()
+ * \return limit in bytes, 0 for none
+ */
+/*****************************************************************************/
+uint64_t mem_limit( void )
+{
+    int64_t cur = __atomic_load_n( &g_mem_limit, __ATOMIC_RELAXED );
+    uint64_t bytes = 0 ;
+    char *env = NULL ;
+
+    if( cur >= 0 )
+        return (uint64_t)cur ;
+    env = getenv("HETERO_MEM_LIMIT");
+    if((env == NULL) || (mem_size_parse( env, &bytes ) != api_Success))
+        bytes = 0 ;
+    mem_set_limit( bytes );
+    return bytes ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Bytes that can still be allocated under the limit
+ * \return bytes, UINT64_MAX when there is no limit
+ */
+/*****************************************************************************/
+uint64_t mem_headroom( void )
+{
+    uint64_t limit = mem_limit() , live = mem_current();
+
+    if( limit == 0 )
+        return UINT64_MAX ;
+    return (live < limit) ? limit - live : 0 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Bytes allocated and not released, over all stages
+ */
+/*****************************************************************************/
+uint64_t mem_current( void )
+{
+    uint64_t live = 0 ;
+
+    pthread_mutex_lock( &g_mem_lock );
+    live = g_mem_total.live ;
+    pthread_mutex_unlock( &g_mem_lock );
+    return live ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Accounting so far
+ * \param  *stage - output, Mem_MaxStages entries. NULL to skip
+ * \param  *total - output, over all stages. NULL to skip
+ * \return none
+ */
+/*****************************************************************************/
+void mem_stats( Mem_Stats *stage, Mem_Stats *total )
+{
+    pthread_mutex_lock( &g_mem_lock );
+    if( stage != NULL )
+        memcpy( stage, g_mem_stage, sizeof(g_mem_stage));
+    if( total != NULL )
+        *total = g_mem_total ;
+    pthread_mutex_unlock( &g_mem_lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Print the accounting of every stage that allocated, and the
+ *         process-wide peak against the limit
+ * \return none
+ */
+/*****************************************************************************/
+void mem_report( void )
+{
+    Mem_Stats stage[Mem_MaxStages] , total ;
+    uint64_t limit = mem_limit();
+    uint32_t idx_i = 0 ;
+
+    mem_stats( stage, &total );
+    debug("%-18s %8s %8s %12s %12s %12s %14s", "memory stage", "allocs", "frees", "alloc MiB",
+                "live MiB", "peak MiB", "process MiB");
+    for( idx_i=0 ; idx_i < Mem_MaxStages ; idx_i++ ) {
+        if( stage[idx_i].allocs == 0 )
+            continue ;
+        debug("%-18s %8llu %8llu %12.2f %12.2f %12.2f %14.2f", g_mem_stage_names[idx_i],
+                    (unsigned long long)stage[idx_i].allocs, (unsigned long long)stage[idx_i].frees,
+                    MEM_MIB(stage[idx_i].bytes), MEM_MIB(stage[idx_i].live), MEM_MIB(stage[idx_i].peak),
+                    MEM_MIB(stage[idx_i].total_peak));
+    }
+    if( limit != 0 )
+        debug("Memory : peak %.2f MiB of a %.2f MiB limit, %llu buffers", MEM_MIB(total.peak), MEM_MIB(limit),
+                    (unsigned long long)total.allocs);
+    else
+        debug("Memory : peak %.2f MiB, %llu buffers", MEM_MIB(total.peak), (unsigned long long)total.allocs);
+    return ;
+}
@@ -29,32 +29,132 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
+#include <ctype.h>
 #include <limits.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
 
 #include "debug.h"
 #include "api_err.h"
 #include "datatype.h"
+#include "tune_db.h"
+#include "perf_counters.h"
+#include "half.h"
+#include "decompress.h"
+#include "hash.h"
+#include "simd.h"
+#include "huge_pages.h"
+#include "mem_track.h"
+#include "row_index.h"
+
+/*!
+ * Strict conversion : tokens are converted to a wide type into a block,
+ * then the block is range-checked and narrowed by branch-free loops. Flags
+ * are only inspected once per block; the first bad token is located, and
+ * its line and column worked out, only when a block fails.
+ */
+#define STRICT_BLOCK    1024
+
+typedef enum __Strict_Fault__
+{
+    Strict_None     =  0 ,
+    Strict_Syntax        ,       /* not a number, or trailing characters */
+    Strict_Range         ,       /* does not fit the data-type */
+    Strict_Extent        ,       /* beyond the detected dimensions */
+} Strict_Fault ;
+
+typedef struct __Strict_Block__
+{
+    Vector_MetaData *meta ;
+    void *buff ;                 /* values of the array */
+    uint8_t *base ;              /* start of the text : token offsets */
+    uint64_t first ;             /* index of the first value held */
+    uint32_t count ;
+    union {
+        int64_t s[STRICT_BLOCK] ;
+        uint64_t u[STRICT_BLOCK] ;
+        double d[STRICT_BLOCK] ;
+    } wide ;
+    uint8_t bad[STRICT_BLOCK] ;  /* syntax flag of each token */
+    uint8_t *tok[STRICT_BLOCK] ;
+    uint64_t fault_offset ;      /* first bad token, from base */
+    Strict_Fault fault ;
+} Strict_Block ;
+
+static __thread int32_t t_strict = -1 ;   /* parse_set_strict(), -1 : HETERO_STRICT */
+
+
+/*!
+ * Text streamed from a private mapping of the file, when a memory limit is
+ * set (see mem_track.h). Detection only reads the mapping; parsing dirties
+ * the pages it writes terminators into, and the pages behind the parse are
+ * dropped once window bytes are dirty, so the text never costs more than
+ * the window on top of the values.
+ */
+#define TEXT_WINDOW_MIN     (1ULL << 20)
+#define TEXT_WINDOW_SLACK   4            /* pages dirtied ahead of the parse : row / plane ends */
+
+typedef struct __Text_Window__
+{
+    uint8_t *base ;              /* start of the mapping, NULL : text in a buffer */
+    uint64_t size ;              /* bytes of text */
+    uint64_t map_bytes ;
+    uint64_t page ;
+    uint8_t *done ;              /* pages below here were dropped */
+    uint64_t window ;            /* dirty bytes allowed past done */
+    uint64_t charged ;           /* bytes charged for the window */
+    Mem_Stage stage ;
+} Text_Window ;
+
+#define TEXT_WINDOW_SLIDE(win, pos)  do { if(((win) != NULL) && ((pos) >= (win)->done + (win)->window)) \
+                                              _window_drop( win, pos ); } while(0)
+
+/*!
+ * State shared by the levels of _parse_axis() : one strtok_r() position
+ * per axis, separators indexed by axis (outermost first)
+ */
+typedef struct {
+    Vector_MetaData *meta ;
+    void *values ;
+    Strict_Block *strict ;
+    Text_Window *win ;
+    char sep[DATA_MAX_DIMS][2] ;
+    char *save[DATA_MAX_DIMS] ;
+} Parse_Ctx ;
+
 
 /*!
  * Internal Utility function declarations
  */
-static api_Err_Status _read_file( uint8_t **, Vector_MetaData *,  char *, char *);
-static api_Err_Status _alloc_ND_mem( void **, Vector_MetaData *, uint32_t, uint64_t );
-static void  _dealloc_ND_mem( void **, Vector_MetaData *, uint32_t );
+static api_Err_Status _read_file( uint8_t **, uint64_t *, Vector_MetaData *,  char *, char *, Text_Window * );
+static void _index_text( uint8_t *, uint64_t, Vector_MetaData *, char *, uint8_t * );
+static uint8_t *_skip_records( uint8_t *, uint8_t *, uint8_t, uint64_t );
+static api_Err_Status _read_text( uint8_t **, uint64_t *, char *, uint64_t * );
+static api_Err_Status _map_text( uint8_t **, uint64_t *, char *, uint64_t *, Text_Window * );
+static api_Err_Status _window_plan( Text_Window *, Vector_MetaData *, uint32_t, char * );
+static void _window_drop( Text_Window *, uint8_t * );
+static void _text_release( uint8_t **, Text_Window * );
+static uint64_t _ND_bytes( Vector_MetaData *, uint32_t );
+static uint64_t _count_tokens( const uint8_t *, const uint8_t *, uint8_t );
+static api_Err_Status _alloc_ND_mem( void **, Vector_MetaData *, uint32_t, uint64_t, void * );
+static void  _dealloc_ND_mem( void **, Vector_MetaData *, uint32_t, uint32_t );
 static api_Err_Status _convert_to_number( uint8_t *, Vector_MetaData *, void *, uint64_t );
 
-static inline uint32_t _1D_sizeof_dim( Vector_MetaData *);
-static inline uint32_t _2D_sizeof_dim( Vector_MetaData *, uint32_t );
-static inline uint32_t _3D_sizeof_dim( Vector_MetaData *, uint32_t );
+static api_Err_Status _detect_sizes( uint8_t *, uint8_t *, Vector_MetaData *);
 
-static api_Err_Status _detect_1D_items( uint8_t *, uint8_t *, Vector_MetaData *);
-static api_Err_Status _detect_2D_sizes( uint8_t *, uint8_t *, Vector_MetaData *);
-static api_Err_Status _detect_3D_sizes( uint8_t *, uint8_t *, Vector_MetaData *);
+static api_Err_Status _parse_data_ND( void *, uint8_t *, uint8_t *, Vector_MetaData *, Strict_Block *, Text_Window * ) ;
+static api_Err_Status _parse_axis( Parse_Ctx *, uint8_t *, uint32_t, uint64_t, uint32_t );
 
-static api_Err_Status _parse_data_1D( void *, uint8_t *, uint8_t *, Vector_MetaData *) ;
-static api_Err_Status _parse_data_2D( void **, uint8_t *, uint8_t *, Vector_MetaData *) ;
-static api_Err_Status _parse_data_3D( void ***, uint8_t *, uint8_t *, Vector_MetaData *) ;
+static api_Err_Status _convert_token( Strict_Block *, uint8_t *, Vector_MetaData *, void *, uint64_t, uint32_t );
+static api_Err_Status _strict_flush( Strict_Block * );
+static uint64_t _strict_range( Strict_Block *, uint32_t, uint32_t );
+static void _strict_report( Strict_Block *, char *, uint8_t * );
+static uint64_t _strict_any( uint8_t *, uint32_t );
+static uint64_t _strict_range_s( int64_t *, uint32_t, int64_t, int64_t );
+static uint64_t _strict_range_u( uint64_t *, uint32_t, uint64_t );
+static uint64_t _strict_range_d( double *, uint32_t, double );
 
 
 
@@ -63,6 +163,7 @@ static api_Err_Status _parse_data_3D( void ***, uint8_t *, uint8_t *, Vector_Met
  * \brief  convert list of delimiters to a string format
  *         that can readily be used for strtok for parsing. The data dimensions
  *         are considered to be uniform and the input data is not 'sparse'
+ *         (see sparse_read() for index:value inputs)
  * \param  ***out - output buffer holding parsed data from file
  * \param  *meta - detected dimension. Memory should be allocated by caller.
  *                      Caller should also fill in d_type with correct entry
@@ -73,18 +174,49 @@ static api_Err_Status _parse_data_3D( void ***, uint8_t *, uint8_t *, Vector_Met
  */
 /*****************************************************************************/
 api_Err_Status read_data( void **out, Vector_MetaData *meta, char *path, uint8_t *sep )
+{
+    return read_data_placed( out, meta, path, sep, NULL, NULL );
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  read_data() with the values placed in memory supplied by the
+ *         caller, e.g. a shared memory mapping. Only the row pointers are
+ *         allocated here; release the array with unwrap_data()
+ * \param  **out - output buffer holding parsed data from file
+ * \param  *meta - detected dimension. Caller fills in the data-type
+ * \param  *path - file-name to parse
+ * \param  *sep - separator between dimensions
+ * \param  place - returns zeroed memory for data_items(meta) values once the
+ *                 dimensions are known, NULL on failure. NULL : read_data()
+ * \param  *ctx - passed to place
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status read_data_placed( void **out, Vector_MetaData *meta, char *path, uint8_t *sep, Data_Place_Fn place, void *ctx )
 {
     api_Err_Status err = api_Success ;
     uint32_t idx_i = 0, idx_j = 0 , type_size = 0 ;
+    void *payload = NULL ;
+    Strict_Block *strict = NULL ;
+    char label[256] ;
     uint8_t *filebuff = NULL, *linebuff = NULL, *first_line = NULL ;
     uint8_t *l_ptr = NULL , *d_ptr = NULL , *v_ptr = NULL ;
+    uint64_t text_size = 0 ;
     char *conv_err = NULL ;
+    Perf_Sample ps ;
+    Text_Window win ;
+    Mem_Stage stage = Mem_Other ;
 
 
     double d_temp = 0.0 ;
     float f_temp = 0.0 ;
     long double ld_temp = 0.0 ;
 
+    memset( &win, 0, sizeof(win));
+    stage = mem_stage_set( Mem_Read );
+
     /* sanity check the input parameters */
     if( out == NULL ) {
         debug("double pointer passed into funcion = NULL");
@@ -102,6 +234,8 @@ api_Err_Status read_data( void **out, Vector_MetaData *meta, char *path, uint8_t
         goto err_data_read ;
     }
     memset((void *)&(meta->dim), 0 , sizeof(meta->dim));
+    meta->text_hash = 0 ;
+    meta->data_hash = 0 ;
 
 
     if( path == NULL ) {
@@ -122,7 +256,7 @@ api_Err_Status read_data( void **out, Vector_MetaData *meta, char *path, uint8_t
      * Also detect no of dimensions and
      * populate length in each dimension
      */
-    err = _read_file( &filebuff, meta, path, sep);
+    err = _read_file( &filebuff, &text_size, meta, path, (char *)sep, &win );
     if( err != api_Success ) {
         debug("Could not read data from file[%s]", path);
         goto err_data_read ;
@@ -130,51 +264,294 @@ api_Err_Status read_data( void **out, Vector_MetaData *meta, char *path, uint8_t
 
     debug("[%d]-dimensional data within file detected", meta->no_dims);
 
+    /* the text is still as stored : index its records for read_data_range() */
+    _index_text( filebuff, text_size, meta, path, sep );
+
+    /* mapped text : size the window the values leave under the limit */
+    if( win.base != NULL ) {
+        mem_stage_set( Mem_Parse );
+        err = _window_plan( &win, meta, (place != NULL), path );
+        if( err != api_Success )
+            goto err_data_read ;
+    }
+
+    if( place != NULL ) {
+        payload = place( ctx, meta );
+        if( payload == NULL ) {
+            debug("No memory was placed for %llu values", (unsigned long long)data_items( meta ));
+            err = api_Err_Memory ;
+            goto err_data_read ;
+        }
+    }
+
     /* call allocation function based on number of detected dimensions */
-    err = _alloc_ND_mem((void **)out, meta, 0, 1);
+    mem_stage_set( Mem_Alloc );
+    perf_begin( &ps );
+    err = _alloc_ND_mem((void **)out, meta, 0, 1, payload);
+    perf_end( &ps, Perf_Alloc, data_items( meta ));
     if( err != api_Success ) {
         debug("Could not allocate enough memory in single dimension. err = %d", err );
         goto err_data_read_mem ;
     }
-    switch( meta->no_dims )
-    {
-        case 1 :
-            err =  _parse_data_1D( *out, filebuff , sep, meta );
-            if( err != api_Success ) {
-                debug("Error parsing 1D data. err = %d", err );
-                goto err_data_read_mem ;
-            }
-            break ;
-        case 2 :
-            err =  _parse_data_2D((void **)(*out), filebuff , sep, meta );
-            if( err != api_Success ) {
-                debug("Error parsing 2D data. err = %d", err );
-                goto err_data_read_mem ;
-            }
-            break ;
-        case 3 :
-            err =  _parse_data_3D((void ***)(*out), filebuff , sep, meta );
-            if( err != api_Success ) {
-                debug("Error parsing 3D data. err = %d", err );
-                goto err_data_read_mem ;
-            }
-            break ;
-        default :
-            debug("Support only upto 3-Dimensions provided");
-            err = api_Err_Failure ;
+    if( parse_strict()) {
+        strict = calloc( 1, sizeof(Strict_Block));
+        if( strict == NULL ) {
+            debug("Could not allocate strict conversion state");
+            err = api_Err_Memory ;
             goto err_data_read_mem ;
+        }
+        strict->meta = meta ;
+        strict->buff = data_payload( *out, meta );
+        strict->base = filebuff ;
+    }
+    mem_stage_set( Mem_Parse );
+    perf_begin( &ps );
+    err = _parse_data_ND( *out, filebuff, sep, meta, strict, (win.base != NULL) ? &win : NULL );
+    if( err != api_Success ) {
+        debug("Error parsing %u-dimensional data. err = %d", meta->no_dims, err );
+        goto err_data_read_mem ;
+    }
+    /* the values were just written : hash them while they are cache-warm */
+    meta->data_hash = hash_bytes( data_payload( *out, meta ), data_items( meta ) * sizeof_datatype( meta->type ));
+    perf_end( &ps, Perf_Parse, data_items( meta ));
+    if( payload == NULL ) {
+        snprintf( label, sizeof(label), "values of %s", path );
+        huge_report( label, data_payload( *out, meta ), data_items( meta ) * sizeof_datatype( meta->type ));
     }
 
-    filebuff = (filebuff != NULL) ? free(filebuff), NULL : NULL ;
+    strict = (strict != NULL) ? free(strict), NULL : NULL ;
+    _text_release( &filebuff, &win );
+    mem_stage_set( stage );
     return err ;
 
 err_data_read_mem :
-    if( out != NULL ) {
-        *out = (*out != NULL) ? free(*out) , NULL : NULL ;
-    }
+    if((strict != NULL) && (strict->fault != Strict_None))
+        _strict_report( strict, path, sep );
+    strict = (strict != NULL) ? free(strict), NULL : NULL ;
+    _dealloc_ND_mem( out, meta, 0, (payload != NULL));
 
 err_data_read :
-    filebuff = (filebuff != NULL) ? free(filebuff), NULL : NULL ;
+    _text_release( &filebuff, &win );
+    mem_stage_set( stage );
+    return err ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  read_data() of a range of records along the outermost axis (rows
+ *         of 2D data, planes of 3D data, ...). The file's row index (see
+ *         row_index.h) gives the byte offset to seek to, so only the range,
+ *         and at most ROW_INDEX_STRIDE records on either side, is read and
+ *         parsed. Without a current index the file is scanned once to build
+ *         and save one. Compressed files cannot be seeked and are refused
+ * \param  **out - output buffer holding parsed data from file
+ * \param  *meta - dimensions of the range, shape[0] = records loaded.
+ *                 Caller fills in the data-type
+ * \param  *path - file-name to parse
+ * \param  *sep - separator between dimensions
+ * \param  first - first record
+ * \param  count - records to load, 0 : to the end of the file. Clamped to
+ *                 the end of the file
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status read_data_range( void **out, Vector_MetaData *meta, char *path, uint8_t *sep, uint64_t first, uint64_t count )
+{
+    api_Err_Status err = api_Success ;
+    Row_Index idx ;
+    Perf_Sample ps ;
+    uint8_t *slice = NULL , *start = NULL , *end = NULL ;
+    uint64_t from = 0 , to = 0 , skip = 0 , done = 0 ;
+    ssize_t rd = 0 ;
+    int fd = -1 ;
+    Mem_Stage stage = mem_stage_set( Mem_Read );
+
+    memset( &idx, 0, sizeof(idx));
+
+    if((out == NULL) || (*out != NULL) || (meta == NULL) || (path == NULL) || (sep == NULL)) {
+        debug("Invalid params out = %p, meta = %p, path = %p, sep = %p", out, meta, path, sep);
+        err = api_Err_Param ;
+        goto err_range_read ;
+    }
+
+    err = read_data_index( &idx, meta, path, sep );
+    if( err != api_Success )
+        goto err_range_read ;
+
+    if( first >= idx.hdr.records ) {
+        log_error("[%s] has %llu records, cannot load from record %llu", path,
+                    (unsigned long long)idx.hdr.records, (unsigned long long)first);
+        err = api_Err_Param ;
+        goto err_range_read ;
+    }
+    count = ((count == 0) || (count > idx.hdr.records - first)) ? idx.hdr.records - first : count ;
+    err = row_index_range( &idx, first, count, &from, &to, &skip );
+    if( err != api_Success )
+        goto err_range_read ;
+
+    /* read the indexed records around the range */
+    slice = huge_alloc( to - from + 1, 0 );
+    if( slice == NULL ) {
+        debug("Could not alloc(%llu) bytes for records of [%s]", (unsigned long long)(to - from + 1), path);
+        err = api_Err_Memory ;
+        goto err_range_read ;
+    }
+    fd = open( path, O_RDONLY | O_CLOEXEC );
+    if( fd < 0 ) {
+        debug("Could not open [%s]. errno = %d", path, errno);
+        err = api_Err_File ;
+        goto err_range_read ;
+    }
+    perf_begin( &ps );
+    for( done=0 ; done < (to - from) ; done += (uint64_t)rd ) {
+        rd = pread( fd, slice + done, (size_t)(to - from - done), (off_t)(from + done));
+        if((rd < 0) && (errno == EINTR)) {
+            rd = 0 ;
+            continue ;
+        }
+        if( rd <= 0 ) {
+            debug("Could not read [%s] at %llu. errno = %d", path, (unsigned long long)(from + done), (rd < 0) ? errno : 0);
+            err = api_Err_File ;
+            goto err_range_read ;
+        }
+    }
+    slice[to - from] = '\0' ;
+    perf_end( &ps, Perf_Read, to - from );
+
+    /* trim to the records asked for */
+    start = _skip_records( slice, slice + (to - from), sep[idx.hdr.no_dims - 1], skip );
+    end = _skip_records( start, slice + (to - from), sep[idx.hdr.no_dims - 1], count );
+    *end = '\0' ;
+
+    meta->no_dims = idx.hdr.no_dims ;
+    memcpy( meta->dim.shape, idx.hdr.shape, sizeof(idx.hdr.shape));
+    meta->dim.shape[0] = count ;
+    meta->text_hash = 0 ;
+    meta->data_hash = 0 ;
+    debug("[%s] : records %llu to %llu from bytes %llu to %llu", path, (unsigned long long)first,
+                (unsigned long long)(first + count - 1), (unsigned long long)from, (unsigned long long)to);
+
+    err = parse_records( out, meta, start, sep, path, from + (uint64_t)(start - slice), parse_strict());
+
+err_range_read :
+    if( fd >= 0 )
+        close( fd );
+    slice = (slice != NULL) ? huge_free(slice), NULL : NULL ;
+    row_index_free( &idx );
+    mem_stage_set( stage );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  The row index of a file : the saved one when it is current, else
+ *         the file is read once to detect its dimensions and index its
+ *         records, and the index is saved for next time
+ * \param  *idx - output index, released with row_index_free()
+ * \param  *meta - scratch meta-data. Caller fills in the data-type
+ * \param  *path - the file
+ * \param  *sep - separator between dimensions
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status read_data_index( Row_Index *idx, Vector_MetaData *meta, char *path, uint8_t *sep )
+{
+    api_Err_Status err = api_Success ;
+    Text_Window win ;
+    uint8_t *text = NULL ;
+    uint64_t size = 0 ;
+
+    if((idx == NULL) || (meta == NULL) || (path == NULL) || (sep == NULL)) {
+        debug("Invalid params idx = %p, meta = %p, path = %p, sep = %p", idx, meta, path, sep);
+        return api_Err_Param ;
+    }
+    if( row_index_load( idx, path, sep ) == api_Success )
+        return api_Success ;
+
+    memset( &win, 0, sizeof(win));
+    err = _read_file( &text, &size, meta, path, (char *)sep, &win );
+    if( err == api_Success )
+        err = row_index_build( idx, text, size, sep, meta, path );
+    _text_release( &text, &win );
+    if( err != api_Success ) {
+        debug("Could not index the records of [%s]. err = %d", path, err);
+        return err ;
+    }
+    if( row_index_save( idx, path ) != api_Success )
+        log_warn("Could not save the row index of [%s] : it is rebuilt by every partial load", path);
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Parse text holding whole records of a file into a new array.
+ *         The text is tokenised in place
+ * \param  **out - output array, released with clean_data()
+ * \param  *meta - type and dimensions : shape[0] records of the text
+ * \param  *text - NUL-terminated, writable text of the records
+ * \param  *sep - separator between dimensions
+ * \param  *path - the file, for reporting bad values
+ * \param  offset - offset of the text within the file
+ * \param  strict - check every value (see parse_set_strict())
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status parse_records( void **out, Vector_MetaData *meta, uint8_t *text, uint8_t *sep, char *path, uint64_t offset, uint32_t strict )
+{
+    api_Err_Status err = api_Success ;
+    Strict_Block *sb = NULL ;
+    Perf_Sample ps ;
+    Mem_Stage stage = mem_stage_set( Mem_Alloc );
+
+    if((out == NULL) || (*out != NULL) || (meta == NULL) || (text == NULL) || (sep == NULL) || (path == NULL)) {
+        debug("Invalid params out = %p, meta = %p, text = %p, sep = %p, path = %p", out, meta, text, sep, path);
+        err = api_Err_Param ;
+        goto err_records ;
+    }
+    err = _alloc_ND_mem( out, meta, 0, 1, NULL );
+    if( err != api_Success ) {
+        debug("Could not allocate %u-dimensional array. err = %d", meta->no_dims, err);
+        goto err_records ;
+    }
+    if( strict ) {
+        sb = calloc( 1, sizeof(Strict_Block));
+        if( sb == NULL ) {
+            debug("Could not allocate strict conversion state");
+            err = api_Err_Memory ;
+            goto err_records_mem ;
+        }
+        sb->meta = meta ;
+        sb->buff = data_payload( *out, meta );
+        sb->base = text ;
+    }
+    mem_stage_set( Mem_Parse );
+    perf_begin( &ps );
+    err = _parse_data_ND( *out, text, sep, meta, sb, NULL );
+    if( err != api_Success ) {
+        debug("Error parsing %u-dimensional data. err = %d", meta->no_dims, err );
+        goto err_records_mem ;
+    }
+    meta->data_hash = hash_bytes( data_payload( *out, meta ), data_items( meta ) * sizeof_datatype( meta->type ));
+    perf_end( &ps, Perf_Parse, data_items( meta ));
+
+    sb = (sb != NULL) ? free(sb), NULL : NULL ;
+    goto err_records ;
+
+err_records_mem :
+    /* offsets of bad values are from the start of the file */
+    if((sb != NULL) && (sb->fault != Strict_None)) {
+        sb->fault_offset += offset ;
+        _strict_report( sb, path, sep );
+    }
+    sb = (sb != NULL) ? free(sb), NULL : NULL ;
+    _dealloc_ND_mem( out, meta, 0, 0 );
+
+err_records :
+    mem_stage_set( stage );
     return err ;
 }
 
@@ -201,12 +578,86 @@ uint32_t sizeof_datatype( Data_Type type )
         case DataType_float        : type_size = sizeof(float)       ;  break ;
         case DataType_double       : type_size = sizeof(double)      ;  break ;
         case DataType_long_double  : type_size = sizeof(long double) ;  break ;
+        case DataType_float16      : type_size = sizeof(uint16_t)    ;  break ;
+        case DataType_bfloat16     : type_size = sizeof(uint16_t)    ;  break ;
         default :                    type_size = 0 ;
     }
     return type_size ;
 }
 
 
+/*****************************************************************************/
+/*!
+ * \brief  helper function to return the name of a data-type, as accepted
+ *         on the command-line
+ * \param  type - data type
+ * \return returns name of the data-type, "unknown" if invalid
+ */
+/*****************************************************************************/
+const char *datatype_name( Data_Type type )
+{
+    static const char *names[DataType_MaxTypes] = {
+        "uint8", "uint16", "uint32", "uint64", "int8", "int16", "int32", "int64",
+        "float", "double", "longdouble", "float16", "bfloat16"
+    } ;
+
+    return (type < DataType_MaxTypes) ? names[type] : "unknown" ;
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Convert one text token to a number of the given type
+ * \param  *str - NUL-terminated token
+ * \param  type - data type of the destination
+ * \param  *buff - destination array
+ * \param  idx_i - index within the destination array
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status convert_number( uint8_t *str, Data_Type type, void *buff, uint64_t idx_i )
+{
+    Vector_MetaData meta ;
+
+    memset( &meta, 0, sizeof(meta));
+    meta.type = type ;
+    return _convert_to_number( str, &meta, buff, idx_i );
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Select strict conversion for read_data() calls made by this
+ *         thread : every value's syntax and range for the data-type are
+ *         checked, and the first bad value is reported with its line and
+ *         column. Errors instead of wrapping or stopping at garbage
+ * \param  on - 1 strict, 0 lenient, -1 follow HETERO_STRICT (default)
+ * \return none
+ */
+/*****************************************************************************/
+void parse_set_strict( int32_t on )
+{
+    t_strict = on ;
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Whether read_data() converts strictly in this thread
+ * \return 1 for strict conversion
+ */
+/*****************************************************************************/
+uint32_t parse_strict( void )
+{
+    char *env = NULL ;
+
+    if( t_strict >= 0 )
+        return (uint32_t)(t_strict != 0) ;
+    env = getenv("HETERO_STRICT");
+    return (env != NULL) && (env[0] != '\0') && strcmp( env, "0" ) ;
+}
+
+
 /*****************************************************************************/
 /*!
  * \brief  free memory allocated while parsing input file
@@ -216,165 +667,311 @@ uint32_t sizeof_datatype( Data_Type type )
 /*****************************************************************************/
 api_Err_Status clean_data( void **buff, Vector_MetaData *meta )
 {
-    _dealloc_ND_mem( buff, meta, 0 );
+    _dealloc_ND_mem( buff, meta, 0, 0 );
     return api_Success ;
 }
 
 
+/*****************************************************************************/
+/*!
+ * \brief  Build the read_data() layout over values held elsewhere : a
+ *         contiguous row-major block of data_items(meta) values
+ * \param  **out - output array. *out must be NULL
+ * \param  *meta - type, number of dimensions and dimensions of the values
+ * \param  *payload - the values. Not copied, must outlive the array
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status wrap_data( void **out, Vector_MetaData *meta, void *payload )
+{
+    if((out == NULL) || (meta == NULL) || (payload == NULL) || (sizeof_datatype( meta->type ) == 0)) {
+        debug("Invalid params out = %p , meta = %p , payload = %p", out, meta, payload);
+        return api_Err_Param ;
+    }
+    return _alloc_ND_mem( out, meta, 0, 1, payload );
+}
+
 
 /*****************************************************************************/
 /*!
- * \brief  Read Entire file content into a buffer,
- *         While doing this, also detect number of axes and also dimensions
- *         on each axis
- * \param[out] **buffer - output buffer into which file is read
- * \param[out] *meta - Meta-data about the file
- * \param[in]  *path - file path
- * \param[in]  *sep - List of separators (upto 3) in 'ascending' order.
- *
- * \note       *sep The data will be parsed and spatially co-located in order of
- *             separators and array subscripts are in order of separators
- *             i.e if sep = "\n|,", then data is assumed to be in the format
- *                    a0,b0,c0,....|a1,b1,c1,.....|............\n
- *                    d0,e0,f0,....|d1,e1,f1,.....|............\n
- *                            .........................        \m
- *                            .........................        \m
- *                            .........................        \m
- *                            .........................        \m
- *                    ax,bx,cx  are in contiguous memory.
- *                    buff[i][j][k] subscripting map is i->\n, j->| , k->,
+ * \brief  Release an array from wrap_data() or read_data_placed(). The
+ *         values are left alone
+ * \param  **buff - array, set to NULL
+ * \param  *meta - meta-data of the array
  * \return returns api_Success on success.
  */
 /*****************************************************************************/
-static api_Err_Status _read_file( uint8_t **buff, Vector_MetaData *meta,  char *path , char *sep )
+api_Err_Status unwrap_data( void **buff, Vector_MetaData *meta )
 {
-    api_Err_Status err = api_Success ;
-    int fd = -1 ;
-    uint32_t idx_i = 0, max_dim = 0 ;
-    int32_t idx_k = 0 ;
-    uint64_t dim_x = 0 , dim_y = 0 , dim_z = 0 ;
-    size_t chunk = 4*1024 ;
-    ssize_t rd , bytes ;
-    struct stat sb ;
-    uint8_t *file_content = NULL ;
+    _dealloc_ND_mem( buff, meta, 0, 1 );
+    if( buff != NULL )
+        *buff = NULL ;
+    return api_Success ;
+}
 
 
-    meta->no_dims = 0 ;
-    max_dim = strlen(sep);
+/*****************************************************************************/
+/*!
+ * \brief  Allocate an N-dimensional array with the same layout read_data()
+ *         produces. Used for results of computations on loaded data
+ * \param  **out - output buffer. *out must be NULL
+ * \param  *meta - type, number of dimensions and dimensions to allocate
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status alloc_data( void **out, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
 
-    /* check the file */
-    fd = open( path , O_RDONLY );
-    if( fd == -1 ) {
-        debug("Could not open file[%s]. errno = %d", path, errno ) ;
-        err = api_Err_File ;
-        goto err_file_read ;
+    if((out == NULL) || (meta == NULL)) {
+        debug("Invalid params out = %p , meta = %p", out, meta);
+        err = api_Err_Param ;
+        goto err_data_alloc ;
     }
-
-    memset( &sb , 0  , sizeof(struct stat));
-    if( fstat( fd , &sb) == -1) {
-        debug("Could not read file meta-data. errno = %d", errno );
-        err = api_Err_File ;
-        goto err_file_read ;
+    if( sizeof_datatype( meta->type ) == 0 ) {
+        debug("Unknown data-type %d", meta->type);
+        err = api_Err_Param ;
+        goto err_data_alloc ;
     }
 
-    if((sb.st_mode & S_IFMT) != S_IFREG ) {
-        debug("file [%s] is not a file!", path);
-        err = api_Err_File ;
-        goto err_file_read ;
-    }
+    meta->text_hash = 0 ;
+    meta->data_hash = 0 ;
+    err = _alloc_ND_mem( out, meta, 0, 1, NULL );
+    if( err != api_Success )
+        debug("Could not allocate %u-dimensional array. err = %d", meta->no_dims, err);
 
-    /* create a buffer to read the entire file into memory */
-    *buff = malloc((sb.st_size * sizeof(uint8_t)) + 1);
-    if( *buff == NULL ) {
-        debug("Could not alloc(%u) bytes to read file", sb.st_size+1,  path);
-        err = api_Err_File ;
-        goto err_file_read ;
-    }
+err_data_alloc :
+    return err ;
+}
 
 
-    /* Read entire file into memory buffer */
-    for( rd=0, bytes=0 ; rd < sb.st_size ; rd += bytes ) {
-        chunk = ((sb.st_size-rd) >= LINE_SIZE) ? LINE_SIZE : (sb.st_size - rd) ;
-        bytes = read(fd, *buff + rd, chunk );
-        if( bytes == -1 ) {
-            if( errno == EINTR ){
-                bytes = 0 ;
-            } else {
-                debug("read() failed errno(%d).Reading file[%s], fd=(%d), read-so-far=(0x%08x), chunk-size=(%u)", errno, path, fd, rd, chunk);
-                err = api_Err_File ;
-                goto err_file_read_mem ;
-            }
-        }
+/*****************************************************************************/
+/*!
+ * \brief  Return the contiguous block holding the values of an N-dimensional
+ *         array created by read_data() or alloc_data(). Elements are laid out
+ *         in row-major order of the array subscripts
+ * \param  *buff - N-dimensional array
+ * \param  *meta - meta-data of the array
+ * \return pointer to first element or NULL
+ */
+/*****************************************************************************/
+void *data_payload( void *buff, Vector_MetaData *meta )
+{
+    uint32_t idx_i = 0 ;
 
-        /*!
-         * Figure out number of dimensions from file. The maximum number of
-         * dimensions are figured from the separator list. If we reach max
-         * known dimensions, then don't do the search again.
-         */
-        for( idx_i=0 ; (idx_i < bytes) && (meta->no_dims < max_dim); idx_i++ ) {
-            for( idx_k=meta->no_dims ; idx_k < max_dim ; idx_k++ ) {
-                if( (*buff)[rd + idx_i] == sep[idx_k] ) {
-                    meta->no_dims++ ;
-                    break ;
-                }
-            }
-        }
-    }   /* for ( read buffer from file ) */
+    if((buff == NULL) || (meta == NULL))
+        return NULL ;
 
+    for( idx_i=1 ; (idx_i < meta->no_dims) && (buff != NULL) ; idx_i++ )
+        buff = ((void **)buff)[0] ;
 
-    /*!
-     * depending on how many dimensions
-     * populate union with details of how many values in each dimension
-     * NOTE : The code is generic enough for upto 3-dimensions. Hence why
-     * dim_z is used for 1-d data , y,z for 2-d data amd x,y,z for 3-d data
-     */
-    switch( meta->no_dims )
-    {
-        case 1 :
-            err = _detect_1D_items( *buff, sep, meta );
-            if( err != api_Success ) {
-                debug("Error detecting no.of 1D items. err = %d", err );
-                goto err_file_read_mem ;
-            }
-            break ;
-        case 2 :
-            err = _detect_2D_sizes( *buff, sep, meta );
-            if( err != api_Success ) {
-                debug("Error detecting no.of 2D items. err = %d", err );
-                goto err_file_read_mem ;
-            }
-            break ;
-        case 3 :
-            err = _detect_3D_sizes( *buff, sep,  meta );
-            if( err != api_Success ) {
-                debug("Error detecting no.of 3D items. err = %d", err );
-                goto err_file_read_mem ;
-            }
-            break ;
-        default :
-            debug("Parser only has support for maximum 3D data");
-            err = api_Err_Param ;
-            goto err_file_read_mem ;
+    return buff ;
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Total number of elements held in an array
+ * \param  *meta - meta-data of the array
+ * \return number of elements (0 for unknown dimensions)
+ */
+/*****************************************************************************/
+uint64_t data_items( Vector_MetaData *meta )
+{
+    uint64_t items = 1 ;
+    uint32_t axis = 0 ;
+
+    if((meta == NULL) || (meta->no_dims == 0) || (meta->no_dims > DATA_MAX_DIMS))
+        return 0 ;
+
+    for( axis=0 ; axis < meta->no_dims ; axis++ )
+        items *= meta->dim.shape[axis] ;
+    return items ;
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Row-major strides of an array, in elements : the distance in the
+ *         values between neighbours along each axis
+ * \param  *meta - meta-data of the array
+ * \param  *strides - output, DATA_MAX_DIMS entries. Unused axes are 0
+ * \return none
+ */
+/*****************************************************************************/
+void data_strides( Vector_MetaData *meta, uint64_t *strides )
+{
+    uint64_t step = 1 ;
+    int32_t axis = 0 ;
+
+    if( strides == NULL )
+        return ;
+    memset( strides, 0, DATA_MAX_DIMS * sizeof(uint64_t));
+    if((meta == NULL) || (meta->no_dims > DATA_MAX_DIMS))
+        return ;
+
+    for( axis=(int32_t)meta->no_dims - 1 ; axis >= 0 ; axis-- ) {
+        strides[axis] = step ;
+        step *= meta->dim.shape[axis] ;
     }
+}
 
 
+/*****************************************************************************/
+/*!
+ * \brief  Whether two arrays have the same rank and extent along every axis
+ * \param  *a - meta-data of the first array
+ * \param  *b - meta-data of the second array
+ * \return 1 when the shapes match
+ */
+/*****************************************************************************/
+uint32_t data_same_shape( Vector_MetaData *a, Vector_MetaData *b )
+{
+    uint32_t axis = 0 ;
+
+    if((a == NULL) || (b == NULL) || (a->no_dims != b->no_dims) || (a->no_dims > DATA_MAX_DIMS))
+        return 0 ;
+
+    for( axis=0 ; axis < a->no_dims ; axis++ ) {
+        if( a->dim.shape[axis] != b->dim.shape[axis] )
+            return 0 ;
+    }
+    return 1 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Read an entire file into a NUL-terminated buffer, in chunks tuned
+ *         for this machine. zstd and lz4 files are inflated on the way
+ * \param  **buff - output buffer, released with huge_free()
+ * \param  *size - number of bytes read (excluding the terminator)
+ * \param  *path - file path
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status read_text( uint8_t **buff, uint64_t *size, char *path )
+{
+    return _read_text( buff, size, path, NULL );
+}
+
+
+/*****************************************************************************/
+/*!
+ * \brief  read_text(), hashing the bytes as stored on disk as each chunk
+ *         lands (see hash.h)
+ * \param  **buff - output buffer, released with huge_free()
+ * \param  *size - number of bytes read (excluding the terminator)
+ * \param  *path - file path
+ * \param  *hash - output hash of the file, NULL to skip hashing
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _read_text( uint8_t **buff, uint64_t *size, char *path, uint64_t *hash )
+{
+    api_Err_Status err = api_Success ;
+    Hash_State hs ;
+    int fd = -1 ;
+    size_t chunk = 4*1024 ;
+    ssize_t rd , bytes ;
+    size_t read_size = LINE_SIZE ;
+    struct stat sb ;
+    Perf_Sample ps ;
+    uint8_t *raw = NULL ;
+    Mem_Stage stage = mem_stage_set( Mem_Read );
+
+    if((buff == NULL) || (size == NULL) || (path == NULL)) {
+        debug("Invalid params buff = %p, size = %p, path = %p", buff, size, path);
+        err = api_Err_Param ;
+        goto err_text_read ;
+    }
+    *buff = NULL ;
+    *size = 0 ;
+
+    /* check the file */
+    fd = open( path , O_RDONLY );
+    if( fd == -1 ) {
+        debug("Could not open file[%s]. errno = %d", path, errno ) ;
+        err = api_Err_File ;
+        goto err_text_read ;
+    }
+
+    memset( &sb , 0  , sizeof(struct stat));
+    if( fstat( fd , &sb) == -1) {
+        debug("Could not read file meta-data. errno = %d", errno );
+        err = api_Err_File ;
+        goto err_text_read ;
+    }
+
+    if((sb.st_mode & S_IFMT) != S_IFREG ) {
+        debug("file [%s] is not a file!", path);
+        err = api_Err_File ;
+        goto err_text_read ;
+    }
+
+    /* create a buffer to read the entire file into memory */
+    *buff = huge_alloc((sb.st_size * sizeof(uint8_t)) + 1, 0 );
+    if( *buff == NULL ) {
+        debug("Could not alloc(%llu) bytes to read file [%s]", (unsigned long long)sb.st_size+1, path);
+        err = api_Err_Memory ;
+        goto err_text_read ;
+    }
+
+    read_size = (size_t)tune_lookup( "read.chunk", sb.st_size, LINE_SIZE );
+    read_size = (read_size != 0) ? read_size : LINE_SIZE ;
+    hash_init( &hs );
+    perf_begin( &ps );
+    for( rd=0, bytes=0 ; rd < sb.st_size ; rd += bytes ) {
+        chunk = ((sb.st_size-rd) >= read_size) ? read_size : (sb.st_size - rd) ;
+        bytes = read(fd, *buff + rd, chunk );
+        if( bytes == -1 ) {
+            if( errno == EINTR ){
+                bytes = 0 ;
+            } else {
+                debug("read() failed errno(%d).Reading file[%s], fd=(%d), read-so-far=(0x%08x), chunk-size=(%u)", errno, path, fd, rd, chunk);
+                err = api_Err_File ;
+                goto err_text_read_mem ;
+            }
+        } else if( bytes == 0 ) {
+            /* file shrunk underneath us */
+            break ;
+        } else if( hash != NULL ) {
+            hash_update( &hs, *buff + rd, (uint64_t)bytes );
+        }
+    }
+    perf_end( &ps, Perf_Read, (uint64_t)rd );
+    if( hash != NULL )
+        *hash = hash_digest( &hs );
+    (*buff)[rd] = '\0' ;
+    *size = (uint64_t)rd ;
 
     if( close(fd) ) {
         debug("Closing file[%s] (fd=%d) returned  error. errno = %d", path, fd, errno);
+        fd = -1 ;
         err = api_Err_File ;
-        goto err_file_read_mem ;
+        goto err_text_read_mem ;
     }
 
+    /* compressed input : inflate straight into the text buffer */
+    if( compress_format( *buff, *size ) != Compress_None ) {
+        raw = *buff ;
+        err = decompress_text( buff, size, raw, *size, path );
+        raw = (raw != NULL) ? huge_free(raw), NULL : NULL ;
+    }
+    huge_report( path, *buff, *size );
+    mem_stage_set( stage );
     return err ;
 
-err_file_read_mem :
-    if( buff != NULL )
-        *buff = (*buff != NULL) ? free(*buff) , NULL : NULL ;
+err_text_read_mem :
+    *buff = (*buff != NULL) ? huge_free(*buff) , NULL : NULL ;
+    *size = 0 ;
 
-err_file_read :
+err_text_read :
     if((fd != -1) && close(fd) != 0 )
         debug("close(%d)'ing  file [%s] caused error : %d", fd , path , errno );
 
+    mem_stage_set( stage );
     return err ;
 }
 
@@ -383,113 +980,95 @@ err_file_read :
 
 /*****************************************************************************/
 /*!
- * \brief  Dynamically create an n-dimensional array (currently set at
- *         3-dimensions)
+ * \brief  Read Entire file content into a buffer,
+ *         While doing this, also detect number of axes and also dimensions
+ *         on each axis
+ * \param[out] **buffer - output buffer into which file is read
+ * \param[out] *text_size - bytes of text in the buffer
+ * \param[out] *meta - Meta-data about the file
+ * \param[in]  *path - file path
+ * \param[in]  *sep - List of separators (up to DATA_MAX_DIMS) in 'ascending' order.
+ * \param[out] *win - the text is a private mapping of the file when
+ *                    win->base is set (memory limit, uncompressed file)
  *
- * \param  ***out - output buffer holding parsed data from file
- * \param  *meta -  detected dimension. Memory should be allocated by caller.
- *                      Caller should also fill in type with correct entry
- *                      before this function is called
- * \param  dimension  - which axis are we currently allocating memory for
- * \param  mult_factor- to be used in recursion. Factor to multiply with
- *                      number of elements in current dimension while allocating
- *                      space. This will be the mult-accumulated value from all the
- *                      number of elements of previous axes
+ * \note       *sep The data will be parsed and spatially co-located in order of
+ *             separators and array subscripts are in order of separators
+ *             i.e if sep = "\n|,", then data is assumed to be in the format
+ *                    a0,b0,c0,....|a1,b1,c1,.....|............\n
+ *                    d0,e0,f0,....|d1,e1,f1,.....|............\n
+ *                            .........................        \m
+ *                            .........................        \m
+ *                            .........................        \m
+ *                            .........................        \m
+ *                    ax,bx,cx  are in contiguous memory.
+ *                    buff[i][j][k] subscripting map is i->\n, j->| , k->,
  * \return returns api_Success on success.
- * \note   This function will be called recursively to add memory for the next
- *         dimension until we exhaust dimensions
  */
 /*****************************************************************************/
-static api_Err_Status _alloc_ND_mem( void **out, Vector_MetaData *meta, uint32_t dimension , uint64_t mult_factor)
+static api_Err_Status _read_file( uint8_t **buff, uint64_t *text_size, Vector_MetaData *meta,  char *path , char *sep, Text_Window *win )
 {
     api_Err_Status err = api_Success ;
-    uint64_t idx_i = 0 ;
-    uint32_t type_size = 0, next_dim_size_t = 0 , next_dim_elem = 0 ;
-    uint64_t elem = 0 ;
+    uint32_t max_dim = 0 ;
+    int32_t idx_k = 0 ;
+    uint64_t size = 0 , idx_i = 0 ;
+    Perf_Sample ps ;
+    Mem_Stage stage = Mem_Other ;
 
-    /* sanity check inputs */
-    if( out == NULL ) {
-        debug("Cannot alloc memory into NULL pointer");
-        err = api_Err_Param ;
-        goto err_NDmem_alloc ;
-    } else if( *out != NULL ) {
-        debug("Possible over-write of memory!");
-        err = api_Err_Param ;
-        goto err_NDmem_alloc ;
-    }
 
-    if( meta == NULL ) {
-        debug("Meta-data about data-in-memory = NULL");
-        err = api_Err_Param ;
-        goto err_NDmem_alloc ;
+    meta->no_dims = 0 ;
+    max_dim = strlen(sep);
+    if( max_dim > DATA_MAX_DIMS ) {
+        debug("%u separators given, at most %u dimensions are supported", max_dim, DATA_MAX_DIMS);
+        return api_Err_Param ;
     }
 
-
-    /* We do not need to allocate for a non-existent dimension */
-    if( dimension >= meta->no_dims )
-        return err ;
+    /* under a memory limit the text is not copied into memory we own */
+    *buff = NULL ;
+    if( mem_limit() != 0 )
+        err = _map_text( buff, &size, path, &meta->text_hash, win );
+    if((err == api_Success) && (*buff == NULL))
+        err = _read_text( buff, &size, path, &meta->text_hash );
+    if( err != api_Success )
+        goto err_file_read ;
 
     /*!
-     * If we are at the last dimension sizeof-type should be
-     * actual size of type, otherwise it should be type (void *)
+     * Figure out number of dimensions from file. The maximum number of
+     * dimensions are figured from the separator list. If we reach max
+     * known dimensions, then don't do the search again.
      */
-    type_size = ((dimension + 1) == meta->no_dims) ? sizeof_datatype( meta->type ) : sizeof(void *);
-
-
-    /* Figure out how many members of each dimension we have to allocate */
-    switch( meta->no_dims )
-    {
-        case 1 :
-            elem = _1D_sizeof_dim( meta ) ;
-            break ;
-        case 2 :
-            elem = _2D_sizeof_dim( meta, dimension ) ;
-            next_dim_elem = _2D_sizeof_dim( meta, dimension+1 ) ;
-            break ;
-        case 3 :
-            elem = _3D_sizeof_dim( meta, dimension ) ;
-            next_dim_elem = _3D_sizeof_dim( meta, dimension+1 ) ;
-            break ;
-        default :
-            debug("Currently only upto 3 dimensions supported");
-            err = api_Err_Param ;
-            goto err_NDmem_alloc ;
-    }
-
-    /* Allocate space to hold pointers to current stride in the matrix */
-    *out = calloc( elem * mult_factor, type_size );
-    if( *out == NULL ) {
-        debug("Could not allocate memory space to hold %u elements . Type-size = %u", elem, type_size );
-        err = api_Err_Memory ;
-        goto err_NDmem_alloc ;
+    for( idx_i=0 ; (idx_i < size) && (meta->no_dims < max_dim); idx_i++ ) {
+        for( idx_k=meta->no_dims ; idx_k < max_dim ; idx_k++ ) {
+            if( (*buff)[idx_i] == sep[idx_k] ) {
+                meta->no_dims++ ;
+                break ;
+            }
+        }
     }
 
-    /* Allocate space for next dimension */
-    err = _alloc_ND_mem((void **)*out, meta, dimension+1, mult_factor*elem);
-    if( err != api_Success ) {
-        debug("Could not allocate memory for dimension %u", dimension+1);
-        goto err_NDmem_alloc_mem ;
-    }
 
     /*!
-     * Add pointers to all other rows into pointer list for access
-     * We do not do this if this invocation is for the last dimension
-     * as we will end up putting corrupt values (i.e addresses from NULL)
-     *r into the last dimension access. If these pages are locked down,
-     * then this will cause exceptions
+     * count the values along each axis : the shape is taken from the
+     * first block of each axis, and the outermost axis from the whole text
      */
-    if((dimension+1) < meta->no_dims ) {
-        next_dim_size_t = ((dimension+2) == meta->no_dims) ? sizeof_datatype( meta->type ) : sizeof(void *) ;
-        for( idx_i=1 ; idx_i < (elem * mult_factor) ; idx_i++ ) {
-            ((void **)(*out))[idx_i] = **((void ***)out) + (idx_i * next_dim_elem * next_dim_size_t ) ;
-        }
+    stage = mem_stage_set( Mem_Detect );
+    perf_begin( &ps );
+    err = _detect_sizes( *buff, sep, meta );
+    if( err != api_Success ) {
+        debug("Error detecting sizes of %u-dimensional data. err = %d", meta->no_dims, err );
+        goto err_file_read_mem ;
     }
+    perf_end( &ps, Perf_Detect, size );
+    mem_stage_set( stage );
 
+    *text_size = size ;
     return err ;
 
-err_NDmem_alloc_mem :
-    *out = (*out != NULL) ? free(*out), NULL : NULL ;
-err_NDmem_alloc :
+err_file_read_mem :
+    mem_stage_set( stage );
+    if( buff != NULL )
+        _text_release( buff, win );
+
+err_file_read :
     return err ;
 }
 
@@ -497,151 +1076,359 @@ err_NDmem_alloc :
 
 /*****************************************************************************/
 /*!
- * \brief  Dynamically create an n-dimensional array (currently set at
- *         3-dimensions)
- *
- * \param  ***out - output buffer holding parsed data from file
- * \param  *meta -  detected dimension. Memory should be allocated by caller.
- *                      Caller should also fill in type with correct entry
- *                      before this function is called
- * \param  dimension  - which axis are we currently allocating memory for
- * \return void
- * \note   This function will be called recursively to add memory for the next
- *         dimension until we exhaust dimensions
+ * \brief  Save the row index of a file just read, unless a current one
+ *         exists or the file has too few records to need one. Failures only
+ *         cost the index
+ * \param  *text - text of the file, not parsed yet
+ * \param  size - bytes of text
+ * \param  *meta - detected dimensions
+ * \param  *path - the file
+ * \param  *sep - separators
+ * \return none
  */
 /*****************************************************************************/
-static void  _dealloc_ND_mem( void **out, Vector_MetaData *meta, uint32_t dimension )
+static void _index_text( uint8_t *text, uint64_t size, Vector_MetaData *meta, char *path, uint8_t *sep )
 {
-    api_Err_Status err = api_Success ;
-
-    if( meta == NULL )
-        goto err_NDmem_dealloc ;
+    Row_Index idx ;
+    char *env = getenv("HETERO_ROW_INDEX");
 
-    /* Check if function has hit recursive limit */
-    if( dimension >= meta->no_dims)
+    if(((env != NULL) && !strcmp( env, "0" )) || (meta->dim.shape[0] <= ROW_INDEX_STRIDE))
+        return ;
+    if( row_index_load( &idx, path, sep ) == api_Success ) {
+        row_index_free( &idx );
+        return ;
+    }
+    if( row_index_build( &idx, text, size, sep, meta, path ) != api_Success )
         return ;
+    if( row_index_save( &idx, path ) == api_Success )
+        log_dbg("Saved row index of [%s] : %llu records", path, (unsigned long long)idx.hdr.records);
+    row_index_free( &idx );
+    return ;
+}
 
-    if( out == NULL )
-        goto err_NDmem_dealloc ;
 
-    _dealloc_ND_mem((void **)(*out), meta, (dimension+1));
-    *out = (*out != NULL) ? free(*out) , NULL : NULL ;
 
-err_NDmem_dealloc :
-    return ;
+/*****************************************************************************/
+/*!
+ * \brief  Step over records of text, strtok_r() style : each is a run of
+ *         characters other than the separator
+ * \param  *pos - text
+ * \param  *end - end of the text
+ * \param  sep - separator of the records
+ * \param  n - records to step over
+ * \return the separator after the n-th record, or end
+ */
+/*****************************************************************************/
+static uint8_t *_skip_records( uint8_t *pos, uint8_t *end, uint8_t sep, uint64_t n )
+{
+    uint8_t *next = NULL ;
 
+    for( ; (n != 0) && (pos < end) ; n-- ) {
+        while((pos < end) && (*pos == sep))
+            pos++ ;
+        next = memchr( pos, sep, (size_t)(end - pos));
+        pos = (next != NULL) ? next : end ;
+    }
+    return pos ;
 }
 
 
+
 /*****************************************************************************/
 /*!
- * \brief  Function to return no of items in a dimension
- * \param  *meta -  Data structure holding global meta-data about dimensions
+ * \brief  Map a file private and writable, followed by at least one zero
+ *         byte, for parsing in place under a memory limit. Pages are only
+ *         copied where they are written to. Compressed files are left to
+ *         _read_text() : they are inflated whole anyway
+ * \param  **buff - output text, NULL when the file is left to _read_text()
+ * \param  *size - number of bytes of text
+ * \param  *path - file path
+ * \param  *hash - output hash of the file (see hash.h)
+ * \param  *win - mapping, released with _text_release()
  * \return returns api_Success on success.
  */
 /*****************************************************************************/
-static inline uint32_t _1D_sizeof_dim( Vector_MetaData *meta )
+static api_Err_Status _map_text( uint8_t **buff, uint64_t *size, char *path, uint64_t *hash, Text_Window *win )
 {
-    return meta->dim.dim_1d.items ;
+    api_Err_Status err = api_Success ;
+    Hash_State hs ;
+    Perf_Sample ps ;
+    struct stat sb ;
+    uint8_t *base = NULL ;
+    uint64_t page = (uint64_t)sysconf( _SC_PAGESIZE ) , map_bytes = 0 ;
+    int fd = -1 ;
+
+    fd = open( path , O_RDONLY );
+    if( fd == -1 ) {
+        debug("Could not open file[%s]. errno = %d", path, errno ) ;
+        err = api_Err_File ;
+        goto err_text_map ;
+    }
+    memset( &sb , 0  , sizeof(struct stat));
+    if((fstat( fd , &sb ) == -1) || ((sb.st_mode & S_IFMT) != S_IFREG )) {
+        debug("file [%s] is not a file! errno = %d", path, errno);
+        err = api_Err_File ;
+        goto err_text_map ;
+    }
+
+    /* zero pages past the end of the file terminate the text */
+    map_bytes = (((uint64_t)sb.st_size + page) / page) * page ;
+    base = mmap( NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( base == MAP_FAILED ) {
+        debug("Could not map %llu bytes for [%s]. errno = %d", (unsigned long long)map_bytes, path, errno);
+        base = NULL ;
+        goto err_text_map ;
+    }
+    if((sb.st_size != 0) && (mmap( base, (size_t)sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                                    fd, 0 ) == MAP_FAILED)) {
+        debug("Could not map file [%s]. errno = %d : reading it instead", path, errno);
+        goto err_text_map ;
+    }
+    if( compress_format( base, (uint64_t)sb.st_size ) != Compress_None )
+        goto err_text_map ;
+    madvise( base, map_bytes, MADV_SEQUENTIAL );
+
+    hash_init( &hs );
+    perf_begin( &ps );
+    hash_update( &hs, base, (uint64_t)sb.st_size );
+    perf_end( &ps, Perf_Read, (uint64_t)sb.st_size );
+    *hash = hash_digest( &hs );
+
+    win->base = base ;
+    win->size = (uint64_t)sb.st_size ;
+    win->map_bytes = map_bytes ;
+    win->page = page ;
+    win->done = base ;
+    win->window = win->size + 1 ;
+    *buff = base ;
+    *size = win->size ;
+    close( fd );
+    return err ;
+
+err_text_map :
+    if( base != NULL )
+        munmap( base, map_bytes );
+    if( fd != -1 )
+        close( fd );
+    return err ;
 }
 
+
+
 /*****************************************************************************/
 /*!
- * \brief  Function to return no of items in a dimension for the 2D structure
- * \param  *meta -  Data structure holding global meta-data about dimensions
- * \return returns api_Success on success.
+ * \brief  Size the window of mapped text once the dimensions are known :
+ *         whatever the values leave under the limit. The window is charged
+ *         to the calling thread's stage until _text_release()
+ * \param  *win - mapping from _map_text()
+ * \param  *meta - detected dimensions
+ * \param  placed - values go to memory placed by the caller
+ * \param  *path - file path, for messages
+ * \return api_Err_Memory when the values do not fit under the limit
  */
 /*****************************************************************************/
-static inline uint32_t _2D_sizeof_dim( Vector_MetaData *meta , uint32_t dim )
+static api_Err_Status _window_plan( Text_Window *win, Vector_MetaData *meta, uint32_t placed, char *path )
 {
-    uint64_t dim_size = 0 ;
-    if((dim+1) == 1 )
-        dim_size = meta->dim.dim_2d.rows ;
-    else if((dim+1) == 2 )
-        dim_size = meta->dim.dim_2d.cols ;
+    uint64_t need = _ND_bytes( meta, placed ) , room = mem_headroom();
+    uint64_t slack = TEXT_WINDOW_SLACK * win->page ;
+
+    if( room < need + slack + TEXT_WINDOW_MIN ) {
+        log_error("[%s] : %.1f MiB of values and text do not fit the memory limit, %.1f MiB free", path,
+                    (double)(need + slack + TEXT_WINDOW_MIN) / (1 << 20), (double)room / (1 << 20));
+        return api_Err_Memory ;
+    }
 
-    return dim_size ;
+    win->window = room - need - slack ;
+    if( win->window > win->size ) {
+        win->window = win->size + 1 ;
+    } else {
+        debug("[%s] : %.1f MiB of text streamed through a %.1f MiB window to stay under the memory limit", path,
+                    (double)win->size / (1 << 20), (double)win->window / (1 << 20));
+    }
+    win->charged = win->window + slack ;
+    return mem_charge( win->charged, &win->stage );
 }
 
 
+
 /*****************************************************************************/
 /*!
- * \brief  Function to return no of items in a dimension for the 3D structure
- * \param  *meta -  Data structure holding global meta-data about dimensions
- * \return returns api_Success on success.
+ * \brief  Drop the mapped pages behind the parse once the window is full.
+ *         They read back as the file; tokens before pos are not visited
+ *         again by strtok_r()
+ * \param  *win - mapping from _map_text()
+ * \param  *pos - token being parsed
+ * \return none
  */
 /*****************************************************************************/
-static inline uint32_t _3D_sizeof_dim( Vector_MetaData *meta , uint32_t dim )
+static void _window_drop( Text_Window *win, uint8_t *pos )
 {
-    uint64_t dim_size = 0 ;
-    if((dim+1) == 1 )
-        dim_size = meta->dim.dim_3d.dim_z ;
-    else if((dim+1) == 2 )
-        dim_size = meta->dim.dim_3d.dim_y ;
-    else if((dim+1) == 3 )
-        dim_size = meta->dim.dim_3d.dim_x ;
-
-    return dim_size ;
+    uint8_t *end = (uint8_t *)((uintptr_t)pos & ~(uintptr_t)(win->page - 1)) ;
+
+    if( end <= win->done )
+        return ;
+    if( madvise( win->done, (size_t)(end - win->done), MADV_DONTNEED ) != 0 )
+        log_dbg("madvise(MADV_DONTNEED) of parsed text failed. errno = %d", errno);
+    win->done = end ;
+    return ;
 }
 
 
+/*****************************************************************************/
+/*!
+ * \brief  Release file text : unmap it and its window's charge, or free it
+ * \param  **buff - text, set to NULL
+ * \param  *win - mapping from _map_text(), unused for a buffer
+ * \return none
+ */
+/*****************************************************************************/
+static void _text_release( uint8_t **buff, Text_Window *win )
+{
+    if((win != NULL) && (win->base != NULL)) {
+        munmap( win->base, win->map_bytes );
+        if( win->charged != 0 )
+            mem_release( win->charged, win->stage );
+        memset( win, 0, sizeof(*win));
+        *buff = NULL ;
+        return ;
+    }
+    *buff = (*buff != NULL) ? huge_free(*buff) , NULL : NULL ;
+    return ;
+}
+
 
 
 /*****************************************************************************/
 /*!
- * \brief  Function to return no of items in a dimension for the 3D structure
- * \param  *buff -  Output Buffer which will have parsed data
- * \param  *file_content -  Buffer holding content of file
- * \param  *sep_list -  List of separators - only the first is considered for 1D data
- * \param  *meta -  Data structure holding global meta-data about dimensions
+ * \brief  Bytes _alloc_ND_mem() allocates for an array : row pointers and
+ *         values
+ * \param  *meta - dimensions and data-type
+ * \param  placed - values go to memory placed by the caller : pointers only
+ * \return bytes
+ */
+/*****************************************************************************/
+static uint64_t _ND_bytes( Vector_MetaData *meta, uint32_t placed )
+{
+    uint64_t ptrs = 0 , rows = 1 ;
+    uint32_t axis = 0 ;
+
+    /* one pointer per sub-array of every axis but the innermost */
+    for( axis=0 ; (axis + 1) < meta->no_dims ; axis++ ) {
+        rows *= meta->dim.shape[axis] ;
+        ptrs += rows ;
+    }
+    return (ptrs * sizeof(void *)) + (placed ? 0 : data_items( meta ) * sizeof_datatype( meta->type )) ;
+}
+
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Dynamically create an n-dimensional array (up to DATA_MAX_DIMS
+ *         dimensions)
+ *
+ * \param  ***out - output buffer holding parsed data from file
+ * \param  *meta -  detected dimension. Memory should be allocated by caller.
+ *                      Caller should also fill in type with correct entry
+ *                      before this function is called
+ * \param  dimension  - which axis are we currently allocating memory for
+ * \param  mult_factor- to be used in recursion. Factor to multiply with
+ *                      number of elements in current dimension while allocating
+ *                      space. This will be the mult-accumulated value from all the
+ *                      number of elements of previous axes
+ * \param  *payload  - values of the last dimension when placed by the
+ *                      caller, NULL to allocate them
  * \return returns api_Success on success.
+ * \note   This function will be called recursively to add memory for the next
+ *         dimension until we exhaust dimensions
  */
 /*****************************************************************************/
-static api_Err_Status _parse_data_1D( void *buff, uint8_t *file_content , uint8_t *sep_list , Vector_MetaData *meta )
+static api_Err_Status _alloc_ND_mem( void **out, Vector_MetaData *meta, uint32_t dimension , uint64_t mult_factor, void *payload)
 {
     api_Err_Status err = api_Success ;
-    uint8_t *str = NULL , *l_ptr = NULL ;
-    uint8_t sep[2] = "" ;
     uint64_t idx_i = 0 ;
-    uint8_t *conv_err = NULL ;
-    float f_temp = 0.0f ;
-    double d_temp = 0.0 ;
-    long double ld_temp = 0.0 ;
+    uint32_t type_size = 0, next_dim_size_t = 0 ;
+    uint64_t elem = 0 , next_dim_elem = 0 ;
 
     /* sanity check inputs */
-    if( buff == NULL ) {
-        debug("Cannot write values into buffer");
+    if( out == NULL ) {
+        debug("Cannot alloc memory into NULL pointer");
         err = api_Err_Param ;
-        goto err_1D_parse ;
-    }
-    if( file_content == NULL ) {
-        debug("Data read from file = NULL");
+        goto err_NDmem_alloc ;
+    } else if( *out != NULL ) {
+        debug("Possible over-write of memory!");
         err = api_Err_Param ;
-        goto err_1D_parse ;
+        goto err_NDmem_alloc ;
     }
-    if( sep_list == NULL ) {
-        debug("Separator list = NULL");
+
+    if( meta == NULL ) {
+        debug("Meta-data about data-in-memory = NULL");
         err = api_Err_Param ;
-        goto err_1D_parse ;
+        goto err_NDmem_alloc ;
     }
-    if( meta == NULL ) {
-        debug("Vector meta-data structure = NULL. Abort");
+
+
+    if((meta->no_dims == 0) || (meta->no_dims > DATA_MAX_DIMS)) {
+        debug("Only 1 to %u dimensions supported, not %u", DATA_MAX_DIMS, meta->no_dims);
         err = api_Err_Param ;
-        goto err_1D_parse ;
+        goto err_NDmem_alloc ;
+    }
+
+    /* We do not need to allocate for a non-existent dimension */
+    if( dimension >= meta->no_dims )
+        return err ;
+
+    /*!
+     * If we are at the last dimension sizeof-type should be
+     * actual size of type, otherwise it should be type (void *)
+     */
+    type_size = ((dimension + 1) == meta->no_dims) ? sizeof_datatype( meta->type ) : sizeof(void *);
+
+
+    /* Figure out how many members of each dimension we have to allocate */
+    elem = meta->dim.shape[dimension] ;
+    if((dimension + 1) < meta->no_dims )
+        next_dim_elem = meta->dim.shape[dimension+1] ;
+
+    /* Allocate space to hold pointers to current stride in the matrix */
+    if(((dimension + 1) == meta->no_dims) && (payload != NULL)) {
+        *out = payload ;             /* placed values need not be zeroed */
+        return err ;
+    }
+    *out = huge_alloc( elem * mult_factor * type_size, 1 );
+    if( *out == NULL ) {
+        debug("Could not allocate memory space to hold %llu elements . Type-size = %u", (unsigned long long)(elem * mult_factor), type_size );
+        err = api_Err_Memory ;
+        goto err_NDmem_alloc ;
     }
 
+    /* Allocate space for next dimension */
+    err = _alloc_ND_mem((void **)*out, meta, dimension+1, mult_factor*elem, payload);
+    if( err != api_Success ) {
+        debug("Could not allocate memory for dimension %u", dimension+1);
+        goto err_NDmem_alloc_mem ;
+    }
 
-    sep[0] = sep_list[0] ;
-    for( str = strtok_r(file_content, sep, &l_ptr) , idx_i = 0 ;
-                       str != NULL ; str = strtok_r(NULL, sep, &l_ptr), idx_i++) {
-        err = _convert_to_number( str, meta, buff, idx_i );
-        if( err != api_Success ) {
-            debug("Error converting string to value. index = %u, err = %d", idx_i, err );
-            goto err_1D_parse ;
+    /*!
+     * Add pointers to all other rows into pointer list for access
+     * We do not do this if this invocation is for the last dimension
+     * as we will end up putting corrupt values (i.e addresses from NULL)
+     *r into the last dimension access. If these pages are locked down,
+     * then this will cause exceptions
+     */
+    if((dimension+1) < meta->no_dims ) {
+        next_dim_size_t = ((dimension+2) == meta->no_dims) ? sizeof_datatype( meta->type ) : sizeof(void *) ;
+        for( idx_i=1 ; idx_i < (elem * mult_factor) ; idx_i++ ) {
+            ((void **)(*out))[idx_i] = **((void ***)out) + (idx_i * next_dim_elem * next_dim_size_t ) ;
         }
     }
 
-err_1D_parse :
+    return err ;
+
+err_NDmem_alloc_mem :
+    *out = (*out != NULL) ? huge_free(*out), NULL : NULL ;
+err_NDmem_alloc :
     return err ;
 }
 
@@ -649,156 +1436,159 @@ err_1D_parse :
 
 /*****************************************************************************/
 /*!
- * \brief  Function to return no of items in a dimension for the 3D structure
- * \param  **buff -  Output Buffer which will have parsed data
- * \param  *file_content -  Buffer holding content of file
- * \param  *sep_list -  List of separators - only the first is considered for 1D data
- * \param  *meta -  Data structure holding global meta-data about dimensions
- * \return returns api_Success on success.
+ * \brief  Release an n-dimensional array made by _alloc_ND_mem()
+ *
+ * \param  ***out - output buffer holding parsed data from file
+ * \param  *meta -  detected dimension. Memory should be allocated by caller.
+ *                      Caller should also fill in type with correct entry
+ *                      before this function is called
+ * \param  dimension  - which axis are we currently allocating memory for
+ * \param  keep_payload - values of the last dimension are not ours to free
+ * \return void
+ * \note   This function will be called recursively to add memory for the next
+ *         dimension until we exhaust dimensions
  */
 /*****************************************************************************/
-static api_Err_Status _parse_data_2D( void **buff, uint8_t *file_content , uint8_t *sep_list , Vector_MetaData *meta )
+static void  _dealloc_ND_mem( void **out, Vector_MetaData *meta, uint32_t dimension, uint32_t keep_payload )
 {
     api_Err_Status err = api_Success ;
-    uint8_t *linebuff = NULL , *l_ptr = NULL , *v_ptr = NULL, *d_ptr = NULL ;
-    uint8_t sep_r[2] = "" , sep_c[2] = "" ;
-    uint64_t idx_i = 0 , idx_j = 0 ;
-    uint8_t *conv_err = NULL ;
-    float f_temp = 0.0f ;
-    double d_temp = 0.0 ;
-    long double ld_temp = 0.0 ;
 
-    /* sanity check inputs */
-    if((buff == NULL ) || (*buff == NULL)) {
-        debug("Cannot write values into NULL buffer. buff = %p", buff);
-        err = api_Err_Param ;
-        goto err_2D_parse ;
-    }
-    if( file_content == NULL ) {
-        debug("Data read from file = NULL");
-        err = api_Err_Param ;
-        goto err_2D_parse ;
-    }
-    if( sep_list == NULL ) {
-        debug("Separator list = NULL");
-        err = api_Err_Param ;
-        goto err_2D_parse ;
-    }
-    memset( sep_r, 0, sizeof(sep_r));
-    memset( sep_c, 0, sizeof(sep_c));
+    if( meta == NULL )
+        goto err_NDmem_dealloc ;
 
-    if( meta == NULL ) {
-        debug("Vector meta-data structure = NULL. Abort");
-        err = api_Err_Param ;
-        goto err_2D_parse ;
-    }
+    /* Check if function has hit recursive limit */
+    if( dimension >= meta->no_dims)
+        return ;
 
-    sep_r[0] = sep_list[1];   /* Second delimiter is for rows */
-    sep_c[0] = sep_list[0];    /* First delimiter is for columns */
+    if( out == NULL )
+        goto err_NDmem_dealloc ;
 
-    /* Parse files for data and convert */
-    for( linebuff = strtok_r(file_content, sep_r, &l_ptr) , idx_i = 0 ;
-                linebuff != NULL ; linebuff = strtok_r(NULL, sep_r, &l_ptr), idx_i++) {
-        for( v_ptr = strtok_r(linebuff, sep_c, &d_ptr) , idx_j = 0 ;
-                    v_ptr != NULL ; v_ptr = strtok_r(NULL, sep_c, &d_ptr) , idx_j++) {
+    _dealloc_ND_mem((void **)(*out), meta, (dimension+1), keep_payload);
+    if( keep_payload && ((dimension + 1) == meta->no_dims))
+        *out = NULL ;
+    else
+        *out = (*out != NULL) ? huge_free(*out) , NULL : NULL ;
 
-            err = _convert_to_number( v_ptr, meta, (void *)(*buff),
-                                       (idx_i * meta->dim.dim_2d.cols) + idx_j );
-            if( err != api_Success ) {
-                debug("Error converting string to value. index = %u, err = %d", idx_i, err );
-                goto err_2D_parse ;
-            }
-        }    /* for each column */
-    }   /* for each row */
+err_NDmem_dealloc :
+    return ;
 
-err_2D_parse :
-    return err ;
 }
 
 
-
-
-
 /*****************************************************************************/
 /*!
- * \brief  Function to return no of items in a dimension for the 3D structure
- * \param  ***buff -  Output Buffer which will have parsed data
+ * \brief  Parse text of any rank into the values of an array from
+ *         _alloc_ND_mem(). sep_list[0] splits the innermost axis,
+ *         sep_list[no_dims-1] the outermost
+ * \param  *buff -  Output Buffer which will have parsed data
  * \param  *file_content -  Buffer holding content of file
- * \param  *sep_list -  List of separators - only the first is considered for 1D data
+ * \param  *sep_list -  List of separators, one per dimension
  * \param  *meta -  Data structure holding global meta-data about dimensions
+ * \param  *strict - strict conversion state, NULL for plain conversion
+ * \param  *win - mapped text to drop behind the parse, NULL for a buffer
  * \return returns api_Success on success.
  */
 /*****************************************************************************/
-static api_Err_Status _parse_data_3D( void ***buff, uint8_t *file_content , uint8_t *sep_list , Vector_MetaData *meta )
+static api_Err_Status _parse_data_ND( void *buff, uint8_t *file_content , uint8_t *sep_list , Vector_MetaData *meta, Strict_Block *strict, Text_Window *win )
 {
     api_Err_Status err = api_Success ;
-    uint8_t *dimx_ptr = NULL , *dimy_ptr = NULL, *dimz_ptr = NULL;
-    uint8_t *save_x = NULL , *save_y = NULL, *save_z = NULL;
-    uint8_t sep_x[2] = "", sep_y[2] = "", sep_z[2] = "" ;
-    uint64_t idx_i = 0 , idx_j = 0, idx_k = 0 ;
-    uint8_t *conv_err = NULL ;
-    float f_temp = 0.0f ;
-    double d_temp = 0.0 ;
-    long double ld_temp = 0.0 ;
+    Parse_Ctx ctx ;
+    uint32_t axis = 0 ;
 
     /* sanity check inputs */
-    if((buff == NULL ) || (*buff == NULL) || (**buff == NULL)) {
-        debug("Cannot write values into NULL buffer. buff = %p , *buff = %p"
-                                               , buff , buff ? *buff : "buff = null" );
-        err = api_Err_Param ;
-        goto err_3D_parse ;
-    }
     if( file_content == NULL ) {
         debug("Data read from file = NULL");
         err = api_Err_Param ;
-        goto err_3D_parse ;
+        goto err_ND_parse ;
     }
     if( sep_list == NULL ) {
         debug("Separator list = NULL");
         err = api_Err_Param ;
-        goto err_3D_parse ;
+        goto err_ND_parse ;
     }
-    memset( sep_x, 0, sizeof(sep_x));
-    memset( sep_y, 0, sizeof(sep_y));
-    memset( sep_z, 0, sizeof(sep_z));
-
     if( meta == NULL ) {
         debug("Vector meta-data structure = NULL. Abort");
         err = api_Err_Param ;
-        goto err_3D_parse ;
+        goto err_ND_parse ;
+    }
+    if((meta->no_dims == 0) || (meta->no_dims > DATA_MAX_DIMS) || (strlen( sep_list ) < meta->no_dims)) {
+        debug("Cannot parse %u dimensions with separators [%s]", meta->no_dims, sep_list);
+        err = api_Err_Param ;
+        goto err_ND_parse ;
+    }
+
+    memset( &ctx, 0, sizeof(ctx));
+    ctx.meta = meta ;
+    ctx.values = data_payload( buff, meta );
+    ctx.strict = strict ;
+    ctx.win = win ;
+    if( ctx.values == NULL ) {
+        debug("Cannot write values into NULL buffer. buff = %p", buff);
+        err = api_Err_Param ;
+        goto err_ND_parse ;
     }
+    for( axis=0 ; axis < meta->no_dims ; axis++ )
+        ctx.sep[axis][0] = sep_list[meta->no_dims - 1 - axis] ;
 
-    sep_x[0] = sep_list[0];   /* First delimiter is for dimension-x */
-    sep_y[0] = sep_list[1];   /* Second delimiter is for dimension-y */
-    sep_z[0] = sep_list[2];   /* Third delimiter is for dimension-z */
+    err = _parse_axis( &ctx, file_content, 0, 0, 1 );
+    if( err != api_Success )
+        goto err_ND_parse ;
+    if( strict != NULL )
+        err = _strict_flush( strict );
 
-    /* Parse files for data and convert */
-    for( dimz_ptr = strtok_r(file_content, sep_z, &save_z) , idx_i = 0 ;
-                dimz_ptr != NULL ; dimz_ptr = strtok_r(NULL, sep_z, &save_z), idx_i++) {
-        for( dimy_ptr = strtok_r(dimz_ptr, sep_y, &save_y) , idx_j = 0 ;
-                    dimy_ptr != NULL ; dimy_ptr = strtok_r(NULL, sep_y, &save_y) , idx_j++) {
-            for( dimx_ptr = strtok_r(dimy_ptr, sep_x, &save_x) , idx_k = 0 ;
-                        dimx_ptr != NULL ; dimx_ptr = strtok_r(NULL, sep_x, &save_x) , idx_k++) {
+err_ND_parse :
+    return err ;
+}
 
-                err = _convert_to_number( dimx_ptr, meta, (void *)(**buff),
-                                          (idx_i * meta->dim.dim_3d.dim_y * meta->dim.dim_3d.dim_x) + (idx_j * meta->dim.dim_3d.dim_x) +  idx_k );
-                if( err != api_Success ) {
-                    debug("Error converting string to value. index = %u, err = %d", idx_i, err );
-                    goto err_3D_parse ;
-                }
-            }   /* for each item in dim-x */
-        }   /* for each item in dim-y */
-    }   /* for each item in dim-z */
 
+/*****************************************************************************/
+/*!
+ * \brief  Split one block of text along an axis, descending into each
+ *         piece until the innermost axis, whose tokens are converted
+ * \param  *ctx - parse state
+ * \param  *text - the block, NUL-terminated by the enclosing strtok_r()
+ * \param  axis - axis the block is split along, 0 outermost
+ * \param  base - flat index of the block's first element, in units of
+ *                this axis' extent
+ * \param  inside - every enclosing index is within the detected shape ;
+ *                  0 : values are syntax-checked only
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _parse_axis( Parse_Ctx *ctx, uint8_t *text, uint32_t axis, uint64_t base, uint32_t inside )
+{
+    api_Err_Status err = api_Success ;
+    Vector_MetaData *meta = ctx->meta ;
+    uint64_t extent = meta->dim.shape[axis] , idx_i = 0 ;
+    uint8_t *str = NULL ;
+
+    if((axis + 1) == meta->no_dims ) {
+        for( str = (uint8_t *)strtok_r((char *)text, ctx->sep[axis], &ctx->save[axis]) , idx_i = 0 ;
+                    str != NULL ; str = (uint8_t *)strtok_r(NULL, ctx->sep[axis], &ctx->save[axis]) , idx_i++ ) {
+            TEXT_WINDOW_SLIDE( ctx->win, str );
+            err = _convert_token( ctx->strict, str, meta, ctx->values, (base * extent) + idx_i,
+                                       inside && ((axis == 0) || (idx_i < extent)));
+            if( err != api_Success ) {
+                debug("Error converting string to value. index = %llu, err = %d", (unsigned long long)idx_i, err );
+                return err ;
+            }
+        }
+        return err ;
+    }
 
-err_3D_parse :
+    for( str = (uint8_t *)strtok_r((char *)text, ctx->sep[axis], &ctx->save[axis]) , idx_i = 0 ;
+                str != NULL ; str = (uint8_t *)strtok_r(NULL, ctx->sep[axis], &ctx->save[axis]) , idx_i++ ) {
+        err = _parse_axis( ctx, str, axis+1, (base * extent) + idx_i,
+                                inside && ((axis == 0) || (idx_i < extent)));
+        if( err != api_Success )
+            return err ;
+    }
     return err ;
 }
 
 
 
 
-
 /*****************************************************************************/
 /*!
  * \brief  Function to convert text to a number of specified type
@@ -923,6 +1713,21 @@ static api_Err_Status _convert_to_number( uint8_t *str, Vector_MetaData *meta, v
             }
             ((long double *)buff)[idx_i] = ld_temp ;
             break ;
+        case DataType_float16 :
+        case DataType_bfloat16 :
+            /* parse as float, then round to the 16-bit format */
+            f_temp = (float)strtof(str , &conv_err );
+            if((f_temp == 0.0 ) && (conv_err == (char *)str)){
+                debug("strtof() conversion error @ (zero-indexed) line-%llu", idx_i );
+                err = api_Err_Failure ;
+                goto err_convert ;
+            } else if((f_temp == HUGE_VALF) || ((meta->type == DataType_float16) && (fabsf( f_temp ) > 65504.0f))) {
+                debug("%s value saturation", datatype_name( meta->type ));
+                err = api_Err_Failure ;
+                goto err_convert ;
+            }
+            ((uint16_t *)buff)[idx_i] = (meta->type == DataType_float16) ? f32_to_half( f_temp ) : f32_to_bf16( f_temp );
+            break ;
         default :
             debug("Unknown data-type");
             err = api_Err_Param ;
@@ -935,164 +1740,295 @@ err_convert :
 
 
 
-
-
 /*****************************************************************************/
 /*!
- * \brief  Given a long string (*buff)er and a separator string, count how many
- *         items are available in the string
- *
- * \param  *(*buff) - data (*buff)er with text to count number of items
- * \param  *sep_list -  list of separators from command-line. Only the first
- *                      character is considered as a separator.
- * \param  *meta  - meta-data structure, which contains no-of-dimensions
- *                  (caller responsibility). The number of items will be
- *                  populated in this structure
- *
+ * \brief  Convert one token, strictly when a Strict_Block is given : the
+ *         value goes to the block in a wide type, the checks are made when
+ *         the block is flushed
+ * \param  *sb - strict conversion state, NULL for _convert_to_number()
+ * \param  *str - NUL-terminated token
+ * \param  *meta - meta-data of the array
+ * \param  *buff - values of the array
+ * \param  idx_i - index of the value
+ * \param  inside - the token lies within the detected dimensions
  * \return returns api_Success on success.
  */
 /*****************************************************************************/
-static api_Err_Status _detect_1D_items( uint8_t *buff, uint8_t *sep_list, Vector_MetaData *meta )
+static api_Err_Status _convert_token( Strict_Block *sb, uint8_t *str, Vector_MetaData *meta, void *buff, uint64_t idx_i, uint32_t inside )
 {
     api_Err_Status err = api_Success ;
-    uint8_t *content = NULL , *l_ptr=NULL, *linebuff = NULL, sep[2] = "" ;
+    char *lead = (char *)str , *end = NULL ;
+    long double ld_temp = 0.0 ;
+    uint32_t n = 0 , neg = 0 , over = 0 ;
 
-    /* Sanity check inputs */
-    if( buff == NULL ) {
-        debug("Empty (*buff) data passed into function");
-        err = api_Err_Param ;
-        goto err_1D_item_detect ;
-    }
-    if( sep_list == NULL ) {
-        debug("Empty separator string passed into function");
-        err = api_Err_Param ;
-        goto err_1D_item_detect ;
-    }
-    if( meta == NULL ) {
-        debug("meta-data struct = NULL");
-        err = api_Err_Param ;
-        goto err_1D_item_detect ;
+    if( sb == NULL )
+        return _convert_to_number( str, meta, buff, idx_i );
+
+    /* the block holds consecutive values only */
+    if((sb->count == STRICT_BLOCK) || ((sb->count != 0) && (idx_i != sb->first + sb->count)) || !inside ) {
+        err = _strict_flush( sb );
+        if( err != api_Success )
+            return err ;
     }
-    if( meta->no_dims != 1 ) {
-        debug("Error : function called with dimensions [%u]", meta->no_dims);
-        err = api_Err_Param ;
-        goto err_1D_item_detect ;
+    if( !inside ) {
+        sb->fault = Strict_Extent ;
+        sb->fault_offset = (uint64_t)(str - sb->base) ;
+        return api_Err_Failure ;
     }
+    if( sb->count == 0 )
+        sb->first = idx_i ;
+    n = sb->count++ ;
+    sb->tok[n] = str ;
 
-    /* obtain duplicates of data buffer */
-    content = strdup(buff);
-    if( content == NULL ) {
-        debug("Could not duplicate data buffer in RAM to count items");
-        err = api_Err_Memory ;
-        goto err_1D_item_detect ;
+    while( isspace((unsigned char)*lead ))
+        lead++ ;
+    errno = 0 ;
+    switch( meta->type )
+    {
+        case DataType_uint8  :
+        case DataType_uint16 :
+        case DataType_uint32 :
+        case DataType_uint64 :
+            /* strtoull() negates "-1" : no sign for unsigned types */
+            sb->wide.u[n] = strtoull( lead, &end, 0 );
+            neg = (*lead == '-') ;
+            over = (errno == ERANGE) ;
+            break ;
+        case DataType_int8  :
+        case DataType_int16 :
+        case DataType_int32 :
+        case DataType_int64 :
+            sb->wide.s[n] = strtoll( lead, &end, 0 );
+            over = (errno == ERANGE) ;
+            break ;
+        case DataType_long_double :
+            ld_temp = strtold( lead, &end );
+            ((long double *)sb->buff)[idx_i] = ld_temp ;
+            over = (errno == ERANGE) && (fabsl( ld_temp ) > 1.0L) ;
+            break ;
+        default :
+            /* float types are range-checked in double : ERANGE on underflow is fine */
+            sb->wide.d[n] = strtod( lead, &end );
+            over = (errno == ERANGE) && (fabs( sb->wide.d[n] ) > 1.0) ;
+            break ;
     }
-
-    /* obtain duplicate of separator string */
-    memset(sep,0,sizeof(sep));
-    sep[0] = sep_list[0];
-
-    for( linebuff = strtok_r(content, sep, &l_ptr) ;
-                       linebuff != NULL ; linebuff = strtok_r(NULL, sep, &l_ptr) )
-        meta->dim.dim_1d.items++ ;
-
-
-err_1D_item_detect :
-    content = (content != NULL) ? free(content), NULL : NULL ;
+    while( isspace((unsigned char)*end ))
+        end++ ;
+    sb->bad[n] = ((end == lead) | (*end != '\0') | neg) ? Strict_Syntax : (over ? Strict_Range : Strict_None) ;
     return err ;
 }
 
+
+
 /*****************************************************************************/
 /*!
- * \brief  Given a long string buffer and a separator string, count how many
- *         items are available in the string
- *
- * \param  *buff - data buffer with text to count number of items
- * \param  *sep_list -  list of separators from command-line. Only the first
- *                      two characters are considered as a separator.
- * \param  *meta  - meta-data structure, which contains no-of_dimensions
- *                  (caller responsibility). The number of items will be
- *                  populated in this structure
- *
+ * \brief  Check the values held in a Strict_Block and store them in the
+ *         array. On a failure the first bad token is recorded in sb->fault
+ * \param  *sb - strict conversion state
  * \return returns api_Success on success.
  */
 /*****************************************************************************/
-static api_Err_Status _detect_2D_sizes( uint8_t *buff, uint8_t *sep_list, Vector_MetaData *meta )
+static api_Err_Status _strict_flush( Strict_Block *sb )
 {
-    api_Err_Status err = api_Success ;
-    uint8_t *content = NULL , *row_ptr=NULL, *col_ptr = NULL, *linebuff = NULL , *ptr = NULL ;
-    uint8_t sep[2] = "" ;
-
-    /* Sanity check inputs */
-    if( buff == NULL ) {
-        debug("Empty buff data passed into function");
-        err = api_Err_Param ;
-        goto err_2D_item_detect ;
-    }
-    if( sep_list == NULL ) {
-        debug("Empty separator string passed into function");
-        err = api_Err_Param ;
-        goto err_2D_item_detect ;
-    }
-    if( meta == NULL ) {
-        debug("meta-data struct = NULL");
-        err = api_Err_Param ;
-        goto err_2D_item_detect ;
+    uint32_t n = sb->count , idx_i = 0 ;
+    uint64_t flags = 0 , first = sb->first ;
+
+    if( n == 0 )
+        return api_Success ;
+    sb->count = 0 ;
+
+    flags = _strict_any( sb->bad, n ) | _strict_range( sb, 0, n );
+    if( flags != 0 ) {
+        /* slow path : find the offender */
+        for( idx_i=0 ; (idx_i < n) && (sb->bad[idx_i] == Strict_None) && !_strict_range( sb, idx_i, 1 ) ; idx_i++ )
+            ;
+        sb->fault = (sb->bad[idx_i] != Strict_None) ? (Strict_Fault)sb->bad[idx_i] : Strict_Range ;
+        sb->fault_offset = (uint64_t)(sb->tok[idx_i] - sb->base) ;
+        return api_Err_Failure ;
     }
-    if( meta->no_dims != 2 ) {
-        debug("Error : function called with dimensions [%u]", meta->no_dims);
-        err = api_Err_Param ;
-        goto err_2D_item_detect ;
+
+    switch( sb->meta->type )
+    {
+        case DataType_uint8 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((uint8_t *)sb->buff)[first + idx_i] = (uint8_t)sb->wide.u[idx_i] ;
+            break ;
+        case DataType_uint16 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((uint16_t *)sb->buff)[first + idx_i] = (uint16_t)sb->wide.u[idx_i] ;
+            break ;
+        case DataType_uint32 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((uint32_t *)sb->buff)[first + idx_i] = (uint32_t)sb->wide.u[idx_i] ;
+            break ;
+        case DataType_uint64 :
+            memcpy((uint64_t *)sb->buff + first, sb->wide.u, n * sizeof(uint64_t));
+            break ;
+        case DataType_int8 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((int8_t *)sb->buff)[first + idx_i] = (int8_t)sb->wide.s[idx_i] ;
+            break ;
+        case DataType_int16 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((int16_t *)sb->buff)[first + idx_i] = (int16_t)sb->wide.s[idx_i] ;
+            break ;
+        case DataType_int32 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((int32_t *)sb->buff)[first + idx_i] = (int32_t)sb->wide.s[idx_i] ;
+            break ;
+        case DataType_int64 :
+            memcpy((int64_t *)sb->buff + first, sb->wide.s, n * sizeof(int64_t));
+            break ;
+        case DataType_float :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((float *)sb->buff)[first + idx_i] = (float)sb->wide.d[idx_i] ;
+            break ;
+        case DataType_double :
+            memcpy((double *)sb->buff + first, sb->wide.d, n * sizeof(double));
+            break ;
+        case DataType_float16 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((uint16_t *)sb->buff)[first + idx_i] = f32_to_half((float)sb->wide.d[idx_i] );
+            break ;
+        case DataType_bfloat16 :
+            for( idx_i=0 ; idx_i < n ; idx_i++ )
+                ((uint16_t *)sb->buff)[first + idx_i] = f32_to_bf16((float)sb->wide.d[idx_i] );
+            break ;
+        default :
+            /* long double : stored as converted */
+            break ;
     }
+    return api_Success ;
+}
 
-    memset(sep,0,sizeof(sep));
 
-    /* obtain duplicates of data buffer */
-    content = strdup(buff);
-    if( content == NULL ) {
-        debug("Could not duplicate data buffer in RAM to count items");
-        err = api_Err_Memory ;
-        goto err_2D_item_detect ;
-    }
 
-    col_ptr = strchr( content, (int)sep_list[1] );
-    if( col_ptr == NULL ) {
-        debug("Could not detect row-separator in 2-D data");
-        err = api_Err_Memory ;
-        goto err_2D_item_detect ;
+/*****************************************************************************/
+/*!
+ * \brief  Range flags of n values of a Strict_Block from index from. 64-bit
+ *         and double values were range-checked through ERANGE
+ * \param  *sb - strict conversion state
+ * \param  from - first value
+ * \param  n - number of values
+ * \return non-zero if a value does not fit the data-type
+ */
+/*****************************************************************************/
+static uint64_t _strict_range( Strict_Block *sb, uint32_t from, uint32_t n )
+{
+    switch( sb->meta->type )
+    {
+        case DataType_uint8     : return _strict_range_u( sb->wide.u + from, n, UINT8_MAX );
+        case DataType_uint16    : return _strict_range_u( sb->wide.u + from, n, UINT16_MAX );
+        case DataType_uint32    : return _strict_range_u( sb->wide.u + from, n, UINT32_MAX );
+        case DataType_int8      : return _strict_range_s( sb->wide.s + from, n, INT8_MIN, INT8_MAX );
+        case DataType_int16     : return _strict_range_s( sb->wide.s + from, n, INT16_MIN, INT16_MAX );
+        case DataType_int32     : return _strict_range_s( sb->wide.s + from, n, INT32_MIN, INT32_MAX );
+        case DataType_float     :
+        case DataType_bfloat16  : return _strict_range_d( sb->wide.d + from, n, FLT_MAX );
+        case DataType_float16   : return _strict_range_d( sb->wide.d + from, n, 65504.0 );
+        default                 : return 0 ;
     }
+}
 
 
-    linebuff = strndup( content,(col_ptr - content));
-    if( linebuff == NULL ) {
-        debug("Could not duplicate data buffer in RAM to count items");
-        err = api_Err_Memory ;
-        goto err_2D_item_detect ;
-    }
 
-    /* Count number of columns in each row */
-    sep[0] = sep_list[0];    /* 1st char -denotes column delimiter */
-    for( col_ptr = strtok_r(linebuff, sep, &ptr) ;
-                       col_ptr != NULL ; col_ptr = strtok_r(NULL, sep, &ptr) )
-        meta->dim.dim_2d.cols++ ;
+/*****************************************************************************/
+/*!
+ * \brief  Branch-free flag reductions over a block
+ * \return non-zero if any value is flagged
+ */
+/*****************************************************************************/
+SIMD_KERNEL
+static uint64_t _strict_any( uint8_t *bad, uint32_t n )
+{
+    uint64_t flags = 0 ;
+    uint32_t idx_i = 0 ;
+
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        flags |= bad[idx_i] ;
+    return flags ;
+}
+
+SIMD_KERNEL
+static uint64_t _strict_range_s( int64_t *v, uint32_t n, int64_t lo, int64_t hi )
+{
+    uint64_t flags = 0 ;
+    uint32_t idx_i = 0 ;
 
-    free(linebuff);
-    linebuff = NULL ;
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        flags |= (uint64_t)((v[idx_i] < lo) | (v[idx_i] > hi)) ;
+    return flags ;
+}
 
+SIMD_KERNEL
+static uint64_t _strict_range_u( uint64_t *v, uint32_t n, uint64_t hi )
+{
+    uint64_t flags = 0 ;
+    uint32_t idx_i = 0 ;
 
-    /* Count number of rows */
-    sep[0] = sep_list[1];    /* 2nd char -denotes row delimiter */
-    for( linebuff = strtok_r(content, sep, &row_ptr) ;
-                       linebuff != NULL ; linebuff = strtok_r(NULL, sep, &row_ptr) )
-        meta->dim.dim_2d.rows++ ;
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        flags |= (uint64_t)(v[idx_i] > hi) ;
+    return flags ;
+}
 
+SIMD_KERNEL
+static uint64_t _strict_range_d( double *v, uint32_t n, double hi )
+{
+    uint64_t flags = 0 ;
+    uint32_t idx_i = 0 ;
 
-err_2D_item_detect :
-    content = (content != NULL) ? free(content), NULL : NULL ;
-    return err ;
+    /* finite values too large for the type; "inf" and "nan" were asked for */
+    for( idx_i=0 ; idx_i < n ; idx_i++ )
+        flags |= (uint64_t)((fabs( v[idx_i] ) > hi) & (fabs( v[idx_i] ) <= DBL_MAX)) ;
+    return flags ;
 }
 
 
 
+/*****************************************************************************/
+/*!
+ * \brief  Report the token a strict conversion failed on as
+ *         file:line:column. The text was split in place while parsing, so
+ *         the file is read again to count lines
+ * \param  *sb - strict conversion state with the fault
+ * \param  *path - file being parsed
+ * \param  *sep - separator list
+ * \return none
+ */
+/*****************************************************************************/
+static void _strict_report( Strict_Block *sb, char *path, uint8_t *sep )
+{
+    static const char *why[] = { "", "is not a valid %s", "is out of range for %s", "is past the row/plane length set by the first one" } ;
+    char reason[64] ;
+    uint8_t *text = NULL ;
+    uint64_t size = 0 , off = sb->fault_offset , line = 1 , col = 1 , idx_i = 0 , len = 0 , hash = 0 ;
+    Text_Window win ;
+
+    /* under a memory limit the text is looked at where it lies */
+    memset( &win, 0, sizeof(win));
+    snprintf( reason, sizeof(reason), why[sb->fault], datatype_name( sb->meta->type ));
+    if( mem_limit() != 0 )
+        _map_text( &text, &size, path, &hash, &win );
+    if(((text == NULL) && (read_text( &text, &size, path ) != api_Success)) || (off >= size)) {
+        log_error("%s: byte %llu : value %s", path, (unsigned long long)off, reason);
+        _text_release( &text, &win );
+        return ;
+    }
+    while((off < size) && (text[off] != '\n') && isspace( text[off] ))
+        off++ ;
+    for( idx_i=0 ; idx_i < off ; idx_i++ ) {
+        col = (text[idx_i] == '\n') ? 1 : col + 1 ;
+        line += (text[idx_i] == '\n') ;
+    }
+    while((off + len < size) && (len < 32) && !isspace( text[off + len] ) && (strchr((char *)sep, text[off + len]) == NULL))
+        len++ ;
+
+    log_error("%s:%llu:%llu: \"%.*s\" %s", path, (unsigned long long)line, (unsigned long long)col,
+                    (int)len, (char *)text + off, reason);
+    _text_release( &text, &win );
+    return ;
+}
+
 
 
 
@@ -1100,120 +2036,92 @@ err_2D_item_detect :
 /*****************************************************************************/
 /*!
  * \brief  Given a long string buffer and a separator string, count how many
- *         items are available in the string
+ *         items lie along each axis
  *
  * \param  *buff - data buffer with text to count number of items
- * \param  *sep_list -  list of separators from command-line. Only the first
- *                      three characters are considered as a separator.
- * \param  *meta  - meta-data structure, which contains no-ofdimensions
- *                  (caller responsibility). The number of items will be
- *                  populated in this structure
+ * \param  *sep_list -  list of separators from command-line. The first
+ *                      no_dims characters are separators, innermost axis
+ *                      first
+ * \param  *meta  - meta-data structure, which contains no-of-dimensions
+ *                  (caller responsibility). The extent of every axis will
+ *                  be populated in meta->dim.shape
  *
  * \return returns api_Success on success.
  */
 /*****************************************************************************/
-static api_Err_Status _detect_3D_sizes( uint8_t *buff, uint8_t *sep_list, Vector_MetaData *meta )
+static api_Err_Status _detect_sizes( uint8_t *buff, uint8_t *sep_list, Vector_MetaData *meta )
 {
     api_Err_Status err = api_Success ;
-    uint8_t *content = NULL , *dimx_ptr=NULL, *dimy_ptr = NULL, *dimz_ptr = NULL ;
-    uint8_t *linebuff = NULL , *ptr = NULL ;
-    uint8_t sep[2] = "" ;
+    uint8_t *end_ptr = NULL ;
+    uint32_t idx_k = 0 , n = 0 ;
 
     /* Sanity check inputs */
     if( buff == NULL ) {
         debug("Empty buff data passed into function");
         err = api_Err_Param ;
-        goto err_3D_item_detect ;
+        goto err_item_detect ;
     }
     if( sep_list == NULL ) {
         debug("Empty separator string passed into function");
         err = api_Err_Param ;
-        goto err_3D_item_detect ;
+        goto err_item_detect ;
     }
     if( meta == NULL ) {
         debug("meta-data struct = NULL");
         err = api_Err_Param ;
-        goto err_3D_item_detect ;
+        goto err_item_detect ;
     }
-    if( meta->no_dims !=3 ) {
-        debug("Error : function called with dimensions [%u]", meta->no_dims);
+    n = meta->no_dims ;
+    if((n == 0) || (n > DATA_MAX_DIMS)) {
+        debug("Parser supports 1 to %u dimensions, not [%u]", DATA_MAX_DIMS, n);
         err = api_Err_Param ;
-        goto err_3D_item_detect ;
-    }
-
-    memset(sep,0,sizeof(sep));
-
-    /* obtain duplicates of data buffer */
-    content = strdup(buff);
-    if( content == NULL ) {
-        debug("Could not duplicate data buffer in RAM to count items");
-        err = api_Err_Memory ;
-        goto err_3D_item_detect ;
+        goto err_item_detect ;
     }
 
-
     /*!
-     * First step - calculate number of items in dimension-X
+     * Separator k splits axis n-1-k. Every axis but the outermost is sized
+     * by its first block, which ends at the first separator of the axis
+     * around it. Counted where the text lies : no copy of it is made
      */
-    dimy_ptr = strchr( content, (int)sep_list[1] );
-    if( dimy_ptr == NULL ) {
-        debug("Could not detect dimension-y-separator in 3-D data");
-        err = api_Err_Memory ;
-        goto err_3D_item_detect ;
+    for( idx_k=0 ; (idx_k + 1) < n ; idx_k++ ) {
+        end_ptr = (uint8_t *)strchr((char *)buff, (int)sep_list[idx_k+1] );
+        if( end_ptr == NULL ) {
+            debug("Could not detect separator of axis %u in %u-D data", n - 2 - idx_k, n);
+            err = api_Err_Memory ;
+            goto err_item_detect ;
+        }
+        meta->dim.shape[n-1-idx_k] = _count_tokens( buff, end_ptr, sep_list[idx_k] );
     }
 
+    /* the outermost axis is counted over the whole text */
+    meta->dim.shape[0] = _count_tokens( buff, NULL, sep_list[n-1] );
 
-    linebuff = strndup( content,(dimy_ptr - content));
-    if( linebuff == NULL ) {
-        debug("Could not duplicate data buffer in RAM to count items");
-        err = api_Err_Memory ;
-        goto err_3D_item_detect ;
-    }
 
-    /* Count number of items in dimension-x */
-    sep[0] = sep_list[0];    /* 1st char -denotes x axis delimiter */
-    for( dimx_ptr = strtok_r(linebuff, sep, &ptr) ;
-                       dimx_ptr != NULL ; dimx_ptr = strtok_r(NULL, sep, &ptr) )
-        meta->dim.dim_3d.dim_x++ ;
+err_item_detect :
+    return err ;
+}
 
-    free(linebuff);
-    linebuff = NULL ;
 
-    /*!
-     * Second step - calculate number of items in dimension-Y
-     */
-    dimz_ptr = strchr( content, (int)sep_list[2] );
-    if( dimz_ptr == NULL ) {
-        debug("Could not detect dimension-z-separator in 3-D data");
-        err = api_Err_Memory ;
-        goto err_3D_item_detect ;
-    }
 
+/*****************************************************************************/
+/*!
+ * \brief  Count the items strtok_r() would split text into, without
+ *         writing to it : runs of characters other than the separator
+ * \param  *from - start of the text
+ * \param  *to - end of the text, NULL : up to the terminator
+ * \param  sep - separator
+ * \return number of items
+ */
+/*****************************************************************************/
+static uint64_t _count_tokens( const uint8_t *from, const uint8_t *to, uint8_t sep )
+{
+    uint64_t items = 0 ;
+    uint32_t inside = 0 , is_item = 0 ;
 
-    linebuff = strndup( content,(dimz_ptr - content));
-    if( linebuff == NULL ) {
-        debug("Could not duplicate data buffer in RAM to count items");
-        err = api_Err_Memory ;
-        goto err_3D_item_detect ;
+    for( ; (from != to) && (*from != '\0') ; from++ ) {
+        is_item = (*from != sep) ;
+        items += is_item & !inside ;
+        inside = is_item ;
     }
-
-    /* Count number of items in dimension-y */
-    sep[0] = sep_list[1];    /* 2nd char -denotes dim-y delimiter */
-    for( dimy_ptr = strtok_r(linebuff, sep, &ptr) ;
-                       dimy_ptr != NULL ; dimy_ptr = strtok_r(NULL, sep, &ptr) )
-        meta->dim.dim_3d.dim_y++ ;
-
-    free(linebuff);
-    linebuff = NULL ;
-
-    /* Count number of items in dim-z  */
-    sep[0] = sep_list[2];    /* 3rd char -denotes dim-z delimiter */
-    for( linebuff = strtok_r(content, sep, &ptr) ;
-                       linebuff != NULL ; linebuff = strtok_r(NULL, sep, &ptr) )
-        meta->dim.dim_3d.dim_z++ ;
-
-
-err_3D_item_detect :
-    content = (content != NULL) ? free(content), NULL : NULL ;
-    return err ;
+    return items ;
 }
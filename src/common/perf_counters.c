@@ -0,0 +1,375 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "time_eval.h"
+#include "perf_counters.h"
+#include "mem_track.h"
+
+
+#define PERF_MAX_THREADS   512
+
+
+typedef struct __Perf_Thread__
+{
+    int fd[Perf_MaxCounters] ;
+    uint32_t used ;
+} Perf_Thread ;
+
+
+typedef struct __Perf_Totals__
+{
+    uint64_t calls ;
+    uint64_t elements ;
+    double secs ;
+    uint64_t count[Perf_MaxCounters] ;
+} Perf_Totals ;
+
+
+/* type and config of each counter, counting user space only */
+static const struct
+{
+    uint32_t type ;
+    uint64_t config ;
+    const char *name ;
+} g_perf_events[Perf_MaxCounters] =
+{
+    [Perf_Cycles]        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles"        },
+    [Perf_Instructions]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions"  },
+    [Perf_Cache_Misses]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "cache-misses"  },
+    [Perf_Branch_Misses] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,    "branch-misses" },
+    [Perf_LLC_Loads]     = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                 (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16), "LLC-loads" },
+};
+
+static const char *g_perf_region_names[Perf_MaxRegions] =
+{
+    [Perf_Read]      = "read_data.read",
+    [Perf_Inflate]   = "read_data.inflate",
+    [Perf_Detect]    = "read_data.detect",
+    [Perf_Alloc]     = "read_data.alloc",
+    [Perf_Parse]     = "read_data.parse",
+    [Perf_Expr]      = "expr_evaluate",
+    [Perf_Stencil]   = "stencil_3d",
+    [Perf_Gemm]      = "gemm",
+    [Perf_Transpose] = "transpose",
+};
+
+
+static pthread_mutex_t g_perf_lock = PTHREAD_MUTEX_INITIALIZER ;
+static int32_t g_perf_state = -1 ;                      /* -1 : not decided yet */
+static uint32_t g_perf_available[Perf_MaxCounters] ;    /* opened on some thread */
+static uint32_t g_perf_warned = 0 ;
+static Perf_Thread g_perf_threads[PERF_MAX_THREADS] ;
+static uint64_t g_perf_retired[Perf_MaxCounters] ;      /* counts of exited threads */
+static Perf_Totals g_perf_totals[Perf_MaxRegions] ;
+static __thread int32_t _tls_perf_slot = -1 ;
+
+static int _perf_open( Perf_Counter );
+static uint64_t _perf_read( int );
+static void _perf_snapshot( uint64_t * );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Whether instrumentation is on (HETERO_PERF=1, decided once)
+ */
+/*****************************************************************************/
+uint32_t perf_enabled( void )
+{
+    char *env = NULL ;
+
+    if( g_perf_state < 0 ) {
+        env = getenv("HETERO_PERF");
+        pthread_mutex_lock( &g_perf_lock );
+        if( g_perf_state < 0 )
+            g_perf_state = ((env != NULL) && ((strcmp( env, "1" ) == 0) || (strcmp( env, "on" ) == 0))) ;
+        pthread_mutex_unlock( &g_perf_lock );
+    }
+    return (uint32_t)g_perf_state ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Open counters for the calling thread. Called by pool workers when
+ *         they start and implicitly by perf_begin() for other threads
+ * \return void
+ */
+/*****************************************************************************/
+void perf_thread_register( void )
+{
+    Perf_Thread *t = NULL ;
+    uint32_t idx_i = 0 , opened = 0 ;
+    int saved_errno = 0 ;
+
+    if( !perf_enabled() || (_tls_perf_slot >= 0))
+        return ;
+
+    pthread_mutex_lock( &g_perf_lock );
+    for( idx_i=0 ; (idx_i < PERF_MAX_THREADS) && g_perf_threads[idx_i].used ; idx_i++ )
+        ;
+    if( idx_i == PERF_MAX_THREADS ) {
+        pthread_mutex_unlock( &g_perf_lock );
+        return ;
+    }
+
+    t = &g_perf_threads[idx_i] ;
+    t->used = 1 ;
+    _tls_perf_slot = (int32_t)idx_i ;
+    for( idx_i=0 ; idx_i < Perf_MaxCounters ; idx_i++ ) {
+        t->fd[idx_i] = _perf_open((Perf_Counter)idx_i );
+        if( t->fd[idx_i] >= 0 ) {
+            g_perf_available[idx_i] = 1 ;
+            opened++ ;
+        } else if( saved_errno == 0 ) {
+            saved_errno = errno ;
+        }
+    }
+
+    if((opened == 0) && !g_perf_warned ) {
+        debug("Hardware counters unavailable (errno = %d%s) : reporting wall time only", saved_errno,
+                    ((saved_errno == EACCES) || (saved_errno == EPERM)) ? ", see /proc/sys/kernel/perf_event_paranoid" : "");
+        g_perf_warned = 1 ;
+    }
+    pthread_mutex_unlock( &g_perf_lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Fold the counts of the calling thread into the retired totals and
+ *         close its counters. Called by pool workers before they exit
+ * \return void
+ */
+/*****************************************************************************/
+void perf_thread_unregister( void )
+{
+    Perf_Thread *t = NULL ;
+    uint32_t idx_i = 0 ;
+
+    if( _tls_perf_slot < 0 )
+        return ;
+
+    pthread_mutex_lock( &g_perf_lock );
+    t = &g_perf_threads[_tls_perf_slot] ;
+    for( idx_i=0 ; idx_i < Perf_MaxCounters ; idx_i++ ) {
+        if( t->fd[idx_i] < 0 )
+            continue ;
+        g_perf_retired[idx_i] += _perf_read( t->fd[idx_i] );
+        close( t->fd[idx_i] );
+        t->fd[idx_i] = -1 ;
+    }
+    t->used = 0 ;
+    _tls_perf_slot = -1 ;
+    pthread_mutex_unlock( &g_perf_lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Start measuring a region
+ * \param  *s - sample kept by the caller until perf_end()
+ * \return void
+ */
+/*****************************************************************************/
+void perf_begin( Perf_Sample *s )
+{
+    s->valid = perf_enabled();
+    if( !s->valid )
+        return ;
+
+    perf_thread_register();
+    _perf_snapshot( s->count );
+    start_wall_timer( s->wall );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Finish measuring a region and add it to the region's totals
+ * \param  *s - sample from perf_begin()
+ * \param  region - region to charge
+ * \param  elements - elements processed, for per-element figures
+ * \return void
+ */
+/*****************************************************************************/
+void perf_end( Perf_Sample *s, Perf_Region region, uint64_t elements )
+{
+    uint64_t now[Perf_MaxCounters] ;
+    struct timespec wall ;
+    uint32_t idx_i = 0 ;
+
+    if( !s->valid || (region >= Perf_MaxRegions))
+        return ;
+
+    stop_wall_timer( wall );
+    _perf_snapshot( now );
+
+    pthread_mutex_lock( &g_perf_lock );
+    g_perf_totals[region].calls++ ;
+    g_perf_totals[region].elements += elements ;
+    g_perf_totals[region].secs += wall_time_taken( s->wall, wall );
+    for( idx_i=0 ; idx_i < Perf_MaxCounters ; idx_i++ )
+        g_perf_totals[region].count[idx_i] += (now[idx_i] > s->count[idx_i]) ? now[idx_i] - s->count[idx_i] : 0 ;
+    pthread_mutex_unlock( &g_perf_lock );
+    s->valid = 0 ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Print the totals of every region that ran : IPC and events per
+ *         element. Counters that could not be opened show as n/a. Followed
+ *         by the memory accounting of each stage
+ * \return void
+ */
+/*****************************************************************************/
+void perf_report( void )
+{
+    Perf_Totals *t = NULL ;
+    char cols[Perf_MaxCounters][32] ;
+    uint32_t idx_r = 0 , idx_c = 0 ;
+    double elems = 0.0 ;
+
+    if( !perf_enabled())
+        return ;
+
+    pthread_mutex_lock( &g_perf_lock );
+    debug("%-18s %6s %10s %12s %6s %10s %10s %10s %10s", "region", "calls", "secs", "elements",
+                "IPC", "cyc/elem", "miss/elem", "brmis/elem", "LLC/elem");
+    for( idx_r=0 ; idx_r < Perf_MaxRegions ; idx_r++ ) {
+        t = &g_perf_totals[idx_r] ;
+        if( t->calls == 0 )
+            continue ;
+        elems = (t->elements != 0) ? (double)t->elements : 1.0 ;
+
+        if( g_perf_available[Perf_Cycles] && g_perf_available[Perf_Instructions] && (t->count[Perf_Cycles] != 0))
+            snprintf( cols[Perf_Instructions], sizeof(cols[0]), "%6.2f",
+                        (double)t->count[Perf_Instructions] / (double)t->count[Perf_Cycles] );
+        else
+            snprintf( cols[Perf_Instructions], sizeof(cols[0]), "%6s", "n/a" );
+        for( idx_c=0 ; idx_c < Perf_MaxCounters ; idx_c++ ) {
+            if( idx_c == Perf_Instructions )
+                continue ;
+            if( g_perf_available[idx_c] )
+                snprintf( cols[idx_c], sizeof(cols[0]), "%10.3f", (double)t->count[idx_c] / elems );
+            else
+                snprintf( cols[idx_c], sizeof(cols[0]), "%10s", "n/a" );
+        }
+
+        debug("%-18s %6llu %10.4f %12llu %s %s %s %s %s", g_perf_region_names[idx_r], (unsigned long long)t->calls,
+                    t->secs, (unsigned long long)t->elements, cols[Perf_Instructions], cols[Perf_Cycles],
+                    cols[Perf_Cache_Misses], cols[Perf_Branch_Misses], cols[Perf_LLC_Loads]);
+    }
+    pthread_mutex_unlock( &g_perf_lock );
+    mem_report();
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Open one counter on the calling thread, any CPU, user space only
+ * \return file descriptor or -1 (errno set)
+ */
+/*****************************************************************************/
+static int _perf_open( Perf_Counter counter )
+{
+    struct perf_event_attr attr ;
+
+    memset( &attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = g_perf_events[counter].type ;
+    attr.config = g_perf_events[counter].config ;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING ;
+    attr.exclude_kernel = 1 ;
+    attr.exclude_hv = 1 ;
+
+    return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Current count of a counter, scaled up if it was multiplexed
+ */
+/*****************************************************************************/
+static uint64_t _perf_read( int fd )
+{
+    uint64_t v[3] = { 0, 0, 0 } ;
+
+    if( read( fd, v, sizeof(v)) != (ssize_t)sizeof(v))
+        return 0 ;
+    if((v[2] != 0) && (v[2] < v[1]))
+        return (uint64_t)((double)v[0] * ((double)v[1] / (double)v[2])) ;
+    return v[0] ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sum of every counter over all registered and exited threads
+ */
+/*****************************************************************************/
+static void _perf_snapshot( uint64_t *count )
+{
+    uint32_t idx_t = 0 , idx_c = 0 ;
+
+    pthread_mutex_lock( &g_perf_lock );
+    memcpy( count, g_perf_retired, sizeof(g_perf_retired));
+    for( idx_t=0 ; idx_t < PERF_MAX_THREADS ; idx_t++ ) {
+        if( !g_perf_threads[idx_t].used )
+            continue ;
+        for( idx_c=0 ; idx_c < Perf_MaxCounters ; idx_c++ )
+            if( g_perf_threads[idx_t].fd[idx_c] >= 0 )
+                count[idx_c] += _perf_read( g_perf_threads[idx_t].fd[idx_c] );
+    }
+    pthread_mutex_unlock( &g_perf_lock );
+    return ;
+}
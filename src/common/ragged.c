@@ -0,0 +1,333 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "huge_pages.h"
+#include "ragged.h"
+
+
+static api_Err_Status _rg_scan( Ragged_Data *, uint8_t *, uint8_t *, uint32_t );
+static api_Err_Status _rg_alloc( Ragged_Data * );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Read a ragged 2D or 3D array. The text is scanned twice : once to
+ *         size every level, once to fill offsets and values
+ * \param  *rg - output. rg->type selects the value type, everything else is
+ *               filled in. Free with ragged_free()
+ * \param  *path - file to parse
+ * \param  *sep - separators, innermost first. 2 or 3 characters give a
+ *                2D or 3D array
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status ragged_read( Ragged_Data *rg, char *path, uint8_t *sep )
+{
+    api_Err_Status err = api_Success ;
+    uint8_t *text = NULL ;
+    uint64_t size = 0 ;
+    uint32_t no_dims = 0 ;
+
+    if((rg == NULL) || (path == NULL) || (sep == NULL)) {
+        debug("Invalid params rg = %p, path = %p, sep = %p", rg, path, sep);
+        err = api_Err_Param ;
+        goto err_ragged_read ;
+    }
+    no_dims = strlen( sep );
+    if((no_dims < 2) || (no_dims > RAGGED_MAX_DIMS) || (sizeof_datatype( rg->type ) == 0)) {
+        debug("Ragged arrays are 2D or 3D of a known type. Got %u separators, type %d", no_dims, rg->type);
+        err = api_Err_Param ;
+        goto err_ragged_read ;
+    }
+    memset( rg->count, 0, sizeof(rg->count));
+    memset( rg->offset, 0, sizeof(rg->offset));
+    rg->val = NULL ;
+    rg->no_dims = no_dims ;
+
+    err = read_text( &text, &size, path );
+    if( err != api_Success )
+        goto err_ragged_read ;
+
+    /* trailing separators and blanks would only close empty rows */
+    while((size > 0) && ((strchr((char *)sep, text[size - 1]) != NULL) || (text[size - 1] == ' ') ||
+                         (text[size - 1] == '\t') || (text[size - 1] == '\r')))
+        text[--size] = '\0' ;
+
+    err = _rg_scan( rg, text, sep, 0 );
+    if( err != api_Success )
+        goto err_ragged_read_mem ;
+    if( rg->count[no_dims - 1] == 0 ) {
+        debug("No values in file [%s]", path);
+        err = api_Err_Param ;
+        goto err_ragged_read_mem ;
+    }
+    err = _rg_alloc( rg );
+    if( err != api_Success )
+        goto err_ragged_read_mem ;
+    err = _rg_scan( rg, text, sep, 1 );
+    if( err != api_Success )
+        goto err_ragged_read_mem ;
+
+    if( no_dims == 2 )
+        debug("[%s] : %llu rows, %llu values", path, (unsigned long long)rg->count[0], (unsigned long long)rg->count[1]);
+    else
+        debug("[%s] : %llu planes, %llu rows, %llu values", path, (unsigned long long)rg->count[0],
+                    (unsigned long long)rg->count[1], (unsigned long long)rg->count[2]);
+    text = (text != NULL) ? huge_free(text), NULL : NULL ;
+    return err ;
+
+err_ragged_read_mem :
+    ragged_free( rg );
+    text = (text != NULL) ? huge_free(text), NULL : NULL ;
+err_ragged_read :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate a ragged array with the shape of another. Offsets are
+ *         copied, values are left uninitialised
+ * \param  *out - output, free with ragged_free()
+ * \param  *in - array to copy the shape of
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status ragged_alloc_like( Ragged_Data *out, Ragged_Data *in )
+{
+    api_Err_Status err = api_Success ;
+    uint32_t idx_l = 0 ;
+
+    if((out == NULL) || (in == NULL) || (in->offset[0] == NULL)) {
+        debug("Invalid params out = %p, in = %p", out, in);
+        err = api_Err_Param ;
+        goto err_ragged_alloc ;
+    }
+
+    out->type = in->type ;
+    out->no_dims = in->no_dims ;
+    memcpy( out->count, in->count, sizeof(in->count));
+    memset( out->offset, 0, sizeof(out->offset));
+    out->val = NULL ;
+    err = _rg_alloc( out );
+    if( err != api_Success )
+        goto err_ragged_alloc ;
+    for( idx_l=0 ; idx_l < in->no_dims - 1 ; idx_l++ )
+        memcpy( out->offset[idx_l], in->offset[idx_l], (in->count[idx_l] + 1) * sizeof(uint64_t));
+
+err_ragged_alloc :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Whether two ragged arrays have the same rank, type and row lengths
+ * \return 1 if they do, 0 otherwise
+ */
+/*****************************************************************************/
+uint32_t ragged_same_shape( Ragged_Data *a, Ragged_Data *b )
+{
+    uint32_t idx_l = 0 ;
+
+    if((a == NULL) || (b == NULL) || (a->type != b->type) || (a->no_dims != b->no_dims) ||
+       memcmp( a->count, b->count, sizeof(a->count)))
+        return 0 ;
+
+    for( idx_l=0 ; idx_l < a->no_dims - 1 ; idx_l++ )
+        if((a->offset[idx_l] != b->offset[idx_l]) &&
+           memcmp( a->offset[idx_l], b->offset[idx_l], (a->count[idx_l] + 1) * sizeof(uint64_t)))
+            return 0 ;
+    return 1 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Describe the value buffer of a ragged array as a 1D array, so that
+ *         element-wise kernels (expr_evaluate() etc.) run over it directly
+ * \param  *rg - ragged array. rg->val is the 1D array
+ * \param  *meta - output meta-data
+ * \return void
+ */
+/*****************************************************************************/
+void ragged_values( Ragged_Data *rg, Vector_MetaData *meta )
+{
+    memset( meta, 0, sizeof(*meta));
+    meta->type = rg->type ;
+    meta->no_dims = 1 ;
+    meta->dim.dim_1d.items = rg->count[rg->no_dims - 1] ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release a ragged array
+ * \param  *rg - ragged array
+ * \return void
+ */
+/*****************************************************************************/
+void ragged_free( Ragged_Data *rg )
+{
+    uint32_t idx_l = 0 ;
+
+    if( rg == NULL )
+        return ;
+
+    for( idx_l=0 ; idx_l < RAGGED_MAX_DIMS - 1 ; idx_l++ )
+        rg->offset[idx_l] = (rg->offset[idx_l] != NULL) ? free(rg->offset[idx_l]), NULL : NULL ;
+    rg->val = (rg->val != NULL) ? free(rg->val), NULL : NULL ;
+    memset( rg->count, 0, sizeof(rg->count));
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Walk the text once. A value separator ends a token, a row
+ *         separator also ends a row, a plane separator (3D) also ends a
+ *         plane. Rows still open at a plane separator or at the end of the
+ *         text are closed only if they hold values, so trailing separators
+ *         do not add empty rows
+ * \param  *rg - counts are accumulated; with fill set, offsets and values
+ *               are written too
+ * \param  *text - NUL-terminated text, modified and restored while parsing
+ * \param  *sep - separators, innermost first
+ * \param  fill - 0 : count only, 1 : write offsets and values
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _rg_scan( Ragged_Data *rg, uint8_t *text, uint8_t *sep, uint32_t fill )
+{
+    api_Err_Status err = api_Success ;
+    uint8_t *ptr = text , *tok = text , *blank = NULL , saved = 0 ;
+    uint64_t values = 0 , rows = 0 , planes = 0 , row_start = 0 , plane_start = 0 ;
+    uint64_t *row_off = rg->offset[rg->no_dims - 2] ;
+    uint32_t level = 0 , at_end = 0 ;
+
+    if( fill ) {
+        row_off[0] = 0 ;
+        if( rg->no_dims == 3 )
+            rg->offset[0][0] = 0 ;
+    }
+
+    for( ;; ptr++ ) {
+        at_end = (*ptr == '\0') ;
+        for( level=0 ; !at_end && (level < rg->no_dims) && (*ptr != sep[level]) ; level++ )
+            ;
+        if( !at_end && (level == rg->no_dims))
+            continue ;
+
+        /* a token ends here : convert it unless it is empty or blank */
+        for( blank=tok ; (blank < ptr) && ((*blank == ' ') || (*blank == '\t') || (*blank == '\r')) ; blank++ )
+            ;
+        if( blank != ptr ) {
+            if( fill ) {
+                saved = *ptr ;
+                *ptr = '\0' ;
+                err = convert_number( tok, rg->type, rg->val, values );
+                *ptr = saved ;
+                if( err != api_Success ) {
+                    debug("Could not convert value %llu (row %llu)", (unsigned long long)values, (unsigned long long)rows);
+                    goto err_rg_scan ;
+                }
+            }
+            values++ ;
+        }
+        tok = ptr + 1 ;
+
+        /* row ends at a row separator; at a plane separator or the end only if not empty */
+        if((!at_end && (level == 1)) || (((at_end) || (level == 2)) && (values != row_start))) {
+            rows++ ;
+            row_start = values ;
+            if( fill )
+                row_off[rows] = values ;
+        }
+        if((rg->no_dims == 3) && ((!at_end && (level == 2)) || (at_end && (rows != plane_start)))) {
+            planes++ ;
+            plane_start = rows ;
+            if( fill )
+                rg->offset[0][planes] = rows ;
+        }
+        if( at_end )
+            break ;
+    }
+
+    if( rg->no_dims == 2 ) {
+        rg->count[0] = rows ;
+        rg->count[1] = values ;
+    } else {
+        rg->count[0] = planes ;
+        rg->count[1] = rows ;
+        rg->count[2] = values ;
+    }
+
+err_rg_scan :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate offsets and values for the counts held in rg->count
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _rg_alloc( Ragged_Data *rg )
+{
+    api_Err_Status err = api_Success ;
+    uint32_t idx_l = 0 ;
+
+    for( idx_l=0 ; idx_l < rg->no_dims - 1 ; idx_l++ ) {
+        rg->offset[idx_l] = calloc( rg->count[idx_l] + 1, sizeof(uint64_t));
+        if( rg->offset[idx_l] == NULL ) {
+            err = api_Err_Memory ;
+            goto err_rg_alloc ;
+        }
+    }
+    rg->val = malloc(((rg->count[rg->no_dims - 1] != 0) ? rg->count[rg->no_dims - 1] : 1) * sizeof_datatype( rg->type ));
+    if( rg->val == NULL )
+        err = api_Err_Memory ;
+
+err_rg_alloc :
+    if( err != api_Success ) {
+        debug("Could not allocate ragged array of %llu values", (unsigned long long)rg->count[rg->no_dims - 1]);
+        ragged_free( rg );
+    }
+    return err ;
+}
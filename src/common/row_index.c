@@ -0,0 +1,338 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "row_index.h"
+
+
+static api_Err_Status _row_index_stat( char *, uint64_t *, int64_t *, int64_t * );
+static api_Err_Status _row_index_io( int, void *, uint64_t, uint32_t );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Index the records of a file's text. The text must be the file as
+ *         stored : a compressed file is refused
+ * \param  *idx - output index, released with row_index_free()
+ * \param  *text - text of the file
+ * \param  size - bytes of text
+ * \param  *sep - separators, the outermost last
+ * \param  *meta - dimensions detected in the text
+ * \param  *path - the file
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status row_index_build( Row_Index *idx, const uint8_t *text, uint64_t size, uint8_t *sep, Vector_MetaData *meta, char *path )
+{
+    api_Err_Status err = api_Success ;
+    const uint8_t *pos = text , *end = text + size ;
+    uint64_t cap = 0 ;
+    uint8_t outer = 0 ;
+
+    if((idx == NULL) || (text == NULL) || (sep == NULL) || (meta == NULL) || (path == NULL)) {
+        debug("Invalid params idx = %p, text = %p, sep = %p, meta = %p, path = %p", idx, text, sep, meta, path);
+        err = api_Err_Param ;
+        goto err_index_build ;
+    }
+    memset( idx, 0, sizeof(*idx));
+    if((meta->no_dims == 0) || (meta->no_dims > DATA_MAX_DIMS) || (strlen((char *)sep) >= sizeof(idx->hdr.sep))) {
+        debug("Cannot index %u-dimensional data with separators [%s]", meta->no_dims, sep);
+        err = api_Err_Param ;
+        goto err_index_build ;
+    }
+
+    err = _row_index_stat( path, &idx->hdr.file_size, &idx->hdr.mtime_sec, &idx->hdr.mtime_nsec );
+    if( err != api_Success )
+        goto err_index_build ;
+    if( idx->hdr.file_size != size ) {
+        debug("[%s] : text is not the file as stored (compressed?), not indexed", path);
+        err = api_Err_Param ;
+        goto err_index_build ;
+    }
+
+    memcpy( idx->hdr.magic, ROW_INDEX_MAGIC, sizeof(idx->hdr.magic));
+    idx->hdr.no_dims = meta->no_dims ;
+    idx->hdr.stride = ROW_INDEX_STRIDE ;
+    memcpy( idx->hdr.shape, meta->dim.shape, sizeof(idx->hdr.shape));
+    strcpy( idx->hdr.sep, (char *)sep );
+
+    cap = (meta->dim.shape[0] / ROW_INDEX_STRIDE) + 1 ;
+    idx->offset = malloc( cap * sizeof(uint64_t));
+    if( idx->offset == NULL ) {
+        debug("Could not allocate %llu index entries", (unsigned long long)cap);
+        err = api_Err_Memory ;
+        goto err_index_build ;
+    }
+
+    /* records are runs of characters other than the outermost separator */
+    outer = sep[meta->no_dims - 1] ;
+    while( pos < end ) {
+        while((pos < end) && (*pos == outer))
+            pos++ ;
+        if((pos == end) || (*pos == '\0'))
+            break ;
+        if((idx->hdr.records % ROW_INDEX_STRIDE) == 0 ) {
+            if( idx->hdr.no_offsets == cap )
+                break ;
+            idx->offset[idx->hdr.no_offsets++] = (uint64_t)(pos - text) ;
+        }
+        idx->hdr.records++ ;
+        pos = memchr( pos, outer, (size_t)(end - pos));
+        pos = (pos != NULL) ? pos : end ;
+    }
+    if( idx->hdr.records != meta->dim.shape[0] ) {
+        debug("[%s] : %llu records found, %llu detected", path,
+                    (unsigned long long)idx->hdr.records, (unsigned long long)meta->dim.shape[0]);
+        err = api_Err_Failure ;
+        goto err_index_build_mem ;
+    }
+    return err ;
+
+err_index_build_mem :
+    row_index_free( idx );
+err_index_build :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Persist an index next to its file, as <path>.idx. Written to a
+ *         temporary name and renamed, so readers never see a partial index
+ * \param  *idx - index from row_index_build()
+ * \param  *path - the indexed file
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status row_index_save( Row_Index *idx, char *path )
+{
+    api_Err_Status err = api_Success ;
+    char name[4096] , tmp[4096] ;
+    int fd = -1 ;
+
+    if((idx == NULL) || (idx->offset == NULL) || (path == NULL)) {
+        debug("Invalid params idx = %p, path = %p", idx, path);
+        err = api_Err_Param ;
+        goto err_index_save ;
+    }
+    snprintf( name, sizeof(name), "%s.idx", path );
+    snprintf( tmp, sizeof(tmp), "%s.idx.%ld", path, (long)getpid());
+
+    fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644 );
+    if( fd < 0 ) {
+        debug("Could not create [%s]. errno = %d", tmp, errno);
+        err = api_Err_File ;
+        goto err_index_save ;
+    }
+    err = _row_index_io( fd, &idx->hdr, sizeof(idx->hdr), 1 );
+    if( err == api_Success )
+        err = _row_index_io( fd, idx->offset, idx->hdr.no_offsets * sizeof(uint64_t), 1 );
+    if( close( fd ) != 0 )
+        err = api_Err_File ;
+    if((err == api_Success) && (rename( tmp, name ) != 0)) {
+        debug("Could not rename [%s] to [%s]. errno = %d", tmp, name, errno);
+        err = api_Err_File ;
+    }
+    if( err != api_Success )
+        unlink( tmp );
+
+err_index_save :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Load the index of a file, if one was saved and is still current
+ * \param  *idx - output index, released with row_index_free()
+ * \param  *path - the indexed file
+ * \param  *sep - separators the file is read with
+ * \return returns api_Success on success, api_Err_File when there is no
+ *         current index
+ */
+/*****************************************************************************/
+api_Err_Status row_index_load( Row_Index *idx, char *path, uint8_t *sep )
+{
+    api_Err_Status err = api_Success ;
+    char name[4096] ;
+    uint64_t size = 0 ;
+    int64_t sec = 0 , nsec = 0 ;
+    int fd = -1 ;
+
+    if((idx == NULL) || (path == NULL) || (sep == NULL)) {
+        debug("Invalid params idx = %p, path = %p, sep = %p", idx, path, sep);
+        return api_Err_Param ;
+    }
+    memset( idx, 0, sizeof(*idx));
+
+    snprintf( name, sizeof(name), "%s.idx", path );
+    fd = open( name, O_RDONLY | O_CLOEXEC );
+    if( fd < 0 )
+        return api_Err_File ;
+
+    err = _row_index_io( fd, &idx->hdr, sizeof(idx->hdr), 0 );
+    if( err != api_Success )
+        goto err_index_load ;
+    err = _row_index_stat( path, &size, &sec, &nsec );
+    if( err != api_Success )
+        goto err_index_load ;
+    if( memcmp( idx->hdr.magic, ROW_INDEX_MAGIC, sizeof(idx->hdr.magic)) ||
+        (idx->hdr.sep[sizeof(idx->hdr.sep) - 1] != '\0') || strcmp( idx->hdr.sep, (char *)sep ) ||
+        (idx->hdr.file_size != size) || (idx->hdr.mtime_sec != sec) || (idx->hdr.mtime_nsec != nsec) ||
+        (idx->hdr.no_dims == 0) || (idx->hdr.no_dims > DATA_MAX_DIMS) || (idx->hdr.stride == 0) ||
+        (idx->hdr.no_offsets != (idx->hdr.records + idx->hdr.stride - 1) / idx->hdr.stride)) {
+        log_dbg("[%s] is stale or not an index of [%s]", name, path);
+        err = api_Err_File ;
+        goto err_index_load ;
+    }
+
+    idx->offset = malloc((idx->hdr.no_offsets + 1) * sizeof(uint64_t));
+    if( idx->offset == NULL ) {
+        debug("Could not allocate %llu index entries", (unsigned long long)idx->hdr.no_offsets);
+        err = api_Err_Memory ;
+        goto err_index_load ;
+    }
+    err = _row_index_io( fd, idx->offset, idx->hdr.no_offsets * sizeof(uint64_t), 0 );
+
+err_index_load :
+    close( fd );
+    if( err != api_Success )
+        row_index_free( idx );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Bytes of the file to read for a range of records : from the
+ *         indexed record at or before the first, to the indexed record at
+ *         or after the end of the range
+ * \param  *idx - index of the file
+ * \param  first - first record
+ * \param  count - number of records, first + count <= records
+ * \param  *from - output : first byte to read
+ * \param  *to - output : end of the bytes to read
+ * \param  *skip - output : records in the bytes before the first one
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status row_index_range( Row_Index *idx, uint64_t first, uint64_t count, uint64_t *from, uint64_t *to, uint64_t *skip )
+{
+    uint64_t last = 0 ;
+
+    if((idx == NULL) || (idx->offset == NULL) || (from == NULL) || (to == NULL) || (skip == NULL) ||
+       (count == 0) || (first >= idx->hdr.records) || (count > idx->hdr.records - first)) {
+        debug("Invalid range of %llu records from %llu", (unsigned long long)count, (unsigned long long)first);
+        return api_Err_Param ;
+    }
+
+    *from = idx->offset[first / idx->hdr.stride] ;
+    *skip = first % idx->hdr.stride ;
+    last = (first + count + idx->hdr.stride - 1) / idx->hdr.stride ;
+    *to = (last < idx->hdr.no_offsets) ? idx->offset[last] : idx->hdr.file_size ;
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release an index
+ * \param  *idx - index
+ * \return void
+ */
+/*****************************************************************************/
+void row_index_free( Row_Index *idx )
+{
+    if( idx == NULL )
+        return ;
+    idx->offset = (idx->offset != NULL) ? free(idx->offset), NULL : NULL ;
+    memset( &idx->hdr, 0, sizeof(idx->hdr));
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Size and modification time of a file, what an index is current for
+ */
+/*****************************************************************************/
+static api_Err_Status _row_index_stat( char *path, uint64_t *size, int64_t *sec, int64_t *nsec )
+{
+    struct stat sb ;
+
+    if( stat( path, &sb ) != 0 ) {
+        debug("Could not stat [%s]. errno = %d", path, errno);
+        return api_Err_File ;
+    }
+    *size = (uint64_t)sb.st_size ;
+    *sec = (int64_t)sb.st_mtim.tv_sec ;
+    *nsec = (int64_t)sb.st_mtim.tv_nsec ;
+    return api_Success ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Read or write all of a buffer
+ * \param  fd - file
+ * \param  *buff - buffer
+ * \param  bytes - size of the buffer
+ * \param  write_out - 1 : write, 0 : read
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _row_index_io( int fd, void *buff, uint64_t bytes, uint32_t write_out )
+{
+    uint8_t *pos = (uint8_t *)buff ;
+    ssize_t done = 0 ;
+
+    while( bytes != 0 ) {
+        done = write_out ? write( fd, pos, bytes ) : read( fd, pos, bytes );
+        if((done < 0) && (errno == EINTR))
+            continue ;
+        if( done <= 0 ) {
+            debug("Index %s failed. errno = %d", write_out ? "write" : "read", (done < 0) ? errno : 0);
+            return api_Err_File ;
+        }
+        pos += done ;
+        bytes -= (uint64_t)done ;
+    }
+    return api_Success ;
+}
@@ -0,0 +1,350 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "shm_array.h"
+
+
+static void *_shm_map_new( Shm_Array *, Vector_MetaData * );
+static void *_shm_place( void *, Vector_MetaData * );
+static void _shm_dims( Vector_MetaData *, uint64_t * );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a zeroed array in shared memory, e.g. for the result of a
+ *         computation
+ * \param  *sa - output array, released with shm_array_close()
+ * \param  *name - POSIX shared memory name, NULL for a memfd
+ * \param  *meta - type, number of dimensions and dimensions of the array
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status shm_array_create( Shm_Array *sa, char *name, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    void *payload = NULL ;
+
+    if((sa == NULL) || (meta == NULL) || ((name != NULL) && (strlen( name ) >= SHM_ARRAY_NAME_MAX))) {
+        debug("Invalid params sa = %p, name = %p, meta = %p", sa, name, meta);
+        return api_Err_Param ;
+    }
+    memset( sa, 0, sizeof(Shm_Array));
+    sa->fd = -1 ;
+    if( name != NULL )
+        strcpy( sa->name, name );
+
+    payload = _shm_map_new( sa, meta );
+    if( payload == NULL ) {
+        err = api_Err_Memory ;
+        goto err_shm_create ;
+    }
+    /* new values : the hashes of meta describe some other array */
+    sa->meta.text_hash = 0 ;
+    sa->meta.data_hash = 0 ;
+    err = wrap_data( &sa->buff, &sa->meta, payload );
+    if( err != api_Success ) {
+        debug("Could not lay out %u-dimensional array over [%s]. err = %d", meta->no_dims, sa->name, err);
+        goto err_shm_create ;
+    }
+    return err ;
+
+err_shm_create :
+    shm_array_close( sa, 1 );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  read_data() straight into shared memory : values are parsed into
+ *         the mapping, no copy is made
+ * \param  *sa - output array, released with shm_array_close()
+ * \param  *name - POSIX shared memory name, NULL for a memfd
+ * \param  *path - file to read
+ * \param  *sep - separator list, as for read_data()
+ * \param  type - data-type of the values
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status shm_array_load( Shm_Array *sa, char *name, char *path, uint8_t *sep, Data_Type type )
+{
+    api_Err_Status err = api_Success ;
+
+    if((sa == NULL) || ((name != NULL) && (strlen( name ) >= SHM_ARRAY_NAME_MAX))) {
+        debug("Invalid params sa = %p, name = %p", sa, name);
+        return api_Err_Param ;
+    }
+    memset( sa, 0, sizeof(Shm_Array));
+    sa->fd = -1 ;
+    if( name != NULL )
+        strcpy( sa->name, name );
+
+    sa->meta.type = type ;
+    err = read_data_placed( &sa->buff, &sa->meta, path, sep, _shm_place, sa );
+    if( err != api_Success ) {
+        debug("Could not load [%s] into shared memory [%s]. err = %d", path, sa->name, err);
+        shm_array_close( sa, 1 );
+        return err ;
+    }
+    sa->hdr->text_hash = sa->meta.text_hash ;
+    sa->hdr->data_hash = sa->meta.data_hash ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Map an array exported by another process, read-only. The header
+ *         is checked against the size of the object
+ * \param  *sa - output array, released with shm_array_close()
+ * \param  *name - name of the object, NULL to use fd
+ * \param  fd - open descriptor of the object when name is NULL. It stays
+ *              owned by the caller
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status shm_array_open( Shm_Array *sa, char *name, int fd )
+{
+    api_Err_Status err = api_Success ;
+    Shm_Array_Header *hdr = NULL ;
+    struct stat sb ;
+    uint64_t items = 1 ;
+    uint32_t idx_i = 0 ;
+    int own_fd = -1 ;
+
+    if((sa == NULL) || ((name == NULL) && (fd < 0)) || ((name != NULL) && (strlen( name ) >= SHM_ARRAY_NAME_MAX))) {
+        debug("Invalid params sa = %p, name = %p, fd = %d", sa, name, fd);
+        return api_Err_Param ;
+    }
+    memset( sa, 0, sizeof(Shm_Array));
+    sa->fd = -1 ;
+
+    if( name != NULL ) {
+        strcpy( sa->name, name );
+        own_fd = fd = (strchr( name + 1, '/' ) != NULL) ? open( name, O_RDONLY | O_CLOEXEC ) : shm_open( name, O_RDONLY, 0 );
+        if( fd < 0 ) {
+            debug("Could not open [%s]. errno = %d", name, errno);
+            err = api_Err_File ;
+            goto err_shm_open ;
+        }
+    }
+    if((fstat( fd, &sb ) != 0) || ((uint64_t)sb.st_size < sizeof(Shm_Array_Header))) {
+        debug("[%s] is too small for an array header", sa->name);
+        err = api_Err_File ;
+        goto err_shm_open_fd ;
+    }
+    hdr = mmap( NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if( hdr == MAP_FAILED ) {
+        debug("Could not map [%s]. errno = %d", sa->name, errno);
+        err = api_Err_Memory ;
+        goto err_shm_open_fd ;
+    }
+    sa->hdr = hdr ;
+    sa->map_size = (uint64_t)sb.st_size ;
+
+    if( memcmp( hdr->magic, SHM_ARRAY_MAGIC, sizeof(hdr->magic)) || (hdr->type >= DataType_MaxTypes) ||
+        (hdr->type_size != sizeof_datatype((Data_Type)hdr->type)) || (hdr->no_dims < 1) || (hdr->no_dims > DATA_MAX_DIMS) ||
+        (hdr->header_size < sizeof(Shm_Array_Header)) || (hdr->header_size > sa->map_size)) {
+        debug("[%s] does not hold an array header", sa->name);
+        err = api_Err_File ;
+        goto err_shm_open_map ;
+    }
+    for( idx_i=0 ; idx_i < hdr->no_dims ; idx_i++ )
+        items *= hdr->dims[idx_i] ;
+    if((items * hdr->type_size != hdr->payload_bytes) || (hdr->payload_bytes > sa->map_size - hdr->header_size)) {
+        debug("[%s] : %llu bytes of values do not fit its dimensions or size", sa->name,
+                    (unsigned long long)hdr->payload_bytes);
+        err = api_Err_File ;
+        goto err_shm_open_map ;
+    }
+
+    sa->meta.type = (Data_Type)hdr->type ;
+    sa->meta.no_dims = hdr->no_dims ;
+    sa->meta.text_hash = hdr->text_hash ;
+    sa->meta.data_hash = hdr->data_hash ;
+    for( idx_i=0 ; idx_i < hdr->no_dims ; idx_i++ )
+        sa->meta.dim.shape[idx_i] = hdr->dims[idx_i] ;
+    err = wrap_data( &sa->buff, &sa->meta, (uint8_t *)hdr + hdr->header_size );
+    if( err != api_Success )
+        goto err_shm_open_map ;
+
+    if( own_fd >= 0 )
+        close( own_fd );
+    return err ;
+
+err_shm_open_map :
+    munmap( sa->hdr, sa->map_size );
+    sa->hdr = NULL ;
+err_shm_open_fd :
+    if( own_fd >= 0 )
+        close( own_fd );
+err_shm_open :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Unmap an array. The object itself stays for other processes
+ *         unless remove is set (memfds go away with their last descriptor)
+ * \param  *sa - array
+ * \param  remove - shm_unlink() a named object
+ * \return void
+ */
+/*****************************************************************************/
+void shm_array_close( Shm_Array *sa, uint32_t remove )
+{
+    if( sa == NULL )
+        return ;
+
+    unwrap_data( &sa->buff, &sa->meta );
+    if( sa->fd >= 0 )
+        close( sa->fd );
+    else if( remove && (sa->hdr != NULL) && (sa->name[0] == '/') && (strchr( sa->name + 1, '/' ) == NULL))
+        shm_unlink( sa->name );
+    if( sa->hdr != NULL )
+        munmap( sa->hdr, sa->map_size );
+    sa->hdr = NULL ;
+    sa->map_size = 0 ;
+    sa->fd = -1 ;
+    sa->name[0] = '\0' ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create the object of sa->name (memfd if empty), size it for the
+ *         values of meta and write the header
+ * \return the zeroed values, NULL on failure
+ */
+/*****************************************************************************/
+static void *_shm_map_new( Shm_Array *sa, Vector_MetaData *meta )
+{
+    Shm_Array_Header *hdr = NULL ;
+    uint64_t bytes = 0 ;
+    uint32_t memfd = (sa->name[0] == '\0') ;
+    int fd = -1 ;
+
+    if((meta->no_dims < 1) || (meta->no_dims > DATA_MAX_DIMS) || (sizeof_datatype( meta->type ) == 0)) {
+        debug("Cannot export %u-dimensional arrays of type %d", meta->no_dims, meta->type);
+        return NULL ;
+    }
+    bytes = data_items( meta ) * sizeof_datatype( meta->type );
+
+    if( !memfd ) {
+        /* replaces an older object : processes mapping it keep the old values */
+        shm_unlink( sa->name );
+        fd = shm_open( sa->name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600 );
+    } else {
+        /* no CLOEXEC : exec'd children reach it through /proc/<pid>/fd */
+        fd = (int)syscall( SYS_memfd_create, "hetero-array", 0 );
+        if( fd >= 0 )
+            snprintf( sa->name, sizeof(sa->name), "/proc/%ld/fd/%d", (long)getpid(), fd );
+    }
+    if( fd < 0 ) {
+        debug("Could not create shared memory [%s]. errno = %d", sa->name, errno);
+        return NULL ;
+    }
+    if( ftruncate( fd, (off_t)(SHM_ARRAY_HEADER + bytes)) != 0 ) {
+        debug("Could not size [%s] to %llu bytes. errno = %d", sa->name, (unsigned long long)bytes, errno);
+        goto err_shm_map_fd ;
+    }
+    hdr = mmap( NULL, SHM_ARRAY_HEADER + bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if( hdr == MAP_FAILED ) {
+        debug("Could not map [%s]. errno = %d", sa->name, errno);
+        goto err_shm_map_fd ;
+    }
+
+    memcpy( hdr->magic, SHM_ARRAY_MAGIC, sizeof(hdr->magic));
+    hdr->header_size = SHM_ARRAY_HEADER ;
+    hdr->type = (uint32_t)meta->type ;
+    hdr->type_size = sizeof_datatype( meta->type );
+    hdr->no_dims = meta->no_dims ;
+    _shm_dims( meta, hdr->dims );
+    hdr->payload_bytes = bytes ;
+    snprintf( hdr->type_name, sizeof(hdr->type_name), "%s", datatype_name( meta->type ));
+
+    sa->hdr = hdr ;
+    sa->map_size = SHM_ARRAY_HEADER + bytes ;
+    sa->meta = *meta ;
+    if( memfd )
+        sa->fd = fd ;
+    else
+        close( fd );
+    return (uint8_t *)hdr + SHM_ARRAY_HEADER ;
+
+err_shm_map_fd :
+    close( fd );
+    if( !memfd )
+        shm_unlink( sa->name );
+    return NULL ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Data_Place_Fn of shm_array_load()
+ */
+/*****************************************************************************/
+static void *_shm_place( void *ctx, Vector_MetaData *meta )
+{
+    return _shm_map_new((Shm_Array *)ctx, meta );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Dimensions of an array, outermost first
+ */
+/*****************************************************************************/
+static void _shm_dims( Vector_MetaData *meta, uint64_t *dims )
+{
+    uint32_t axis = 0 ;
+
+    memset( dims, 0, DATA_MAX_DIMS * sizeof(uint64_t));
+    for( axis=0 ; axis < meta->no_dims ; axis++ )
+        dims[axis] = meta->dim.shape[axis] ;
+    return ;
+}
@@ -0,0 +1,885 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "thread_pool.h"
+#include "huge_pages.h"
+#include "sparse.h"
+#include "half.h"
+
+
+#define SPARSE_TASK_NNZ    (64 * 1024)    /* stored entries handed to a pool thread at a time */
+
+
+typedef void (*Sparse_Scatter_Fn)( uint8_t *, const uint64_t *, const void *, uint64_t );
+typedef uint64_t (*Sparse_Merge_Fn)( uint64_t *, void *, const uint64_t *, const void *, uint64_t,
+                                     const uint64_t *, const void *, uint64_t );
+typedef uint64_t (*Sparse_Compact_Fn)( uint64_t *, void *, uint64_t );
+
+
+/*!
+ * Entries of a sparse operand handled by each task. Task t of a sparse add
+ * covers entries bound[t]..bound[t+1] of both operands, which always lie in
+ * the same range of the flattened (row * cols + col) index space
+ */
+typedef struct __Sparse_Add_Ctx__
+{
+    Sparse_Data *a ;
+    Sparse_Data *b ;
+    Sparse_Data *out ;
+    Sparse_Merge_Fn merge ;
+    uint64_t *a_bound ;
+    uint64_t *b_bound ;
+    uint64_t *offset ;       /* first output entry of each task, counts in pass 1 */
+    uint32_t count_only ;
+    uint32_t esize ;
+} Sparse_Add_Ctx ;
+
+
+typedef struct __Sparse_Dense_Ctx__
+{
+    Sparse_Data *a ;
+    uint8_t *out ;
+    uint64_t pitch ;         /* bytes per dense row */
+    uint32_t esize ;
+    Sparse_Scatter_Fn scatter ;
+} Sparse_Dense_Ctx ;
+
+
+typedef struct __Sparse_Sort_Key__
+{
+    uint64_t col ;
+    uint64_t pos ;
+} Sparse_Sort_Key ;
+
+
+
+/*!
+ * Typed kernels
+ *  scatter : dst[col[i]] += val[i]
+ *  merge   : union of two rows with ascending columns, summing common columns
+ *  compact : sum runs of equal columns of a sorted row, returns new length
+ * ADD combines two stored values; 16-bit floats add through float32
+ */
+#define _SP_ADD( x, y )       ((x) + (y))
+#define _SP_ADD_F16( x, y )   f32_to_half( half_to_f32(x) + half_to_f32(y) )
+#define _SP_ADD_BF16( x, y )  f32_to_bf16( bf16_to_f32(x) + bf16_to_f32(y) )
+
+#define SPARSE_KERNELS( T, ADD, SUFFIX )                                              \
+static void _sp_scatter_##SUFFIX( uint8_t *dst, const uint64_t *col,                  \
+                                  const void *val, uint64_t n )                       \
+{                                                                                     \
+    T *d = (T *)dst ;                                                                 \
+    const T *v = (const T *)val ;                                                     \
+    uint64_t idx_i = 0 ;                                                              \
+                                                                                      \
+    for( idx_i=0 ; idx_i < n ; idx_i++ )                                              \
+        d[col[idx_i]] = (T)ADD( d[col[idx_i]], v[idx_i] );                            \
+    return ;                                                                          \
+}                                                                                     \
+                                                                                      \
+static uint64_t _sp_merge_##SUFFIX( uint64_t *oc, void *ov,                           \
+                                    const uint64_t *ac, const void *av, uint64_t an,  \
+                                    const uint64_t *bc, const void *bv, uint64_t bn ) \
+{                                                                                     \
+    T *o = (T *)ov ;                                                                  \
+    const T *x = (const T *)av , *y = (const T *)bv ;                                 \
+    uint64_t idx_a = 0 , idx_b = 0 , idx_o = 0 ;                                      \
+                                                                                      \
+    while((idx_a < an) && (idx_b < bn)) {                                             \
+        if( ac[idx_a] < bc[idx_b] ) {                                                 \
+            oc[idx_o] = ac[idx_a] ; o[idx_o++] = x[idx_a++] ;                         \
+        } else if( bc[idx_b] < ac[idx_a] ) {                                          \
+            oc[idx_o] = bc[idx_b] ; o[idx_o++] = y[idx_b++] ;                         \
+        } else {                                                                      \
+            oc[idx_o] = ac[idx_a] ; o[idx_o++] = (T)ADD( x[idx_a], y[idx_b] ) ;       \
+            idx_a++ ; idx_b++ ;                                                       \
+        }                                                                             \
+    }                                                                                 \
+    for( ; idx_a < an ; idx_a++ , idx_o++ ) {                                         \
+        oc[idx_o] = ac[idx_a] ; o[idx_o] = x[idx_a] ;                                 \
+    }                                                                                 \
+    for( ; idx_b < bn ; idx_b++ , idx_o++ ) {                                         \
+        oc[idx_o] = bc[idx_b] ; o[idx_o] = y[idx_b] ;                                 \
+    }                                                                                 \
+    return idx_o ;                                                                    \
+}                                                                                     \
+                                                                                      \
+static uint64_t _sp_compact_##SUFFIX( uint64_t *col, void *val, uint64_t n )          \
+{                                                                                     \
+    T *v = (T *)val ;                                                                 \
+    uint64_t idx_i = 0 , idx_o = 0 ;                                                  \
+                                                                                      \
+    for( idx_i=1 ; idx_i < n ; idx_i++ ) {                                            \
+        if( col[idx_i] == col[idx_o] ) {                                              \
+            v[idx_o] = (T)ADD( v[idx_o], v[idx_i] );                                  \
+        } else {                                                                      \
+            idx_o++ ;                                                                 \
+            col[idx_o] = col[idx_i] ;                                                 \
+            v[idx_o] = v[idx_i] ;                                                     \
+        }                                                                             \
+    }                                                                                 \
+    return (n != 0) ? idx_o + 1 : 0 ;                                                 \
+}
+
+SPARSE_KERNELS( uint8_t,     _SP_ADD,      u8   )
+SPARSE_KERNELS( uint16_t,    _SP_ADD,      u16  )
+SPARSE_KERNELS( uint32_t,    _SP_ADD,      u32  )
+SPARSE_KERNELS( uint64_t,    _SP_ADD,      u64  )
+SPARSE_KERNELS( int8_t,      _SP_ADD,      s8   )
+SPARSE_KERNELS( int16_t,     _SP_ADD,      s16  )
+SPARSE_KERNELS( int32_t,     _SP_ADD,      s32  )
+SPARSE_KERNELS( int64_t,     _SP_ADD,      s64  )
+SPARSE_KERNELS( float,       _SP_ADD,      f32  )
+SPARSE_KERNELS( double,      _SP_ADD,      f64  )
+SPARSE_KERNELS( long double, _SP_ADD,      f80  )
+SPARSE_KERNELS( uint16_t,    _SP_ADD_F16,  f16  )
+SPARSE_KERNELS( uint16_t,    _SP_ADD_BF16, bf16 )
+
+static const struct
+{
+    Sparse_Scatter_Fn scatter ;
+    Sparse_Merge_Fn merge ;
+    Sparse_Compact_Fn compact ;
+} g_sp_kernels[DataType_MaxTypes] =
+{
+    [DataType_uint8]       = { _sp_scatter_u8 ,  _sp_merge_u8 ,  _sp_compact_u8  },
+    [DataType_uint16]      = { _sp_scatter_u16,  _sp_merge_u16,  _sp_compact_u16 },
+    [DataType_uint32]      = { _sp_scatter_u32,  _sp_merge_u32,  _sp_compact_u32 },
+    [DataType_uint64]      = { _sp_scatter_u64,  _sp_merge_u64,  _sp_compact_u64 },
+    [DataType_int8]        = { _sp_scatter_s8 ,  _sp_merge_s8 ,  _sp_compact_s8  },
+    [DataType_int16]       = { _sp_scatter_s16,  _sp_merge_s16,  _sp_compact_s16 },
+    [DataType_int32]       = { _sp_scatter_s32,  _sp_merge_s32,  _sp_compact_s32 },
+    [DataType_int64]       = { _sp_scatter_s64,  _sp_merge_s64,  _sp_compact_s64 },
+    [DataType_float]       = { _sp_scatter_f32,  _sp_merge_f32,  _sp_compact_f32 },
+    [DataType_double]      = { _sp_scatter_f64,  _sp_merge_f64,  _sp_compact_f64 },
+    [DataType_long_double] = { _sp_scatter_f80,  _sp_merge_f80,  _sp_compact_f80 },
+    [DataType_float16]     = { _sp_scatter_f16,  _sp_merge_f16,  _sp_compact_f16 },
+    [DataType_bfloat16]    = { _sp_scatter_bf16, _sp_merge_bf16, _sp_compact_bf16 },
+};
+
+
+static uint64_t _sp_rows( Vector_MetaData * );
+static uint64_t _sp_cols( Vector_MetaData * );
+static uint64_t _sp_row_of( Sparse_Data *, uint64_t );
+static uint64_t _sp_flat( Sparse_Data *, uint64_t, uint64_t );
+static uint64_t _sp_lower_bound( Sparse_Data *, uint64_t, uint64_t );
+static uint64_t _sp_merge_count( const uint64_t *, uint64_t, const uint64_t *, uint64_t );
+static int _sp_key_cmp( const void *, const void * );
+static api_Err_Status _sp_alloc( Sparse_Data *, uint64_t );
+static api_Err_Status _sp_finish_rows( Sparse_Data * );
+static void _sp_dense_task( void *, uint64_t, uint32_t );
+static void _sp_add_task( void *, uint64_t, uint32_t );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Read a sparse vector or matrix of index:value tokens
+ * \param  *sp - output. sp->meta.type selects the value type, everything
+ *               else is filled in. Free with sparse_free()
+ * \param  *path - file to parse
+ * \param  *sep - token separator, optionally followed by the row separator
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status sparse_read( Sparse_Data *sp, char *path, uint8_t *sep )
+{
+    api_Err_Status err = api_Success ;
+    uint8_t *text = NULL , *ptr = NULL , *end = NULL , *tok = NULL ;
+    uint8_t esep = 0 , rsep = 0 , saved = 0 ;
+    uint64_t size = 0 , nnz = 0 , rows = 1 , pending = 0 , row = 0 , max_col = 0 , idx_k = 0 ;
+    uint64_t *row_of = NULL ;
+    uint32_t esize = 0 ;
+
+    if((sp == NULL) || (path == NULL) || (sep == NULL) || (sep[0] == '\0')) {
+        debug("Invalid params sp = %p, path = %p, sep = %p", sp, path, sep);
+        err = api_Err_Param ;
+        goto err_sparse_read ;
+    }
+    esize = sizeof_datatype( sp->meta.type );
+    if( esize == 0 ) {
+        debug("Unknown data-type %d", sp->meta.type);
+        err = api_Err_Param ;
+        goto err_sparse_read ;
+    }
+    sp->nnz = 0 ;
+    sp->row_ptr = NULL ;
+    sp->col = NULL ;
+    sp->val = NULL ;
+    esep = sep[0] ;
+    rsep = sep[1] ;
+
+    err = read_text( &text, &size, path );
+    if( err != api_Success )
+        goto err_sparse_read ;
+
+    /* one entry per index separator. Trailing empty rows are not counted */
+    for( ptr=text ; *ptr != '\0' ; ptr++ ) {
+        if((rsep != '\0') && (*ptr == rsep)) {
+            pending++ ;
+        } else if( *ptr == SPARSE_INDEX_SEP ) {
+            nnz++ ;
+            rows += pending ;
+            pending = 0 ;
+        }
+    }
+    if( nnz == 0 ) {
+        debug("No index%cvalue tokens in file [%s]", SPARSE_INDEX_SEP, path);
+        err = api_Err_Param ;
+        goto err_sparse_read_mem ;
+    }
+
+    err = _sp_alloc( sp, nnz );
+    row_of = malloc( nnz * sizeof(uint64_t));
+    if((err != api_Success) || (row_of == NULL)) {
+        debug("Could not allocate %llu sparse entries", (unsigned long long)nnz);
+        err = api_Err_Memory ;
+        goto err_sparse_read_mem ;
+    }
+
+    for( ptr=text ; *ptr != '\0' ; ) {
+        if((rsep != '\0') && (*ptr == rsep)) {
+            row++ ;
+            ptr++ ;
+            continue ;
+        } else if((*ptr == esep) || isspace( *ptr )) {
+            ptr++ ;
+            continue ;
+        }
+
+        sp->col[idx_k] = strtoull((char *)ptr, (char **)&end, 10);
+        if((end == ptr) || (*end != SPARSE_INDEX_SEP)) {
+            debug("Malformed token in row %llu, expected index%cvalue", (unsigned long long)row, SPARSE_INDEX_SEP);
+            err = api_Err_Failure ;
+            goto err_sparse_read_mem ;
+        }
+        tok = end + 1 ;
+        for( end=tok ; (*end != '\0') && (*end != esep) && ((rsep == '\0') || (*end != rsep)) ; end++ )
+            ;
+        saved = *end ;
+        *end = '\0' ;
+        err = convert_number( tok, sp->meta.type, sp->val, idx_k );
+        *end = saved ;
+        if( err != api_Success ) {
+            debug("Could not convert value of index %llu in row %llu", (unsigned long long)sp->col[idx_k],
+                                                                       (unsigned long long)row);
+            goto err_sparse_read_mem ;
+        }
+        max_col = (sp->col[idx_k] > max_col) ? sp->col[idx_k] : max_col ;
+        row_of[idx_k++] = row ;
+        ptr = end ;
+    }
+
+    if( rows == 1 ) {
+        sp->meta.no_dims = 1 ;
+        sp->meta.dim.dim_1d.items = max_col + 1 ;
+    } else {
+        sp->meta.no_dims = 2 ;
+        sp->meta.dim.dim_2d.rows = rows ;
+        sp->meta.dim.dim_2d.cols = max_col + 1 ;
+    }
+
+    /* tokens arrive in row order, so only the offsets need building */
+    sp->row_ptr = calloc( rows + 1, sizeof(uint64_t));
+    if( sp->row_ptr == NULL ) {
+        debug("Could not allocate %llu row offsets", (unsigned long long)rows + 1);
+        err = api_Err_Memory ;
+        goto err_sparse_read_mem ;
+    }
+    for( idx_k=0 ; idx_k < nnz ; idx_k++ )
+        sp->row_ptr[row_of[idx_k] + 1]++ ;
+    for( row=0 ; row < rows ; row++ )
+        sp->row_ptr[row + 1] += sp->row_ptr[row] ;
+
+    err = _sp_finish_rows( sp );
+    if( err != api_Success )
+        goto err_sparse_read_mem ;
+
+    debug("[%s] : %llu entries, %u-D, %llu x %llu", path, (unsigned long long)sp->nnz, sp->meta.no_dims,
+                (unsigned long long)_sp_rows( &sp->meta ), (unsigned long long)_sp_cols( &sp->meta ));
+    row_of = (row_of != NULL) ? free(row_of), NULL : NULL ;
+    text = (text != NULL) ? huge_free(text), NULL : NULL ;
+    return err ;
+
+err_sparse_read_mem :
+    sparse_free( sp );
+    row_of = (row_of != NULL) ? free(row_of), NULL : NULL ;
+    text = (text != NULL) ? huge_free(text), NULL : NULL ;
+err_sparse_read :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Build a sparse array from coordinate (COO) triplets in any order.
+ *         Duplicate coordinates are summed
+ * \param  *sp - output, free with sparse_free()
+ * \param  *meta - type and shape (1 or 2 dims) of the array
+ * \param  nnz - number of triplets
+ * \param  *row - row of each triplet (NULL for vectors)
+ * \param  *col - column (vector : index) of each triplet
+ * \param  *val - values, contiguous of meta->type
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status sparse_from_coo( Sparse_Data *sp, Vector_MetaData *meta, uint64_t nnz,
+                                uint64_t *row, uint64_t *col, void *val )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t rows = 0 , cols = 0 , idx_k = 0 , r = 0 , pos = 0 ;
+    uint32_t esize = 0 ;
+
+    if((sp == NULL) || (meta == NULL) || ((nnz != 0) && ((col == NULL) || (val == NULL)))) {
+        debug("Invalid params sp = %p, meta = %p, col = %p, val = %p", sp, meta, col, val);
+        err = api_Err_Param ;
+        goto err_sparse_coo ;
+    }
+    esize = sizeof_datatype( meta->type );
+    rows = _sp_rows( meta );
+    cols = _sp_cols( meta );
+    if((esize == 0) || (rows == 0) || ((meta->no_dims == 2) && (nnz != 0) && (row == NULL))) {
+        debug("Sparse arrays are 1D or 2D of a known type. Got %u-D, type %d", meta->no_dims, meta->type);
+        err = api_Err_Param ;
+        goto err_sparse_coo ;
+    }
+    for( idx_k=0 ; idx_k < nnz ; idx_k++ ) {
+        r = (meta->no_dims == 2) ? row[idx_k] : 0 ;
+        if((r >= rows) || (col[idx_k] >= cols)) {
+            debug("Entry %llu (%llu, %llu) outside %llu x %llu", (unsigned long long)idx_k, (unsigned long long)r,
+                        (unsigned long long)col[idx_k], (unsigned long long)rows, (unsigned long long)cols);
+            err = api_Err_Param ;
+            goto err_sparse_coo ;
+        }
+    }
+
+    sp->meta = *meta ;
+    err = _sp_alloc( sp, nnz );
+    sp->row_ptr = calloc( rows + 1, sizeof(uint64_t));
+    if((err != api_Success) || (sp->row_ptr == NULL)) {
+        debug("Could not allocate %llu sparse entries", (unsigned long long)nnz);
+        err = api_Err_Memory ;
+        goto err_sparse_coo_mem ;
+    }
+
+    /* counting sort by row, stable so equal coordinates keep their order */
+    for( idx_k=0 ; idx_k < nnz ; idx_k++ )
+        sp->row_ptr[((meta->no_dims == 2) ? row[idx_k] : 0) + 1]++ ;
+    for( r=0 ; r < rows ; r++ )
+        sp->row_ptr[r + 1] += sp->row_ptr[r] ;
+    for( idx_k=0 ; idx_k < nnz ; idx_k++ ) {
+        r = (meta->no_dims == 2) ? row[idx_k] : 0 ;
+        pos = sp->row_ptr[r]++ ;
+        sp->col[pos] = col[idx_k] ;
+        memcpy((uint8_t *)sp->val + (pos * esize), (uint8_t *)val + (idx_k * esize), esize );
+    }
+    for( r=rows ; r > 0 ; r-- )
+        sp->row_ptr[r] = sp->row_ptr[r - 1] ;
+    sp->row_ptr[0] = 0 ;
+
+    err = _sp_finish_rows( sp );
+    if( err != api_Success )
+        goto err_sparse_coo_mem ;
+    return err ;
+
+err_sparse_coo_mem :
+    sparse_free( sp );
+err_sparse_coo :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  out = a + b where a is sparse and b dense. out may be b itself, in
+ *         which case only the stored entries of a are touched
+ * \param  *out - dense result, same shape as b
+ * \param  *out_meta - meta-data of out
+ * \param  *a - sparse operand, its shape must fit within b
+ * \param  *b - dense operand from read_data() or alloc_data()
+ * \param  *b_meta - meta-data of b
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status sparse_add_dense( void *out, Vector_MetaData *out_meta, Sparse_Data *a, void *b, Vector_MetaData *b_meta )
+{
+    api_Err_Status err = api_Success ;
+    Sparse_Dense_Ctx ctx ;
+    uint8_t *b_data = NULL ;
+
+    memset( &ctx, 0, sizeof(ctx));
+
+    if((out == NULL) || (out_meta == NULL) || (a == NULL) || (b == NULL) || (b_meta == NULL)) {
+        debug("Invalid params out = %p, out_meta = %p, a = %p, b = %p, b_meta = %p", out, out_meta, a, b, b_meta);
+        err = api_Err_Param ;
+        goto err_sparse_dense ;
+    }
+    if((a->meta.type != b_meta->type) || (out_meta->type != b_meta->type) || (a->meta.no_dims != b_meta->no_dims) ||
+       !data_same_shape( out_meta, b_meta ) ||
+       (b_meta->type >= DataType_MaxTypes) || (g_sp_kernels[b_meta->type].scatter == NULL)) {
+        debug("Sparse and dense operands differ in type or rank, or output differs from dense operand");
+        err = api_Err_Param ;
+        goto err_sparse_dense ;
+    }
+    if((_sp_rows( &a->meta ) > _sp_rows( b_meta )) || (_sp_cols( &a->meta ) > _sp_cols( b_meta ))) {
+        debug("Sparse operand (%llu x %llu) does not fit dense operand (%llu x %llu)",
+                    (unsigned long long)_sp_rows( &a->meta ), (unsigned long long)_sp_cols( &a->meta ),
+                    (unsigned long long)_sp_rows( b_meta ), (unsigned long long)_sp_cols( b_meta ));
+        err = api_Err_Param ;
+        goto err_sparse_dense ;
+    }
+
+    ctx.a = a ;
+    ctx.esize = sizeof_datatype( b_meta->type );
+    ctx.pitch = _sp_cols( b_meta ) * ctx.esize ;
+    ctx.scatter = g_sp_kernels[b_meta->type].scatter ;
+    ctx.out = data_payload( out, out_meta );
+    b_data = data_payload( b, b_meta );
+    if( ctx.out != b_data )
+        memcpy( ctx.out, b_data, data_items( b_meta ) * ctx.esize );
+
+    /* entries of a canonical sparse array hit distinct elements : no races */
+    err = tpool_parallel_for( tpool_default(), (a->nnz + SPARSE_TASK_NNZ - 1) / SPARSE_TASK_NNZ, _sp_dense_task, &ctx );
+    if( err != api_Success )
+        debug("Error adding sparse entries. err = %d", err);
+
+err_sparse_dense :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  out = a + b for two sparse arrays of the same type and rank. The
+ *         shape of out is the larger of the two along each axis
+ * \param  *out - output, must be empty (zeroed). Free with sparse_free()
+ * \param  *a - sparse operand
+ * \param  *b - sparse operand
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status sparse_add( Sparse_Data *out, Sparse_Data *a, Sparse_Data *b )
+{
+    api_Err_Status err = api_Success ;
+    Sparse_Add_Ctx ctx ;
+    Sparse_Data *drive = NULL , *other = NULL ;
+    uint64_t *drive_bound = NULL , *other_bound = NULL ;
+    uint64_t no_tasks = 0 , idx_t = 0 , rows = 0 , cols = 0 , flat = 0 , total = 0 , count = 0 ;
+
+    memset( &ctx, 0, sizeof(ctx));
+
+    if((out == NULL) || (a == NULL) || (b == NULL) || (out->row_ptr != NULL)) {
+        debug("Invalid params out = %p, a = %p, b = %p. out must be empty", out, a, b);
+        err = api_Err_Param ;
+        goto err_sparse_add ;
+    }
+    if((a->meta.type != b->meta.type) || (a->meta.no_dims != b->meta.no_dims) ||
+       (a->meta.type >= DataType_MaxTypes) || (g_sp_kernels[a->meta.type].merge == NULL)) {
+        debug("Sparse operands differ in type or rank");
+        err = api_Err_Param ;
+        goto err_sparse_add ;
+    }
+
+    out->meta = a->meta ;
+    rows = (_sp_rows( &a->meta ) > _sp_rows( &b->meta )) ? _sp_rows( &a->meta ) : _sp_rows( &b->meta );
+    cols = (_sp_cols( &a->meta ) > _sp_cols( &b->meta )) ? _sp_cols( &a->meta ) : _sp_cols( &b->meta );
+    if( out->meta.no_dims == 1 ) {
+        out->meta.dim.dim_1d.items = cols ;
+    } else {
+        out->meta.dim.dim_2d.rows = rows ;
+        out->meta.dim.dim_2d.cols = cols ;
+    }
+
+    /* tasks split the operand with more entries evenly */
+    drive = (a->nnz >= b->nnz) ? a : b ;
+    other = (drive == a) ? b : a ;
+    no_tasks = (drive->nnz + SPARSE_TASK_NNZ - 1) / SPARSE_TASK_NNZ ;
+    no_tasks = (no_tasks != 0) ? no_tasks : 1 ;
+    ctx.a_bound = malloc((no_tasks + 1) * sizeof(uint64_t));
+    ctx.b_bound = malloc((no_tasks + 1) * sizeof(uint64_t));
+    ctx.offset = calloc( no_tasks + 1, sizeof(uint64_t));
+    if((ctx.a_bound == NULL) || (ctx.b_bound == NULL) || (ctx.offset == NULL)) {
+        debug("Could not allocate %llu task bounds", (unsigned long long)no_tasks);
+        err = api_Err_Memory ;
+        goto err_sparse_add_mem ;
+    }
+    drive_bound = (drive == a) ? ctx.a_bound : ctx.b_bound ;
+    other_bound = (drive == a) ? ctx.b_bound : ctx.a_bound ;
+    for( idx_t=0 ; idx_t <= no_tasks ; idx_t++ ) {
+        drive_bound[idx_t] = (idx_t * SPARSE_TASK_NNZ < drive->nnz) ? idx_t * SPARSE_TASK_NNZ : drive->nnz ;
+        if( idx_t == 0 ) {
+            other_bound[idx_t] = 0 ;
+        } else if( drive_bound[idx_t] == drive->nnz ) {
+            other_bound[idx_t] = other->nnz ;
+        } else {
+            flat = _sp_flat( drive, drive_bound[idx_t], cols );
+            other_bound[idx_t] = _sp_lower_bound( other, flat, cols );
+        }
+    }
+
+    ctx.a = a ;
+    ctx.b = b ;
+    ctx.out = out ;
+    ctx.merge = g_sp_kernels[a->meta.type].merge ;
+    ctx.esize = sizeof_datatype( a->meta.type );
+
+    /* pass 1 : size of every task's output */
+    ctx.count_only = 1 ;
+    err = tpool_parallel_for( tpool_default(), no_tasks, _sp_add_task, &ctx );
+    if( err != api_Success )
+        goto err_sparse_add_mem ;
+    for( idx_t=0 ; idx_t < no_tasks ; idx_t++ ) {
+        count = ctx.offset[idx_t] ;
+        ctx.offset[idx_t] = total ;
+        total += count ;
+    }
+    ctx.offset[no_tasks] = total ;
+
+    err = _sp_alloc( out, total );
+    out->row_ptr = calloc( rows + 1, sizeof(uint64_t));
+    if((err != api_Success) || (out->row_ptr == NULL)) {
+        debug("Could not allocate %llu sparse entries", (unsigned long long)total);
+        err = api_Err_Memory ;
+        goto err_sparse_add_out ;
+    }
+
+    /* pass 2 : merge into place, counting entries per row */
+    ctx.count_only = 0 ;
+    err = tpool_parallel_for( tpool_default(), no_tasks, _sp_add_task, &ctx );
+    if( err != api_Success )
+        goto err_sparse_add_out ;
+    for( idx_t=0 ; idx_t < rows ; idx_t++ )
+        out->row_ptr[idx_t + 1] += out->row_ptr[idx_t] ;
+
+    goto err_sparse_add_mem ;
+
+err_sparse_add_out :
+    sparse_free( out );
+err_sparse_add_mem :
+    ctx.a_bound = (ctx.a_bound != NULL) ? free(ctx.a_bound), NULL : NULL ;
+    ctx.b_bound = (ctx.b_bound != NULL) ? free(ctx.b_bound), NULL : NULL ;
+    ctx.offset = (ctx.offset != NULL) ? free(ctx.offset), NULL : NULL ;
+err_sparse_add :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release a sparse array and reset it to empty
+ * \param  *sp - sparse array
+ * \return void
+ */
+/*****************************************************************************/
+void sparse_free( Sparse_Data *sp )
+{
+    if( sp == NULL )
+        return ;
+
+    sp->row_ptr = (sp->row_ptr != NULL) ? free(sp->row_ptr), NULL : NULL ;
+    sp->col = (sp->col != NULL) ? free(sp->col), NULL : NULL ;
+    sp->val = (sp->val != NULL) ? free(sp->val), NULL : NULL ;
+    sp->nnz = 0 ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Add one range of sparse entries into the dense output
+ * \param  *arg - Sparse_Dense_Ctx
+ * \param  task - task index
+ * \param  thread_idx - unused
+ * \return void
+ */
+/*****************************************************************************/
+static void _sp_dense_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Sparse_Dense_Ctx *ctx = (Sparse_Dense_Ctx *)arg ;
+    Sparse_Data *a = ctx->a ;
+    uint64_t begin = task * SPARSE_TASK_NNZ , end = begin + SPARSE_TASK_NNZ , row = 0 , stop = 0 ;
+
+    (void)thread_idx ;
+    end = (end < a->nnz) ? end : a->nnz ;
+    while( begin < end ) {
+        row = _sp_row_of( a, begin );
+        stop = (a->row_ptr[row + 1] < end) ? a->row_ptr[row + 1] : end ;
+        ctx->scatter( ctx->out + (row * ctx->pitch), a->col + begin,
+                      (uint8_t *)a->val + (begin * ctx->esize), stop - begin );
+        begin = stop ;
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Merge the entries of a and b falling in one task's range, row by
+ *         row. Pass 1 only counts, pass 2 writes at the task's offset
+ * \param  *arg - Sparse_Add_Ctx
+ * \param  task - task index
+ * \param  thread_idx - unused
+ * \return void
+ */
+/*****************************************************************************/
+static void _sp_add_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Sparse_Add_Ctx *ctx = (Sparse_Add_Ctx *)arg ;
+    Sparse_Data *a = ctx->a , *b = ctx->b , *out = ctx->out ;
+    uint64_t ka = ctx->a_bound[task] , ka_end = ctx->a_bound[task + 1] ;
+    uint64_t kb = ctx->b_bound[task] , kb_end = ctx->b_bound[task + 1] ;
+    uint64_t ra = 0 , rb = 0 , row = 0 , sa = 0 , sb = 0 , n = 0 , pos = 0 , total = 0 ;
+
+    (void)thread_idx ;
+    pos = ctx->count_only ? 0 : ctx->offset[task] ;
+    while((ka < ka_end) || (kb < kb_end)) {
+        ra = (ka < ka_end) ? _sp_row_of( a, ka ) : UINT64_MAX ;
+        rb = (kb < kb_end) ? _sp_row_of( b, kb ) : UINT64_MAX ;
+        row = (ra < rb) ? ra : rb ;
+        sa = (ra == row) ? ((a->row_ptr[row + 1] < ka_end) ? a->row_ptr[row + 1] : ka_end) : ka ;
+        sb = (rb == row) ? ((b->row_ptr[row + 1] < kb_end) ? b->row_ptr[row + 1] : kb_end) : kb ;
+
+        if( ctx->count_only ) {
+            n = _sp_merge_count( a->col + ka, sa - ka, b->col + kb, sb - kb );
+        } else {
+            n = ctx->merge( out->col + pos, (uint8_t *)out->val + (pos * ctx->esize),
+                            a->col + ka, (uint8_t *)a->val + (ka * ctx->esize), sa - ka,
+                            b->col + kb, (uint8_t *)b->val + (kb * ctx->esize), sb - kb );
+            /* a row can straddle two tasks */
+            __atomic_fetch_add( &out->row_ptr[row + 1], n, __ATOMIC_RELAXED );
+            pos += n ;
+        }
+        total += n ;
+        ka = sa ;
+        kb = sb ;
+    }
+    if( ctx->count_only )
+        ctx->offset[task] = total ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Sort the entries of every row by column and sum duplicates,
+ *         packing the rows again if any were merged
+ * \param  *sp - array with row_ptr, col and val filled, rows grouped
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _sp_finish_rows( Sparse_Data *sp )
+{
+    api_Err_Status err = api_Success ;
+    Sparse_Sort_Key *keys = NULL ;
+    uint8_t *tmp = NULL , *val = (uint8_t *)sp->val ;
+    uint64_t rows = _sp_rows( &sp->meta ) , row = 0 , begin = 0 , len = 0 , idx_k = 0 , max_len = 0 , out = 0 ;
+    uint32_t esize = sizeof_datatype( sp->meta.type ) ;
+    uint32_t sorted = 1 ;
+
+    for( row=0 ; row < rows ; row++ ) {
+        len = sp->row_ptr[row + 1] - sp->row_ptr[row] ;
+        max_len = (len > max_len) ? len : max_len ;
+    }
+
+    for( row=0 ; row < rows ; row++ ) {
+        begin = sp->row_ptr[row] ;
+        len = sp->row_ptr[row + 1] - begin ;
+        for( idx_k=1, sorted=1 ; (idx_k < len) && sorted ; idx_k++ )
+            sorted = (sp->col[begin + idx_k - 1] < sp->col[begin + idx_k]) ;
+
+        if( !sorted ) {
+            if( keys == NULL ) {
+                keys = malloc( max_len * sizeof(Sparse_Sort_Key));
+                tmp = malloc( max_len * esize );
+                if((keys == NULL) || (tmp == NULL)) {
+                    debug("Could not allocate sort buffers for %llu entries", (unsigned long long)max_len);
+                    err = api_Err_Memory ;
+                    goto err_sparse_finish ;
+                }
+            }
+            for( idx_k=0 ; idx_k < len ; idx_k++ ) {
+                keys[idx_k].col = sp->col[begin + idx_k] ;
+                keys[idx_k].pos = idx_k ;
+            }
+            qsort( keys, len, sizeof(Sparse_Sort_Key), _sp_key_cmp );
+            for( idx_k=0 ; idx_k < len ; idx_k++ ) {
+                sp->col[begin + idx_k] = keys[idx_k].col ;
+                memcpy( tmp + (idx_k * esize), val + ((begin + keys[idx_k].pos) * esize), esize );
+            }
+            memcpy( val + (begin * esize), tmp, len * esize );
+            len = g_sp_kernels[sp->meta.type].compact( sp->col + begin, val + (begin * esize), len );
+        }
+
+        /* shift the row down over entries merged away in earlier rows */
+        if( out != begin ) {
+            memmove( sp->col + out, sp->col + begin, len * sizeof(uint64_t));
+            memmove( val + (out * esize), val + (begin * esize), len * esize );
+        }
+        sp->row_ptr[row] = out ;
+        out += len ;
+    }
+    sp->row_ptr[rows] = out ;
+    sp->nnz = out ;
+
+err_sparse_finish :
+    keys = (keys != NULL) ? free(keys), NULL : NULL ;
+    tmp = (tmp != NULL) ? free(tmp), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate column and value arrays for nnz entries
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _sp_alloc( Sparse_Data *sp, uint64_t nnz )
+{
+    uint64_t n = (nnz != 0) ? nnz : 1 ;
+
+    sp->nnz = nnz ;
+    sp->col = malloc( n * sizeof(uint64_t));
+    sp->val = malloc( n * sizeof_datatype( sp->meta.type ));
+    return ((sp->col != NULL) && (sp->val != NULL)) ? api_Success : api_Err_Memory ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Number of rows (1 for vectors) and columns of a sparse shape
+ */
+/*****************************************************************************/
+static uint64_t _sp_rows( Vector_MetaData *meta )
+{
+    return (meta->no_dims == 1) ? 1 : (meta->no_dims == 2) ? meta->dim.dim_2d.rows : 0 ;
+}
+
+static uint64_t _sp_cols( Vector_MetaData *meta )
+{
+    return (meta->no_dims == 1) ? meta->dim.dim_1d.items : (meta->no_dims == 2) ? meta->dim.dim_2d.cols : 0 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Row holding entry k : last row whose first entry is <= k
+ */
+/*****************************************************************************/
+static uint64_t _sp_row_of( Sparse_Data *sp, uint64_t k )
+{
+    uint64_t lo = 0 , hi = _sp_rows( &sp->meta ) , mid = 0 ;
+
+    while( hi - lo > 1 ) {
+        mid = lo + ((hi - lo) / 2) ;
+        if( sp->row_ptr[mid] <= k )
+            lo = mid ;
+        else
+            hi = mid ;
+    }
+    return lo ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Position of entry k in the row-major flattened index space of a
+ *         shape with cols columns
+ */
+/*****************************************************************************/
+static uint64_t _sp_flat( Sparse_Data *sp, uint64_t k, uint64_t cols )
+{
+    return (_sp_row_of( sp, k ) * cols) + sp->col[k] ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  First entry whose flattened position is >= flat
+ */
+/*****************************************************************************/
+static uint64_t _sp_lower_bound( Sparse_Data *sp, uint64_t flat, uint64_t cols )
+{
+    uint64_t lo = 0 , hi = sp->nnz , mid = 0 ;
+
+    while( lo < hi ) {
+        mid = lo + ((hi - lo) / 2) ;
+        if( _sp_flat( sp, mid, cols ) < flat )
+            lo = mid + 1 ;
+        else
+            hi = mid ;
+    }
+    return lo ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Size of the union of two ascending column lists
+ */
+/*****************************************************************************/
+static uint64_t _sp_merge_count( const uint64_t *ac, uint64_t an, const uint64_t *bc, uint64_t bn )
+{
+    uint64_t idx_a = 0 , idx_b = 0 , n = 0 ;
+
+    while((idx_a < an) && (idx_b < bn)) {
+        if( ac[idx_a] <= bc[idx_b] )
+            idx_b += (ac[idx_a++] == bc[idx_b]) ;
+        else
+            idx_b++ ;
+        n++ ;
+    }
+    return n + (an - idx_a) + (bn - idx_b) ;
+}
+
+
+
+static int _sp_key_cmp( const void *x, const void *y )
+{
+    const Sparse_Sort_Key *p = (const Sparse_Sort_Key *)x , *q = (const Sparse_Sort_Key *)y ;
+
+    if( p->col != q->col )
+        return (p->col < q->col) ? -1 : 1 ;
+    return (p->pos < q->pos) ? -1 : (p->pos > q->pos) ;
+}
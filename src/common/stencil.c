@@ -0,0 +1,542 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "tune_db.h"
+#include "stencil.h"
+
+
+#define STENCIL_DEFAULT_TIME_BLOCK   4
+#define STENCIL_DEFAULT_L2           (1024 * 1024)
+#define STENCIL_MIN_TILE             8
+
+
+/*!
+ * Row kernel : d[j] for j in [0,n) from rows r[dz][dy] (dz,dy in -1..1
+ * mapped to 0..2) where r[..][..][j] is the cell above/below d[j]
+ */
+typedef void (*Stencil_Row_Fn)( void *, void *[3][3], uint64_t, Stencil_Coeffs * );
+
+
+/*!
+ * State shared by the tasks of one pass (time_block fused sweeps)
+ */
+typedef struct __Stencil_Pass__
+{
+    uint8_t *src ;
+    uint8_t *dst ;
+    uint64_t nx , ny , nz ;
+    uint32_t esize ;
+    uint32_t steps ;                 /* sweeps fused in this pass */
+    uint32_t tile_x , tile_y ;
+    uint64_t tiles_x , tiles_y ;
+    uint64_t pitch ;                 /* row pitch of ring planes (elements) */
+    uint64_t plane ;                 /* elements per ring plane */
+    uint8_t *ring ;                  /* per-thread ring planes */
+    uint64_t ring_stride ;           /* bytes of ring per thread */
+    Stencil_Coeffs *coeffs ;
+    Stencil_Row_Fn row_fn ;
+} Stencil_Pass ;
+
+
+static void _stencil_tile( void *, uint64_t, uint32_t );
+static api_Err_Status _stencil_check( void *, void *, Vector_MetaData *, Stencil_Coeffs *, Stencil_Row_Fn * );
+static void _stencil_auto_tiling( Stencil_Tiling *, Vector_MetaData *, Stencil_Type, uint32_t );
+
+
+
+/*!
+ * Cell update, shared by the blocked kernels and the reference so both
+ * perform the same arithmetic. Neighbour sums are grouped per row :
+ * M = r[x] , S = r[x-1] + r[x+1]
+ */
+#define _M( r, dz, dy, j )    ((r)[dz][dy][(j)])
+#define _S( r, dz, dy, j )    ((r)[dz][dy][(j)-1] + (r)[dz][dy][(j)+1])
+
+#define _STENCIL_7PT( r, j, c0, c1 )                                              \
+    ( (c0) * _M(r,1,1,j) +                                                        \
+      (c1) * ( _S(r,1,1,j) + _M(r,1,0,j) + _M(r,1,2,j) + _M(r,0,1,j) + _M(r,2,1,j) ))
+
+#define _STENCIL_27PT( r, j, c0, c1, c2, c3 )                                     \
+    ( (c0) * _M(r,1,1,j) +                                                        \
+      (c1) * ( _S(r,1,1,j) + _M(r,1,0,j) + _M(r,1,2,j) + _M(r,0,1,j) + _M(r,2,1,j) ) + \
+      (c2) * ( _S(r,1,0,j) + _S(r,1,2,j) + _S(r,0,1,j) + _S(r,2,1,j) +            \
+               _M(r,0,0,j) + _M(r,0,2,j) + _M(r,2,0,j) + _M(r,2,2,j) ) +          \
+      (c3) * ( _S(r,0,0,j) + _S(r,0,2,j) + _S(r,2,0,j) + _S(r,2,2,j) ))
+
+#define STENCIL_ROW_KERNEL( T, SUFFIX )                                           \
+SIMD_KERNEL                                                                       \
+static void _stencil_row_##SUFFIX( void *dst, void *rows[3][3], uint64_t n,       \
+                                   Stencil_Coeffs *coeffs )                       \
+{                                                                                 \
+    T *d = (T *)dst ;                                                             \
+    T *r[3][3] ;                                                                  \
+    T c0 = (T)coeffs->centre , c1 = (T)coeffs->face ;                             \
+    T c2 = (T)coeffs->edge , c3 = (T)coeffs->corner ;                             \
+    uint64_t idx_i = 0 , idx_j = 0 ;                                              \
+                                                                                  \
+    for( idx_i=0 ; idx_i < 3 ; idx_i++ )                                          \
+        for( idx_j=0 ; idx_j < 3 ; idx_j++ )                                      \
+            r[idx_i][idx_j] = (T *)rows[idx_i][idx_j] ;                           \
+                                                                                  \
+    if( coeffs->type == Stencil_7pt ) {                                           \
+        for( idx_j=0 ; idx_j < n ; idx_j++ )                                      \
+            d[idx_j] = _STENCIL_7PT( r, idx_j, c0, c1 ) ;                         \
+    } else {                                                                      \
+        for( idx_j=0 ; idx_j < n ; idx_j++ )                                      \
+            d[idx_j] = _STENCIL_27PT( r, idx_j, c0, c1, c2, c3 ) ;                \
+    }                                                                             \
+    return ;                                                                      \
+}
+
+STENCIL_ROW_KERNEL( float , float  )
+STENCIL_ROW_KERNEL( double, double )
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Name of a tuning database knob of the stencil, e.g.
+ *         "stencil.7pt.float.tile_y"
+ * \param  *knob - output name
+ * \param  len - size of knob
+ * \param  type - stencil shape
+ * \param  d_type - element type
+ * \param  *param - tile_x, tile_y or time_block
+ * \return void
+ */
+/*****************************************************************************/
+void stencil_tune_knob( char *knob, size_t len, Stencil_Type type, Data_Type d_type, const char *param )
+{
+    snprintf( knob, len, "stencil.%s.%s.%s", (type == Stencil_27pt) ? "27pt" : "7pt", datatype_name( d_type ), param );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Fill in smoothing weights which sum to 1
+ * \param  *coeffs - output coefficients
+ * \param  type - 7 or 27 point stencil
+ * \return void
+ */
+/*****************************************************************************/
+void stencil_default_coeffs( Stencil_Coeffs *coeffs, Stencil_Type type )
+{
+    if( coeffs == NULL )
+        return ;
+
+    memset( coeffs, 0, sizeof(Stencil_Coeffs));
+    coeffs->type = type ;
+    if( type == Stencil_7pt ) {
+        coeffs->centre = 0.4 ;
+        coeffs->face = 0.1 ;
+    } else {
+        coeffs->centre = 0.125 ;
+        coeffs->face = 0.0625 ;
+        coeffs->edge = 0.03125 ;
+        coeffs->corner = 0.015625 ;
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Apply a stencil 'iterations' times using spatial (x/y) and
+ *         temporal blocking. Each task owns an x/y tile and sweeps it along z
+ *         as a wavefront : at every z step each of the time_block time levels
+ *         advances one plane, intermediate levels living in small per-thread
+ *         ring buffers of three planes. Tiles are overlapped by the halo
+ *         the fused sweeps need, so tasks are independent and run on the pool
+ * \param  *out - output volume, allocated with alloc_data() for *meta
+ * \param  *in - input volume from read_data(). Not modified
+ * \param  *meta - meta-data of both volumes (3 dimensions, float or double)
+ * \param  *coeffs - stencil type and weights
+ * \param  iterations - number of sweeps
+ * \param  *tiling - blocking parameters. NULL or zero fields : automatic
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status stencil_3d( void *out, void *in, Vector_MetaData *meta, Stencil_Coeffs *coeffs,
+                           uint32_t iterations, Stencil_Tiling *tiling )
+{
+    api_Err_Status err = api_Success ;
+    Stencil_Pass pass ;
+    Stencil_Tiling tile ;
+    Stencil_Row_Fn row_fn = NULL ;
+    Thread_Pool *pool = NULL ;
+    void *tmp = NULL ;
+    uint8_t *src = NULL , *dst_out = NULL , *dst_tmp = NULL ;
+    uint32_t no_passes = 0 , idx_p = 0 , no_threads = 0 ;
+    Perf_Sample ps ;
+
+    memset( &pass, 0, sizeof(pass));
+    memset( &tile, 0, sizeof(tile));
+
+    err = _stencil_check( out, in, meta, coeffs, &row_fn );
+    if( err != api_Success )
+        goto err_stencil ;
+
+    if( iterations == 0 ) {
+        memcpy( data_payload(out, meta), data_payload(in, meta), data_items(meta) * sizeof_datatype(meta->type));
+        goto err_stencil ;
+    }
+
+    if( tiling != NULL )
+        tile = *tiling ;
+    _stencil_auto_tiling( &tile, meta, coeffs->type, iterations );
+
+    /* passes alternate between out and a temporary so the last lands in out */
+    no_passes = (iterations + tile.time_block - 1) / tile.time_block ;
+    if( no_passes > 1 ) {
+        err = alloc_data( &tmp, meta );
+        if( err != api_Success ) {
+            debug("Could not allocate temporary volume. err = %d", err);
+            goto err_stencil ;
+        }
+        dst_tmp = data_payload( tmp, meta );
+    }
+    dst_out = data_payload( out, meta );
+
+    pool = tpool_default();
+    no_threads = tpool_size( pool );
+
+    pass.nx = meta->dim.dim_3d.dim_x ;
+    pass.ny = meta->dim.dim_3d.dim_y ;
+    pass.nz = meta->dim.dim_3d.dim_z ;
+    pass.esize = sizeof_datatype( meta->type );
+    pass.tile_x = tile.tile_x ;
+    pass.tile_y = tile.tile_y ;
+    pass.tiles_x = (pass.nx + tile.tile_x - 1) / tile.tile_x ;
+    pass.tiles_y = (pass.ny + tile.tile_y - 1) / tile.tile_y ;
+    pass.pitch = tile.tile_x + (2 * tile.time_block) ;
+    pass.plane = pass.pitch * (tile.tile_y + (2 * tile.time_block)) ;
+    pass.coeffs = coeffs ;
+    pass.row_fn = row_fn ;
+
+    /* three ring planes for every intermediate time level, per thread */
+    pass.ring_stride = 3 * (tile.time_block - 1) * pass.plane * pass.esize ;
+    pass.ring_stride = (pass.ring_stride + SIMD_ALIGN - 1) & ~((uint64_t)SIMD_ALIGN - 1) ;
+    if( pass.ring_stride != 0 ) {
+        if( posix_memalign((void **)&pass.ring, SIMD_ALIGN, pass.ring_stride * no_threads) != 0 ) {
+            debug("Could not allocate %llu bytes of ring buffers",
+                                  (unsigned long long)(pass.ring_stride * no_threads));
+            pass.ring = NULL ;
+            err = api_Err_Memory ;
+            goto err_stencil_mem ;
+        }
+    }
+
+    /* one element per point update */
+    src = data_payload( in, meta );
+    perf_begin( &ps );
+    for( idx_p=0 ; idx_p < no_passes ; idx_p++ ) {
+        pass.src = src ;
+        pass.dst = (((no_passes - 1 - idx_p) % 2) == 0) ? dst_out : dst_tmp ;
+        pass.steps = ((idx_p + 1) == no_passes) ? iterations - (idx_p * tile.time_block) : tile.time_block ;
+
+        err = tpool_parallel_for( pool, pass.tiles_x * pass.tiles_y, _stencil_tile, &pass );
+        if( err != api_Success ) {
+            debug("Stencil pass %u failed. err = %d", idx_p, err);
+            goto err_stencil_mem ;
+        }
+        src = pass.dst ;
+    }
+    perf_end( &ps, Perf_Stencil, data_items( meta ) * iterations );
+
+err_stencil_mem :
+    pass.ring = (pass.ring != NULL) ? free(pass.ring), NULL : NULL ;
+    clean_data( &tmp, meta );
+err_stencil :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Straightforward sweep-by-sweep stencil used to verify stencil_3d()
+ * \param  *out - output volume, allocated with alloc_data() for *meta
+ * \param  *in - input volume. Not modified
+ * \param  *meta - meta-data of both volumes
+ * \param  *coeffs - stencil type and weights
+ * \param  iterations - number of sweeps
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status stencil_3d_reference( void *out, void *in, Vector_MetaData *meta,
+                                     Stencil_Coeffs *coeffs, uint32_t iterations )
+{
+    api_Err_Status err = api_Success ;
+    Stencil_Row_Fn row_fn = NULL ;
+    void *tmp = NULL ;
+    uint8_t *src = NULL , *dst = NULL , *swap = NULL ;
+    void *rows[3][3] ;
+    uint64_t nx , ny , nz , z , y , bytes ;
+    uint32_t esize , it , dz , dy ;
+
+    err = _stencil_check( out, in, meta, coeffs, &row_fn );
+    if( err != api_Success )
+        goto err_stencil_ref ;
+
+    nx = meta->dim.dim_3d.dim_x ;
+    ny = meta->dim.dim_3d.dim_y ;
+    nz = meta->dim.dim_3d.dim_z ;
+    esize = sizeof_datatype( meta->type );
+    bytes = nx * ny * nz * esize ;
+
+    err = alloc_data( &tmp, meta );
+    if( err != api_Success ) {
+        debug("Could not allocate temporary volume. err = %d", err);
+        goto err_stencil_ref ;
+    }
+
+    /* boundaries never change - start both buffers from the input */
+    memcpy( data_payload(out, meta), data_payload(in, meta), bytes );
+    memcpy( data_payload(tmp, meta), data_payload(in, meta), bytes );
+    src = data_payload( ((iterations % 2) == 0) ? out : tmp, meta );
+    dst = data_payload( ((iterations % 2) == 0) ? tmp : out, meta );
+
+    for( it=0 ; it < iterations ; it++ ) {
+        for( z=1 ; (z+1) < nz ; z++ ) {
+            for( y=1 ; (y+1) < ny ; y++ ) {
+                if( nx < 3 )
+                    continue ;
+                for( dz=0 ; dz < 3 ; dz++ )
+                    for( dy=0 ; dy < 3 ; dy++ )
+                        rows[dz][dy] = src + ((((z+dz-1) * ny) + (y+dy-1)) * nx + 1) * esize ;
+                row_fn( dst + (((z * ny) + y) * nx + 1) * esize, rows, nx - 2, coeffs );
+            }
+        }
+        swap = src ; src = dst ; dst = swap ;
+    }
+
+    clean_data( &tmp, meta );
+err_stencil_ref :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Process one x/y tile for all planes and all fused time levels
+ * \param  *arg - Stencil_Pass
+ * \param  task - tile index
+ * \param  thread_idx - selects the ring buffers of the executing thread
+ * \return void
+ */
+/*****************************************************************************/
+static void _stencil_tile( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Stencil_Pass *p = (Stencil_Pass *)arg ;
+    uint8_t *ring = p->ring + (thread_idx * p->ring_stride) ;
+    uint32_t T = p->steps , t , dz , dy ;
+    int64_t y0 , y1 , x0 , x1 , ybase , xbase ;
+    int64_t ylo , yhi , xlo , xhi , y , z , s , ix_lo , ix_hi ;
+    int64_t nx = (int64_t)p->nx , ny = (int64_t)p->ny , nz = (int64_t)p->nz ;
+    uint8_t *lvl_row[2] ;
+    void *rows[3][3] ;
+    uint8_t *drow = NULL , *crow = NULL ;
+
+    y0 = (int64_t)(task / p->tiles_x) * p->tile_y ;
+    x0 = (int64_t)(task % p->tiles_x) * p->tile_x ;
+    y1 = ((y0 + p->tile_y) < ny) ? (y0 + p->tile_y) : ny ;
+    x1 = ((x0 + p->tile_x) < nx) ? (x0 + p->tile_x) : nx ;
+    ybase = y0 - (int64_t)T ;
+    xbase = x0 - (int64_t)T ;
+
+/* address of cell (x,y) of plane z at time level l (0 = src, T = dst) */
+#define _LVL_PTR( l, zz, yy, xx )                                                        \
+    (((l) == 0) ? p->src + (((((zz) * ny) + (yy)) * nx) + (xx)) * p->esize :             \
+     ((l) == T) ? p->dst + (((((zz) * ny) + (yy)) * nx) + (xx)) * p->esize :             \
+                  ring + ((((uint64_t)((l) - 1) * 3 + ((zz) % 3)) * p->plane) +            \
+                          (((yy) - ybase) * p->pitch) + ((xx) - xbase)) * p->esize)
+
+    for( s=0 ; s < (nz + T - 1) ; s++ ) {
+        for( t=1 ; t <= T ; t++ ) {
+            z = s - (int64_t)(t - 1) ;
+            if((z < 0) || (z >= nz))
+                continue ;
+
+            /* region of level t still needed by the remaining levels */
+            ylo = y0 - (int64_t)(T - t) ; yhi = y1 + (int64_t)(T - t) ;
+            xlo = x0 - (int64_t)(T - t) ; xhi = x1 + (int64_t)(T - t) ;
+            ylo = (ylo < 0) ? 0 : ylo ; yhi = (yhi > ny) ? ny : yhi ;
+            xlo = (xlo < 0) ? 0 : xlo ; xhi = (xhi > nx) ? nx : xhi ;
+
+            /* interior x range of this region */
+            ix_lo = (xlo < 1) ? 1 : xlo ;
+            ix_hi = (xhi > (nx - 1)) ? (nx - 1) : xhi ;
+
+            for( y=ylo ; y < yhi ; y++ ) {
+                drow = _LVL_PTR( t, z, y, xlo );
+                crow = _LVL_PTR( t-1, z, y, xlo );
+
+                /* fixed boundary planes/rows are carried over */
+                if((z == 0) || (z == (nz - 1)) || (y == 0) || (y == (ny - 1)) || (ix_lo >= ix_hi)) {
+                    memcpy( drow, crow, (xhi - xlo) * p->esize );
+                    continue ;
+                }
+                if( xlo < ix_lo )
+                    memcpy( drow, crow, p->esize );
+                if( xhi > ix_hi ) {
+                    lvl_row[0] = _LVL_PTR( t, z, y, ix_hi );
+                    lvl_row[1] = _LVL_PTR( t-1, z, y, ix_hi );
+                    memcpy( lvl_row[0], lvl_row[1], p->esize );
+                }
+
+                for( dz=0 ; dz < 3 ; dz++ )
+                    for( dy=0 ; dy < 3 ; dy++ )
+                        rows[dz][dy] = _LVL_PTR( t-1, z + dz - 1, y + dy - 1, ix_lo );
+                p->row_fn( _LVL_PTR( t, z, y, ix_lo ), rows, (uint64_t)(ix_hi - ix_lo), p->coeffs );
+            }
+        }
+    }
+#undef _LVL_PTR
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Validate parameters and select the row kernel for the data-type
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _stencil_check( void *out, void *in, Vector_MetaData *meta,
+                                      Stencil_Coeffs *coeffs, Stencil_Row_Fn *row_fn )
+{
+    api_Err_Status err = api_Success ;
+
+    if((out == NULL) || (in == NULL) || (meta == NULL) || (coeffs == NULL)) {
+        debug("Invalid params out = %p, in = %p, meta = %p, coeffs = %p", out, in, meta, coeffs);
+        err = api_Err_Param ;
+        goto err_stencil_check ;
+    }
+    if( out == in ) {
+        debug("Stencil cannot be computed in place");
+        err = api_Err_Param ;
+        goto err_stencil_check ;
+    }
+    if( meta->no_dims != 3 ) {
+        debug("Stencils need 3-dimensional data. Got %u dimensions", meta->no_dims);
+        err = api_Err_Param ;
+        goto err_stencil_check ;
+    }
+    if( coeffs->type >= Stencil_MaxTypes ) {
+        debug("Unknown stencil type %d", coeffs->type);
+        err = api_Err_Param ;
+        goto err_stencil_check ;
+    }
+
+    switch( meta->type )
+    {
+        case DataType_float  : *row_fn = _stencil_row_float ;  break ;
+        case DataType_double : *row_fn = _stencil_row_double ; break ;
+        default :
+            debug("Stencils are only provided for float and double data");
+            err = api_Err_Param ;
+            goto err_stencil_check ;
+    }
+
+err_stencil_check :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Choose blocking parameters not set by the caller. Values tuned
+ *         for this machine and volume size are used first; otherwise the
+ *         ring buffers of a tile plus the three source planes streaming
+ *         through it are sized to stay within half of the L2 cache
+ * \param  *tile - in/out blocking parameters
+ * \param  *meta - volume meta-data
+ * \param  type - stencil shape, part of the tuning knob names
+ * \param  iterations - total number of sweeps
+ * \return void
+ */
+/*****************************************************************************/
+static void _stencil_auto_tiling( Stencil_Tiling *tile, Vector_MetaData *meta, Stencil_Type type, uint32_t iterations )
+{
+    long l2 = sysconf( _SC_LEVEL2_CACHE_SIZE );
+    uint64_t esize = sizeof_datatype( meta->type ) ;
+    uint64_t nx = meta->dim.dim_3d.dim_x , ny = meta->dim.dim_3d.dim_y ;
+    uint64_t budget , planes , width , bytes = data_items( meta ) * esize ;
+    char knob[TUNE_NAME_LEN] ;
+
+    if( l2 <= 0 )
+        l2 = STENCIL_DEFAULT_L2 ;
+    budget = (uint64_t)l2 / 2 ;
+
+    stencil_tune_knob( knob, sizeof(knob), type, meta->type, "time_block" );
+    if( tile->time_block == 0 )
+        tile->time_block = (uint32_t)tune_lookup( knob, bytes, STENCIL_DEFAULT_TIME_BLOCK );
+    stencil_tune_knob( knob, sizeof(knob), type, meta->type, "tile_x" );
+    if( tile->tile_x == 0 )
+        tile->tile_x = (uint32_t)tune_lookup( knob, bytes, 0 );
+    stencil_tune_knob( knob, sizeof(knob), type, meta->type, "tile_y" );
+    if( tile->tile_y == 0 )
+        tile->tile_y = (uint32_t)tune_lookup( knob, bytes, 0 );
+
+    if( tile->time_block == 0 )
+        tile->time_block = STENCIL_DEFAULT_TIME_BLOCK ;
+    if( tile->time_block > iterations )
+        tile->time_block = iterations ;
+
+    /* 3 ring planes per intermediate level + 3 input planes */
+    planes = 3 * tile->time_block ;
+
+    if( tile->tile_x == 0 ) {
+        tile->tile_x = (nx < 512) ? (uint32_t)nx : 512 ;
+    }
+    if( tile->tile_y == 0 ) {
+        width = (tile->tile_x + 2 * tile->time_block) * esize ;
+        tile->tile_y = (uint32_t)(budget / (planes * width)) ;
+        tile->tile_y = (tile->tile_y > (2 * tile->time_block)) ? tile->tile_y - (2 * tile->time_block) : 0 ;
+        if( tile->tile_y < STENCIL_MIN_TILE )
+            tile->tile_y = STENCIL_MIN_TILE ;
+    }
+    if( tile->tile_x == 0 )
+        tile->tile_x = 1 ;
+    if( tile->tile_y > ny )
+        tile->tile_y = (ny != 0) ? (uint32_t)ny : 1 ;
+    return ;
+}
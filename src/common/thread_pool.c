@@ -0,0 +1,410 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "thread_pool.h"
+#include "tune_db.h"
+#include "perf_counters.h"
+
+
+/*!
+ * Pool of native worker threads. A job is a set of independent tasks which
+ * are handed out dynamically (atomic counter) to the workers and to the
+ * thread which submitted the job. Only one job is in flight at a time.
+ */
+struct __Thread_Pool__
+{
+    uint32_t no_threads ;          /* workers + submitting thread */
+    pthread_t *workers ;
+
+    pthread_mutex_t lock ;         /* protects everything below */
+    pthread_cond_t  job_cond ;     /* signalled when a new job is posted */
+    pthread_cond_t  done_cond ;    /* signalled when a worker finishes a job */
+    pthread_mutex_t submit_lock ;  /* serialises submitting threads */
+
+    uint64_t generation ;          /* incremented for every posted job */
+    uint32_t workers_busy ;
+    uint32_t shutdown ;
+
+    tpool_task_fn fn ;
+    void *ctx ;
+    uint64_t no_tasks ;
+    uint64_t next_task ;           /* accessed atomically */
+};
+
+
+typedef struct __Worker_Args__
+{
+    Thread_Pool *pool ;
+    uint32_t thread_idx ;
+} Worker_Args ;
+
+
+/*!
+ * Set for threads currently executing pool tasks. Parallel-for calls made
+ * from inside a task run inline on the calling thread instead of dead-locking
+ * on the pool.
+ */
+static __thread uint32_t _tls_in_pool = 0 ;
+
+static Thread_Pool *g_default_pool = NULL ;
+static pthread_mutex_t g_default_lock = PTHREAD_MUTEX_INITIALIZER ;
+
+static void *_worker_main( void * );
+static void _run_tasks( Thread_Pool *, uint32_t );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a thread pool
+ * \param  **pool - output handle to the pool
+ * \param  no_threads - total number of threads executing jobs, including the
+ *                      thread calling tpool_parallel_for(). 0 selects the
+ *                      default (see tpool_default_threads())
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status tpool_create( Thread_Pool **pool, uint32_t no_threads )
+{
+    api_Err_Status err = api_Success ;
+    Thread_Pool *tp = NULL ;
+    Worker_Args *args = NULL ;
+    uint32_t idx_i = 0 ;
+
+    if( pool == NULL ) {
+        debug("Cannot return thread-pool in NULL pointer");
+        err = api_Err_Param ;
+        goto err_tpool_create ;
+    }
+    *pool = NULL ;
+
+    if( no_threads == 0 )
+        no_threads = tpool_default_threads();
+    if( no_threads > TPOOL_MAX_THREADS )
+        no_threads = TPOOL_MAX_THREADS ;
+
+    tp = calloc( 1, sizeof(Thread_Pool));
+    if( tp == NULL ) {
+        debug("Could not allocate thread-pool structure");
+        err = api_Err_Memory ;
+        goto err_tpool_create ;
+    }
+    tp->no_threads = no_threads ;
+    pthread_mutex_init( &tp->lock, NULL );
+    pthread_mutex_init( &tp->submit_lock, NULL );
+    pthread_cond_init( &tp->job_cond, NULL );
+    pthread_cond_init( &tp->done_cond, NULL );
+
+    if( no_threads > 1 ) {
+        tp->workers = calloc( no_threads - 1, sizeof(pthread_t));
+        if( tp->workers == NULL ) {
+            debug("Could not allocate %u worker handles", no_threads - 1);
+            err = api_Err_Memory ;
+            goto err_tpool_create_mem ;
+        }
+    }
+
+    for( idx_i=1 ; idx_i < no_threads ; idx_i++ ) {
+        args = malloc( sizeof(Worker_Args));
+        if( args == NULL ) {
+            debug("Could not allocate arguments for worker %u", idx_i);
+            err = api_Err_Memory ;
+            goto err_tpool_create_threads ;
+        }
+        args->pool = tp ;
+        args->thread_idx = idx_i ;
+        if( pthread_create( &tp->workers[idx_i-1], NULL, _worker_main, args ) != 0 ) {
+            debug("pthread_create() failed for worker %u", idx_i);
+            free( args );
+            err = api_Err_Init ;
+            goto err_tpool_create_threads ;
+        }
+    }
+
+    *pool = tp ;
+    return err ;
+
+err_tpool_create_threads :
+    /* only the first idx_i-1 workers are running */
+    tp->no_threads = idx_i ;
+    tpool_destroy( &tp );
+    return err ;
+
+err_tpool_create_mem :
+    pthread_cond_destroy( &tp->job_cond );
+    pthread_cond_destroy( &tp->done_cond );
+    pthread_mutex_destroy( &tp->lock );
+    pthread_mutex_destroy( &tp->submit_lock );
+    free( tp );
+err_tpool_create :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Execute fn(ctx, task, thread) for task = 0..no_tasks-1 on the pool
+ *         and wait for completion. The calling thread executes tasks too.
+ * \param  *pool - thread pool. NULL executes serially on the caller
+ * \param  no_tasks - number of tasks
+ * \param  fn - task function
+ * \param  *ctx - opaque context handed to every task
+ * \return returns api_Success on success.
+ * \note   Calls made from within a task are executed inline on that thread
+ */
+/*****************************************************************************/
+api_Err_Status tpool_parallel_for( Thread_Pool *pool, uint64_t no_tasks, tpool_task_fn fn, void *ctx )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t idx_i = 0 ;
+    uint32_t in_pool = _tls_in_pool ;
+
+    if( fn == NULL ) {
+        debug("Task function = NULL");
+        err = api_Err_Param ;
+        goto err_parallel_for ;
+    }
+
+    /* serial execution : no pool, single thread, nested call or tiny job */
+    if((pool == NULL) || (pool->no_threads <= 1) || in_pool || (no_tasks <= 1)) {
+        for( idx_i=0 ; idx_i < no_tasks ; idx_i++ )
+            fn( ctx, idx_i, 0 );
+        goto err_parallel_for ;
+    }
+
+    pthread_mutex_lock( &pool->submit_lock );
+
+    pthread_mutex_lock( &pool->lock );
+    pool->fn = fn ;
+    pool->ctx = ctx ;
+    pool->no_tasks = no_tasks ;
+    __atomic_store_n( &pool->next_task, 0, __ATOMIC_RELAXED );
+    pool->workers_busy = pool->no_threads - 1 ;
+    pool->generation++ ;
+    pthread_cond_broadcast( &pool->job_cond );
+    pthread_mutex_unlock( &pool->lock );
+
+    _tls_in_pool = 1 ;
+    _run_tasks( pool, 0 );
+    _tls_in_pool = in_pool ;
+
+    pthread_mutex_lock( &pool->lock );
+    while( pool->workers_busy != 0 )
+        pthread_cond_wait( &pool->done_cond, &pool->lock );
+    pool->fn = NULL ;
+    pool->ctx = NULL ;
+    pthread_mutex_unlock( &pool->lock );
+
+    pthread_mutex_unlock( &pool->submit_lock );
+
+err_parallel_for :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Stop all workers and release the pool
+ * \param  **pool - pool handle, set to NULL on return
+ * \return void
+ */
+/*****************************************************************************/
+void tpool_destroy( Thread_Pool **pool )
+{
+    Thread_Pool *tp = NULL ;
+    uint32_t idx_i = 0 ;
+
+    if((pool == NULL) || (*pool == NULL))
+        return ;
+    tp = *pool ;
+
+    pthread_mutex_lock( &tp->lock );
+    tp->shutdown = 1 ;
+    pthread_cond_broadcast( &tp->job_cond );
+    pthread_mutex_unlock( &tp->lock );
+
+    for( idx_i=1 ; idx_i < tp->no_threads ; idx_i++ )
+        pthread_join( tp->workers[idx_i-1], NULL );
+
+    pthread_cond_destroy( &tp->job_cond );
+    pthread_cond_destroy( &tp->done_cond );
+    pthread_mutex_destroy( &tp->lock );
+    pthread_mutex_destroy( &tp->submit_lock );
+    tp->workers = (tp->workers != NULL) ? free(tp->workers), NULL : NULL ;
+    free( tp );
+    *pool = NULL ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Number of threads executing jobs on the pool
+ * \param  *pool - thread pool
+ * \return number of threads (1 for a NULL pool)
+ */
+/*****************************************************************************/
+uint32_t tpool_size( Thread_Pool *pool )
+{
+    return (pool != NULL) ? pool->no_threads : 1 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Default number of threads. HETERO_THREADS in the environment
+ *         overrides the tuned pool size, which overrides the number of
+ *         online processors.
+ * \return number of threads to use
+ */
+/*****************************************************************************/
+uint32_t tpool_default_threads( void )
+{
+    char *env = getenv("HETERO_THREADS");
+    long no_cpus = 0 ;
+
+    if((env != NULL) && (strtol(env, NULL, 0) > 0))
+        no_cpus = strtol(env, NULL, 0);
+    else if((no_cpus = sysconf(_SC_NPROCESSORS_ONLN)) > 0)
+        no_cpus = (long)tune_lookup( "pool.threads", 0, (uint64_t)no_cpus );
+
+    if( no_cpus < 1 )
+        no_cpus = 1 ;
+    if( no_cpus > TPOOL_MAX_THREADS )
+        no_cpus = TPOOL_MAX_THREADS ;
+    return (uint32_t)no_cpus ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Process wide pool shared by all kernels. Created on first use.
+ * \return default pool or NULL if it could not be created (kernels then
+ *         run serially)
+ */
+/*****************************************************************************/
+Thread_Pool *tpool_default( void )
+{
+    Thread_Pool *pool = NULL ;
+
+    pthread_mutex_lock( &g_default_lock );
+    if( g_default_pool == NULL ) {
+        if( tpool_create( &g_default_pool, 0 ) != api_Success )
+            debug("Could not create default thread-pool. Running serially");
+    }
+    pool = g_default_pool ;
+    pthread_mutex_unlock( &g_default_lock );
+    return pool ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Release the process wide pool (at program termination)
+ * \return void
+ */
+/*****************************************************************************/
+void tpool_default_release( void )
+{
+    pthread_mutex_lock( &g_default_lock );
+    tpool_destroy( &g_default_pool );
+    pthread_mutex_unlock( &g_default_lock );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pull tasks of the current job until none are left
+ * \param  *pool - thread pool
+ * \param  thread_idx - index of executing thread
+ * \return void
+ */
+/*****************************************************************************/
+static void _run_tasks( Thread_Pool *pool, uint32_t thread_idx )
+{
+    uint64_t task = 0 ;
+
+    for( task = __atomic_fetch_add( &pool->next_task, 1, __ATOMIC_RELAXED ) ;
+         task < pool->no_tasks ;
+         task = __atomic_fetch_add( &pool->next_task, 1, __ATOMIC_RELAXED ))
+        pool->fn( pool->ctx, task, thread_idx );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Worker thread body. Waits for jobs and executes their tasks
+ * \param  *arg - Worker_Args (owned by the worker)
+ * \return NULL
+ */
+/*****************************************************************************/
+static void *_worker_main( void *arg )
+{
+    Worker_Args *args = (Worker_Args *)arg ;
+    Thread_Pool *pool = args->pool ;
+    uint32_t thread_idx = args->thread_idx ;
+    uint64_t seen = 0 ;
+
+    free( args );
+    _tls_in_pool = 1 ;
+    perf_thread_register();
+
+    /* generation starts at 0 - a job posted before we got here is not missed */
+    pthread_mutex_lock( &pool->lock );
+    for( ;; ) {
+        while((pool->generation == seen) && !pool->shutdown )
+            pthread_cond_wait( &pool->job_cond, &pool->lock );
+        if( pool->shutdown )
+            break ;
+        seen = pool->generation ;
+        pthread_mutex_unlock( &pool->lock );
+
+        _run_tasks( pool, thread_idx );
+
+        pthread_mutex_lock( &pool->lock );
+        if( --pool->workers_busy == 0 )
+            pthread_cond_signal( &pool->done_cond );
+    }
+    pthread_mutex_unlock( &pool->lock );
+    perf_thread_unregister();
+    return NULL ;
+}
@@ -0,0 +1,670 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include <time.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "datatype.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "transpose.h"
+
+
+#define TR_LEAF        32       /* recursion stops at TR_LEAF x TR_LEAF blocks */
+#define TR_TASK        256      /* blocks handed to pool threads */
+
+
+/* out[c][r] = in[r][c] for one TS x TS tile, leading dimensions in elements */
+typedef void (*Tr_Tile_Fn)( uint8_t *, uint64_t, const uint8_t *, uint64_t );
+
+
+/*!
+ * A batch of independent 2D transposes : out[c*ldo + r] = in[r*ldi + c]
+ * for every batch entry b, offset by b*out_bstride / b*in_bstride elements
+ */
+typedef struct __Tr_Job__
+{
+    uint8_t *out ;
+    const uint8_t *in ;
+    uint64_t rows , cols ;
+    uint64_t ldo , ldi ;
+    uint64_t batch ;
+    uint64_t out_bstride , in_bstride ;
+    uint64_t esize ;
+    uint32_t ts ;                     /* SIMD tile edge, 0 : scalar only */
+    Tr_Tile_Fn tile ;
+    uint64_t row_tasks , col_tasks ;
+} Tr_Job ;
+
+
+static void _tr_select_tile( uint64_t, uint32_t *, Tr_Tile_Fn * );
+static void _tr_recursive( Tr_Job *, uint8_t *, const uint8_t *, uint64_t, uint64_t );
+static void _tr_leaf( Tr_Job *, uint8_t *, const uint8_t *, uint64_t, uint64_t );
+static void _tr_task( void *, uint64_t, uint32_t );
+static api_Err_Status _tr_run( Tr_Job * );
+static void _tr_inplace_diag( Tr_Job *, uint8_t *, uint64_t );
+static void _tr_inplace_swap( Tr_Job *, uint8_t *, uint8_t *, uint64_t, uint64_t );
+static void _tr_inplace_task( void *, uint64_t, uint32_t );
+
+
+
+/*!
+ * In-register tile transposes
+ */
+#if defined(__x86_64__)
+/*****************************************************************************/
+/*!
+ * \brief  8 x 8 tile of 4-byte elements in eight ymm registers
+ */
+/*****************************************************************************/
+__attribute__((target("avx2")))
+static void _tr_tile_4B_avx2( uint8_t *out, uint64_t ldo, const uint8_t *in, uint64_t ldi )
+{
+    const float *s = (const float *)in ;
+    float *d = (float *)out ;
+    __m256 r0 , r1 , r2 , r3 , r4 , r5 , r6 , r7 ;
+    __m256 t0 , t1 , t2 , t3 , t4 , t5 , t6 , t7 ;
+
+    r0 = _mm256_loadu_ps( s + 0 * ldi ); r1 = _mm256_loadu_ps( s + 1 * ldi );
+    r2 = _mm256_loadu_ps( s + 2 * ldi ); r3 = _mm256_loadu_ps( s + 3 * ldi );
+    r4 = _mm256_loadu_ps( s + 4 * ldi ); r5 = _mm256_loadu_ps( s + 5 * ldi );
+    r6 = _mm256_loadu_ps( s + 6 * ldi ); r7 = _mm256_loadu_ps( s + 7 * ldi );
+
+    t0 = _mm256_unpacklo_ps( r0, r1 ); t1 = _mm256_unpackhi_ps( r0, r1 );
+    t2 = _mm256_unpacklo_ps( r2, r3 ); t3 = _mm256_unpackhi_ps( r2, r3 );
+    t4 = _mm256_unpacklo_ps( r4, r5 ); t5 = _mm256_unpackhi_ps( r4, r5 );
+    t6 = _mm256_unpacklo_ps( r6, r7 ); t7 = _mm256_unpackhi_ps( r6, r7 );
+
+    r0 = _mm256_shuffle_ps( t0, t2, 0x44 ); r1 = _mm256_shuffle_ps( t0, t2, 0xEE );
+    r2 = _mm256_shuffle_ps( t1, t3, 0x44 ); r3 = _mm256_shuffle_ps( t1, t3, 0xEE );
+    r4 = _mm256_shuffle_ps( t4, t6, 0x44 ); r5 = _mm256_shuffle_ps( t4, t6, 0xEE );
+    r6 = _mm256_shuffle_ps( t5, t7, 0x44 ); r7 = _mm256_shuffle_ps( t5, t7, 0xEE );
+
+    _mm256_storeu_ps( d + 0 * ldo, _mm256_permute2f128_ps( r0, r4, 0x20 ));
+    _mm256_storeu_ps( d + 1 * ldo, _mm256_permute2f128_ps( r1, r5, 0x20 ));
+    _mm256_storeu_ps( d + 2 * ldo, _mm256_permute2f128_ps( r2, r6, 0x20 ));
+    _mm256_storeu_ps( d + 3 * ldo, _mm256_permute2f128_ps( r3, r7, 0x20 ));
+    _mm256_storeu_ps( d + 4 * ldo, _mm256_permute2f128_ps( r0, r4, 0x31 ));
+    _mm256_storeu_ps( d + 5 * ldo, _mm256_permute2f128_ps( r1, r5, 0x31 ));
+    _mm256_storeu_ps( d + 6 * ldo, _mm256_permute2f128_ps( r2, r6, 0x31 ));
+    _mm256_storeu_ps( d + 7 * ldo, _mm256_permute2f128_ps( r3, r7, 0x31 ));
+    return ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  4 x 4 tile of 8-byte elements in four ymm registers
+ */
+/*****************************************************************************/
+__attribute__((target("avx2")))
+static void _tr_tile_8B_avx2( uint8_t *out, uint64_t ldo, const uint8_t *in, uint64_t ldi )
+{
+    const double *s = (const double *)in ;
+    double *d = (double *)out ;
+    __m256d r0 , r1 , r2 , r3 , t0 , t1 , t2 , t3 ;
+
+    r0 = _mm256_loadu_pd( s + 0 * ldi ); r1 = _mm256_loadu_pd( s + 1 * ldi );
+    r2 = _mm256_loadu_pd( s + 2 * ldi ); r3 = _mm256_loadu_pd( s + 3 * ldi );
+
+    t0 = _mm256_unpacklo_pd( r0, r1 ); t1 = _mm256_unpackhi_pd( r0, r1 );
+    t2 = _mm256_unpacklo_pd( r2, r3 ); t3 = _mm256_unpackhi_pd( r2, r3 );
+
+    _mm256_storeu_pd( d + 0 * ldo, _mm256_permute2f128_pd( t0, t2, 0x20 ));
+    _mm256_storeu_pd( d + 1 * ldo, _mm256_permute2f128_pd( t1, t3, 0x20 ));
+    _mm256_storeu_pd( d + 2 * ldo, _mm256_permute2f128_pd( t0, t2, 0x31 ));
+    _mm256_storeu_pd( d + 3 * ldo, _mm256_permute2f128_pd( t1, t3, 0x31 ));
+    return ;
+}
+
+/*****************************************************************************/
+/*!
+ * \brief  8 x 8 tile of 2-byte elements in eight xmm registers (SSE2)
+ */
+/*****************************************************************************/
+static void _tr_tile_2B_sse2( uint8_t *out, uint64_t ldo, const uint8_t *in, uint64_t ldi )
+{
+    const uint16_t *s = (const uint16_t *)in ;
+    uint16_t *d = (uint16_t *)out ;
+    __m128i r0 , r1 , r2 , r3 , r4 , r5 , r6 , r7 ;
+    __m128i t0 , t1 , t2 , t3 , t4 , t5 , t6 , t7 ;
+
+    r0 = _mm_loadu_si128((const __m128i *)(s + 0 * ldi)); r1 = _mm_loadu_si128((const __m128i *)(s + 1 * ldi));
+    r2 = _mm_loadu_si128((const __m128i *)(s + 2 * ldi)); r3 = _mm_loadu_si128((const __m128i *)(s + 3 * ldi));
+    r4 = _mm_loadu_si128((const __m128i *)(s + 4 * ldi)); r5 = _mm_loadu_si128((const __m128i *)(s + 5 * ldi));
+    r6 = _mm_loadu_si128((const __m128i *)(s + 6 * ldi)); r7 = _mm_loadu_si128((const __m128i *)(s + 7 * ldi));
+
+    t0 = _mm_unpacklo_epi16( r0, r1 ); t1 = _mm_unpackhi_epi16( r0, r1 );
+    t2 = _mm_unpacklo_epi16( r2, r3 ); t3 = _mm_unpackhi_epi16( r2, r3 );
+    t4 = _mm_unpacklo_epi16( r4, r5 ); t5 = _mm_unpackhi_epi16( r4, r5 );
+    t6 = _mm_unpacklo_epi16( r6, r7 ); t7 = _mm_unpackhi_epi16( r6, r7 );
+
+    r0 = _mm_unpacklo_epi32( t0, t2 ); r1 = _mm_unpackhi_epi32( t0, t2 );
+    r2 = _mm_unpacklo_epi32( t1, t3 ); r3 = _mm_unpackhi_epi32( t1, t3 );
+    r4 = _mm_unpacklo_epi32( t4, t6 ); r5 = _mm_unpackhi_epi32( t4, t6 );
+    r6 = _mm_unpacklo_epi32( t5, t7 ); r7 = _mm_unpackhi_epi32( t5, t7 );
+
+    _mm_storeu_si128((__m128i *)(d + 0 * ldo), _mm_unpacklo_epi64( r0, r4 ));
+    _mm_storeu_si128((__m128i *)(d + 1 * ldo), _mm_unpackhi_epi64( r0, r4 ));
+    _mm_storeu_si128((__m128i *)(d + 2 * ldo), _mm_unpacklo_epi64( r1, r5 ));
+    _mm_storeu_si128((__m128i *)(d + 3 * ldo), _mm_unpackhi_epi64( r1, r5 ));
+    _mm_storeu_si128((__m128i *)(d + 4 * ldo), _mm_unpacklo_epi64( r2, r6 ));
+    _mm_storeu_si128((__m128i *)(d + 5 * ldo), _mm_unpackhi_epi64( r2, r6 ));
+    _mm_storeu_si128((__m128i *)(d + 6 * ldo), _mm_unpacklo_epi64( r3, r7 ));
+    _mm_storeu_si128((__m128i *)(d + 7 * ldo), _mm_unpackhi_epi64( r3, r7 ));
+    return ;
+}
+#endif
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Fill in the meta-data of a permuted array
+ * \param  *out_meta - output meta-data
+ * \param  *in_meta - meta-data of the input array
+ * \param  *perm - permutation, in_meta->no_dims entries
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status permute_result_meta( Vector_MetaData *out_meta, Vector_MetaData *in_meta, uint32_t *perm )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t in_ext[PERMUTE_MAX_DIMS] ;
+    uint32_t seen = 0 , idx_i = 0 ;
+
+    if((out_meta == NULL) || (in_meta == NULL) || (perm == NULL)) {
+        debug("Invalid params out_meta = %p, in_meta = %p, perm = %p", out_meta, in_meta, perm);
+        err = api_Err_Param ;
+        goto err_permute_meta ;
+    }
+    if((in_meta->no_dims < 1) || (in_meta->no_dims > PERMUTE_MAX_DIMS)) {
+        debug("Axis permutation supports 1 to %u dimensions", PERMUTE_MAX_DIMS);
+        err = api_Err_Param ;
+        goto err_permute_meta ;
+    }
+    for( idx_i=0 ; idx_i < in_meta->no_dims ; idx_i++ ) {
+        if((perm[idx_i] >= in_meta->no_dims) || (seen & (1u << perm[idx_i]))) {
+            debug("Invalid permutation : axis %u repeated or out of range", perm[idx_i]);
+            err = api_Err_Param ;
+            goto err_permute_meta ;
+        }
+        seen |= (1u << perm[idx_i]) ;
+    }
+
+    /* extents in subscript order */
+    for( idx_i=0 ; idx_i < in_meta->no_dims ; idx_i++ )
+        in_ext[idx_i] = in_meta->dim.shape[idx_i] ;
+
+    *out_meta = *in_meta ;
+    for( idx_i=0 ; idx_i < in_meta->no_dims ; idx_i++ )
+        out_meta->dim.shape[idx_i] = in_ext[perm[idx_i]] ;
+
+err_permute_meta :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Re-layout an array so that a different axis is contiguous. Every
+ *         permutation is mapped onto a batch of 2D transposes (possibly of
+ *         whole rows treated as one element) done by cache-oblivious
+ *         recursive splitting down to SIMD tiles, in parallel on the pool
+ * \param  *out - output array, allocated with alloc_data() for *out_meta
+ * \param  *out_meta - from permute_result_meta()
+ * \param  *in - input array from read_data()
+ * \param  *in_meta - meta-data of the input
+ * \param  *perm - permutation (see transpose.h)
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status permute_axes( void *out, Vector_MetaData *out_meta, void *in, Vector_MetaData *in_meta, uint32_t *perm )
+{
+    api_Err_Status err = api_Success ;
+    Vector_MetaData check ;
+    Tr_Job job ;
+    uint64_t esize = 0 , nx = 0 , ny = 0 , nz = 0 , code = 0 ;
+    uint32_t idx_i = 0 ;
+    Perf_Sample ps ;
+
+    memset( &job, 0, sizeof(job));
+
+    if((out == NULL) || (in == NULL) || (out == in)) {
+        debug("Invalid params out = %p, in = %p", out, in);
+        err = api_Err_Param ;
+        goto err_permute ;
+    }
+    err = permute_result_meta( &check, in_meta, perm );
+    if( err != api_Success )
+        goto err_permute ;
+    if((out_meta == NULL) || (out_meta->type != check.type) || !data_same_shape( out_meta, &check )) {
+        debug("Output meta-data does not describe the permuted array");
+        err = api_Err_Param ;
+        goto err_permute ;
+    }
+
+    esize = sizeof_datatype( in_meta->type );
+    job.out = data_payload( out, out_meta );
+    job.in = data_payload( in, in_meta );
+    job.batch = 1 ;
+    job.esize = esize ;
+
+    /* permutation as a number : {2,0,1} -> 201 */
+    for( idx_i=0 ; idx_i < in_meta->no_dims ; idx_i++ )
+        code = (code * 10) + perm[idx_i] ;
+
+    if( in_meta->no_dims == 2 ) {
+        ny = in_meta->dim.dim_2d.rows ;
+        nx = in_meta->dim.dim_2d.cols ;
+        if( code == 10 ) {
+            job.rows = ny ; job.cols = nx ; job.ldi = nx ; job.ldo = ny ;
+        }
+    } else if( in_meta->no_dims == 3 ) {
+        nz = in_meta->dim.dim_3d.dim_z ;
+        ny = in_meta->dim.dim_3d.dim_y ;
+        nx = in_meta->dim.dim_3d.dim_x ;
+        switch( code )
+        {
+            case 21 :    /* 0,2,1 : out[z][x][y] - transpose every z-plane */
+                job.rows = ny ; job.cols = nx ; job.ldi = nx ; job.ldo = ny ;
+                job.batch = nz ; job.in_bstride = ny * nx ; job.out_bstride = nx * ny ;
+                break ;
+            case 102 :   /* 1,0,2 : out[y][z][x] - x-rows move as single elements */
+                job.rows = nz ; job.cols = ny ; job.ldi = ny ; job.ldo = nz ;
+                job.esize = esize * nx ;
+                break ;
+            case 120 :   /* 1,2,0 : out[y][x][z] - (z) x (y*x) matrix */
+                job.rows = nz ; job.cols = ny * nx ; job.ldi = ny * nx ; job.ldo = nz ;
+                break ;
+            case 201 :   /* 2,0,1 : out[x][z][y] - (z*y) x (x) matrix */
+                job.rows = nz * ny ; job.cols = nx ; job.ldi = nx ; job.ldo = nz * ny ;
+                break ;
+            case 210 :   /* 2,1,0 : out[x][y][z] - z x x transposes, one per y */
+                job.rows = nz ; job.cols = nx ; job.ldi = ny * nx ; job.ldo = ny * nz ;
+                job.batch = ny ; job.in_bstride = nx ; job.out_bstride = nz ;
+                break ;
+            default :
+                break ;
+        }
+    }
+
+    /* identity permutation (and 1D data) */
+    if( job.rows == 0 ) {
+        memcpy( job.out, job.in, data_items( in_meta ) * esize );
+        goto err_permute ;
+    }
+
+    perf_begin( &ps );
+    err = _tr_run( &job );
+    perf_end( &ps, Perf_Transpose, data_items( in_meta ));
+
+err_permute :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Transpose a square 2D array in place. Diagonal blocks are
+ *         transposed in place, mirrored off-diagonal blocks are swapped
+ *         while transposing; both recurse cache-obliviously down to SIMD tiles
+ * \param  *buff - square 2D array from read_data()
+ * \param  *meta - meta-data of the array
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status transpose_2d_inplace( void *buff, Vector_MetaData *meta )
+{
+    api_Err_Status err = api_Success ;
+    Tr_Job job ;
+    uint64_t blocks = 0 ;
+    Perf_Sample ps ;
+
+    memset( &job, 0, sizeof(job));
+
+    if((buff == NULL) || (meta == NULL) || (meta->no_dims != 2)) {
+        debug("In-place transpose needs a 2D array");
+        err = api_Err_Param ;
+        goto err_inplace ;
+    }
+    if( meta->dim.dim_2d.rows != meta->dim.dim_2d.cols ) {
+        debug("In-place transpose needs a square array. Got %llu x %llu",
+                  (unsigned long long)meta->dim.dim_2d.rows, (unsigned long long)meta->dim.dim_2d.cols);
+        err = api_Err_Param ;
+        goto err_inplace ;
+    }
+
+    job.out = data_payload( buff, meta );
+    job.in = job.out ;
+    job.rows = meta->dim.dim_2d.rows ;
+    job.cols = job.rows ;
+    job.ldi = job.rows ;
+    job.ldo = job.rows ;
+    job.esize = sizeof_datatype( meta->type );
+    _tr_select_tile( job.esize, &job.ts, &job.tile );
+
+    /* one task per block on or above the diagonal */
+    job.row_tasks = (job.rows + TR_TASK - 1) / TR_TASK ;
+    blocks = (job.row_tasks * (job.row_tasks + 1)) / 2 ;
+    perf_begin( &ps );
+    err = tpool_parallel_for( tpool_default(), blocks, _tr_inplace_task, &job );
+    perf_end( &ps, Perf_Transpose, data_items( meta ));
+
+err_inplace :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Parse a permutation such as "2,0,1"
+ * \param  *perm - output permutation
+ * \param  *str - comma separated axis list
+ * \param  no_dims - expected number of axes
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status parse_permutation( uint32_t *perm, uint8_t *str, uint32_t no_dims )
+{
+    api_Err_Status err = api_Success ;
+    char *pos = (char *)str , *end = NULL ;
+    uint32_t idx_i = 0 ;
+
+    if((perm == NULL) || (str == NULL) || (no_dims > PERMUTE_MAX_DIMS)) {
+        debug("Invalid params perm = %p, str = %p, no_dims = %u", perm, str, no_dims);
+        err = api_Err_Param ;
+        goto err_parse_perm ;
+    }
+
+    for( idx_i=0 ; idx_i < no_dims ; idx_i++ ) {
+        perm[idx_i] = (uint32_t)strtoul( pos, &end, 10 );
+        if( end == pos ) {
+            debug("Expected %u axes in permutation [%s]", no_dims, str);
+            err = api_Err_Param ;
+            goto err_parse_perm ;
+        }
+        pos = (*end == ',') ? end + 1 : end ;
+    }
+    if( *end != '\0' ) {
+        debug("Permutation [%s] has more than %u axes", str, no_dims);
+        err = api_Err_Param ;
+    }
+
+err_parse_perm :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Choose the SIMD tile kernel for an element size
+ * \return void
+ */
+/*****************************************************************************/
+static void _tr_select_tile( uint64_t esize, uint32_t *ts, Tr_Tile_Fn *tile )
+{
+    *ts = 0 ;
+    *tile = NULL ;
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if( esize == 2 ) {
+        *ts = 8 ;
+        *tile = _tr_tile_2B_sse2 ;
+    } else if((esize == 4) && __builtin_cpu_supports("avx2")) {
+        *ts = 8 ;
+        *tile = _tr_tile_4B_avx2 ;
+    } else if((esize == 8) && __builtin_cpu_supports("avx2")) {
+        *ts = 4 ;
+        *tile = _tr_tile_8B_avx2 ;
+    }
+#endif
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Split a batch of transposes into pool tasks and run them
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tr_run( Tr_Job *job )
+{
+    _tr_select_tile( job->esize, &job->ts, &job->tile );
+    job->row_tasks = (job->rows + TR_TASK - 1) / TR_TASK ;
+    job->col_tasks = (job->cols + TR_TASK - 1) / TR_TASK ;
+    return tpool_parallel_for( tpool_default(), job->batch * job->row_tasks * job->col_tasks, _tr_task, job );
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : one TR_TASK x TR_TASK block of one batch entry
+ */
+/*****************************************************************************/
+static void _tr_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Tr_Job *job = (Tr_Job *)arg ;
+    uint64_t per_batch = job->row_tasks * job->col_tasks ;
+    uint64_t b = task / per_batch ;
+    uint64_t r0 = ((task % per_batch) / job->col_tasks) * TR_TASK ;
+    uint64_t c0 = ((task % per_batch) % job->col_tasks) * TR_TASK ;
+    uint64_t rows = ((job->rows - r0) < TR_TASK) ? (job->rows - r0) : TR_TASK ;
+    uint64_t cols = ((job->cols - c0) < TR_TASK) ? (job->cols - c0) : TR_TASK ;
+
+    _tr_recursive( job,
+                   job->out + ((b * job->out_bstride) + (c0 * job->ldo) + r0) * job->esize,
+                   job->in + ((b * job->in_bstride) + (r0 * job->ldi) + c0) * job->esize,
+                   rows, cols );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Cache-oblivious transpose : halve the longer side until the block
+ *         fits in L1 regardless of the cache sizes
+ */
+/*****************************************************************************/
+static void _tr_recursive( Tr_Job *job, uint8_t *out, const uint8_t *in, uint64_t rows, uint64_t cols )
+{
+    uint64_t half = 0 , align = (job->ts != 0) ? job->ts : 1 ;
+
+    if((rows <= TR_LEAF) && (cols <= TR_LEAF)) {
+        _tr_leaf( job, out, in, rows, cols );
+        return ;
+    }
+
+    if( rows >= cols ) {
+        half = ((rows / 2) + align - 1) / align * align ;
+        _tr_recursive( job, out, in, half, cols );
+        _tr_recursive( job, out + (half * job->esize), in + (half * job->ldi * job->esize), rows - half, cols );
+    } else {
+        half = ((cols / 2) + align - 1) / align * align ;
+        _tr_recursive( job, out, in, rows, half );
+        _tr_recursive( job, out + (half * job->ldo * job->esize), in + (half * job->esize), rows, cols - half );
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Transpose a block which fits in L1 : SIMD tiles where whole tiles
+ *         fit, element copies at the edges
+ */
+/*****************************************************************************/
+static void _tr_leaf( Tr_Job *job, uint8_t *out, const uint8_t *in, uint64_t rows, uint64_t cols )
+{
+    uint64_t r = 0 , c = 0 , full_r = 0 , full_c = 0 , es = job->esize ;
+
+    if( job->tile != NULL ) {
+        full_r = rows / job->ts * job->ts ;
+        full_c = cols / job->ts * job->ts ;
+        for( r=0 ; r < full_r ; r += job->ts )
+            for( c=0 ; c < full_c ; c += job->ts )
+                job->tile( out + ((c * job->ldo) + r) * es, job->ldo, in + ((r * job->ldi) + c) * es, job->ldi );
+    }
+
+    /* elements not covered by whole tiles */
+    for( r=0 ; r < rows ; r++ ) {
+        for( c = (r < full_r) ? full_c : 0 ; c < cols ; c++ ) {
+            switch( es )
+            {
+                case 1 : out[(c * job->ldo) + r] = in[(r * job->ldi) + c] ; break ;
+                case 2 : ((uint16_t *)out)[(c * job->ldo) + r] = ((const uint16_t *)in)[(r * job->ldi) + c] ; break ;
+                case 4 : ((uint32_t *)out)[(c * job->ldo) + r] = ((const uint32_t *)in)[(r * job->ldi) + c] ; break ;
+                case 8 : ((uint64_t *)out)[(c * job->ldo) + r] = ((const uint64_t *)in)[(r * job->ldi) + c] ; break ;
+                default :
+                    memcpy( out + ((c * job->ldo) + r) * es, in + ((r * job->ldi) + c) * es, es );
+                    break ;
+            }
+        }
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : one block on the diagonal (transposed in place) or one
+ *         block above it (swapped with its mirror below the diagonal)
+ */
+/*****************************************************************************/
+static void _tr_inplace_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Tr_Job *job = (Tr_Job *)arg ;
+    uint64_t bi = 0 , bj = 0 , r0 , c0 , rows , cols ;
+    uint8_t *a = job->out ;
+
+    /* task -> (bi, bj) with bi <= bj, row by row of the upper triangle */
+    for( bi=0 ; task >= (job->row_tasks - bi) ; bi++ )
+        task -= (job->row_tasks - bi) ;
+    bj = bi + task ;
+
+    r0 = bi * TR_TASK ;
+    c0 = bj * TR_TASK ;
+    rows = ((job->rows - r0) < TR_TASK) ? (job->rows - r0) : TR_TASK ;
+    cols = ((job->rows - c0) < TR_TASK) ? (job->rows - c0) : TR_TASK ;
+
+    if( bi == bj )
+        _tr_inplace_diag( job, a + ((r0 * job->ldi) + r0) * job->esize, rows );
+    else
+        _tr_inplace_swap( job, a + ((r0 * job->ldi) + c0) * job->esize,
+                               a + ((c0 * job->ldi) + r0) * job->esize, rows, cols );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Transpose an n x n block on the diagonal in place
+ */
+/*****************************************************************************/
+static void _tr_inplace_diag( Tr_Job *job, uint8_t *a, uint64_t n )
+{
+    uint64_t half = 0 , align = (job->ts != 0) ? job->ts : 1 ;
+    uint64_t ld = job->ldi , es = job->esize ;
+
+    if( n <= 1 )
+        return ;
+
+    /* diagonal halves in place, off-diagonal quadrants swapped */
+    half = (n <= TR_LEAF) ? (n / 2) : (((n / 2) + align - 1) / align * align) ;
+    _tr_inplace_diag( job, a, half );
+    _tr_inplace_diag( job, a + ((half * ld) + half) * es, n - half );
+    _tr_inplace_swap( job, a + (half * es), a + (half * ld * es), half, n - half );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Swap block A (rows x cols) with the transpose of block B
+ *         (cols x rows) : A[i][j] <-> B[j][i]. Both blocks lie in the same
+ *         square array and do not overlap
+ */
+/*****************************************************************************/
+static void _tr_inplace_swap( Tr_Job *job, uint8_t *a, uint8_t *b, uint64_t rows, uint64_t cols )
+{
+    uint64_t half = 0 , align = (job->ts != 0) ? job->ts : 1 ;
+    uint64_t ld = job->ldi , es = job->esize , r , c , full_r = 0 , full_c = 0 ;
+    uint8_t ta[8 * 8 * sizeof(double)] __attribute__((aligned(SIMD_ALIGN))) ;
+    uint8_t tb[8 * 8 * sizeof(double)] __attribute__((aligned(SIMD_ALIGN))) ;
+    uint8_t tmp[16] ;
+
+    if((rows > TR_LEAF) || (cols > TR_LEAF)) {
+        if( rows >= cols ) {
+            half = ((rows / 2) + align - 1) / align * align ;
+            _tr_inplace_swap( job, a, b, half, cols );
+            _tr_inplace_swap( job, a + (half * ld * es), b + (half * es), rows - half, cols );
+        } else {
+            half = ((cols / 2) + align - 1) / align * align ;
+            _tr_inplace_swap( job, a, b, rows, half );
+            _tr_inplace_swap( job, a + (half * es), b + (half * ld * es), rows, cols - half );
+        }
+        return ;
+    }
+
+    /* whole tiles : transpose both through L1 scratch, then exchange */
+    if( job->tile != NULL ) {
+        full_r = rows / job->ts * job->ts ;
+        full_c = cols / job->ts * job->ts ;
+        for( r=0 ; r < full_r ; r += job->ts ) {
+            for( c=0 ; c < full_c ; c += job->ts ) {
+                job->tile( ta, job->ts, a + ((r * ld) + c) * es, ld );
+                job->tile( tb, job->ts, b + ((c * ld) + r) * es, ld );
+                for( half=0 ; half < job->ts ; half++ ) {
+                    memcpy( b + (((c + half) * ld) + r) * es, ta + (half * job->ts * es), job->ts * es );
+                    memcpy( a + (((r + half) * ld) + c) * es, tb + (half * job->ts * es), job->ts * es );
+                }
+            }
+        }
+    }
+
+    for( r=0 ; r < rows ; r++ ) {
+        for( c = (r < full_r) ? full_c : 0 ; c < cols ; c++ ) {
+            memcpy( tmp, a + ((r * ld) + c) * es, es );
+            memcpy( a + ((r * ld) + c) * es, b + ((c * ld) + r) * es, es );
+            memcpy( b + ((c * ld) + r) * es, tmp, es );
+        }
+    }
+    return ;
+}
@@ -0,0 +1,383 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "debug.h"
+#include "api_err.h"
+#include "tune_db.h"
+
+
+typedef struct __Tune_Entry__
+{
+    char cpu[TUNE_NAME_LEN] ;
+    char knob[TUNE_NAME_LEN] ;
+    uint32_t size_class ;
+    uint64_t value ;
+} Tune_Entry ;
+
+
+static pthread_mutex_t g_tune_lock = PTHREAD_MUTEX_INITIALIZER ;
+static Tune_Entry *g_tune_entries = NULL ;
+static uint32_t g_tune_count = 0 ;
+static uint32_t g_tune_cap = 0 ;
+static uint32_t g_tune_loaded = 0 ;
+static char g_tune_cpu[TUNE_NAME_LEN] ;
+static char g_tune_path[4096] ;
+
+static void _tune_sanitise( char *, const char *, size_t );
+static api_Err_Status _tune_load_locked( void );
+static Tune_Entry *_tune_find( const char *, const char *, uint32_t, uint32_t );
+static api_Err_Status _tune_append( const char *, const char *, uint32_t, uint64_t );
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Size class of a problem : floor(log2(size)), 0 for size 0
+ */
+/*****************************************************************************/
+uint32_t tune_size_class( uint64_t size )
+{
+    return (size != 0) ? (uint32_t)(63 - __builtin_clzll( size )) : 0 ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  CPU model from /proc/cpuinfo with blanks replaced by '_', so the
+ *         database is shared by identical machines of a fleet
+ * \return model name, "unknown" if it cannot be determined
+ */
+/*****************************************************************************/
+const char *tune_cpu_model( void )
+{
+    FILE *fp = NULL ;
+    char line[512] , *val = NULL ;
+
+    pthread_mutex_lock( &g_tune_lock );
+    if( g_tune_cpu[0] != '\0' )
+        goto err_cpu_model ;
+
+    _tune_sanitise( g_tune_cpu, "unknown", sizeof(g_tune_cpu));
+    fp = fopen( "/proc/cpuinfo", "r" );
+    if( fp == NULL )
+        goto err_cpu_model ;
+    while( fgets( line, sizeof(line), fp ) != NULL ) {
+        if((strncmp( line, "model name", 10 ) != 0) || ((val = strchr( line, ':' )) == NULL))
+            continue ;
+        for( val++ ; *val == ' ' ; val++ )
+            ;
+        val[strcspn( val, "\n" )] = '\0' ;
+        _tune_sanitise( g_tune_cpu, val, sizeof(g_tune_cpu));
+        break ;
+    }
+    fclose( fp );
+
+err_cpu_model :
+    pthread_mutex_unlock( &g_tune_lock );
+    return g_tune_cpu ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Location of the database : HETERO_TUNE_DB, else ~/TUNE_DB_FILE,
+ *         else TUNE_DB_FILE in the working directory
+ */
+/*****************************************************************************/
+const char *tune_db_path( void )
+{
+    char *env = getenv("HETERO_TUNE_DB") , *home = getenv("HOME") ;
+
+    if((env != NULL) && (env[0] != '\0'))
+        snprintf( g_tune_path, sizeof(g_tune_path), "%s", env );
+    else if((home != NULL) && (home[0] != '\0'))
+        snprintf( g_tune_path, sizeof(g_tune_path), "%s/%s", home, TUNE_DB_FILE );
+    else
+        snprintf( g_tune_path, sizeof(g_tune_path), "%s", TUNE_DB_FILE );
+    return g_tune_path ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Load the database (once). A missing file is an empty database
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status tune_db_load( void )
+{
+    api_Err_Status err = api_Success ;
+
+    tune_cpu_model();
+    pthread_mutex_lock( &g_tune_lock );
+    err = _tune_load_locked();
+    pthread_mutex_unlock( &g_tune_lock );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Write all entries (of every CPU model) back to the database.
+ *         Written to a temporary file and renamed so concurrent readers
+ *         never see a partial file
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status tune_db_save( void )
+{
+    api_Err_Status err = api_Success ;
+    char tmp[4096 + 16] ;
+    FILE *fp = NULL ;
+    uint32_t idx_i = 0 ;
+
+    tune_db_load();
+    pthread_mutex_lock( &g_tune_lock );
+
+    snprintf( tmp, sizeof(tmp), "%s.%d", tune_db_path(), (int)getpid());
+    fp = fopen( tmp, "w" );
+    if( fp == NULL ) {
+        debug("Could not create [%s]. errno = %d", tmp, errno);
+        err = api_Err_File ;
+        goto err_tune_save ;
+    }
+
+    fprintf( fp, "# hetero-examples tuning database, written by autotune\n" );
+    fprintf( fp, "# cpu-model knob size-class value\n" );
+    for( idx_i=0 ; idx_i < g_tune_count ; idx_i++ )
+        fprintf( fp, "%s %s %u %llu\n", g_tune_entries[idx_i].cpu, g_tune_entries[idx_i].knob,
+                        g_tune_entries[idx_i].size_class, (unsigned long long)g_tune_entries[idx_i].value );
+
+    if((fclose( fp ) != 0) || (rename( tmp, g_tune_path ) != 0)) {
+        debug("Could not write [%s]. errno = %d", g_tune_path, errno);
+        unlink( tmp );
+        err = api_Err_File ;
+    }
+
+err_tune_save :
+    pthread_mutex_unlock( &g_tune_lock );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Tuned value of a knob for this CPU and a problem size
+ * \param  *knob - knob name, e.g. "read.chunk"
+ * \param  size - problem size (bytes or items, as used when tuning)
+ * \param  fallback - value when nothing has been tuned
+ * \return value of the entry with the nearest size class, else fallback.
+ *         Sizes more than TUNE_NEAREST_CLASSES classes outside the tuned
+ *         classes get the fallback
+ */
+/*****************************************************************************/
+uint64_t tune_lookup( const char *knob, uint64_t size, uint64_t fallback )
+{
+    char *env = getenv("HETERO_TUNE") ;
+    Tune_Entry *entry = NULL ;
+    uint64_t value = fallback ;
+
+    if((knob == NULL) || ((env != NULL) && (strcmp( env, "off" ) == 0)))
+        return fallback ;
+
+    tune_db_load();
+    pthread_mutex_lock( &g_tune_lock );
+    entry = _tune_find( g_tune_cpu, knob, tune_size_class( size ), 1 );
+    if( entry != NULL )
+        value = entry->value ;
+    pthread_mutex_unlock( &g_tune_lock );
+    return value ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Set a knob for this CPU and size class, in memory. Takes effect
+ *         for later lookups in this process; tune_db_save() persists it
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+api_Err_Status tune_store( const char *knob, uint64_t size, uint64_t value )
+{
+    api_Err_Status err = api_Success ;
+    Tune_Entry *entry = NULL ;
+    char name[TUNE_NAME_LEN] ;
+
+    if((knob == NULL) || (knob[0] == '\0')) {
+        debug("Invalid knob name");
+        return api_Err_Param ;
+    }
+
+    tune_db_load();
+    pthread_mutex_lock( &g_tune_lock );
+    _tune_sanitise( name, knob, sizeof(name));
+    entry = _tune_find( g_tune_cpu, name, tune_size_class( size ), 0 );
+    if( entry != NULL )
+        entry->value = value ;
+    else
+        err = _tune_append( g_tune_cpu, name, tune_size_class( size ), value );
+    pthread_mutex_unlock( &g_tune_lock );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Copy a name replacing blanks with '_' (entries are blank separated)
+ */
+/*****************************************************************************/
+static void _tune_sanitise( char *dst, const char *src, size_t len )
+{
+    size_t idx_i = 0 ;
+
+    for( idx_i=0 ; (idx_i + 1 < len) && (src[idx_i] != '\0') ; idx_i++ )
+        dst[idx_i] = ((src[idx_i] == ' ') || (src[idx_i] == '\t')) ? '_' : src[idx_i] ;
+    dst[idx_i] = '\0' ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Parse the database file into memory. Called with g_tune_lock held
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_load_locked( void )
+{
+    api_Err_Status err = api_Success ;
+    FILE *fp = NULL ;
+    char line[512] , cpu[TUNE_NAME_LEN] , knob[TUNE_NAME_LEN] ;
+    unsigned int size_class = 0 ;
+    unsigned long long value = 0 ;
+    uint32_t line_no = 0 ;
+
+    if( g_tune_loaded )
+        return err ;
+    g_tune_loaded = 1 ;
+
+    fp = fopen( tune_db_path(), "r" );
+    if( fp == NULL )
+        return err ;
+
+    while( fgets( line, sizeof(line), fp ) != NULL ) {
+        line_no++ ;
+        if((line[0] == '#') || (line[0] == '\n'))
+            continue ;
+        if( sscanf( line, "%95s %95s %u %llu", cpu, knob, &size_class, &value ) != 4 ) {
+            debug("Ignoring malformed line %u of [%s]", line_no, g_tune_path);
+            continue ;
+        }
+        if( _tune_find( cpu, knob, size_class, 0 ) != NULL )
+            continue ;
+        err = _tune_append( cpu, knob, size_class, value );
+        if( err != api_Success )
+            break ;
+    }
+    fclose( fp );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Find an entry. Called with g_tune_lock held
+ * \param  nearest - 0 : exact size class only, 1 : nearest size class,
+ *                   within the classes tuned for the knob or
+ *                   TUNE_NEAREST_CLASSES of them
+ */
+/*****************************************************************************/
+static Tune_Entry *_tune_find( const char *cpu, const char *knob, uint32_t size_class, uint32_t nearest )
+{
+    Tune_Entry *best = NULL ;
+    uint32_t idx_i = 0 , dist = 0 , best_dist = UINT32_MAX ;
+    uint32_t lo = UINT32_MAX , hi = 0 ;
+
+    for( idx_i=0 ; idx_i < g_tune_count ; idx_i++ ) {
+        if( strcmp( g_tune_entries[idx_i].knob, knob ) || strcmp( g_tune_entries[idx_i].cpu, cpu ))
+            continue ;
+        dist = (g_tune_entries[idx_i].size_class > size_class) ? g_tune_entries[idx_i].size_class - size_class
+                                                                : size_class - g_tune_entries[idx_i].size_class ;
+        if((dist != 0) && !nearest)
+            continue ;
+        lo = (g_tune_entries[idx_i].size_class < lo) ? g_tune_entries[idx_i].size_class : lo ;
+        hi = (g_tune_entries[idx_i].size_class > hi) ? g_tune_entries[idx_i].size_class : hi ;
+        if( dist < best_dist ) {
+            best = &g_tune_entries[idx_i] ;
+            best_dist = dist ;
+        }
+    }
+    /* a value tuned for one size says little about sizes far outside the
+       measured range : leave those to the caller's default */
+    if((best != NULL) && (best_dist > TUNE_NEAREST_CLASSES) && ((size_class < lo) || (size_class > hi)))
+        best = NULL ;
+    return best ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Add an entry, growing the table. Called with g_tune_lock held
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _tune_append( const char *cpu, const char *knob, uint32_t size_class, uint64_t value )
+{
+    Tune_Entry *grown = NULL ;
+    uint32_t cap = 0 ;
+
+    if( g_tune_count == g_tune_cap ) {
+        cap = (g_tune_cap != 0) ? g_tune_cap * 2 : 64 ;
+        grown = (Tune_Entry *)realloc( g_tune_entries, cap * sizeof(Tune_Entry));
+        if( grown == NULL ) {
+            debug("Could not grow the tuning table to %u entries", cap);
+            return api_Err_Memory ;
+        }
+        g_tune_entries = grown ;
+        g_tune_cap = cap ;
+    }
+
+    _tune_sanitise( g_tune_entries[g_tune_count].cpu, cpu, TUNE_NAME_LEN );
+    _tune_sanitise( g_tune_entries[g_tune_count].knob, knob, TUNE_NAME_LEN );
+    g_tune_entries[g_tune_count].size_class = size_class ;
+    g_tune_entries[g_tune_count].value = value ;
+    g_tune_count++ ;
+    return api_Success ;
+}
@@ -0,0 +1,316 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "time_eval.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "hetero_sched.h"
+#include "half.h"
+#include "hetero_split_options.h"
+
+static api_Err_Status _generate_vector( void **, Vector_MetaData *, uint64_t, uint32_t );
+static double _get_value( void *, Data_Type, uint64_t );
+static void _report( const char *, Hetero_Stats *, uint64_t );
+static api_Err_Status _verify( Hetero_Job * );
+
+int main( int argc , char *argv[] )
+{
+    api_Err_Status err = api_Success ;
+    Hetero_Split_Options hs_opt ;
+    Vector_MetaData a_meta , b_meta , out_meta ;
+    void *a = NULL , *b = NULL , *out = NULL ;
+    Hetero_Device *dev = NULL ;
+    Hetero_Job job ;
+    Hetero_Stats cpu_only , dev_only , split ;
+    double ideal = 0.0 ;
+
+    memset( &hs_opt, 0, sizeof(hs_opt));
+    memset( &a_meta, 0, sizeof(a_meta));
+    memset( &b_meta, 0, sizeof(b_meta));
+    memset( &out_meta, 0, sizeof(out_meta));
+    memset( &job, 0, sizeof(job));
+    memset( &dev_only, 0, sizeof(dev_only));
+
+    err = parse_hetero_split_cmdline( argc, argv, &hs_opt );
+    if( err != api_Success ) {
+        debug("Error parsing cmdline options. err=%d", err );
+        goto err_main ;
+    }
+
+    a_meta.type = hs_opt.type ;
+    b_meta.type = hs_opt.type ;
+    if( hs_opt.file_a != NULL ) {
+        err = read_data( &a, &a_meta, hs_opt.file_a, hs_opt.sep );
+        if((err == api_Success) && (hs_opt.file_b != NULL))
+            err = read_data( &b, &b_meta, hs_opt.file_b, hs_opt.sep );
+    } else {
+        err = _generate_vector( &a, &a_meta, hs_opt.items, 1 );
+        if((err == api_Success) && (hs_opt.op == Hetero_Add))
+            err = _generate_vector( &b, &b_meta, hs_opt.items, 2 );
+    }
+    if( err != api_Success ) {
+        debug("Could not obtain input vectors. err = %d", err);
+        goto err_main ;
+    }
+    if((a_meta.no_dims != 1) || ((b != NULL) && ((b_meta.no_dims != 1) || (b_meta.dim.dim_1d.items != a_meta.dim.dim_1d.items)))) {
+        debug("Inputs have to be 1D vectors of the same length");
+        err = api_Err_Param ;
+        goto err_main ;
+    }
+
+    job.op = hs_opt.op ;
+    job.type = hs_opt.type ;
+    job.items = a_meta.dim.dim_1d.items ;
+    job.a = data_payload( a, &a_meta );
+    if( job.op == Hetero_Add ) {
+        out_meta = a_meta ;
+        err = alloc_data( &out, &out_meta );
+        if( err != api_Success ) {
+            debug("Could not allocate result. err = %d", err);
+            goto err_main ;
+        }
+        job.b = data_payload( b, &b_meta );
+        job.out = data_payload( out, &out_meta );
+    }
+
+    if( hs_opt.device != Hetero_Dev_None ) {
+        err = hetero_device_open( &dev, hs_opt.device );
+        if( err != api_Success ) {
+            debug("Device not available (err = %d), running on the thread pool only", err);
+            err = api_Success ;
+        }
+    }
+
+    debug("===============================================");
+    debug("%s of %llu items, %u pool threads, device [%s]", (job.op == Hetero_Add) ? "add" : "sum",
+                (unsigned long long)job.items, tpool_size(tpool_default()), hetero_device_name(dev));
+
+    /* untimed pass to fault in the output pages */
+    err = hetero_run( &job, NULL, HETERO_USE_CPU, hs_opt.min_chunk, &cpu_only );
+    if( err == api_Success )
+        err = hetero_run( &job, NULL, HETERO_USE_CPU, hs_opt.min_chunk, &cpu_only );
+    if( err != api_Success ) {
+        debug("Pool-only run failed. err = %d", err);
+        goto err_main ;
+    }
+    _report( "pool only  ", &cpu_only, job.items );
+
+    if( dev != NULL ) {
+        err = hetero_run( &job, dev, HETERO_USE_DEV, hs_opt.min_chunk, &dev_only );
+        if( err != api_Success ) {
+            debug("Device-only run failed. err = %d", err);
+            goto err_main ;
+        }
+        _report( "device only", &dev_only, job.items );
+    }
+
+    err = hetero_run( &job, dev, HETERO_USE_CPU | HETERO_USE_DEV, hs_opt.min_chunk, &split );
+    if( err != api_Success ) {
+        debug("Split run failed. err = %d", err);
+        goto err_main ;
+    }
+    _report( "split      ", &split, job.items );
+    debug("  pool   : %5.1f %% of items in %llu chunks, busy %.4f s", 100.0 * (double)split.items[HETERO_AGENT_CPU] / (double)job.items,
+                (unsigned long long)split.chunks[HETERO_AGENT_CPU], split.busy[HETERO_AGENT_CPU]);
+    debug("  device : %5.1f %% of items in %llu chunks, busy %.4f s", 100.0 * (double)split.items[HETERO_AGENT_DEV] / (double)job.items,
+                (unsigned long long)split.chunks[HETERO_AGENT_DEV], split.busy[HETERO_AGENT_DEV]);
+
+    /* combined capacity : both sides busy for the whole job */
+    if((dev_only.secs > 0.0) && (cpu_only.secs > 0.0)) {
+        ideal = (double)job.items / (((double)job.items / cpu_only.secs) + ((double)job.items / dev_only.secs)) ;
+        debug("combined capacity %.4f s, split reached %.1f %% of it", ideal, 100.0 * ideal / split.secs);
+    }
+    if( job.op == Hetero_Sum )
+        debug("sum = %.17g", job.sum);
+
+    if( hs_opt.verify )
+        err = _verify( &job );
+    debug("===============================================");
+
+err_main :
+    hetero_device_close( &dev );
+    clean_data( &out, &out_meta );
+    clean_data( &b, &b_meta );
+    clean_data( &a, &a_meta );
+    clean_hetero_split_opts( &hs_opt );
+    tpool_default_release();
+    perf_report();
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Print time and throughput of one run
+ */
+/*****************************************************************************/
+static void _report( const char *label, Hetero_Stats *st, uint64_t items )
+{
+    debug("%s : %.4f s, %.1f Mitems/s", label, st->secs, (double)items / st->secs / 1e6);
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a 1D vector of small pseudo-random values
+ * \param  **out - output vector
+ * \param  *meta - meta-data. type filled in by caller
+ * \param  items - length
+ * \param  seed - random seed
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _generate_vector( void **out, Vector_MetaData *meta, uint64_t items, uint32_t seed )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t idx_i = 0 ;
+    uint32_t value = 0 ;
+    void *payload = NULL ;
+
+    meta->no_dims = 1 ;
+    meta->dim.dim_1d.items = items ;
+
+    err = alloc_data( out, meta );
+    if( err != api_Success )
+        goto err_generate ;
+
+    payload = data_payload( *out, meta );
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        seed = (seed * 1103515245u) + 12345u ;
+        value = (seed >> 16) & 0x3f ;
+        switch( meta->type )
+        {
+            case DataType_uint8       : ((uint8_t *)payload)[idx_i] = (uint8_t)value ; break ;
+            case DataType_uint16      : ((uint16_t *)payload)[idx_i] = (uint16_t)value ; break ;
+            case DataType_uint32      : ((uint32_t *)payload)[idx_i] = value ; break ;
+            case DataType_uint64      : ((uint64_t *)payload)[idx_i] = value ; break ;
+            case DataType_int8        : ((int8_t *)payload)[idx_i] = (int8_t)value - 32 ; break ;
+            case DataType_int16       : ((int16_t *)payload)[idx_i] = (int16_t)value - 32 ; break ;
+            case DataType_int32       : ((int32_t *)payload)[idx_i] = (int32_t)value - 32 ; break ;
+            case DataType_int64       : ((int64_t *)payload)[idx_i] = (int64_t)value - 32 ; break ;
+            case DataType_float       : ((float *)payload)[idx_i] = (float)value / 64.0f ; break ;
+            case DataType_double      : ((double *)payload)[idx_i] = (double)value / 64.0 ; break ;
+            case DataType_long_double : ((long double *)payload)[idx_i] = (long double)value / 64.0L ; break ;
+            case DataType_float16     : ((uint16_t *)payload)[idx_i] = f32_to_half((float)value / 64.0f) ; break ;
+            case DataType_bfloat16    : ((uint16_t *)payload)[idx_i] = f32_to_bf16((float)value / 64.0f) ; break ;
+            default :
+                err = api_Err_Param ;
+                goto err_generate ;
+        }
+    }
+
+err_generate :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Element of a payload as double
+ */
+/*****************************************************************************/
+static double _get_value( void *payload, Data_Type type, uint64_t idx )
+{
+    switch( type )
+    {
+        case DataType_uint8       : return ((uint8_t *)payload)[idx] ;
+        case DataType_uint16      : return ((uint16_t *)payload)[idx] ;
+        case DataType_uint32      : return ((uint32_t *)payload)[idx] ;
+        case DataType_uint64      : return (double)((uint64_t *)payload)[idx] ;
+        case DataType_int8        : return ((int8_t *)payload)[idx] ;
+        case DataType_int16       : return ((int16_t *)payload)[idx] ;
+        case DataType_int32       : return ((int32_t *)payload)[idx] ;
+        case DataType_int64       : return (double)((int64_t *)payload)[idx] ;
+        case DataType_float       : return ((float *)payload)[idx] ;
+        case DataType_double      : return ((double *)payload)[idx] ;
+        case DataType_long_double : return (double)((long double *)payload)[idx] ;
+        case DataType_float16     : return half_to_f32(((uint16_t *)payload)[idx]) ;
+        case DataType_bfloat16    : return bf16_to_f32(((uint16_t *)payload)[idx]) ;
+        default                   : return 0.0 ;
+    }
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Check the result of the last split run against a serial loop.
+ *         Sums are compared with a relative tolerance as the split changes
+ *         the order of the additions
+ * \return returns api_Success if the results match
+ */
+/*****************************************************************************/
+static api_Err_Status _verify( Hetero_Job *job )
+{
+    uint64_t idx_i = 0 , bad = 0 ;
+    double sum = 0.0 , expect = 0.0 , tol = 0.0 ;
+    uint8_t elem[16] ;
+
+    if( job->op == Hetero_Sum ) {
+        for( idx_i=0 ; idx_i < job->items ; idx_i++ )
+            sum += _get_value((void *)job->a, job->type, idx_i );
+        tol = 1e-6 * ((fabs(sum) > 1.0) ? fabs(sum) : 1.0) ;
+        debug("verify : serial sum = %.17g, %s", sum, (fabs( sum - job->sum ) <= tol) ? "match" : "MISMATCH");
+        return (fabs( sum - job->sum ) <= tol) ? api_Success : api_Err_Failure ;
+    }
+
+    /* the sum in the element type, with its wrap-around and rounding */
+    for( idx_i=0 ; idx_i < job->items ; idx_i++ ) {
+        switch( job->type )
+        {
+            case DataType_uint8  : *(uint8_t *)elem = ((uint8_t *)job->a)[idx_i] + ((uint8_t *)job->b)[idx_i] ; break ;
+            case DataType_uint16 : *(uint16_t *)elem = ((uint16_t *)job->a)[idx_i] + ((uint16_t *)job->b)[idx_i] ; break ;
+            case DataType_uint32 : *(uint32_t *)elem = ((uint32_t *)job->a)[idx_i] + ((uint32_t *)job->b)[idx_i] ; break ;
+            case DataType_uint64 : *(uint64_t *)elem = ((uint64_t *)job->a)[idx_i] + ((uint64_t *)job->b)[idx_i] ; break ;
+            case DataType_int8   : *(int8_t *)elem = ((int8_t *)job->a)[idx_i] + ((int8_t *)job->b)[idx_i] ; break ;
+            case DataType_int16  : *(int16_t *)elem = ((int16_t *)job->a)[idx_i] + ((int16_t *)job->b)[idx_i] ; break ;
+            case DataType_int32  : *(int32_t *)elem = ((int32_t *)job->a)[idx_i] + ((int32_t *)job->b)[idx_i] ; break ;
+            case DataType_int64  : *(int64_t *)elem = ((int64_t *)job->a)[idx_i] + ((int64_t *)job->b)[idx_i] ; break ;
+            case DataType_float  : *(float *)elem = ((float *)job->a)[idx_i] + ((float *)job->b)[idx_i] ; break ;
+            case DataType_double : *(double *)elem = ((double *)job->a)[idx_i] + ((double *)job->b)[idx_i] ; break ;
+            case DataType_float16  : *(uint16_t *)elem = f32_to_half((float)_get_value((void *)job->a, job->type, idx_i ) +
+                                                                     (float)_get_value((void *)job->b, job->type, idx_i )) ; break ;
+            case DataType_bfloat16 : *(uint16_t *)elem = f32_to_bf16((float)_get_value((void *)job->a, job->type, idx_i ) +
+                                                                     (float)_get_value((void *)job->b, job->type, idx_i )) ; break ;
+            default              : *(long double *)elem = ((long double *)job->a)[idx_i] + ((long double *)job->b)[idx_i] ; break ;
+        }
+        expect = _get_value( elem, job->type, 0 );
+        bad += (expect != _get_value( job->out, job->type, idx_i )) ;
+    }
+    debug("verify : %llu of %llu elements differ", (unsigned long long)bad, (unsigned long long)job->items);
+    return (bad == 0) ? api_Success : api_Err_Failure ;
+}
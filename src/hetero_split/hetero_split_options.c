@@ -0,0 +1,214 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "api_err.h"
+#include "datatype.h"
+#include "hetero_sched.h"
+#include "hetero_split_options.h"
+#include "program_options.h"
+#include "debug.h"
+
+Option_Help g_help_strings[] =
+{
+    { .option = 'a', .option_text = "-a,--file-a.....1D input. Without -a vectors are generated"                          },
+    { .option = 'b', .option_text = "-b,--file-b.....second 1D input for add, same length as -a"                          },
+    { .option = 's', .option_text = "-s,--sep........Separator list for -a/-b"                                             },
+    { .option = 'd', .option_text = "-d,--dtype......data-type. Use (u)int8..(u)int64,float,double,longdouble,float16,bfloat16 (default float)"},
+    { .option = 'n', .option_text = "-n,--items......length of generated vectors (default 16M)"                            },
+    { .option = 'o', .option_text = "-o,--op.........add (element-wise a+b) or sum (reduction of a). Default add"        },
+    { .option = 'D', .option_text = "-D,--device.....none, host (emulated by a thread) or opencl. Default opencl if built in"},
+    { .option = 'c', .option_text = "-c,--chunk......smallest chunk handed out, in items (default 64K)"                    },
+    { .option = 'v', .option_text = "-v,--verify.....check against a serial host run"                                      },
+    { .option = 'h', .option_text = "-h,--help.......this help menu"                                                       },
+    { .option =  0 , .option_text = NULL                                                                                    },
+};
+
+
+struct option g_option_list[] = {
+    {.name = "file-a", .has_arg = required_argument, .flag = NULL, .val = 'a'},
+    {.name = "file-b", .has_arg = required_argument, .flag = NULL, .val = 'b'},
+    {.name = "sep"   , .has_arg = required_argument, .flag = NULL, .val = 's'},
+    {.name = "dtype" , .has_arg = required_argument, .flag = NULL, .val = 'd'},
+    {.name = "items" , .has_arg = required_argument, .flag = NULL, .val = 'n'},
+    {.name = "op"    , .has_arg = required_argument, .flag = NULL, .val = 'o'},
+    {.name = "device", .has_arg = required_argument, .flag = NULL, .val = 'D'},
+    {.name = "chunk" , .has_arg = required_argument, .flag = NULL, .val = 'c'},
+    {.name = "verify", .has_arg = no_argument      , .flag = NULL, .val = 'v'},
+    {.name = "help"  , .has_arg = no_argument      , .flag = NULL, .val = 'h'},
+    {.name = NULL,     .has_arg = 0                , .flag = NULL, .val =  0 }
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  parse command-line options of the heterogeneous split benchmark
+ *
+ * \param  argc - number of params from cmdline inclusive of program name
+ * \param  *argv[] - list of commandline options
+ * \param  *hs_opt - structure to store options provided on cmdline
+ * \return api_Success on success
+ */
+/*****************************************************************************/
+api_Err_Status parse_hetero_split_cmdline( int argc , char **argv , Hetero_Split_Options *hs_opt )
+{
+    api_Err_Status err = api_Success ;
+    char *short_opt = NULL ;
+    int opt = 0 ;
+
+    if((argv == NULL) || (hs_opt == NULL)) {
+        debug("Invalid params argv = %p, hs_opt = %p", argv, hs_opt);
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    /* initialise with default values */
+    memset( hs_opt, 0, sizeof(Hetero_Split_Options));
+    hs_opt->type = DataType_float ;
+    hs_opt->op = Hetero_Add ;
+#ifdef HAVE_OPENCL
+    hs_opt->device = Hetero_Dev_OpenCL ;
+#else
+    hs_opt->device = Hetero_Dev_Host ;
+#endif
+    hs_opt->items = 16 * 1024 * 1024 ;
+
+    short_opt = gen_opt_string( g_option_list );
+    if( short_opt == NULL ) {
+        debug("Could not gen short opt-string for parsing cmdline opts");
+        err = api_Err_Failure ;
+        goto err_cmdline_parse ;
+    }
+
+    optind = 1 ;
+    for( opt = getopt_long(argc, argv, short_opt, g_option_list, NULL) ;
+         opt != -1 ; opt = getopt_long(argc, argv, short_opt, g_option_list, NULL)) {
+        switch( opt )
+        {
+            case '?' :   /* intentional fall-through */
+            case 'h' :   /* intentional fall-through */
+            case ':' :
+                usage( argv[0] , g_option_list , g_help_strings);
+                err = api_Stat_Complete ;
+                goto err_cmdline_parse ;
+            case 'a' :
+            case 'b' :
+                if( opt == 'a' )
+                    hs_opt->file_a = strdup(optarg);
+                else
+                    hs_opt->file_b = strdup(optarg);
+                if(((opt == 'a') ? hs_opt->file_a : hs_opt->file_b) == NULL ) {
+                    debug("Could not alloc memory to hold file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 's' :
+                hs_opt->sep = strdup(optarg);
+                if( hs_opt->sep == NULL ) {
+                    debug("Could not alloc memory to hold separators [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'd' :
+                err = map_data_types( &(hs_opt->type), optarg);
+                if( err != api_Success ) {
+                    debug("Error mapping cmdline data-type [%s] to known type. err = %d", optarg, err );
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'o' :
+                if( strcmp( optarg, "add" ) == 0 )
+                    hs_opt->op = Hetero_Add ;
+                else if( strcmp( optarg, "sum" ) == 0 )
+                    hs_opt->op = Hetero_Sum ;
+                else {
+                    debug("Unknown operation [%s]. Use add or sum", optarg);
+                    err = api_Err_Param ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'D' :
+                if( strcmp( optarg, "none" ) == 0 )
+                    hs_opt->device = Hetero_Dev_None ;
+                else if( strcmp( optarg, "host" ) == 0 )
+                    hs_opt->device = Hetero_Dev_Host ;
+                else if( strcmp( optarg, "opencl" ) == 0 )
+                    hs_opt->device = Hetero_Dev_OpenCL ;
+                else {
+                    debug("Unknown device [%s]. Use none, host or opencl", optarg);
+                    err = api_Err_Param ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'n' : hs_opt->items = strtoull( optarg, NULL, 0 ); break ;
+            case 'c' : hs_opt->min_chunk = strtoull( optarg, NULL, 0 ); break ;
+            case 'v' : hs_opt->verify = 1 ; break ;
+        }
+    }
+
+    if((hs_opt->file_a != NULL) && (hs_opt->sep == NULL)) {
+        debug("Separator list (-s) required with input files");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+    if((hs_opt->file_a != NULL) && (hs_opt->op == Hetero_Add) && (hs_opt->file_b == NULL)) {
+        debug("add needs a second input (-b)");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+
+err_cmdline_parse :
+    clean_hetero_split_opts( hs_opt ) ;
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Clean up data structure holding command-line params
+ * \param  *hs_opt - options structure
+ * \return void
+ */
+/*****************************************************************************/
+void clean_hetero_split_opts( Hetero_Split_Options *hs_opt )
+{
+    if( hs_opt == NULL )
+        return ;
+
+    hs_opt->file_a = (hs_opt->file_a != NULL) ? free(hs_opt->file_a), NULL : NULL ;
+    hs_opt->file_b = (hs_opt->file_b != NULL) ? free(hs_opt->file_b), NULL : NULL ;
+    hs_opt->sep = (hs_opt->sep != NULL) ? free(hs_opt->sep), NULL : NULL ;
+    return ;
+}
@@ -0,0 +1,210 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "time_eval.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "gemm.h"
+#include "mat_mul_options.h"
+
+static api_Err_Status _generate_matrix( void **, Vector_MetaData *, uint64_t, uint64_t, uint32_t );
+static double _max_rel_diff( void *, void *, Vector_MetaData * );
+
+int main( int argc , char *argv[] )
+{
+    api_Err_Status err = api_Success ;
+    MatMul_Options mm_opt ;
+    Vector_MetaData a_meta , b_meta , c_meta ;
+    void *a = NULL , *b = NULL , *c = NULL , *ref = NULL ;
+    struct timespec begin , end ;
+    double secs = 0.0 , ref_secs = 0.0 , flops = 0.0 ;
+
+    memset( &mm_opt, 0, sizeof(mm_opt));
+    memset( &a_meta, 0, sizeof(a_meta));
+    memset( &b_meta, 0, sizeof(b_meta));
+    memset( &c_meta, 0, sizeof(c_meta));
+
+    err = parse_mat_mul_cmdline( argc, argv, &mm_opt );
+    if( err != api_Success ) {
+        debug("Error parsing cmdline options. err=%d", err );
+        goto err_main ;
+    }
+
+    a_meta.type = mm_opt.type ;
+    b_meta.type = mm_opt.type ;
+    if( mm_opt.file_a != NULL ) {
+        err = read_data( &a, &a_meta, mm_opt.file_a, mm_opt.sep );
+        if( err == api_Success )
+            err = read_data( &b, &b_meta, mm_opt.file_b, mm_opt.sep );
+    } else {
+        err = _generate_matrix( &a, &a_meta, mm_opt.m, mm_opt.k, 1 );
+        if( err == api_Success )
+            err = _generate_matrix( &b, &b_meta, mm_opt.k, mm_opt.n, 2 );
+    }
+    if( err != api_Success ) {
+        debug("Could not obtain input matrices. err = %d", err);
+        goto err_main ;
+    }
+
+    err = gemm_result_meta( &c_meta, &a_meta, &b_meta );
+    if( err != api_Success ) {
+        debug("Matrices cannot be multiplied. err = %d", err);
+        goto err_main ;
+    }
+    err = alloc_data( &c, &c_meta );
+    if( err != api_Success ) {
+        debug("Could not allocate result. err = %d", err);
+        goto err_main ;
+    }
+
+    debug("===============================================");
+    debug("C[%llu x %llu] = A[%llu x %llu] x B[%llu x %llu], %u threads",
+                (unsigned long long)c_meta.dim.dim_2d.rows, (unsigned long long)c_meta.dim.dim_2d.cols,
+                (unsigned long long)a_meta.dim.dim_2d.rows, (unsigned long long)a_meta.dim.dim_2d.cols,
+                (unsigned long long)b_meta.dim.dim_2d.rows, (unsigned long long)b_meta.dim.dim_2d.cols,
+                tpool_size(tpool_default()));
+
+    start_wall_timer( begin );
+    err = gemm( c, &c_meta, a, &a_meta, b, &b_meta, &mm_opt.blocking );
+    stop_wall_timer( end );
+    if( err != api_Success ) {
+        debug("Matrix multiply failed. err = %d", err);
+        goto err_main ;
+    }
+    secs = wall_time_taken( begin, end );
+    flops = 2.0 * (double)a_meta.dim.dim_2d.rows * (double)a_meta.dim.dim_2d.cols * (double)b_meta.dim.dim_2d.cols ;
+    debug("blocked   : %.4f s, %.2f GFLOP/s (%s)", secs, flops / secs / 1e9,
+                ((mm_opt.type == DataType_int8) || (mm_opt.type == DataType_int16)) ? "int ops" : "flops");
+
+    if( mm_opt.verify ) {
+        err = alloc_data( &ref, &c_meta );
+        if( err != api_Success ) {
+            debug("Could not allocate reference result. err = %d", err);
+            goto err_main ;
+        }
+        start_wall_timer( begin );
+        err = gemm_reference( ref, &c_meta, a, &a_meta, b, &b_meta );
+        stop_wall_timer( end );
+        if( err != api_Success ) {
+            debug("Reference multiply failed. err = %d", err);
+            goto err_main ;
+        }
+        ref_secs = wall_time_taken( begin, end );
+        debug("reference : %.4f s, %.2f GFLOP/s, speed-up %.1fx", ref_secs, flops / ref_secs / 1e9, ref_secs / secs);
+        debug("max relative difference = %g", _max_rel_diff( c, ref, &c_meta ));
+    }
+    debug("===============================================");
+
+err_main :
+    clean_data( &ref, &c_meta );
+    clean_data( &c, &c_meta );
+    clean_data( &b, &b_meta );
+    clean_data( &a, &a_meta );
+    clean_mat_mul_opts( &mm_opt );
+    tpool_default_release();
+    perf_report();
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a rows x cols matrix of pseudo-random values
+ * \param  **out - output matrix
+ * \param  *meta - meta-data. type filled in by caller
+ * \param  rows , cols - dimensions
+ * \param  seed - random seed
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _generate_matrix( void **out, Vector_MetaData *meta, uint64_t rows, uint64_t cols, uint32_t seed )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t idx_i = 0 , items = 0 ;
+    void *payload = NULL ;
+
+    meta->no_dims = 2 ;
+    meta->dim.dim_2d.rows = rows ;
+    meta->dim.dim_2d.cols = cols ;
+
+    err = alloc_data( out, meta );
+    if( err != api_Success )
+        goto err_generate ;
+
+    payload = data_payload( *out, meta );
+    items = data_items( meta );
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        seed = (seed * 1103515245u) + 12345u ;
+        switch( meta->type )
+        {
+            case DataType_float  : ((float *)payload)[idx_i] = (float)(seed >> 8) / (float)(1u << 24) ; break ;
+            case DataType_double : ((double *)payload)[idx_i] = (double)(seed >> 8) / (double)(1u << 24) ; break ;
+            case DataType_int8   : ((int8_t *)payload)[idx_i] = (int8_t)((int32_t)((seed >> 16) & 0xff) - 128) ; break ;
+            case DataType_int16  : ((int16_t *)payload)[idx_i] = (int16_t)((int32_t)((seed >> 16) & 0x3ff) - 512) ; break ;
+            default :
+                debug("Cannot generate matrices of data-type %d", meta->type);
+                err = api_Err_Param ;
+                goto err_generate ;
+        }
+    }
+
+err_generate :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Largest element-wise difference relative to the reference value
+ */
+/*****************************************************************************/
+static double _max_rel_diff( void *c, void *ref, Vector_MetaData *meta )
+{
+    void *pc = data_payload( c, meta ) , *pr = data_payload( ref, meta );
+    uint64_t idx_i = 0 , items = data_items( meta );
+    double x = 0.0 , y = 0.0 , diff = 0.0 , max = 0.0 ;
+
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        switch( meta->type )
+        {
+            case DataType_float  : x = ((float *)pc)[idx_i] ;   y = ((float *)pr)[idx_i] ;   break ;
+            case DataType_double : x = ((double *)pc)[idx_i] ;  y = ((double *)pr)[idx_i] ;  break ;
+            default              : x = ((int32_t *)pc)[idx_i] ; y = ((int32_t *)pr)[idx_i] ; break ;
+        }
+        diff = fabs( x - y ) / ((fabs(y) > 1.0) ? fabs(y) : 1.0) ;
+        max = (diff > max) ? diff : max ;
+    }
+    return max ;
+}
@@ -0,0 +1,194 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "api_err.h"
+#include "datatype.h"
+#include "gemm.h"
+#include "mat_mul_options.h"
+#include "program_options.h"
+#include "debug.h"
+
+Option_Help g_help_strings[] =
+{
+    { .option = 'a', .option_text = "-a,--file-a.....2D input A (rows x cols). Without -a/-b matrices are generated"     },
+    { .option = 'b', .option_text = "-b,--file-b.....2D input B, rows of B == cols of A"                                 },
+    { .option = 'd', .option_text = "-d,--dtype......data-type : float, double, int8 or int16 (default float)"           },
+    { .option = 's', .option_text = "-s,--sep........Separator list for -a/-b, column then row e.g. [,\\n]"              },
+    { .option = 'm', .option_text = "-m,--rows.......rows of generated A (default 1024)"                                 },
+    { .option = 'n', .option_text = "-n,--cols.......columns of generated B (default 1024)"                              },
+    { .option = 'k', .option_text = "-k,--inner......columns of A / rows of B when generated (default 1024)"            },
+    { .option = 'M', .option_text = "-M,--mc.........rows of A per L2 block (default auto)"                              },
+    { .option = 'K', .option_text = "-K,--kc.........depth of packed panels (default auto)"                              },
+    { .option = 'N', .option_text = "-N,--nc.........columns of B per LLC block (default auto)"                          },
+    { .option = 'v', .option_text = "-v,--verify.....compare against the naive reference"                                },
+    { .option = 'h', .option_text = "-h,--help.......this help menu"                                                      },
+    { .option =  0 , .option_text = NULL                                                                                   },
+};
+
+
+struct option g_option_list[] = {
+    {.name = "file-a", .has_arg = required_argument, .flag = NULL, .val = 'a'},
+    {.name = "file-b", .has_arg = required_argument, .flag = NULL, .val = 'b'},
+    {.name = "dtype" , .has_arg = required_argument, .flag = NULL, .val = 'd'},
+    {.name = "sep"   , .has_arg = required_argument, .flag = NULL, .val = 's'},
+    {.name = "rows"  , .has_arg = required_argument, .flag = NULL, .val = 'm'},
+    {.name = "cols"  , .has_arg = required_argument, .flag = NULL, .val = 'n'},
+    {.name = "inner" , .has_arg = required_argument, .flag = NULL, .val = 'k'},
+    {.name = "mc"    , .has_arg = required_argument, .flag = NULL, .val = 'M'},
+    {.name = "kc"    , .has_arg = required_argument, .flag = NULL, .val = 'K'},
+    {.name = "nc"    , .has_arg = required_argument, .flag = NULL, .val = 'N'},
+    {.name = "verify", .has_arg = no_argument      , .flag = NULL, .val = 'v'},
+    {.name = "help"  , .has_arg = no_argument      , .flag = NULL, .val = 'h'},
+    {.name = NULL,     .has_arg = 0                , .flag = NULL, .val =  0 }
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  parse command-line options of the matrix multiply benchmark
+ *
+ * \param  argc - number of params from cmdline inclusive of program name
+ * \param  *argv[] - list of commandline options
+ * \param  *mm_opt - structure to store options provided on cmdline
+ * \return api_Success on success
+ */
+/*****************************************************************************/
+api_Err_Status parse_mat_mul_cmdline( int argc , char **argv , MatMul_Options *mm_opt )
+{
+    api_Err_Status err = api_Success ;
+    char *short_opt = NULL ;
+    int opt = 0 ;
+
+    if((argv == NULL) || (mm_opt == NULL)) {
+        debug("Invalid params argv = %p, mm_opt = %p", argv, mm_opt);
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    /* initialise with default values */
+    memset( mm_opt, 0, sizeof(MatMul_Options));
+    mm_opt->type = DataType_float ;
+    mm_opt->m = 1024 ;
+    mm_opt->n = 1024 ;
+    mm_opt->k = 1024 ;
+
+    short_opt = gen_opt_string( g_option_list );
+    if( short_opt == NULL ) {
+        debug("Could not gen short opt-string for parsing cmdline opts");
+        err = api_Err_Failure ;
+        goto err_cmdline_parse ;
+    }
+
+    optind = 1 ;
+    for( opt = getopt_long(argc, argv, short_opt, g_option_list, NULL) ;
+         opt != -1 ; opt = getopt_long(argc, argv, short_opt, g_option_list, NULL)) {
+        switch( opt )
+        {
+            case '?' :   /* intentional fall-through */
+            case 'h' :   /* intentional fall-through */
+            case ':' :
+                usage( argv[0] , g_option_list , g_help_strings);
+                err = api_Stat_Complete ;
+                goto err_cmdline_parse ;
+            case 'a' :
+            case 'b' :
+                if( opt == 'a' )
+                    mm_opt->file_a = strdup(optarg);
+                else
+                    mm_opt->file_b = strdup(optarg);
+                if(((opt == 'a') ? mm_opt->file_a : mm_opt->file_b) == NULL ) {
+                    debug("Could not alloc memory to hold file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 's' :
+                mm_opt->sep = strdup(optarg);
+                if( mm_opt->sep == NULL ) {
+                    debug("Could not alloc memory to hold separators [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'd' :
+                err = map_data_types( &(mm_opt->type), optarg);
+                if( err != api_Success ) {
+                    debug("Error mapping cmdline data-type [%s] to known type. err = %d", optarg, err );
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'm' : mm_opt->m = strtoull( optarg, NULL, 0 ); break ;
+            case 'n' : mm_opt->n = strtoull( optarg, NULL, 0 ); break ;
+            case 'k' : mm_opt->k = strtoull( optarg, NULL, 0 ); break ;
+            case 'M' : mm_opt->blocking.mc = (uint32_t)strtoul( optarg, NULL, 0 ); break ;
+            case 'K' : mm_opt->blocking.kc = (uint32_t)strtoul( optarg, NULL, 0 ); break ;
+            case 'N' : mm_opt->blocking.nc = (uint32_t)strtoul( optarg, NULL, 0 ); break ;
+            case 'v' : mm_opt->verify = 1 ; break ;
+        }
+    }
+
+    if((mm_opt->file_a != NULL) != (mm_opt->file_b != NULL)) {
+        debug("Either both or none of -a and -b have to be given");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+    if((mm_opt->file_a != NULL) && (mm_opt->sep == NULL)) {
+        debug("Separator list (-s) required with input files");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+
+err_cmdline_parse :
+    clean_mat_mul_opts( mm_opt ) ;
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Clean up data structure holding command-line params
+ * \param  *mm_opt - options structure
+ * \return void
+ */
+/*****************************************************************************/
+void clean_mat_mul_opts( MatMul_Options *mm_opt )
+{
+    if( mm_opt == NULL )
+        return ;
+
+    mm_opt->file_a = (mm_opt->file_a != NULL) ? free(mm_opt->file_a), NULL : NULL ;
+    mm_opt->file_b = (mm_opt->file_b != NULL) ? free(mm_opt->file_b), NULL : NULL ;
+    mm_opt->sep = (mm_opt->sep != NULL) ? free(mm_opt->sep), NULL : NULL ;
+    return ;
+}
@@ -0,0 +1,758 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "time_eval.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "bandwidth.h"
+#include "expr_eval.h"
+#include "hetero_sched.h"
+#include "hash.h"
+#include "transpose.h"
+#include "stencil.h"
+#include "gemm.h"
+#include "roofline_options.h"
+
+
+/*!
+ * Peak floating point rate : chains of dependent multiply-adds over
+ * PEAK_ACC_BYTES of independent accumulators, enough to keep both FMA
+ * pipes of a core busy with 512-bit (8 registers) or 256-bit vectors
+ */
+#define PEAK_ACC_BYTES   512
+#define PEAK_ITERS       (1ULL << 25)
+
+#define ROOF_ONE         0       /* ceilings of one thread */
+#define ROOF_POOL        1       /* ceilings of the whole pool */
+
+
+/* one timed run of a kernel */
+typedef api_Err_Status (*Trial_Fn)( void * );
+
+typedef struct __Roof_Ceilings__
+{
+    double bw[Bw_MaxKernels][2] ;    /* GB/s : one thread, whole pool */
+    double peak[2] ;                 /* GFLOP/s : one thread, whole pool */
+    double mem ;                     /* memory roof : best STREAM kernel of the pool */
+} Roof_Ceilings ;
+
+typedef struct __Peak_Ctx__
+{
+    Data_Type type ;
+    uint64_t iters ;
+    double sink[TPOOL_MAX_THREADS] ;
+} Peak_Ctx ;
+
+/* inputs and outputs of every kernel trial */
+typedef struct __Roof_Trial__
+{
+    void *buff[3] ;                  /* a, b and the result c */
+    Vector_MetaData meta[3] ;
+    Expr_Node *root ;
+    Hetero_Job job ;
+    uint32_t perm[PERMUTE_MAX_DIMS] ;
+    Stencil_Coeffs coeffs ;
+    Stencil_Tiling tiling ;
+    Gemm_Blocking blocking ;
+    char *path ;
+    uint8_t *sep ;
+    uint64_t digest ;
+} Roof_Trial ;
+
+/* a kernel placed on the roofline */
+typedef struct __Roof_Kernel__
+{
+    const char *name ;
+    double bytes ;                   /* compulsory memory traffic */
+    double flops ;
+    double secs ;                    /* best of the repetitions */
+} Roof_Kernel ;
+
+
+static double _peak_gflops( Thread_Pool *, Data_Type, uint32_t );
+static void _peak_task( void *, uint64_t, uint32_t );
+static api_Err_Status _time_trial( Trial_Fn, void *, uint32_t, double * );
+static api_Err_Status _generate( void **, Vector_MetaData *, Data_Type, uint32_t, uint64_t, uint64_t, uint64_t );
+static api_Err_Status _write_sample( char *, uint64_t );
+static void _trial_release( Roof_Trial * );
+static void _append( Roof_Kernel *, uint32_t *, const char *, double, double );
+static api_Err_Status _add_trial( void * );
+static api_Err_Status _sum_trial( void * );
+static api_Err_Status _parse_trial( void * );
+static api_Err_Status _hash_trial( void * );
+static api_Err_Status _transpose_trial( void * );
+static api_Err_Status _stencil_trial( void * );
+static api_Err_Status _gemm_trial( void * );
+static api_Err_Status _roof_elementwise( Roofline_Options *, Roof_Kernel *, uint32_t * );
+static api_Err_Status _roof_parse( Roofline_Options *, Roof_Kernel *, uint32_t * );
+static api_Err_Status _roof_transpose( Roofline_Options *, Roof_Kernel *, uint32_t * );
+static api_Err_Status _roof_stencil( Roofline_Options *, Roof_Kernel *, uint32_t * );
+static api_Err_Status _roof_gemm( Roofline_Options *, Roof_Kernel *, uint32_t * );
+static void _report( Roof_Ceilings *, Roof_Kernel *, uint32_t, Data_Type );
+
+
+#define ROOF_MAX_KERNELS  8
+
+int main( int argc , char *argv[] )
+{
+    api_Err_Status err = api_Success ;
+    Roofline_Options rl_opt ;
+    Roof_Ceilings roof ;
+    Roof_Kernel kern[ROOF_MAX_KERNELS] ;
+    Thread_Pool *one = NULL ;
+    uint32_t no_kern = 0 , idx_i = 0 ;
+
+    memset( &roof, 0, sizeof(roof));
+    memset( kern, 0, sizeof(kern));
+
+    err = parse_roofline_cmdline( argc, argv, &rl_opt );
+    if( err != api_Success ) {
+        debug("Error parsing cmdline options. err=%d", err );
+        goto err_main ;
+    }
+
+    err = tpool_create( &one, 1 );
+    if( err != api_Success ) {
+        debug("Could not create a single thread pool. err = %d", err);
+        goto err_main ;
+    }
+
+    debug("===============================================");
+    debug("Measuring ceilings : %u pool threads, %llu bytes per STREAM array",
+                tpool_size(tpool_default()), (unsigned long long)rl_opt.bytes);
+    for( idx_i=0 ; idx_i < Bw_MaxKernels ; idx_i++ ) {
+        roof.bw[idx_i][ROOF_ONE] = bw_stream((Bw_Kernel)idx_i, one, rl_opt.bytes, rl_opt.reps );
+        roof.bw[idx_i][ROOF_POOL] = bw_stream((Bw_Kernel)idx_i, NULL, rl_opt.bytes, rl_opt.reps );
+        roof.mem = (roof.bw[idx_i][ROOF_POOL] > roof.mem) ? roof.bw[idx_i][ROOF_POOL] : roof.mem ;
+    }
+    roof.peak[ROOF_ONE] = _peak_gflops( one, rl_opt.type, rl_opt.reps );
+    roof.peak[ROOF_POOL] = _peak_gflops( tpool_default(), rl_opt.type, rl_opt.reps );
+    if((roof.mem <= 0.0) || (roof.peak[ROOF_POOL] <= 0.0)) {
+        debug("Could not measure the ceilings of this host");
+        err = api_Err_Failure ;
+        goto err_main ;
+    }
+
+    debug("Placing kernels on the roofline : %s", datatype_name( rl_opt.type ));
+    if( rl_opt.what & (ROOF_ADD | ROOF_SUM | ROOF_HASH))
+        err = _roof_elementwise( &rl_opt, kern, &no_kern );
+    if((err == api_Success) && (rl_opt.what & ROOF_PARSE))
+        err = _roof_parse( &rl_opt, kern, &no_kern );
+    if((err == api_Success) && (rl_opt.what & ROOF_TRANSPOSE))
+        err = _roof_transpose( &rl_opt, kern, &no_kern );
+    if((err == api_Success) && (rl_opt.what & ROOF_STENCIL))
+        err = _roof_stencil( &rl_opt, kern, &no_kern );
+    if((err == api_Success) && (rl_opt.what & ROOF_GEMM))
+        err = _roof_gemm( &rl_opt, kern, &no_kern );
+    if( err != api_Success ) {
+        debug("Kernel measurement failed. err = %d", err);
+        goto err_main ;
+    }
+
+    _report( &roof, kern, no_kern, rl_opt.type );
+    debug("===============================================");
+
+err_main :
+    tpool_destroy( &one );
+    clean_roofline_opts( &rl_opt );
+    tpool_default_release();
+    return err ;
+}
+
+
+
+/*!
+ * Multiply-add chains per data-type
+ */
+#define PEAK_KERNEL( T, SUFFIX )                                                 \
+SIMD_FMA_KERNEL                                                                  \
+static void _peak_##SUFFIX( T *acc, uint64_t iters )                             \
+{                                                                                \
+    T x[PEAK_ACC_BYTES / sizeof(T)] ;                                            \
+    const T m = (T)0.9999999 , c = (T)1e-7 ;                                     \
+    uint64_t idx_i = 0 ;                                                         \
+    uint32_t idx_j = 0 ;                                                         \
+                                                                                 \
+    for( idx_j=0 ; idx_j < PEAK_ACC_BYTES / sizeof(T) ; idx_j++ )                \
+        x[idx_j] = acc[idx_j] ;                                                  \
+    for( idx_i=0 ; idx_i < iters ; idx_i++ )                                     \
+        for( idx_j=0 ; idx_j < PEAK_ACC_BYTES / sizeof(T) ; idx_j++ )            \
+            x[idx_j] = x[idx_j] * m + c ;                                        \
+    for( idx_j=0 ; idx_j < PEAK_ACC_BYTES / sizeof(T) ; idx_j++ )                \
+        acc[idx_j] = x[idx_j] ;                                                  \
+    return ;                                                                     \
+}
+
+PEAK_KERNEL( float , float  )
+PEAK_KERNEL( double, double )
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Pool task : one chain of PEAK_ITERS multiply-adds per accumulator
+ */
+/*****************************************************************************/
+static void _peak_task( void *arg, uint64_t task, uint32_t thread_idx )
+{
+    Peak_Ctx *ctx = (Peak_Ctx *)arg ;
+    float acc_f[PEAK_ACC_BYTES / sizeof(float)] ;
+    double acc_d[PEAK_ACC_BYTES / sizeof(double)] ;
+
+    if( ctx->type == DataType_float ) {
+        memset( acc_f, 0, sizeof(acc_f));
+        _peak_float( acc_f, ctx->iters );
+        ctx->sink[thread_idx] += acc_f[task % (PEAK_ACC_BYTES / sizeof(float))] ;
+    } else {
+        memset( acc_d, 0, sizeof(acc_d));
+        _peak_double( acc_d, ctx->iters );
+        ctx->sink[thread_idx] += acc_d[task % (PEAK_ACC_BYTES / sizeof(double))] ;
+    }
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Peak multiply-add rate of a pool, one task per thread
+ * \param  *pool - threads to run on
+ * \param  type - float or double
+ * \param  reps - timed repetitions, best is kept
+ * \return GFLOP/s (a multiply-add counts as 2). 0 on failure
+ */
+/*****************************************************************************/
+static double _peak_gflops( Thread_Pool *pool, Data_Type type, uint32_t reps )
+{
+    Peak_Ctx ctx ;
+    struct timespec begin , end ;
+    uint32_t no_threads = tpool_size( pool ) , idx_r = 0 ;
+    double flops = 0.0 , secs = 0.0 , best = 0.0 ;
+
+    memset( &ctx, 0, sizeof(ctx));
+    ctx.type = type ;
+    ctx.iters = PEAK_ITERS ;
+    flops = 2.0 * (double)no_threads * (double)ctx.iters * (PEAK_ACC_BYTES / sizeof_datatype( type )) ;
+    for( idx_r=0 ; idx_r < reps ; idx_r++ ) {
+        start_wall_timer( begin );
+        if( tpool_parallel_for( pool, no_threads, _peak_task, &ctx ) != api_Success )
+            return 0.0 ;
+        stop_wall_timer( end );
+        secs = wall_time_taken( begin, end );
+        if((secs > 0.0) && (flops / secs / 1e9 > best))
+            best = flops / secs / 1e9 ;
+    }
+    return best ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Best wall time of reps runs of a trial, after one warm-up run
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _time_trial( Trial_Fn fn, void *ctx, uint32_t reps, double *best )
+{
+    api_Err_Status err = api_Success ;
+    struct timespec begin , end ;
+    uint32_t idx_i = 0 ;
+    double secs = 0.0 ;
+
+    *best = 0.0 ;
+    err = fn( ctx );
+    for( idx_i=0 ; (idx_i < reps) && (err == api_Success) ; idx_i++ ) {
+        start_wall_timer( begin );
+        err = fn( ctx );
+        stop_wall_timer( end );
+        secs = wall_time_taken( begin, end );
+        *best = ((idx_i == 0) || (secs < *best)) ? secs : *best ;
+    }
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Allocate a 1D/2D/3D float or double array of values in [0,1)
+ * \param  **buff - output array
+ * \param  *meta - output meta-data
+ * \param  type - float or double
+ * \param  no_dims - 1, 2 or 3
+ * \param  d0 , d1 , d2 - extents, outermost first
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _generate( void **buff, Vector_MetaData *meta, Data_Type type, uint32_t no_dims,
+                                 uint64_t d0, uint64_t d1, uint64_t d2 )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t idx_i = 0 , items = 0 ;
+    uint32_t seed = 11 ;
+    void *p = NULL ;
+
+    memset( meta, 0, sizeof(Vector_MetaData));
+    meta->type = type ;
+    meta->no_dims = no_dims ;
+    if( no_dims == 1 ) {
+        meta->dim.dim_1d.items = d0 ;
+    } else if( no_dims == 2 ) {
+        meta->dim.dim_2d.rows = d0 ;
+        meta->dim.dim_2d.cols = d1 ;
+    } else {
+        meta->dim.dim_3d.dim_z = d0 ;
+        meta->dim.dim_3d.dim_y = d1 ;
+        meta->dim.dim_3d.dim_x = d2 ;
+    }
+
+    err = alloc_data( buff, meta );
+    if( err != api_Success )
+        return err ;
+
+    p = data_payload( *buff, meta );
+    items = data_items( meta );
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        seed = (seed * 1103515245u) + 12345u ;
+        if( type == DataType_float )
+            ((float *)p)[idx_i] = (float)((seed >> 8) & 0xffff) / 65536.0f ;
+        else
+            ((double *)p)[idx_i] = (double)((seed >> 8) & 0xffff) / 65536.0 ;
+    }
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Write a parse sample : one value per line, in a new file
+ * \param  *path - mkstemp() template, replaced by the name of the file
+ * \param  values - number of values
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _write_sample( char *path, uint64_t values )
+{
+    api_Err_Status err = api_Success ;
+    FILE *fp = NULL ;
+    uint64_t idx_i = 0 ;
+    uint32_t seed = 13 ;
+    int fd = -1 ;
+
+    fd = mkstemp( path );
+    if((fd < 0) || ((fp = fdopen( fd, "w" )) == NULL)) {
+        debug("Could not create parse sample [%s]", path);
+        if( fd >= 0 )
+            close( fd );
+        return api_Err_File ;
+    }
+    for( idx_i=0 ; idx_i < values ; idx_i++ ) {
+        seed = (seed * 1103515245u) + 12345u ;
+        fprintf( fp, "%.6f\n", (double)(seed >> 8) / 1024.0 );
+    }
+    if( fclose( fp ) != 0 ) {
+        debug("Could not write parse sample [%s]", path);
+        err = api_Err_File ;
+    }
+    return err ;
+}
+
+
+
+/*!
+ * Trials
+ */
+static api_Err_Status _add_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+
+    return expr_evaluate( t->root, t->buff[2], &t->meta[2] );
+}
+
+static api_Err_Status _sum_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+
+    return hetero_run( &t->job, NULL, HETERO_USE_CPU, HETERO_MIN_CHUNK, NULL );
+}
+
+static api_Err_Status _parse_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+    api_Err_Status err = api_Success ;
+
+    clean_data( &t->buff[2], &t->meta[2] );
+    memset( &t->meta[2], 0, sizeof(t->meta[2]));
+    t->meta[2].type = t->meta[0].type ;
+    err = read_data( &t->buff[2], &t->meta[2], t->path, t->sep );
+    return err ;
+}
+
+static api_Err_Status _hash_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+
+    t->digest ^= hash_bytes( data_payload( t->buff[0], &t->meta[0] ), data_items( &t->meta[0] ) * sizeof_datatype( t->meta[0].type ));
+    return api_Success ;
+}
+
+static api_Err_Status _transpose_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+
+    return permute_axes( t->buff[2], &t->meta[2], t->buff[0], &t->meta[0], t->perm );
+}
+
+static api_Err_Status _stencil_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+
+    return stencil_3d( t->buff[2], t->buff[0], &t->meta[0], &t->coeffs, 1, &t->tiling );
+}
+
+static api_Err_Status _gemm_trial( void *arg )
+{
+    Roof_Trial *t = (Roof_Trial *)arg ;
+
+    return gemm( t->buff[2], &t->meta[2], t->buff[0], &t->meta[0], t->buff[1], &t->meta[1], &t->blocking );
+}
+
+static void _trial_release( Roof_Trial *t )
+{
+    expr_free( &t->root );
+    clean_data( &t->buff[0], &t->meta[0] );
+    clean_data( &t->buff[1], &t->meta[1] );
+    clean_data( &t->buff[2], &t->meta[2] );
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Complete the next entry of the kernel table, whose time has been
+ *         measured into it
+ * \return void
+ */
+/*****************************************************************************/
+static void _append( Roof_Kernel *kern, uint32_t *no_kern, const char *name, double bytes, double flops )
+{
+    kern[*no_kern].name = name ;
+    kern[*no_kern].bytes = bytes ;
+    kern[*no_kern].flops = flops ;
+    (*no_kern)++ ;
+    return ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Element-wise add (expression engine), sum reduction (pool side
+ *         of the work splitter) and hash of one array
+ * \param  *rl_opt - options
+ * \param  *kern - kernel table, results are appended
+ * \param  *no_kern - entries in the table
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _roof_elementwise( Roofline_Options *rl_opt, Roof_Kernel *kern, uint32_t *no_kern )
+{
+    api_Err_Status err = api_Success ;
+    Roof_Trial t ;
+    uint64_t items = rl_opt->bytes / sizeof_datatype( rl_opt->type ) ;
+    double bytes = (double)items * sizeof_datatype( rl_opt->type ) ;
+
+    memset( &t, 0, sizeof(t));
+    err = _generate( &t.buff[0], &t.meta[0], rl_opt->type, 1, items, 0, 0 );
+    if( err == api_Success )
+        err = _generate( &t.buff[1], &t.meta[1], rl_opt->type, 1, items, 0, 0 );
+    if( err == api_Success ) {
+        t.meta[2] = t.meta[0] ;
+        err = alloc_data( &t.buff[2], &t.meta[2] );
+    }
+    if( err != api_Success ) {
+        debug("Could not allocate element-wise arrays of %llu items. err = %d", (unsigned long long)items, err);
+        goto err_roof_elementwise ;
+    }
+
+    if( rl_opt->what & ROOF_ADD ) {
+        err = expr_parse( &t.root, "a + b", t.buff, t.meta, 2 );
+        if( err == api_Success )
+            err = _time_trial( _add_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+        if( err != api_Success )
+            goto err_roof_elementwise ;
+        _append( kern, no_kern, "add", 3.0 * bytes, (double)items );
+    }
+
+    if( rl_opt->what & ROOF_SUM ) {
+        t.job.op = Hetero_Sum ;
+        t.job.type = rl_opt->type ;
+        t.job.items = items ;
+        t.job.a = data_payload( t.buff[0], &t.meta[0] );
+        err = _time_trial( _sum_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+        if( err != api_Success )
+            goto err_roof_elementwise ;
+        _append( kern, no_kern, "sum", bytes, (double)items );
+    }
+
+    if( rl_opt->what & ROOF_HASH ) {
+        err = _time_trial( _hash_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+        if( err != api_Success )
+            goto err_roof_elementwise ;
+        _append( kern, no_kern, "hash", bytes, 0.0 );
+    }
+
+err_roof_elementwise :
+    _trial_release( &t );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  read_data() of a text file : file in, values out
+ * \param  *rl_opt - options
+ * \param  *kern - kernel table, results are appended
+ * \param  *no_kern - entries in the table
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _roof_parse( Roofline_Options *rl_opt, Roof_Kernel *kern, uint32_t *no_kern )
+{
+    api_Err_Status err = api_Success ;
+    Roof_Trial t ;
+    struct stat sb ;
+    char sample[] = "/tmp/roofline_sample_XXXXXX" , idx[sizeof(sample) + 4] ;
+    char *env = NULL , *was = NULL ;
+    uint8_t sep[] = "\n" ;
+
+    memset( &t, 0, sizeof(t));
+    t.meta[0].type = rl_opt->type ;
+    if( rl_opt->file != NULL ) {
+        t.path = (char *)rl_opt->file ;
+        t.sep = rl_opt->sep ;
+    } else {
+        err = _write_sample( sample, rl_opt->values );
+        if( err != api_Success )
+            goto err_roof_parse ;
+        t.path = sample ;
+        t.sep = sep ;
+    }
+    if( stat( t.path, &sb ) != 0 ) {
+        debug("Could not stat parse sample [%s]", t.path);
+        err = api_Err_File ;
+        goto err_roof_parse ;
+    }
+
+    /* time the parse alone : no row index built and saved next to the file */
+    env = getenv("HETERO_ROW_INDEX");
+    was = (env != NULL) ? strdup( env ) : NULL ;
+    setenv( "HETERO_ROW_INDEX", "0", 1 );
+    err = _time_trial( _parse_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+    if( was != NULL )
+        setenv( "HETERO_ROW_INDEX", was, 1 );
+    else
+        unsetenv( "HETERO_ROW_INDEX" );
+    was = (was != NULL) ? free(was), NULL : NULL ;
+    if( err != api_Success )
+        goto err_roof_parse ;
+    _append( kern, no_kern, "parse", (double)sb.st_size + (double)data_items( &t.meta[2] ) * sizeof_datatype( rl_opt->type ), 0.0 );
+
+err_roof_parse :
+    if( rl_opt->file == NULL ) {
+        snprintf( idx, sizeof(idx), "%s.idx", sample );
+        unlink( idx );
+        unlink( sample );
+    }
+    _trial_release( &t );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Out-of-place transpose of a square matrix
+ * \param  *rl_opt - options
+ * \param  *kern - kernel table, results are appended
+ * \param  *no_kern - entries in the table
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _roof_transpose( Roofline_Options *rl_opt, Roof_Kernel *kern, uint32_t *no_kern )
+{
+    api_Err_Status err = api_Success ;
+    Roof_Trial t ;
+    uint64_t side = 1 , items = rl_opt->bytes / sizeof_datatype( rl_opt->type ) ;
+
+    memset( &t, 0, sizeof(t));
+    while((side + 1) * (side + 1) <= items )
+        side++ ;
+    t.perm[0] = 1 ;
+    t.perm[1] = 0 ;
+    err = _generate( &t.buff[0], &t.meta[0], rl_opt->type, 2, side, side, 0 );
+    if( err == api_Success )
+        err = permute_result_meta( &t.meta[2], &t.meta[0], t.perm );
+    if( err == api_Success )
+        err = alloc_data( &t.buff[2], &t.meta[2] );
+    if( err == api_Success )
+        err = _time_trial( _transpose_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+    if( err == api_Success )
+        _append( kern, no_kern, "transpose", 2.0 * side * side * sizeof_datatype( rl_opt->type ), 0.0 );
+
+    _trial_release( &t );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  One sweep of the 7 and 27-point stencils. A cell update is 8 and
+ *         30 flops (see _STENCIL_7PT / _STENCIL_27PT)
+ * \param  *rl_opt - options
+ * \param  *kern - kernel table, results are appended
+ * \param  *no_kern - entries in the table
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _roof_stencil( Roofline_Options *rl_opt, Roof_Kernel *kern, uint32_t *no_kern )
+{
+    api_Err_Status err = api_Success ;
+    Roof_Trial t ;
+    uint64_t n = rl_opt->edge ;
+    double cells = (double)(n - 2) * (n - 2) * (n - 2) , bytes = 2.0 * n * n * n * sizeof_datatype( rl_opt->type ) ;
+
+    memset( &t, 0, sizeof(t));
+    err = _generate( &t.buff[0], &t.meta[0], rl_opt->type, 3, n, n, n );
+    if( err == api_Success ) {
+        t.meta[2] = t.meta[0] ;
+        err = alloc_data( &t.buff[2], &t.meta[2] );
+    }
+    if( err != api_Success )
+        goto err_roof_stencil ;
+
+    stencil_default_coeffs( &t.coeffs, Stencil_7pt );
+    err = _time_trial( _stencil_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+    if( err != api_Success )
+        goto err_roof_stencil ;
+    _append( kern, no_kern, "stencil7", bytes, 8.0 * cells );
+
+    stencil_default_coeffs( &t.coeffs, Stencil_27pt );
+    err = _time_trial( _stencil_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+    if( err != api_Success )
+        goto err_roof_stencil ;
+    _append( kern, no_kern, "stencil27", bytes, 30.0 * cells );
+
+err_roof_stencil :
+    _trial_release( &t );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Square matrix multiply. Traffic counted is reading A and B and
+ *         writing C once
+ * \param  *rl_opt - options
+ * \param  *kern - kernel table, results are appended
+ * \param  *no_kern - entries in the table
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _roof_gemm( Roofline_Options *rl_opt, Roof_Kernel *kern, uint32_t *no_kern )
+{
+    api_Err_Status err = api_Success ;
+    Roof_Trial t ;
+    double n = (double)rl_opt->mat ;
+
+    memset( &t, 0, sizeof(t));
+    err = _generate( &t.buff[0], &t.meta[0], rl_opt->type, 2, rl_opt->mat, rl_opt->mat, 0 );
+    if( err == api_Success )
+        err = _generate( &t.buff[1], &t.meta[1], rl_opt->type, 2, rl_opt->mat, rl_opt->mat, 0 );
+    if( err == api_Success )
+        err = gemm_result_meta( &t.meta[2], &t.meta[0], &t.meta[1] );
+    if( err == api_Success )
+        err = alloc_data( &t.buff[2], &t.meta[2] );
+    if( err == api_Success )
+        err = _time_trial( _gemm_trial, &t, rl_opt->reps, &kern[*no_kern].secs );
+    if( err == api_Success )
+        _append( kern, no_kern, "gemm", 3.0 * n * n * sizeof_datatype( rl_opt->type ), 2.0 * n * n * n );
+
+    _trial_release( &t );
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Print the ceilings, then every kernel against its roof : the time
+ *         it would take at the memory roof or at peak rate, whichever is
+ *         longer, as a fraction of the time it took
+ * \return void
+ */
+/*****************************************************************************/
+static void _report( Roof_Ceilings *roof, Roof_Kernel *kern, uint32_t no_kern, Data_Type type )
+{
+    uint32_t idx_i = 0 ;
+    double t_mem = 0.0 , t_fp = 0.0 ;
+
+    debug("-----------------------------------------------");
+    debug("Ceilings                 1 thread  %3u threads", tpool_size(tpool_default()));
+    for( idx_i=0 ; idx_i < Bw_MaxKernels ; idx_i++ )
+        debug("  stream %-6s  GB/s   %9.2f  %9.2f", bw_kernel_name((Bw_Kernel)idx_i),
+                    roof->bw[idx_i][ROOF_ONE], roof->bw[idx_i][ROOF_POOL]);
+    debug("  peak %-6s GFLOP/s   %9.2f  %9.2f", datatype_name( type ), roof->peak[ROOF_ONE], roof->peak[ROOF_POOL]);
+    debug("Memory roof %.2f GB/s, compute roof %.2f GFLOP/s, ridge at %.2f flop/byte",
+                roof->mem, roof->peak[ROOF_POOL], roof->peak[ROOF_POOL] / roof->mem);
+    debug("-----------------------------------------------");
+    debug("%-10s %9s %9s %8s %9s %8s %8s %-7s %7s", "kernel", "GB", "GFLOP", "flop/B", "secs",
+                "GB/s", "GFLOP/s", "bound", "of roof");
+    for( idx_i=0 ; idx_i < no_kern ; idx_i++ ) {
+        t_mem = kern[idx_i].bytes / (roof->mem * 1e9) ;
+        t_fp = kern[idx_i].flops / (roof->peak[ROOF_POOL] * 1e9) ;
+        debug("%-10s %9.3f %9.3f %8.3f %9.5f %8.2f %8.2f %-7s %6.1f%%", kern[idx_i].name,
+                    kern[idx_i].bytes / 1e9, kern[idx_i].flops / 1e9, kern[idx_i].flops / kern[idx_i].bytes,
+                    kern[idx_i].secs, kern[idx_i].bytes / kern[idx_i].secs / 1e9, kern[idx_i].flops / kern[idx_i].secs / 1e9,
+                    (t_mem >= t_fp) ? "memory" : "compute",
+                    100.0 * ((t_mem >= t_fp) ? t_mem : t_fp) / kern[idx_i].secs);
+    }
+    return ;
+}
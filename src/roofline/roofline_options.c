@@ -0,0 +1,222 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "api_err.h"
+#include "datatype.h"
+#include "mem_track.h"
+#include "roofline_options.h"
+#include "program_options.h"
+#include "debug.h"
+
+Option_Help g_help_strings[] =
+{
+    { .option = 'k', .option_text = "-k,--kernels....comma list of add,sum,parse,hash,transpose,stencil,gemm (default all)"  },
+    { .option = 'd', .option_text = "-d,--dtype......data-type : float or double (default double)"                          },
+    { .option = 'b', .option_text = "-b,--bytes......size of each STREAM and element-wise array, K/M/G suffix (default 256M)"},
+    { .option = 'f', .option_text = "-f,--file.......sample input of the parse kernel. Without it one is generated (see -v)" },
+    { .option = 's', .option_text = "-s,--sep........Separator list of the sample file"                                     },
+    { .option = 'v', .option_text = "-v,--values.....values in the generated parse sample, K/M suffix (default 4M)"          },
+    { .option = 'n', .option_text = "-n,--edge.......edge of the stencil volume (default 256)"                               },
+    { .option = 'm', .option_text = "-m,--mat........size of the square matrices (default 1024)"                             },
+    { .option = 'r', .option_text = "-r,--reps.......timed repetitions, best is kept (default 5)"                           },
+    { .option = 'h', .option_text = "-h,--help.......this help menu"                                                         },
+    { .option =  0 , .option_text = NULL                                                                                      },
+};
+
+
+struct option g_option_list[] = {
+    {.name = "kernels", .has_arg = required_argument, .flag = NULL, .val = 'k'},
+    {.name = "dtype"  , .has_arg = required_argument, .flag = NULL, .val = 'd'},
+    {.name = "bytes"  , .has_arg = required_argument, .flag = NULL, .val = 'b'},
+    {.name = "file"   , .has_arg = required_argument, .flag = NULL, .val = 'f'},
+    {.name = "sep"    , .has_arg = required_argument, .flag = NULL, .val = 's'},
+    {.name = "values" , .has_arg = required_argument, .flag = NULL, .val = 'v'},
+    {.name = "edge"   , .has_arg = required_argument, .flag = NULL, .val = 'n'},
+    {.name = "mat"    , .has_arg = required_argument, .flag = NULL, .val = 'm'},
+    {.name = "reps"   , .has_arg = required_argument, .flag = NULL, .val = 'r'},
+    {.name = "help"   , .has_arg = no_argument      , .flag = NULL, .val = 'h'},
+    {.name = NULL,      .has_arg = 0                , .flag = NULL, .val =  0 }
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  parse command-line options of the roofline benchmark
+ *
+ * \param  argc - number of params from cmdline inclusive of program name
+ * \param  *argv[] - list of commandline options
+ * \param  *rl_opt - structure to store options provided on cmdline
+ * \return api_Success on success
+ */
+/*****************************************************************************/
+api_Err_Status parse_roofline_cmdline( int argc , char **argv , Roofline_Options *rl_opt )
+{
+    api_Err_Status err = api_Success ;
+    char *short_opt = NULL , *kernels = NULL , *tok = NULL , *save = NULL ;
+    int opt = 0 ;
+
+    if((argv == NULL) || (rl_opt == NULL)) {
+        debug("Invalid params argv = %p, rl_opt = %p", argv, rl_opt);
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    /* initialise with default values */
+    memset( rl_opt, 0, sizeof(Roofline_Options));
+    rl_opt->type = DataType_double ;
+    rl_opt->bytes = 256ULL * 1024 * 1024 ;
+    rl_opt->values = 4 * 1024 * 1024 ;
+    rl_opt->edge = 256 ;
+    rl_opt->mat = 1024 ;
+    rl_opt->reps = 5 ;
+
+    short_opt = gen_opt_string( g_option_list );
+    if( short_opt == NULL ) {
+        debug("Could not gen short opt-string for parsing cmdline opts");
+        err = api_Err_Failure ;
+        goto err_cmdline_parse ;
+    }
+
+    optind = 1 ;
+    for( opt = getopt_long(argc, argv, short_opt, g_option_list, NULL) ;
+         opt != -1 ; opt = getopt_long(argc, argv, short_opt, g_option_list, NULL)) {
+        switch( opt )
+        {
+            case '?' :   /* intentional fall-through */
+            case 'h' :   /* intentional fall-through */
+            case ':' :
+                usage( argv[0] , g_option_list , g_help_strings);
+                err = api_Stat_Complete ;
+                goto err_cmdline_parse ;
+            case 'k' :
+                kernels = strdup(optarg);
+                if( kernels == NULL ) {
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                for( tok = strtok_r( kernels, ",", &save ) ; tok != NULL ; tok = strtok_r( NULL, ",", &save )) {
+                    if( strcmp( tok, "add" ) == 0 )            rl_opt->what |= ROOF_ADD ;
+                    else if( strcmp( tok, "sum" ) == 0 )       rl_opt->what |= ROOF_SUM ;
+                    else if( strcmp( tok, "parse" ) == 0 )     rl_opt->what |= ROOF_PARSE ;
+                    else if( strcmp( tok, "hash" ) == 0 )      rl_opt->what |= ROOF_HASH ;
+                    else if( strcmp( tok, "transpose" ) == 0 ) rl_opt->what |= ROOF_TRANSPOSE ;
+                    else if( strcmp( tok, "stencil" ) == 0 )   rl_opt->what |= ROOF_STENCIL ;
+                    else if( strcmp( tok, "gemm" ) == 0 )      rl_opt->what |= ROOF_GEMM ;
+                    else {
+                        debug("Unknown kernel [%s]", tok);
+                        err = api_Err_Param ;
+                        goto err_cmdline_parse ;
+                    }
+                }
+                kernels = (kernels != NULL) ? free(kernels), NULL : NULL ;
+                break ;
+            case 'f' :
+                rl_opt->file = strdup(optarg);
+                if( rl_opt->file == NULL ) {
+                    debug("Could not alloc memory to hold file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 's' :
+                rl_opt->sep = strdup(optarg);
+                if( rl_opt->sep == NULL ) {
+                    debug("Could not alloc memory to hold separators [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'd' :
+                err = map_data_types( &(rl_opt->type), optarg);
+                if( err != api_Success ) {
+                    debug("Error mapping cmdline data-type [%s] to known type. err = %d", optarg, err );
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'b' :   /* intentional fall-through */
+            case 'v' :
+                /* counts take the same binary suffixes as sizes : 4M = 4 * 2^20 */
+                err = mem_size_parse( optarg, (opt == 'b') ? &rl_opt->bytes : &rl_opt->values );
+                if( err != api_Success ) {
+                    debug("Invalid %s [%s]", (opt == 'b') ? "array size" : "value count", optarg);
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'n' : rl_opt->edge = strtoull( optarg, NULL, 0 ); break ;
+            case 'm' : rl_opt->mat = strtoull( optarg, NULL, 0 ); break ;
+            case 'r' : rl_opt->reps = (uint32_t)strtoul( optarg, NULL, 0 ); break ;
+        }
+    }
+
+    rl_opt->what = (rl_opt->what != 0) ? rl_opt->what : ROOF_ALL ;
+    if((rl_opt->type != DataType_float) && (rl_opt->type != DataType_double)) {
+        debug("The roofline is measured for float or double");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+    if((rl_opt->file != NULL) && (rl_opt->sep == NULL)) {
+        debug("The parse sample (-f) needs its separators (-s)");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+    if((rl_opt->bytes < 4096) || (rl_opt->values == 0) || (rl_opt->edge < 3) || (rl_opt->mat == 0)) {
+        debug("Array size, sample values, volume edge or matrix size too small");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+    rl_opt->reps = (rl_opt->reps != 0) ? rl_opt->reps : 1 ;
+
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+
+err_cmdline_parse :
+    kernels = (kernels != NULL) ? free(kernels), NULL : NULL ;
+    clean_roofline_opts( rl_opt ) ;
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Clean up data structure holding command-line params
+ * \param  *rl_opt - options structure
+ * \return void
+ */
+/*****************************************************************************/
+void clean_roofline_opts( Roofline_Options *rl_opt )
+{
+    if( rl_opt == NULL )
+        return ;
+
+    rl_opt->file = (rl_opt->file != NULL) ? free(rl_opt->file), NULL : NULL ;
+    rl_opt->sep = (rl_opt->sep != NULL) ? free(rl_opt->sep), NULL : NULL ;
+    return ;
+}
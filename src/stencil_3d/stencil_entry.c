@@ -0,0 +1,203 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "api_err.h"
+#include "debug.h"
+#include "datatype.h"
+#include "time_eval.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "bandwidth.h"
+#include "stencil.h"
+#include "stencil_options.h"
+
+static api_Err_Status _generate_volume( void **, Vector_MetaData *, uint64_t );
+static double _max_abs_diff( void *, void *, Vector_MetaData * );
+
+int main( int argc , char *argv[] )
+{
+    api_Err_Status err = api_Success ;
+    Stencil_Options s_opt ;
+    Stencil_Coeffs coeffs ;
+    Vector_MetaData meta ;
+    void *in = NULL , *out = NULL , *ref = NULL ;
+    struct timespec begin , end ;
+    double secs = 0.0 , ref_secs = 0.0 , bytes = 0.0 , mem_bw = 0.0 ;
+    uint32_t passes = 0 ;
+
+    memset( &s_opt, 0, sizeof(s_opt));
+    memset( &meta, 0, sizeof(meta));
+
+    err = parse_stencil_cmdline( argc, argv, &s_opt );
+    if( err != api_Success ) {
+        debug("Error parsing cmdline options. err=%d", err );
+        goto err_main ;
+    }
+
+    meta.type = s_opt.type ;
+    if( s_opt.file != NULL )
+        err = read_data( &in, &meta, s_opt.file, s_opt.sep );
+    else
+        err = _generate_volume( &in, &meta, s_opt.size );
+    if( err != api_Success ) {
+        debug("Could not obtain input volume. err = %d", err);
+        goto err_main ;
+    }
+
+    err = alloc_data( &out, &meta );
+    if( err != api_Success ) {
+        debug("Could not allocate output volume. err = %d", err);
+        goto err_main ;
+    }
+
+    stencil_default_coeffs( &coeffs, (s_opt.points == 27) ? Stencil_27pt : Stencil_7pt );
+
+    debug("===============================================");
+    debug("%u-point stencil, %u sweeps on %llu x %llu x %llu (z,y,x) %s volume",
+                s_opt.points, s_opt.iterations, (unsigned long long)meta.dim.dim_3d.dim_z,
+                (unsigned long long)meta.dim.dim_3d.dim_y, (unsigned long long)meta.dim.dim_3d.dim_x,
+                (meta.type == DataType_float) ? "float" : "double");
+    debug("threads : %u", tpool_size(tpool_default()));
+
+    start_wall_timer( begin );
+    err = stencil_3d( out, in, &meta, &coeffs, s_opt.iterations, &s_opt.tiling );
+    stop_wall_timer( end );
+    if( err != api_Success ) {
+        debug("Blocked stencil failed. err = %d", err);
+        goto err_main ;
+    }
+    secs = wall_time_taken( begin, end );
+
+    /* every sweep of an un-blocked stencil streams the volume in and out */
+    bytes = 2.0 * (double)data_items(&meta) * sizeof_datatype(meta.type) ;
+    passes = (s_opt.tiling.time_block != 0) ? (s_opt.iterations + s_opt.tiling.time_block - 1) / s_opt.tiling.time_block : 0 ;
+    mem_bw = bw_stream_copy( 0, 0 );
+
+    debug("blocked   : %.4f s, %.3f Gcell/s, effective %.2f GB/s",
+                secs, (double)data_items(&meta) * s_opt.iterations / secs / 1e9,
+                bytes * s_opt.iterations / secs / 1e9 );
+    if( passes != 0 )
+        debug("            %u memory passes, %.2f GB/s of DRAM traffic", passes, bytes * passes / secs / 1e9 );
+    debug("stream copy bandwidth : %.2f GB/s -> effective rate is %.2fx memory bandwidth",
+                mem_bw, (mem_bw > 0.0) ? (bytes * s_opt.iterations / secs / 1e9) / mem_bw : 0.0 );
+
+    if( s_opt.verify ) {
+        err = alloc_data( &ref, &meta );
+        if( err != api_Success ) {
+            debug("Could not allocate reference volume. err = %d", err);
+            goto err_main ;
+        }
+        start_wall_timer( begin );
+        err = stencil_3d_reference( ref, in, &meta, &coeffs, s_opt.iterations );
+        stop_wall_timer( end );
+        if( err != api_Success ) {
+            debug("Reference stencil failed. err = %d", err);
+            goto err_main ;
+        }
+        ref_secs = wall_time_taken( begin, end );
+        debug("reference : %.4f s, effective %.2f GB/s, speed-up %.2fx",
+                    ref_secs, bytes * s_opt.iterations / ref_secs / 1e9, ref_secs / secs );
+        debug("max |blocked - reference| = %g", _max_abs_diff( out, ref, &meta ));
+    }
+    debug("===============================================");
+
+err_main :
+    clean_data( &ref, &meta );
+    clean_data( &out, &meta );
+    clean_data( &in, &meta );
+    clean_stencil_opts( &s_opt );
+    tpool_default_release();
+    perf_report();
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Create a size^3 volume filled with pseudo-random values
+ * \param  **out - output volume
+ * \param  *meta - meta-data. type filled in by caller
+ * \param  size - edge of the cube
+ * \return returns api_Success on success.
+ */
+/*****************************************************************************/
+static api_Err_Status _generate_volume( void **out, Vector_MetaData *meta, uint64_t size )
+{
+    api_Err_Status err = api_Success ;
+    uint64_t idx_i = 0 , items = 0 ;
+    uint32_t seed = 12345 ;
+    void *payload = NULL ;
+
+    meta->no_dims = 3 ;
+    meta->dim.dim_3d.dim_x = size ;
+    meta->dim.dim_3d.dim_y = size ;
+    meta->dim.dim_3d.dim_z = size ;
+
+    err = alloc_data( out, meta );
+    if( err != api_Success )
+        goto err_generate ;
+
+    payload = data_payload( *out, meta );
+    items = data_items( meta );
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        seed = (seed * 1103515245u) + 12345u ;
+        if( meta->type == DataType_float )
+            ((float *)payload)[idx_i] = (float)(seed >> 8) / (float)(1u << 24) ;
+        else
+            ((double *)payload)[idx_i] = (double)(seed >> 8) / (double)(1u << 24) ;
+    }
+
+err_generate :
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Largest absolute element-wise difference of two volumes
+ */
+/*****************************************************************************/
+static double _max_abs_diff( void *a, void *b, Vector_MetaData *meta )
+{
+    void *pa = data_payload( a, meta ) , *pb = data_payload( b, meta );
+    uint64_t idx_i = 0 , items = data_items( meta );
+    double diff = 0.0 , max = 0.0 ;
+
+    for( idx_i=0 ; idx_i < items ; idx_i++ ) {
+        if( meta->type == DataType_float )
+            diff = fabs((double)((float *)pa)[idx_i] - (double)((float *)pb)[idx_i]);
+        else
+            diff = fabs(((double *)pa)[idx_i] - ((double *)pb)[idx_i]);
+        max = (diff > max) ? diff : max ;
+    }
+    return max ;
+}
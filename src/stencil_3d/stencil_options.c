@@ -0,0 +1,201 @@
+/*!
+ * This program is a set of examples about how to use openCL for use in
+ * heterogeneous programs
+ * Copyright (C) 2017  Dejice Jacob
+ *
+ *
+ * This file is part of hetero-examples.
+ *
+ * hetero-examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * hetero-examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with hetero-examples.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include "api_err.h"
+#include "datatype.h"
+#include "stencil.h"
+#include "stencil_options.h"
+#include "program_options.h"
+#include "debug.h"
+
+Option_Help g_help_strings[] =
+{
+    { .option = 'f', .option_text = "-f,--file.......3D input volume. Without it a cube is generated (see -n)"            },
+    { .option = 'd', .option_text = "-d,--dtype......data-type : float or double (default float)"                           },
+    { .option = 's', .option_text = "-s,--sep........Separator list for -f, x,y,z order e.g. [,|\\n]"                       },
+    { .option = 'n', .option_text = "-n,--size.......edge of generated cube (default 256)"                                   },
+    { .option = 'p', .option_text = "-p,--points.....stencil : 7 or 27 (default 7)"                                          },
+    { .option = 'i', .option_text = "-i,--iter.......number of sweeps (default 8)"                                           },
+    { .option = 't', .option_text = "-t,--tblock.....sweeps fused per pass - temporal blocking (default auto)"              },
+    { .option = 'x', .option_text = "-x,--tile-x.....tile width along x (default auto)"                                     },
+    { .option = 'y', .option_text = "-y,--tile-y.....tile height along y (default auto)"                                    },
+    { .option = 'v', .option_text = "-v,--verify.....compare against the un-blocked reference"                              },
+    { .option = 'h', .option_text = "-h,--help.......this help menu"                                                         },
+    { .option =  0 , .option_text = NULL                                                                                      },
+};
+
+
+struct option g_option_list[] = {
+    {.name = "file"  , .has_arg = required_argument, .flag = NULL, .val = 'f'},
+    {.name = "dtype" , .has_arg = required_argument, .flag = NULL, .val = 'd'},
+    {.name = "sep"   , .has_arg = required_argument, .flag = NULL, .val = 's'},
+    {.name = "size"  , .has_arg = required_argument, .flag = NULL, .val = 'n'},
+    {.name = "points", .has_arg = required_argument, .flag = NULL, .val = 'p'},
+    {.name = "iter"  , .has_arg = required_argument, .flag = NULL, .val = 'i'},
+    {.name = "tblock", .has_arg = required_argument, .flag = NULL, .val = 't'},
+    {.name = "tile-x", .has_arg = required_argument, .flag = NULL, .val = 'x'},
+    {.name = "tile-y", .has_arg = required_argument, .flag = NULL, .val = 'y'},
+    {.name = "verify", .has_arg = no_argument      , .flag = NULL, .val = 'v'},
+    {.name = "help"  , .has_arg = no_argument      , .flag = NULL, .val = 'h'},
+    {.name = NULL,     .has_arg = 0                , .flag = NULL, .val =  0 }
+};
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  parse command-line options of the stencil benchmark
+ *
+ * \param  argc - number of params from cmdline inclusive of program name
+ * \param  *argv[] - list of commandline options
+ * \param  *s_opt - structure to store options provided on cmdline
+ * \return api_Success on success
+ */
+/*****************************************************************************/
+api_Err_Status parse_stencil_cmdline( int argc , char **argv , Stencil_Options *s_opt )
+{
+    api_Err_Status err = api_Success ;
+    char *short_opt = NULL ;
+    int opt = 0 ;
+
+    if((argv == NULL) || (s_opt == NULL)) {
+        debug("Invalid params argv = %p, s_opt = %p", argv, s_opt);
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    /* initialise with default values */
+    memset( s_opt, 0, sizeof(Stencil_Options));
+    s_opt->type = DataType_float ;
+    s_opt->size = 256 ;
+    s_opt->points = 7 ;
+    s_opt->iterations = 8 ;
+
+    short_opt = gen_opt_string( g_option_list );
+    if( short_opt == NULL ) {
+        debug("Could not gen short opt-string for parsing cmdline opts");
+        err = api_Err_Failure ;
+        goto err_cmdline_parse ;
+    }
+
+    optind = 1 ;
+    for( opt = getopt_long(argc, argv, short_opt, g_option_list, NULL) ;
+         opt != -1 ; opt = getopt_long(argc, argv, short_opt, g_option_list, NULL)) {
+        switch( opt )
+        {
+            case '?' :   /* intentional fall-through */
+            case 'h' :   /* intentional fall-through */
+            case ':' :
+                usage( argv[0] , g_option_list , g_help_strings);
+                err = api_Stat_Complete ;
+                goto err_cmdline_parse ;
+            case 'f' :
+                s_opt->file = strdup(optarg);
+                if( s_opt->file == NULL ) {
+                    debug("Could not alloc memory to hold file-name [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 's' :
+                s_opt->sep = strdup(optarg);
+                if( s_opt->sep == NULL ) {
+                    debug("Could not alloc memory to hold separators [%s]", optarg);
+                    err = api_Err_Memory ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'd' :
+                err = map_data_types( &(s_opt->type), optarg);
+                if( err != api_Success ) {
+                    debug("Error mapping cmdline data-type [%s] to known type. err = %d", optarg, err );
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'n' :
+                s_opt->size = strtoull( optarg, NULL, 0 );
+                break ;
+            case 'p' :
+                s_opt->points = (uint32_t)strtoul( optarg, NULL, 0 );
+                if((s_opt->points != 7) && (s_opt->points != 27)) {
+                    debug("Only 7 and 27 point stencils supported. Got [%s]", optarg);
+                    err = api_Err_Param ;
+                    goto err_cmdline_parse ;
+                }
+                break ;
+            case 'i' :
+                s_opt->iterations = (uint32_t)strtoul( optarg, NULL, 0 );
+                break ;
+            case 't' :
+                s_opt->tiling.time_block = (uint32_t)strtoul( optarg, NULL, 0 );
+                break ;
+            case 'x' :
+                s_opt->tiling.tile_x = (uint32_t)strtoul( optarg, NULL, 0 );
+                break ;
+            case 'y' :
+                s_opt->tiling.tile_y = (uint32_t)strtoul( optarg, NULL, 0 );
+                break ;
+            case 'v' :
+                s_opt->verify = 1 ;
+                break ;
+        }
+    }
+
+    if((s_opt->file != NULL) && (s_opt->sep == NULL)) {
+        debug("Separator list (-s) required with an input file");
+        err = api_Err_Param ;
+        goto err_cmdline_parse ;
+    }
+
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+
+err_cmdline_parse :
+    clean_stencil_opts( s_opt ) ;
+    short_opt = (short_opt != NULL) ? free(short_opt), NULL : NULL ;
+    return err ;
+}
+
+
+
+/*****************************************************************************/
+/*!
+ * \brief  Clean up data structure holding command-line params
+ * \param  *s_opt - options structure
+ * \return void
+ */
+/*****************************************************************************/
+void clean_stencil_opts( Stencil_Options *s_opt )
+{
+    if( s_opt == NULL )
+        return ;
+
+    s_opt->file = (s_opt->file != NULL) ? free(s_opt->file), NULL : NULL ;
+    s_opt->sep = (s_opt->sep != NULL) ? free(s_opt->sep), NULL : NULL ;
+    return ;
+}